@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+# Replays requests against running valhalla_service instances and reports their latency percentiles.
+# Start one service with httpd.service.pipeline false and one with it true (on different ports) and
+# pass both to see how much the in process pipeline saves over the proxy topology.
+
+import argparse
+import json
+import time
+import urllib.error
+import urllib.request
+from concurrent.futures import ThreadPoolExecutor
+
+
+def load_requests(file_name):
+    # one request per line, either {"action": "route", "request": {...}} or a bare route request
+    requests = []
+    with open(file_name) as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            request = json.loads(line)
+            if 'action' in request and 'request' in request:
+                requests.append((request['action'], json.dumps(request['request']).encode()))
+            else:
+                requests.append(('route', json.dumps(request).encode()))
+    return requests
+
+
+def timed_request(url, action, body):
+    request = urllib.request.Request(
+        url.rstrip('/') + '/' + action, data=body, headers={'Content-Type': 'application/json'}
+    )
+    start = time.perf_counter()
+    try:
+        with urllib.request.urlopen(request) as response:
+            response.read()
+            ok = True
+    except urllib.error.HTTPError as e:
+        e.read()
+        ok = e.code < 500
+    return time.perf_counter() - start, ok
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return float('nan')
+    index = min(len(sorted_values) - 1, int(round(p / 100.0 * (len(sorted_values) - 1))))
+    return sorted_values[index]
+
+
+def measure(url, requests, rounds, concurrency, warmup):
+    jobs = [r for _ in range(rounds) for r in requests]
+    with ThreadPoolExecutor(max_workers=concurrency) as pool:
+        # let the tile caches fill up before measuring
+        list(pool.map(lambda r: timed_request(url, *r), requests[:warmup]))
+        results = list(pool.map(lambda r: timed_request(url, *r), jobs))
+    latencies = sorted(r[0] * 1000.0 for r in results)
+    failures = sum(1 for r in results if not r[1])
+    return {
+        'requests': len(results),
+        'failures': failures,
+        'p50': percentile(latencies, 50),
+        'p99': percentile(latencies, 99),
+    }
+
+
+def report(name, stats):
+    print(
+        f"{name}: {stats['requests']} requests, {stats['failures']} failures, "
+        f"p50 {stats['p50']:.2f} ms, p99 {stats['p99']:.2f} ms"
+    )
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compares the latency of valhalla_service topologies')
+    parser.add_argument('requests', help='File with one json request per line')
+    parser.add_argument('--proxy-url', help='Service running the proxy topology, e.g. http://localhost:8002')
+    parser.add_argument('--pipeline-url', help='Service running the in process pipeline, e.g. http://localhost:8003')
+    parser.add_argument('-r', '--rounds', type=int, default=10, help='How many times to send every request')
+    parser.add_argument('-c', '--concurrency', type=int, default=1, help='Requests in flight at once')
+    parser.add_argument('-w', '--warmup', type=int, default=100, help='Requests to send before measuring')
+    args = parser.parse_args()
+
+    if not args.proxy_url and not args.pipeline_url:
+        parser.error('Pass at least one of --proxy-url and --pipeline-url')
+
+    requests = load_requests(args.requests)
+    results = {}
+    for name, url in (('proxy', args.proxy_url), ('pipeline', args.pipeline_url)):
+        if url:
+            results[name] = measure(url, requests, args.rounds, args.concurrency, args.warmup)
+            report(name, results[name])
+
+    if len(results) == 2:
+        for p in ('p50', 'p99'):
+            saved = results['proxy'][p] - results['pipeline'][p]
+            print(f"{p} saved by the pipeline: {saved:.2f} ms ({100.0 * saved / results['proxy'][p]:.1f}%)")
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,146 @@
+#include "baldr/graphoverlay.h"
+#include "baldr/tilehierarchy.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr char kOverlayMagic[8] = {'V', 'H', 'O', 'V', 'R', 'L', 'A', 'Y'};
+constexpr uint32_t kOverlayVersion = 2;
+
+template <typename T> void write_value(std::ofstream& file, const T& value) {
+  file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T> T read_value(std::ifstream& file) {
+  T value;
+  if (!file.read(reinterpret_cast<char*>(&value), sizeof(T))) {
+    throw std::runtime_error("Unexpected end of overlay file");
+  }
+  return value;
+}
+
+void write_ids(std::ofstream& file, const std::vector<valhalla::baldr::GraphId>& ids) {
+  for (const auto& id : ids) {
+    write_value<uint64_t>(file, id.value);
+  }
+}
+
+std::vector<valhalla::baldr::GraphId> read_ids(std::ifstream& file, const uint32_t count) {
+  std::vector<valhalla::baldr::GraphId> ids;
+  ids.reserve(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    ids.emplace_back(read_value<uint64_t>(file));
+  }
+  return ids;
+}
+
+uint32_t find_index(const std::vector<valhalla::baldr::GraphId>& ids,
+                    const valhalla::baldr::GraphId& id) {
+  auto found = std::lower_bound(ids.begin(), ids.end(), id);
+  return found != ids.end() && *found == id ? static_cast<uint32_t>(found - ids.begin())
+                                            : valhalla::baldr::GraphOverlay::kInvalidIndex;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+GraphOverlay::GraphOverlay(std::vector<Cell>&& cells) : cells_(std::move(cells)) {
+  std::sort(cells_.begin(), cells_.end(),
+            [](const Cell& a, const Cell& b) { return a.tile_id < b.tile_id; });
+  const auto cell_level = TileHierarchy::levels().front().level;
+  auto on_cell_level = [cell_level](const GraphId& id) { return id.level() == cell_level; };
+  for (uint32_t i = 0; i < cells_.size(); ++i) {
+    auto& cell = cells_[i];
+    if (!on_cell_level(cell.tile_id) ||
+        !std::all_of(cell.entries.begin(), cell.entries.end(), on_cell_level) ||
+        !std::all_of(cell.exits.begin(), cell.exits.end(), on_cell_level)) {
+      throw std::invalid_argument("Overlay cell " + std::to_string(cell.tile_id) +
+                                  " is not on the highway level");
+    }
+    std::sort(cell.entries.begin(), cell.entries.end());
+    std::sort(cell.exits.begin(), cell.exits.end());
+    cell_indices_.emplace(cell.tile_id.value, i);
+  }
+}
+
+GraphOverlay GraphOverlay::Read(const std::string& file_name) {
+  std::ifstream file(file_name, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("Could not open overlay file " + file_name);
+  }
+
+  char magic[sizeof(kOverlayMagic)];
+  if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, kOverlayMagic, sizeof(magic)) != 0) {
+    throw std::runtime_error(file_name + " is not an overlay file");
+  }
+  auto version = read_value<uint32_t>(file);
+  if (version != kOverlayVersion) {
+    throw std::runtime_error("Unsupported overlay version " + std::to_string(version) + " in " +
+                             file_name);
+  }
+
+  std::vector<Cell> cells(read_value<uint32_t>(file));
+  for (auto& cell : cells) {
+    cell.tile_id = GraphId(read_value<uint64_t>(file));
+    auto entry_count = read_value<uint32_t>(file);
+    auto exit_count = read_value<uint32_t>(file);
+    cell.entries = read_ids(file, entry_count);
+    cell.exits = read_ids(file, exit_count);
+    cell.restricted = read_value<uint8_t>(file) != 0;
+  }
+  return GraphOverlay(std::move(cells));
+}
+
+void GraphOverlay::Write(const std::string& file_name) const {
+  std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    throw std::runtime_error("Could not open overlay file " + file_name + " for writing");
+  }
+
+  file.write(kOverlayMagic, sizeof(kOverlayMagic));
+  write_value(file, kOverlayVersion);
+  write_value(file, static_cast<uint32_t>(cells_.size()));
+  for (const auto& cell : cells_) {
+    write_value<uint64_t>(file, cell.tile_id.value);
+    write_value(file, static_cast<uint32_t>(cell.entries.size()));
+    write_value(file, static_cast<uint32_t>(cell.exits.size()));
+    write_ids(file, cell.entries);
+    write_ids(file, cell.exits);
+    write_value<uint8_t>(file, cell.restricted);
+  }
+  if (!file) {
+    throw std::runtime_error("Failed to write overlay file " + file_name);
+  }
+}
+
+GraphId GraphOverlay::cell_tile(const GraphId& id) {
+  const auto cell_level = TileHierarchy::levels().front().level;
+  if (id.level() == cell_level) {
+    return id.Tile_Base();
+  }
+  // the center of the tile is inside of exactly one cell
+  auto center = TileHierarchy::get_tiling(id.level()).Center(id.tileid());
+  return GraphId(TileHierarchy::get_tiling(cell_level).TileId(center), cell_level, 0);
+}
+
+uint32_t GraphOverlay::cell_index(const GraphId& tile_id) const {
+  auto found = cell_indices_.find(tile_id.Tile_Base().value);
+  return found == cell_indices_.end() ? kInvalidIndex : found->second;
+}
+
+uint32_t GraphOverlay::entry_index(const uint32_t cell, const GraphId& edge_id) const {
+  return find_index(cells_[cell].entries, edge_id);
+}
+
+uint32_t GraphOverlay::exit_index(const uint32_t cell, const GraphId& edge_id) const {
+  return find_index(cells_[cell].exits, edge_id);
+}
+
+} // namespace baldr
+} // namespace valhalla
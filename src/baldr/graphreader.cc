@@ -3,12 +3,15 @@
 #include "incident_singleton.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
+#include "midgard/sequence.h"
 #include "shortcut_recovery.h"
 
 #include <sys/stat.h>
 
 #include <filesystem>
+#include <map>
 #include <string>
+#include <tuple>
 #include <utility>
 
 using namespace valhalla::midgard;
@@ -18,6 +21,9 @@ namespace {
 constexpr size_t DEFAULT_MAX_CACHE_SIZE = 1073741824; // 1 gig
 constexpr size_t AVERAGE_TILE_SIZE = 2097152;         // 2 megs
 constexpr size_t AVERAGE_MM_TILE_SIZE = 1024;         // 1k
+// what a tile file mapped on its own counts against the cache, its pages belong to the page cache
+// but every one of them is a mapping of its own and there are only so many of those per process
+constexpr size_t MAPPED_TILE_SIZE = 65536; // 64k
 
 struct tile_index_entry {
   uint64_t offset;  // byte offset from the beginning of the tar
@@ -25,6 +31,21 @@ struct tile_index_entry {
   uint32_t size;    // size of the tile in bytes
 };
 
+int GetMmapAdvice(const std::string& advice) {
+  if (advice == "normal") {
+    return POSIX_MADV_NORMAL;
+  }
+#ifndef _WIN32
+  if (advice == "random") {
+    return POSIX_MADV_RANDOM;
+  }
+  if (advice == "willneed") {
+    return POSIX_MADV_WILLNEED;
+  }
+#endif
+  throw std::runtime_error("Unknown mmap_tiles_advice " + advice);
+}
+
 } // namespace
 
 namespace valhalla {
@@ -426,6 +447,137 @@ graph_tile_ptr SynchronizedTileCache::Put(const GraphId& graphid, graph_tile_ptr
   return cache_.Put(graphid, std::move(tile), size);
 }
 
+// ----------------------------------------------------------------------------
+// ConcurrentTileCache implementation
+// ----------------------------------------------------------------------------
+
+// Constructor.
+ConcurrentTileCache::ConcurrentTileCache(size_t max_size, size_t shard_count)
+    : shard_count_(1), cache_size_(0), max_cache_size_(max_size) {
+  // round up to a power of 2 so the shard can be picked by masking the hash
+  while (shard_count_ < shard_count) {
+    shard_count_ <<= 1;
+  }
+  shards_ = std::make_unique<Shard[]>(shard_count_);
+  max_shard_size_ = max_cache_size_ / shard_count_;
+}
+
+// Reserves enough cache to hold (max_cache_size / tile_size) items.
+void ConcurrentTileCache::Reserve(size_t tile_size) {
+  assert(tile_size != 0);
+  for (size_t i = 0; i < shard_count_; ++i) {
+    std::unique_lock<std::shared_mutex> lock(shards_[i].mutex);
+    shards_[i].tiles.reserve(max_shard_size_ / tile_size + 1);
+  }
+}
+
+// Checks if tile exists in the cache.
+bool ConcurrentTileCache::Contains(const GraphId& graphid) const {
+  const auto& shard = get_shard(graphid);
+  std::shared_lock<std::shared_mutex> lock(shard.mutex);
+  return shard.tiles.find(graphid) != shard.tiles.cend();
+}
+
+// Lets you know if the cache is too large.
+bool ConcurrentTileCache::OverCommitted() const {
+  return cache_size_.load(std::memory_order_relaxed) > max_cache_size_;
+}
+
+// Clears the cache.
+void ConcurrentTileCache::Clear() {
+  for (size_t i = 0; i < shard_count_; ++i) {
+    auto& shard = shards_[i];
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    cache_size_ -= shard.size;
+    shard.size = 0;
+    shard.tiles.clear();
+    shard.fifo.clear();
+  }
+}
+
+void ConcurrentTileCache::Trim() {
+  for (size_t i = 0; i < shard_count_; ++i) {
+    std::unique_lock<std::shared_mutex> lock(shards_[i].mutex);
+    TrimToFit(shards_[i], 0);
+  }
+}
+
+// Get a pointer to a graph tile object given a GraphId.
+graph_tile_ptr ConcurrentTileCache::Get(const GraphId& graphid) const {
+  const auto& shard = get_shard(graphid);
+  std::shared_lock<std::shared_mutex> lock(shard.mutex);
+  auto cached = shard.tiles.find(graphid);
+  if (cached != shard.tiles.cend()) {
+    return cached->second;
+  }
+  return nullptr;
+}
+
+void ConcurrentTileCache::TrimToFit(Shard& shard, size_t required_size) {
+  while (!shard.fifo.empty() &&
+         (shard.size > max_shard_size_ || max_shard_size_ - shard.size < required_size)) {
+    const auto& oldest = shard.fifo.front();
+    shard.size -= oldest.second;
+    cache_size_ -= oldest.second;
+    shard.tiles.erase(oldest.first);
+    shard.fifo.pop_front();
+  }
+}
+
+// Puts a copy of a tile of into the cache.
+graph_tile_ptr ConcurrentTileCache::Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) {
+  auto& shard = get_shard(graphid);
+  std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+  // another thread loaded the same tile in the meantime, everyone should share its copy
+  auto cached = shard.tiles.find(graphid);
+  if (cached != shard.tiles.end()) {
+    return cached->second;
+  }
+
+  // make room for it, a tile bigger than the whole shard only ever lives in it by itself
+  TrimToFit(shard, size);
+  shard.size += size;
+  cache_size_ += size;
+  shard.fifo.emplace_back(graphid, size);
+  return shard.tiles.emplace(graphid, std::move(tile)).first->second;
+}
+
+namespace {
+
+// Hands the process wide concurrent cache to a GraphReader without giving up its ownership
+class SharedTileCacheRef final : public TileCache {
+public:
+  explicit SharedTileCacheRef(std::shared_ptr<TileCache> cache) : cache_(std::move(cache)) {
+  }
+  void Reserve(size_t tile_size) override {
+    cache_->Reserve(tile_size);
+  }
+  bool Contains(const GraphId& graphid) const override {
+    return cache_->Contains(graphid);
+  }
+  graph_tile_ptr Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) override {
+    return cache_->Put(graphid, std::move(tile), size);
+  }
+  graph_tile_ptr Get(const GraphId& graphid) const override {
+    return cache_->Get(graphid);
+  }
+  bool OverCommitted() const override {
+    return cache_->OverCommitted();
+  }
+  void Clear() override {
+    cache_->Clear();
+  }
+  void Trim() override {
+    cache_->Trim();
+  }
+
+private:
+  const std::shared_ptr<TileCache> cache_;
+};
+
+} // namespace
+
 // Constructs tile cache.
 TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree& pt) {
   size_t max_cache_size = pt.get<size_t>("max_cache_size", DEFAULT_MAX_CACHE_SIZE);
@@ -437,6 +589,28 @@ TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree&
 
   bool use_simple_cache = pt.get<bool>("use_simple_mem_cache", false);
 
+  // one sharded cache shared by every reader in the process
+  if (pt.get<bool>("use_concurrent_mem_cache", false)) {
+#ifndef ENABLE_THREAD_SAFE_TILE_REF_COUNT
+    throw std::runtime_error(
+        "use_concurrent_mem_cache requires building with ENABLE_THREAD_SAFE_TILE_REF_COUNT");
+#endif
+    // readers of other tiles or with another cache size get a cache of their own
+    using cache_key_t = std::tuple<std::string, std::string, std::string, size_t, size_t>;
+    static std::map<cache_key_t, std::shared_ptr<TileCache>> concurrentTileCaches_;
+    static std::mutex factoryMutex;
+    auto shards =
+        pt.get<size_t>("concurrent_mem_cache_shards", ConcurrentTileCache::kDefaultShardCount);
+    cache_key_t key{pt.get<std::string>("tile_extract", ""), pt.get<std::string>("tile_dir", ""),
+                    pt.get<std::string>("tile_url", ""), max_cache_size, shards};
+    std::lock_guard<std::mutex> lock(factoryMutex);
+    auto& concurrentTileCache = concurrentTileCaches_[key];
+    if (!concurrentTileCache) {
+      concurrentTileCache = std::make_shared<ConcurrentTileCache>(max_cache_size, shards);
+    }
+    return new SharedTileCacheRef(concurrentTileCache);
+  }
+
   // wrap tile cache with thread-safe version
   if (pt.get<bool>("global_synchronized_cache", false)) {
     // Handle synchronization of cache
@@ -476,6 +650,8 @@ GraphReader::GraphReader(const boost::property_tree::ptree& pt,
                          bool traffic_readonly)
     : tile_extract_(new tile_extract_t(pt, traffic_readonly)),
       tile_dir_(tile_extract_->tiles.empty() ? pt.get<std::string>("tile_dir", "") : ""),
+      mmap_tiles_(pt.get<bool>("mmap_tiles", false)),
+      mmap_advice_(GetMmapAdvice(pt.get<std::string>("mmap_tiles_advice", "willneed"))),
       tile_getter_(std::move(tile_getter)),
       max_concurrent_users_(pt.get<size_t>("max_concurrent_reader_users", 1)),
       tile_url_(pt.get<std::string>("tile_url", "")), cache_(TileCacheFactory::createTileCache(pt)) {
@@ -491,9 +667,33 @@ GraphReader::GraphReader(const boost::property_tree::ptree& pt,
   if (!tile_url_.empty() && tile_url_.find(GraphTile::kTilePathPattern) == std::string::npos)
     throw std::runtime_error("Not found tilePath pattern in tile url");
 
+  // The shapes are cached alongside the tiles, process wide if the tiles are
+  const auto shape_cache_size = pt.get<size_t>("shape_cache_size", 0);
+  if (shape_cache_size > 0) {
+    if (pt.get<bool>("use_concurrent_mem_cache", false) ||
+        pt.get<bool>("global_synchronized_cache", false)) {
+      // readers of other tiles or with another cache size get a cache of their own
+      using cache_key_t = std::tuple<std::string, std::string, std::string, size_t>;
+      static std::map<cache_key_t, std::shared_ptr<ShapeCache>> globalShapeCaches_;
+      static std::mutex factoryMutex;
+      cache_key_t key{pt.get<std::string>("tile_extract", ""), pt.get<std::string>("tile_dir", ""),
+                      pt.get<std::string>("tile_url", ""), shape_cache_size};
+      std::lock_guard<std::mutex> lock(factoryMutex);
+      auto& globalShapeCache = globalShapeCaches_[key];
+      if (!globalShapeCache) {
+        globalShapeCache = std::make_shared<ShapeCache>(shape_cache_size);
+      }
+      shape_cache_ = globalShapeCache;
+    } else {
+      shape_cache_ = std::make_shared<ShapeCache>(shape_cache_size, 1);
+    }
+  }
+
   // Reserve cache (based on whether using individual tile files or shared,
   // mmap'd file
-  cache_->Reserve(tile_extract_->tiles.empty() ? AVERAGE_TILE_SIZE : AVERAGE_MM_TILE_SIZE);
+  cache_->Reserve(!tile_extract_->tiles.empty() ? AVERAGE_MM_TILE_SIZE
+                  : mmap_tiles_                  ? MAPPED_TILE_SIZE
+                                                 : AVERAGE_TILE_SIZE);
 
   // Initialize the incident cache singleton if we have any kind of configuration to do so. if the
   // configuration is wrong or any kind of problem occurs this throws. the call below will spawn a
@@ -547,6 +747,42 @@ private:
   const std::shared_ptr<midgard::tar> archive_;
 };
 
+// A tile file of the tile_dir mapped read only. Its pages live in the page cache, so they are shared
+// with every other reader and process mapping the same file. Tiles are written to a temporary file
+// and then renamed, so a tile being replaced on disk keeps its old contents while mapped.
+class MappedGraphMemory final : public GraphMemory {
+public:
+  MappedGraphMemory(const std::string& file_name, const size_t file_size, const int advice) {
+    memory_.map_readonly(file_name, file_size, advice);
+    data = memory_.get();
+    size = file_size;
+  }
+
+private:
+  midgard::mem_map<char> memory_;
+};
+
+// Map the uncompressed tile file if there is one, the traffic is only taken if it is
+graph_tile_ptr GraphReader::MapGraphTile(const GraphId& base,
+                                         std::unique_ptr<const GraphMemory>& traffic_memory) const {
+  std::string file_location = tile_dir_;
+  file_location += std::filesystem::path::preferred_separator;
+  file_location += GraphTile::FileSuffix(base);
+  struct stat buffer;
+  if (stat(file_location.c_str(), &buffer) != 0 || buffer.st_size <= 0) {
+    return nullptr;
+  }
+
+  std::unique_ptr<const GraphMemory> memory;
+  try {
+    memory = std::make_unique<const MappedGraphMemory>(file_location, buffer.st_size, mmap_advice_);
+  } catch (const std::exception& e) {
+    LOG_WARN("Failed to map " + file_location + ": " + e.what());
+    return nullptr;
+  }
+  return GraphTile::Create(base, std::move(memory), std::move(traffic_memory));
+}
+
 // Get a pointer to a graph tile object given a GraphId. Return nullptr
 // if the tile is not found/empty
 graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
@@ -592,13 +828,18 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
   } // Try getting it from flat file
   else {
     auto traffic_ptr = tile_extract_->traffic_tiles.find(base);
-    auto traffic_memory = traffic_ptr != tile_extract_->traffic_tiles.end()
-                              ? std::make_unique<TarballGraphMemory>(tile_extract_->traffic_archive,
-                                                                     traffic_ptr->second)
-                              : nullptr;
-
-    // Try to get it from disk and if we cant..
-    graph_tile_ptr tile = GraphTile::Create(tile_dir_, base, std::move(traffic_memory));
+    std::unique_ptr<const GraphMemory> traffic_memory =
+        traffic_ptr != tile_extract_->traffic_tiles.end()
+            ? std::make_unique<TarballGraphMemory>(tile_extract_->traffic_archive,
+                                                   traffic_ptr->second)
+            : nullptr;
+
+    // Try to map it or get it from disk and if we cant..
+    graph_tile_ptr tile = mmap_tiles_ ? MapGraphTile(base, traffic_memory) : nullptr;
+    const bool mapped = tile != nullptr;
+    if (!mapped) {
+      tile = GraphTile::Create(tile_dir_, base, std::move(traffic_memory));
+    }
     if (!tile || !tile->header()) {
       if (!tile_getter_) {
         return nullptr;
@@ -626,7 +867,7 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
     }
 
     // Keep a copy in the cache and return it
-    const size_t size = tile->header()->end_offset();
+    const size_t size = mapped ? MAPPED_TILE_SIZE : tile->header()->end_offset();
     return cache_->Put(base, std::move(tile), size);
   }
 }
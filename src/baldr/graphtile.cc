@@ -10,6 +10,8 @@
 
 #include <boost/algorithm/string.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
 #include <cstdio>
@@ -180,6 +182,11 @@ GraphTile::GraphTile(const std::string& tile_dir,
 
 GraphTile::GraphTile() = default;
 
+uint64_t GraphTile::NextInstance() {
+  static std::atomic<uint64_t> instances{0};
+  return instances.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
 void GraphTile::SaveTileToFile(const std::vector<char>& tile_data,
                                const std::filesystem::path& disk_location) {
   // At first we save tile to a temporary file and then move it
@@ -368,6 +375,11 @@ void GraphTile::Initialize(const GraphId& graphid) {
     predictedspeeds_.set_profiles(reinterpret_cast<int16_t*>(ptr2));
 
     lane_connectivity_size_ = header_->predictedspeeds_offset() - header_->lane_connectivity_offset();
+  } else if (header_->candidate_index_offset() > 0) {
+    lane_connectivity_size_ =
+        header_->candidate_index_offset() - header_->lane_connectivity_offset();
+  } else if (header_->reach_offset() > 0) {
+    lane_connectivity_size_ = header_->reach_offset() - header_->lane_connectivity_offset();
   } else {
     lane_connectivity_size_ = header_->end_offset() - header_->lane_connectivity_offset();
   }
@@ -378,6 +390,41 @@ void GraphTile::Initialize(const GraphId& graphid) {
 
   // ANY NEW EXPANSION DATA GOES HERE
 
+  // Stored reach, only used if it is all there
+  if (header_->reach_offset() > 0 &&
+      header_->reach_offset() + sizeof(StoredReachHeader) <= header_->end_offset()) {
+    const auto* reach_header =
+        reinterpret_cast<const StoredReachHeader*>(tile_ptr + header_->reach_offset());
+    const size_t reach_size = sizeof(StoredReachHeader) + reach_header->costing_count *
+                                                              header_->directededgecount() *
+                                                              sizeof(StoredReach);
+    if (reach_header->costing_count <= kMaxStoredReachCostings &&
+        header_->reach_offset() + reach_size <= header_->end_offset()) {
+      reach_header_ = reach_header;
+      reaches_ = reinterpret_cast<const StoredReach*>(reach_header + 1);
+    }
+  }
+
+  // Candidate index, only used if it is all there
+  const uint64_t candidate_index_end =
+      header_->reach_offset() > 0 ? header_->reach_offset() : header_->end_offset();
+  if (header_->candidate_index_offset() > 0 &&
+      header_->candidate_index_offset() + sizeof(CandidateIndexHeader) <= candidate_index_end) {
+    const auto* index =
+        reinterpret_cast<const CandidateIndexHeader*>(tile_ptr + header_->candidate_index_offset());
+    const uint64_t cell_count = static_cast<uint64_t>(index->columns) * index->rows;
+    const uint64_t index_size = sizeof(CandidateIndexHeader) +
+                                index->edge_count * sizeof(CandidateIndexEdge) +
+                                (cell_count + 1 + index->entry_count) * sizeof(uint32_t);
+    if (cell_count > 0 && index->cell_width > 0 && index->cell_height > 0 &&
+        header_->candidate_index_offset() + index_size <= candidate_index_end) {
+      candidate_index_ = index;
+      candidate_edges_ = reinterpret_cast<const CandidateIndexEdge*>(index + 1);
+      candidate_cells_ = reinterpret_cast<const uint32_t*>(candidate_edges_ + index->edge_count);
+      candidate_entries_ = candidate_cells_ + cell_count + 1;
+    }
+  }
+
   // Associate one stop Ids for transit tiles
   if (graphid.level() == 3) {
     AssociateOneStopIds(graphid);
@@ -600,6 +647,45 @@ AABB2<PointLL> GraphTile::BoundingBox() const {
   return tiles.TileBounds(header_->graphid().tileid());
 }
 
+bool GraphTile::GetCandidateEdges(const AABB2<PointLL>& range,
+                                  std::unordered_set<GraphId>& edges) const {
+  if (candidate_index_ == nullptr) {
+    return false;
+  }
+
+  // the cells the corners of the range are in, clamped to the tile
+  const auto bbox = BoundingBox();
+  const auto cell = [](const double coord, const double min, const float size,
+                       const uint32_t count) {
+    const auto i = static_cast<int64_t>(std::floor((coord - min) / size));
+    return static_cast<uint32_t>(std::max<int64_t>(0, std::min<int64_t>(i, count - 1)));
+  };
+  const auto mincol =
+      cell(range.minx(), bbox.minx(), candidate_index_->cell_width, candidate_index_->columns);
+  const auto maxcol =
+      cell(range.maxx(), bbox.minx(), candidate_index_->cell_width, candidate_index_->columns);
+  const auto minrow =
+      cell(range.miny(), bbox.miny(), candidate_index_->cell_height, candidate_index_->rows);
+  const auto maxrow =
+      cell(range.maxy(), bbox.miny(), candidate_index_->cell_height, candidate_index_->rows);
+
+  // the cells of a row are next to each other so their entries are as well
+  for (auto row = minrow; row <= maxrow; ++row) {
+    const auto first = row * candidate_index_->columns;
+    const auto end = std::min(candidate_cells_[first + maxcol + 1], candidate_index_->entry_count);
+    for (auto entry = candidate_cells_[first + mincol]; entry < end; ++entry) {
+      const auto edge_index = candidate_entries_[entry];
+      if (edge_index < candidate_index_->edge_count) {
+        const auto& edge = candidate_edges_[edge_index];
+        GraphId edge_id(edge.tile_base);
+        edge_id.set_id(edge.id);
+        edges.emplace(edge_id);
+      }
+    }
+  }
+  return true;
+}
+
 iterable_t<const DirectedEdge> GraphTile::GetDirectedEdges(const NodeInfo* node) const {
   if (node < nodes_ || node >= nodes_ + header_->nodecount()) {
     throw std::logic_error(
@@ -0,0 +1,101 @@
+#include "baldr/shapecache.h"
+#include "baldr/graphtile.h"
+
+#include <mutex>
+
+namespace valhalla {
+namespace baldr {
+
+DecodedShape::DecodedShape(midgard::Shape7Decoder<midgard::PointLL> encoded) {
+  while (!encoded.empty()) {
+    shape.emplace_back(encoded.pop());
+  }
+  shape.shrink_to_fit();
+
+  // accumulated in the same order as everyone who measures the shape themselves
+  lengths.reserve(shape.size());
+  double length = 0.0;
+  for (size_t i = 0; i < shape.size(); ++i) {
+    if (i > 0) {
+      length += shape[i - 1].Distance(shape[i]);
+    }
+    lengths.push_back(length);
+  }
+}
+
+ShapeCache::ShapeCache(size_t max_size, size_t shard_count) : shard_count_(1) {
+  // round up to a power of 2 so the shard can be picked by masking the hash
+  while (shard_count_ < shard_count) {
+    shard_count_ <<= 1;
+  }
+  shards_ = std::make_unique<Shard[]>(shard_count_);
+  max_shard_size_ = max_size / shard_count_;
+}
+
+uint64_t ShapeCache::key(const GraphTile* tile, const uint32_t edgeinfo_offset) {
+  return tile->id().Tile_Base().value | (static_cast<uint64_t>(edgeinfo_offset) << 25);
+}
+
+decoded_shape_ptr ShapeCache::Get(const GraphTile* tile, const uint32_t edgeinfo_offset) const {
+  const auto k = key(tile, edgeinfo_offset);
+  const auto& shard = get_shard(k);
+  std::shared_lock<std::shared_mutex> lock(shard.mutex);
+  auto cached = shard.shapes.find(k);
+  if (cached != shard.shapes.cend() && cached->second.tile_instance == tile->instance()) {
+    return cached->second.shape;
+  }
+  return nullptr;
+}
+
+decoded_shape_ptr
+ShapeCache::Put(const GraphTile* tile, const uint32_t edgeinfo_offset, decoded_shape_ptr shape) {
+  const auto k = key(tile, edgeinfo_offset);
+  const auto size = shape->MemoryUsage();
+  auto& shard = get_shard(k);
+  std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+  // another thread decoded the same shape in the meantime, everyone should share its copy. if it
+  // was decoded from an older copy of the tile it is replaced in place
+  auto cached = shard.shapes.find(k);
+  if (cached != shard.shapes.end()) {
+    if (cached->second.tile_instance == tile->instance()) {
+      return cached->second.shape;
+    }
+    shard.size = shard.size - cached->second.size + size;
+    cached->second = {tile->instance(), std::move(shape), size};
+    return cached->second.shape;
+  }
+
+  // make room for it, a shape bigger than the whole shard only ever lives in it by itself
+  while (!shard.fifo.empty() && shard.size + size > max_shard_size_) {
+    auto oldest = shard.shapes.find(shard.fifo.front());
+    shard.size -= oldest->second.size;
+    shard.shapes.erase(oldest);
+    shard.fifo.pop_front();
+  }
+  shard.size += size;
+  shard.fifo.push_back(k);
+  return shard.shapes.emplace(k, Entry{tile->instance(), std::move(shape), size}).first->second.shape;
+}
+
+void ShapeCache::Clear() {
+  for (size_t i = 0; i < shard_count_; ++i) {
+    auto& shard = shards_[i];
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.size = 0;
+    shard.shapes.clear();
+    shard.fifo.clear();
+  }
+}
+
+size_t ShapeCache::Size() const {
+  size_t size = 0;
+  for (size_t i = 0; i < shard_count_; ++i) {
+    std::shared_lock<std::shared_mutex> lock(shards_[i].mutex);
+    size += shards_[i].size;
+  }
+  return size;
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -81,6 +81,9 @@ PYBIND11_MODULE(_valhalla, m) {
       .def(
           "centroid", [](vt::actor_t& self, std::string& req) { return self.centroid(req); },
           "Returns routes from all the input locations to the minimum cost meeting point of those paths.")
+      .def(
+          "batch_route", [](vt::actor_t& self, std::string& req) { return self.batch_route(req); },
+          "Calculates a route from every source to the target at the same index.")
       .def(
           "status", [](vt::actor_t& self, std::string& req) { return self.status(req); },
           "Returns nothing or optionally details about Valhalla's configuration.");
@@ -115,6 +115,10 @@ class Actor(_Actor):
     def centroid(self, req: Union[str, dict]) -> Union[str, dict]:
         return super().centroid(req)
 
+    @dict_or_str
+    def batch_route(self, req: Union[str, dict]) -> Union[str, dict]:
+        return super().batch_route(req)
+
     @dict_or_str
     def status(self, req: Union[str, dict] = "") -> Union[str, dict]:
         return super().status(req)
@@ -97,7 +97,7 @@ void loki_worker_t::route(Api& request) {
   std::unordered_map<size_t, size_t> color_counts;
   try {
     auto locations = PathLocation::fromPBF(options.locations(), true);
-    const auto projections = loki::Search(locations, *reader, costing);
+    const auto projections = loki::Search(locations, *reader, costing, stored_reach_costing);
     for (size_t i = 0; i < locations.size(); ++i) {
       const auto& correlated = projections.at(locations[i]);
       PathLocation::toPBF(correlated, options.mutable_locations(i), *reader);
@@ -131,5 +131,96 @@ void loki_worker_t::route(Api& request) {
     throw valhalla_exception_t{170};
   };
 }
+
+void loki_worker_t::init_batch_route(Api& request) {
+  // we require sources and targets which are routed pairwise
+  auto& options = *request.mutable_options();
+  parse_locations(options.mutable_sources(), request, valhalla_exception_t{112});
+  parse_locations(options.mutable_targets(), request, valhalla_exception_t{112});
+
+  // sanitize
+  if (options.sources_size() < 1) {
+    throw valhalla_exception_t{121};
+  };
+  if (options.targets_size() < 1) {
+    throw valhalla_exception_t{122};
+  };
+  if (options.sources_size() != options.targets_size()) {
+    throw valhalla_exception_t{129};
+  }
+
+  // no locations!
+  options.clear_locations();
+
+  // need costing
+  parse_costing(request);
+}
+
+void loki_worker_t::batch_route(Api& request) {
+  // time this whole method and save that statistic
+  auto _ = measure_scope_time(request);
+
+  init_batch_route(request);
+  auto& options = *request.mutable_options();
+  const auto& costing_name = Costing_Enum_Name(options.costing_type());
+  if (costing_name == "multimodal" || costing_name == "transit") {
+    throw valhalla_exception_t{140, Options_Action_Enum_Name(options.action())};
+  };
+
+  // the batch as a whole has its own limits and every pair has the limits of a regular route
+  // the batch limits always exist, the worker falls back to defaults when they are not configured
+  check_locations(options.sources_size() + options.targets_size(),
+                  max_locations.at("batch_route"));
+  const auto pair_limit = max_distance.find(costing_name);
+  if (pair_limit == max_distance.end()) {
+    throw valhalla_exception_t{125, "'" + costing_name + "'"};
+  }
+  auto max_pair_distance = pair_limit->second;
+  auto max_batch_distance = max_distance.at("batch_route");
+  float batch_distance = 0.f;
+  for (int i = 0; i < options.sources_size(); ++i) {
+    auto pair_distance = to_ll(options.sources(i)).Distance(to_ll(options.targets(i)));
+    if (pair_distance > max_pair_distance) {
+      throw valhalla_exception_t{154, std::to_string(static_cast<size_t>(max_pair_distance)) +
+                                          " meters"};
+    }
+    batch_distance += pair_distance;
+    if (batch_distance > max_batch_distance) {
+      throw valhalla_exception_t{154, std::to_string(static_cast<size_t>(max_batch_distance)) +
+                                          " meters"};
+    }
+  }
+
+  // check distance for hierarchy pruning
+  check_hierarchy_distance(request);
+
+  // correlate all the sources and targets to the underlying graph in one go, like for a single
+  // route we dont care about the inbound reach of origins or the outbound reach of destinations
+  auto sources_targets = PathLocation::fromPBF(options.sources());
+  for (auto& source : sources_targets) {
+    source.min_inbound_reach_ = 0;
+  }
+  for (auto& target : PathLocation::fromPBF(options.targets())) {
+    target.min_outbound_reach_ = 0;
+    sources_targets.emplace_back(std::move(target));
+  }
+
+  // a location that cant be found only fails its own pair, which thor reports in its place
+  try {
+    const auto searched = loki::Search(sources_targets, *reader, costing, stored_reach_costing);
+    for (size_t i = 0; i < sources_targets.size(); ++i) {
+      auto found = searched.find(sources_targets[i]);
+      if (found == searched.cend()) {
+        continue;
+      }
+      PathLocation::toPBF(found->second,
+                          i < static_cast<size_t>(options.sources_size())
+                              ? options.mutable_sources(i)
+                              : options.mutable_targets(i -
+                                                        static_cast<size_t>(options.sources_size())),
+                          *reader);
+    }
+  } catch (const std::exception&) { throw valhalla_exception_t{171}; }
+}
 } // namespace loki
 } // namespace valhalla
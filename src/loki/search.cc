@@ -1,23 +1,47 @@
 #include "loki/search.h"
 #include "baldr/graphconstants.h"
+#include "baldr/rapidjson_utils.h"
 #include "baldr/tilehierarchy.h"
-#include "loki/reach.h"
 #include "midgard/distanceapproximator.h"
 #include "midgard/linesegment2.h"
 #include "midgard/util.h"
+#include "proto_conversions.h"
+#include "thor/reach.h"
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <iterator>
+#include <string>
 #include <unordered_set>
 
 using namespace valhalla::midgard;
 using namespace valhalla::baldr;
 using namespace valhalla::sif;
 using namespace valhalla::loki;
+using namespace valhalla::thor;
 
 namespace {
 
+// The options that matter to the reach, the name and the hierarchy limits dont. Protobuf maps (like
+// the hierarchy limits) are only serialized in a stable order on request
+std::string serialize_reach_options(valhalla::Costing costing) {
+  costing.clear_name();
+  costing.clear_filter_closures();
+  costing.mutable_options()->clear_hierarchy_limits();
+  std::string bytes;
+  {
+    google::protobuf::io::StringOutputStream stream(&bytes);
+    google::protobuf::io::CodedOutputStream coded(&stream);
+    coded.SetSerializationDeterministic(true);
+    costing.SerializeToCodedStream(&coded);
+  }
+  return bytes;
+}
+
 template <typename T> inline T square(T v) {
   return v * v;
 }
@@ -259,6 +283,11 @@ struct bin_handler_t {
   std::vector<candidate_t> bin_candidates;
   std::unordered_set<uint64_t> correlated_edges;
   Reach reach_finder;
+  // the costing whose stored reach can be used instead of expanding it
+  uint8_t stored_reach;
+
+  // the decoded shape of the edge being handled
+  std::vector<PointLL> shape_points;
 
   // keep track of edges whose reachability we've already computed
   // TODO: dont use pointers as keys, its safe for now but fancy caching one day could be bad
@@ -266,8 +295,11 @@ struct bin_handler_t {
 
   bin_handler_t(const std::vector<valhalla::baldr::Location>& locations,
                 valhalla::baldr::GraphReader& reader,
-                const std::shared_ptr<DynamicCost>& costing)
-      : reader(reader), costing(costing) {
+                const std::shared_ptr<DynamicCost>& costing,
+                const uint8_t stored_reach)
+      : reader(reader), costing(costing),
+        // live traffic can close roads which the stored reach knows nothing about
+        stored_reach(reader.HasLiveTraffic() ? kNoStoredReach : stored_reach) {
     // get the unique set of input locations and the max reachability of them all
     std::unordered_set<Location> uniq_locations(locations.begin(), locations.end());
     pps.reserve(uniq_locations.size());
@@ -455,14 +487,32 @@ struct bin_handler_t {
     }
   }
 
+  // the reach stored in the tile is the same as the one we would expand, if it goes far enough
+  bool find_stored_reach(const graph_tile_ptr& tile, const GraphId edge_id, directed_reach& reach) {
+    StoredReach stored;
+    if (stored_reach == kNoStoredReach || !tile ||
+        tile->GetStoredReach(edge_id.id(), stored_reach, stored) < max_reach_limit) {
+      return false;
+    }
+    reach.outbound = std::min<uint32_t>(stored.outbound, max_reach_limit);
+    reach.inbound = std::min<uint32_t>(stored.inbound, max_reach_limit);
+    directed_reaches[tile->directededge(edge_id)] = reach;
+    return true;
+  }
+
   directed_reach get_reach(const GraphId edge_id, const DirectedEdge* edge) {
     // if its in cache return it
     auto itr = directed_reaches.find(edge);
     if (itr != directed_reaches.cend())
       return itr->second;
 
+    directed_reach reach;
+    if (stored_reach != kNoStoredReach &&
+        find_stored_reach(reader.GetGraphTile(edge_id), edge_id, reach))
+      return reach;
+
     // notice we do both directions here because in the end we use this reach for all input locations
-    auto reach = reach_finder(edge, edge_id, max_reach_limit, reader, costing, kInbound | kOutbound);
+    reach = reach_finder(edge, edge_id, max_reach_limit, reader, costing, kInbound | kOutbound);
     directed_reaches[edge] = reach;
     return reach;
   }
@@ -495,8 +545,12 @@ struct bin_handler_t {
     if (!check)
       return {max_reach_limit, max_reach_limit};
 
+    directed_reach reach;
+    if (find_stored_reach(tile, edge_id, reach))
+      return reach;
+
     // notice we do both directions here because in the end we use this reach for all input locations
-    auto reach = reach_finder(edge, edge_id, max_reach_limit, reader, costing, kInbound | kOutbound);
+    reach = reach_finder(edge, edge_id, max_reach_limit, reader, costing, kInbound | kOutbound);
     directed_reaches[edge] = reach;
 
     // if the inbound reach is not 0 and the outbound reach is not 0 and the opposing edge is not
@@ -571,35 +625,27 @@ struct bin_handler_t {
       // of the shape which are on the same side of h that p is. to make this fast we would need a
       // a trivial half plane test as maybe a single dot product and comparison?
 
-      // get some shape of the edge
+      // decode the shape of the edge once for all of the points, unless its cached
       auto edge_info = std::make_shared<const EdgeInfo>(tile->edgeinfo(edge));
-      auto shape = edge_info->lazy_shape();
-      PointLL v;
-      if (!shape.empty()) {
-        v = shape.pop();
+      auto decoded = reader.GetDecodedShape(tile, edge);
+      if (!decoded) {
+        auto shape = edge_info->lazy_shape();
+        shape_points.clear();
+        while (!shape.empty()) {
+          shape_points.emplace_back(shape.pop());
+        }
       }
+      const auto& points = decoded ? decoded->shape : shape_points;
 
-      // iterate along this edges segments projecting each of the points
-      for (size_t i = 0; !shape.empty(); ++i) {
-        auto u = v;
-        v = shape.pop();
-        // for each input point
-        c_itr = bin_candidates.begin();
-        for (p_itr = begin; p_itr != end; ++p_itr, ++c_itr) {
-          // skip updating this candidate because it was prefiltered
-          if (c_itr->prefiltered) {
-            continue;
-          }
-          // how close is the input to this segment
-          auto point = p_itr->project(u, v);
-          auto sq_distance = p_itr->project.approx.DistanceSquared(point);
-          // do we want to keep it
-          if (sq_distance < c_itr->sq_distance) {
-            c_itr->sq_distance = sq_distance;
-            c_itr->point = std::move(point);
-            c_itr->index = i;
-          }
+      // project each of the points onto all of the segments of the edge
+      c_itr = bin_candidates.begin();
+      for (p_itr = begin; p_itr != end; ++p_itr, ++c_itr) {
+        // skip updating this candidate because it was prefiltered
+        if (c_itr->prefiltered) {
+          continue;
         }
+        // how close is the input to this edge
+        c_itr->index = p_itr->project(points, c_itr->point, c_itr->sq_distance);
       }
 
       // if we already have a better reachable candidate we can just assume this one is reachable
@@ -827,7 +873,8 @@ namespace loki {
 std::unordered_map<valhalla::baldr::Location, PathLocation>
 Search(const std::vector<valhalla::baldr::Location>& locations,
        GraphReader& reader,
-       const std::shared_ptr<DynamicCost>& costing) {
+       const std::shared_ptr<DynamicCost>& costing,
+       const uint8_t stored_reach) {
   // we cannot continue without costing
   if (!costing)
     throw std::runtime_error("No costing was provided for edge candidate search");
@@ -837,12 +884,43 @@ Search(const std::vector<valhalla::baldr::Location>& locations,
     return std::unordered_map<valhalla::baldr::Location, PathLocation>{};
 
   // setup the unique list of locations
-  bin_handler_t handler(locations, reader, costing);
+  bin_handler_t handler(locations, reader, costing, stored_reach);
   // search over the bins doing multiple locations per bin
   handler.search();
   // turn each locations candidate set into path locations
   return handler.finalize();
 }
 
+uint8_t GetStoredReachCosting(const Options& options) {
+  // the begin and end of multimodal routes are walked
+  const auto type =
+      options.costing_type() == Costing::multimodal ? Costing::pedestrian : options.costing_type();
+  const auto costing = options.costings().find(type);
+  if (costing == options.costings().cend()) {
+    return kNoStoredReach;
+  }
+
+  // the defaults are what a request without any costing options parses to
+  static const auto defaults = []() {
+    std::array<std::string, Costing::Type_ARRAYSIZE> defaults;
+    rapidjson::Document doc;
+    doc.SetObject();
+    for (int i = 0; i < Costing::Type_ARRAYSIZE; ++i) {
+      const auto default_type = static_cast<Costing::Type>(i);
+      if (!Costing_Type_IsValid(i) || default_type == Costing::none_) {
+        continue;
+      }
+      Costing default_costing;
+      sif::ParseCosting(doc, "/costing_options/" + Costing_Enum_Name(default_type),
+                        &default_costing, default_type);
+      defaults[i] = serialize_reach_options(default_costing);
+    }
+    return defaults;
+  }();
+  return !defaults[type].empty() && serialize_reach_options(costing->second) == defaults[type]
+             ? static_cast<uint8_t>(type)
+             : kNoStoredReach;
+}
+
 } // namespace loki
 } // namespace valhalla
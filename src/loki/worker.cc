@@ -24,6 +24,14 @@ using namespace valhalla::baldr;
 using namespace valhalla::sif;
 using namespace valhalla::loki;
 
+namespace {
+
+// limits of the batch route action for configs which were written before there was one
+constexpr size_t kDefaultBatchRouteMaxLocations = 1000;
+constexpr float kDefaultBatchRouteMaxDistance = 5000000.0f;
+
+} // namespace
+
 namespace valhalla {
 namespace loki {
 void loki_worker_t::parse_locations(google::protobuf::RepeatedPtrField<valhalla::Location>* locations,
@@ -179,6 +187,9 @@ void loki_worker_t::parse_costing(Api& api, bool allow_none) {
     }
   }
 
+  // with the default options the reach of the costing can come from the tiles
+  stored_reach_costing = loki::GetStoredReachCosting(options);
+
   // If more alternates are requested than we support we cap it
   if (options.action() != Options::trace_attributes && options.alternates() > max_alternates)
     options.set_alternates(max_alternates);
@@ -236,13 +247,16 @@ loki_worker_t::loki_worker_t(const boost::property_tree::ptree& config,
         throw std::runtime_error("Max locations for centroid action must be < 128");
     }
     max_distance.emplace(kv.first, config.get<float>("service_limits." + kv.first + ".max_distance"));
-    if (kv.first != "centroid" && kv.first != "trace" && kv.first != "isochrone") {
+    if (kv.first != "centroid" && kv.first != "trace" && kv.first != "isochrone" &&
+        kv.first != "batch_route") {
       max_matrix_distance.emplace(kv.first, config.get<float>("service_limits." + kv.first +
                                                               ".max_matrix_distance"));
       max_matrix_locations.emplace(kv.first, config.get<float>("service_limits." + kv.first +
                                                                ".max_matrix_location_pairs"));
     }
   }
+  max_locations.emplace("batch_route", kDefaultBatchRouteMaxLocations);
+  max_distance.emplace("batch_route", kDefaultBatchRouteMaxDistance);
   // this should never happen
   if (max_locations.empty()) {
     throw std::runtime_error("Missing max_locations configuration");
@@ -325,7 +339,8 @@ void loki_worker_t::check_hierarchy_distance(Api& request) {
   }
 
   // For route action check if total distances between locations exceed the max limit.
-  // For matrix action, check every pair of source and target.
+  // For matrix action, check every pair of source and target. For batch route action, check every
+  // source with its own target.
   bool max_distance_exceeded = false;
   if (request.options().action() == Options_Action_sources_to_targets) {
     for (auto& source : *options.mutable_sources()) {
@@ -336,6 +351,11 @@ void loki_worker_t::check_hierarchy_distance(Api& request) {
         }
       }
     }
+  } else if (request.options().action() == Options_Action_batch_route) {
+    for (int i = 0; i < options.sources_size() && !max_distance_exceeded; ++i) {
+      max_distance_exceeded = to_ll(options.sources(i)).Distance(to_ll(options.targets(i))) >
+                              max_distance_disable_hierarchy_culling;
+    }
   } else {
     auto locations = options.locations();
     float arc_distance = 0.0f;
@@ -391,6 +411,10 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
       case Options::locate:
         result = to_response(locate(request), info, request);
         break;
+      case Options::batch_route:
+        batch_route(request);
+        result.messages.emplace_back(request.SerializeAsString());
+        break;
       case Options::sources_to_targets:
       case Options::optimized_route:
         matrix(request);
@@ -438,6 +462,7 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
   }
 
   // keep track of the metrics if the request is going back to the client
+  record_shape_cache_stats(request, *reader);
   if (!result.intermediate)
     enqueue_statistics(request);
 
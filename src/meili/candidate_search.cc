@@ -41,6 +41,7 @@ CandidateCollector::WithinSquaredDistance(const midgard::PointLL& location,
   std::unordered_set<baldr::GraphId> visited_nodes;
   midgard::projector_t projector(location);
   graph_tile_ptr tile;
+  std::vector<midgard::PointLL> shape;
 
   for (auto it = edgeid_begin; it != edgeid_end; it++) {
     const auto& edgeid = *it;
@@ -62,9 +63,18 @@ CandidateCollector::WithinSquaredDistance(const midgard::PointLL& location,
       continue;
     }
 
-    // Get at the shape
-    auto shape = tile->edgeinfo(edge).lazy_shape();
-    if (shape.empty()) {
+    // Get at the shape, decoded once for the projection onto all of its segments unless its cached
+    auto decoded = reader_.GetDecodedShape(tile, edge);
+    if (!decoded) {
+      auto encoded_shape = tile->edgeinfo(edge).lazy_shape();
+      shape.clear();
+      while (!encoded_shape.empty()) {
+        shape.emplace_back(encoded_shape.pop());
+      }
+    }
+    const auto& points = decoded ? decoded->shape : shape;
+    const auto* lengths = decoded ? &decoded->lengths : nullptr;
+    if (points.empty()) {
       // Otherwise Project will fail
       continue;
     }
@@ -83,7 +93,7 @@ CandidateCollector::WithinSquaredDistance(const midgard::PointLL& location,
 
     if (edge_included) {
       std::tie(point, sq_distance, segment, offset) =
-          helpers::Project(projector, shape, kSnapToNodeDistance);
+          helpers::Project(projector, points, kSnapToNodeDistance, lengths);
 
       if (sq_distance <= sq_search_radius) {
         const double dist = edge->forward() ? offset : 1.0 - offset;
@@ -103,7 +113,7 @@ CandidateCollector::WithinSquaredDistance(const midgard::PointLL& location,
       // No need to project again if we already did it above
       if (!edge_included) {
         std::tie(point, sq_distance, segment, offset) =
-            helpers::Project(projector, shape, kSnapToNodeDistance);
+            helpers::Project(projector, points, kSnapToNodeDistance, lengths);
       }
       if (sq_distance <= sq_search_radius) {
         const double dist = opp_edge->forward() ? offset : 1.0 - offset;
@@ -168,23 +178,49 @@ void IndexBin(const graph_tile_ptr& tile,
   }
 }
 
+std::shared_ptr<const CandidateGridCache::grid_t>
+CandidateGridCache::Get(const int32_t bin_id) const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  const auto it = grids_.find(bin_id);
+  return it == grids_.cend() ? nullptr : it->second;
+}
+
+std::shared_ptr<const CandidateGridCache::grid_t>
+CandidateGridCache::Put(const int32_t bin_id, std::shared_ptr<const grid_t> grid) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  return grids_.emplace(bin_id, std::move(grid)).first->second;
+}
+
+size_t CandidateGridCache::size() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return grids_.size();
+}
+
+void CandidateGridCache::Clear() {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  grids_.clear();
+}
+
 CandidateGridQuery::CandidateGridQuery(baldr::GraphReader& reader,
                                        float cell_width,
-                                       float cell_height)
-    : reader_(reader), cell_width_(cell_width), cell_height_(cell_height), grid_cache_() {
+                                       float cell_height,
+                                       const std::shared_ptr<CandidateGridCache>& grid_cache)
+    : reader_(reader), cell_width_(cell_width), cell_height_(cell_height), grid_cache_(grid_cache) {
   bin_level_ = baldr::TileHierarchy::levels().back().level;
+  if (!grid_cache_) {
+    grid_cache_ = std::make_shared<CandidateGridCache>();
+  }
 }
 
 CandidateGridQuery::~CandidateGridQuery() = default;
 
-inline const CandidateGridQuery::grid_t*
+inline std::shared_ptr<const CandidateGridQuery::grid_t>
 CandidateGridQuery::GetGrid(const int32_t bin_id,
                             const Tiles<PointLL>& tiles,
                             const Tiles<PointLL>& bins) const {
   // Check if the bin is in the cache
-  const auto it = grid_cache_.find(bin_id);
-  if (it != grid_cache_.end()) {
-    return &(it->second);
+  if (auto cached = grid_cache_->Get(bin_id)) {
+    return cached;
   }
 
   // Not in the cache. Get the tile and Index the bin within the tile.
@@ -202,11 +238,10 @@ CandidateGridQuery::GetGrid(const int32_t bin_id,
   int32_t bin_col = rc.second % ndiv;
   int32_t bin_index = (bin_row * ndiv) + bin_col;
 
-  // Insert the bin into the cache and index the bin
-  const auto inserted =
-      grid_cache_.emplace(bin_id, grid_t(tile->BoundingBox(), cell_width_, cell_height_));
-  IndexBin(tile, bin_index, reader_, inserted.first->second);
-  return &(inserted.first->second);
+  // Index the bin and insert it into the cache, unless another thread indexed it in the meantime
+  auto grid = std::make_shared<grid_t>(tile->BoundingBox(), cell_width_, cell_height_);
+  IndexBin(tile, bin_index, reader_, *grid);
+  return grid_cache_->Put(bin_id, std::move(grid));
 }
 
 std::unordered_set<baldr::GraphId>
@@ -216,14 +251,27 @@ CandidateGridQuery::RangeQuery(const AABB2<midgard::PointLL>& range) const {
   const Tiles<PointLL>& tiles = baldr::TileHierarchy::levels().back().tiles;
   Tiles<PointLL> bins(tiles.TileBounds(), tiles.SubdivisionSize());
 
-  // Get a list of bins within the range. These are "tile Ids" that must
-  // be resolved to a Graph Id (tile) / bin combination
-  auto bin_list = bins.TileList(range);
-
-  // Iterate through the bins and query grids to get results
+  // A cached grid means its tile has no candidate index, only the tiles of the other bins are
+  // looked at. Those with a candidate index in their header answer for all of their bins at once
   std::unordered_set<baldr::GraphId> result;
-  for (auto bin_id : bin_list) {
-    auto grid = GetGrid(bin_id, tiles, bins);
+  std::unordered_map<int32_t, bool> indexed_tiles;
+  const int32_t ndiv = tiles.nsubdivisions();
+  for (auto bin_id : bins.TileList(range)) {
+    auto grid = grid_cache_->Get(bin_id);
+    if (!grid) {
+      auto rc = bins.GetRowColumn(bin_id);
+      auto tile_id = tiles.TileId(rc.second / ndiv, rc.first / ndiv);
+      auto indexed = indexed_tiles.emplace(tile_id, false);
+      if (indexed.second) {
+        auto tile = reader_.GetGraphTile(baldr::GraphId(tile_id, bin_level_, 0));
+        indexed.first->second = tile && tile->header()->candidate_index_offset() > 0 &&
+                                tile->GetCandidateEdges(range, result);
+      }
+      if (indexed.first->second) {
+        continue;
+      }
+      grid = GetGrid(bin_id, tiles, bins);
+    }
     if (grid) {
       const auto set = grid->Query(range);
       result.insert(set.begin(), set.end());
@@ -82,6 +82,8 @@ void Config::TransitionCost::Read(const boost::property_tree::ptree& params) {
   if (const auto node = params.get_child_optional("customizable")) {
     is_turn_penalty_factor_customizable = FindValue(*node, "turn_penalty_factor");
   }
+
+  ReadParamOptional(beam_width, params, "default.beam_width");
 }
 
 void Config::EmissionCost::Read(const boost::property_tree::ptree& params) {
@@ -6,54 +6,29 @@
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/midgard/util.h>
 
+#include <limits>
+
 using namespace valhalla;
 using namespace valhalla::meili;
 using namespace valhalla::midgard;
 
-namespace valhalla {
-namespace meili {
-namespace helpers {
+namespace {
 
-// snapped point, squared distance, segment index, offset
+// snapped point, squared distance, segment index, offset from the closest projection onto a shape
 std::tuple<PointLL, double, typename std::vector<PointLL>::size_type, double>
-Project(const projector_t& p, Shape7Decoder<midgard::PointLL>& shape, double snap_distance) {
-  PointLL first_point(shape.pop());
-  auto closest_point = first_point;
-  auto closest_segment_point = first_point;
-  double closest_distance = std::numeric_limits<double>::max();
-  size_t closest_segment = 0;
-  double closest_partial_length = 0.0;
-  double total_length = 0.0;
-
-  // for each segment
-  auto u = first_point;
-  size_t i = 0;
-  for (; !shape.empty(); ++i) {
-    // project a onto b where b is the origin vector representing this segment
-    // and a is the origin vector to the point we are projecting, (a.b/b.b)*b
-    auto v = shape.pop();
-
-    auto projection = p(u, v);
-
-    // check if this point is better
-    const auto distance = p.approx.DistanceSquared(projection);
-    if (distance < closest_distance) {
-      closest_point = std::move(projection);
-      closest_distance = distance;
-      closest_segment = i;
-      closest_partial_length = total_length;
-      closest_segment_point = u;
-    }
-
-    // total edge length
-    total_length += u.Distance(v);
-    u = v;
-  }
-
+Finish(const projector_t& p,
+       const PointLL& first_point,
+       const PointLL& last_point,
+       const size_t segment_count,
+       PointLL closest_point,
+       double closest_distance,
+       size_t closest_segment,
+       const double closest_partial_length,
+       const double total_length,
+       const double snap_distance) {
   // percent_along is a double between 0 and 1 representing the location of
   // the closest point on LineString to the given Point, as a fraction
   // of total 2d line length.
-  closest_partial_length += closest_segment_point.Distance(closest_point);
   double percent_along =
       total_length > 0.0 ? static_cast<double>(closest_partial_length / total_length) : 0.0;
 
@@ -87,15 +62,84 @@ Project(const projector_t& p, Shape7Decoder<midgard::PointLL>& shape, double sna
     closest_segment = 0;
     percent_along = 0.f;
   } else if (total_length * (1.f - percent_along) <= snap_distance) {
-    closest_point = u;
+    closest_point = last_point;
     closest_distance = p.approx.DistanceSquared(closest_point);
-    closest_segment = i - 1;
+    closest_segment = segment_count - 1;
     percent_along = 1.f;
   }
 
   return std::make_tuple(std::move(closest_point), closest_distance, closest_segment, percent_along);
 }
 
+} // namespace
+
+namespace valhalla {
+namespace meili {
+namespace helpers {
+
+// snapped point, squared distance, segment index, offset
+std::tuple<PointLL, double, typename std::vector<PointLL>::size_type, double>
+Project(const projector_t& p, Shape7Decoder<midgard::PointLL>& shape, double snap_distance) {
+  // project onto each segment as it is decoded, the same way the decoded shape is projected below
+  const auto first_point = shape.pop();
+  auto closest_point = first_point;
+  double closest_distance = std::numeric_limits<double>::max();
+  size_t closest_segment = 0;
+  double closest_partial_length = 0.0;
+  double total_length = 0.0;
+  auto u = first_point;
+  size_t segment_count = 0;
+  for (; !shape.empty(); ++segment_count) {
+    const auto v = shape.pop();
+    const auto projection = p(u, v);
+    const auto distance = p.approx.DistanceSquared(projection);
+    if (distance < closest_distance) {
+      closest_point = projection;
+      closest_distance = distance;
+      closest_segment = segment_count;
+      closest_partial_length = total_length + u.Distance(projection);
+    }
+    total_length += u.Distance(v);
+    u = v;
+  }
+
+  return Finish(p, first_point, u, segment_count, closest_point, closest_distance, closest_segment,
+                closest_partial_length, total_length, snap_distance);
+}
+
+// snapped point, squared distance, segment index, offset
+std::tuple<PointLL, double, typename std::vector<PointLL>::size_type, double>
+Project(const projector_t& p,
+        const std::vector<PointLL>& shape,
+        double snap_distance,
+        const std::vector<double>* lengths) {
+  // find the closest segment in one pass over all of them
+  const auto& first_point = shape.front();
+  auto closest_point = first_point;
+  double closest_distance;
+  size_t closest_segment = p(shape, closest_point, closest_distance);
+  const auto& closest_segment_point = shape[closest_segment];
+
+  // total edge length and the length up to the closest segment
+  double closest_partial_length = 0.0;
+  double total_length = 0.0;
+  if (lengths) {
+    closest_partial_length = (*lengths)[closest_segment];
+    total_length = lengths->back();
+  } else {
+    for (size_t i = 0; i + 1 < shape.size(); ++i) {
+      if (i == closest_segment) {
+        closest_partial_length = total_length;
+      }
+      total_length += shape[i].Distance(shape[i + 1]);
+    }
+  }
+  closest_partial_length += closest_segment_point.Distance(closest_point);
+
+  return Finish(p, first_point, shape.back(), shape.size() - 1, closest_point, closest_distance,
+                closest_segment, closest_partial_length, total_length, snap_distance);
+}
+
 } // namespace helpers
 } // namespace meili
 } // namespace valhalla
@@ -234,9 +234,12 @@ std::vector<MatchResult> InterpolateMeasurements(const MapMatcher& mapmatcher,
   return results;
 }
 
-// Find the match result of a state, given its previous state and next state
+// Find the match result of a state, given its previous state and next state. The states are
+// indexed by time, the ones before the first time are not known anymore
+template <typename stateids_t>
 MatchResult FindMatchResult(const MapMatcher& mapmatcher,
-                            const std::vector<StateId>& stateids,
+                            const stateids_t& stateids,
+                            StateId::Time first_time,
                             StateId::Time time,
                             baldr::GraphReader& graph_reader) {
   // Either the time is invalid because of discontinuity or it matches the index
@@ -258,7 +261,7 @@ MatchResult FindMatchResult(const MapMatcher& mapmatcher,
   // Because of node routing in meili we must loop back over the previous path. In most cases the loop
   // is a single iteration but in rare cases (node to node trivial routes) we need to explore states
   // that are older than the immediate previous state
-  for (StateId::Time t = time; t > 0 && !prev_edge.Is_Valid(); --t) {
+  for (StateId::Time t = time; t > first_time && !prev_edge.Is_Valid(); --t) {
     // If there is no path from t - 1
     const auto& prev_state_id = stateids[t - 1];
     if (!prev_state_id.IsValid()) {
@@ -450,7 +453,7 @@ std::vector<MatchResult> FindMatchResults(const MapMatcher& mapmatcher,
   std::vector<MatchResult> results;
   results.reserve(stateids.size());
   for (StateId::Time time = 0; time < stateids.size(); time++) {
-    results.push_back(FindMatchResult(mapmatcher, stateids, time, graph_reader));
+    results.push_back(FindMatchResult(mapmatcher, stateids, 0, time, graph_reader));
   }
 
   return results;
@@ -505,6 +508,7 @@ MapMatcher::MapMatcher(const Config& config,
                              config_.transition_cost) {
   vs_.set_emission_cost_model(emission_cost_model_);
   vs_.set_transition_cost_model(transition_cost_model_);
+  vs_.set_beam_width(config_.transition_cost.beam_width);
 }
 
 MapMatcher::~MapMatcher() {
@@ -517,6 +521,9 @@ void MapMatcher::Clear() {
   vs_.set_transition_cost_model(transition_cost_model_);
   ts_.Clear();
   container_.Clear();
+  online_path_.clear();
+  online_interpolated_.clear();
+  online_time_ = 0;
 }
 
 void MapMatcher::RemoveRedundancies(const std::vector<StateId>& result,
@@ -820,6 +827,104 @@ std::vector<MatchResults> MapMatcher::OfflineMatch(const std::vector<Measurement
   return best_paths;
 }
 
+std::vector<MatchResult> MapMatcher::OnlineMatch(const std::vector<Measurement>& measurements,
+                                                 bool finish) {
+  const float sq_max_search_radius = config_.candidate_search.max_search_radius_meters *
+                                     config_.candidate_search.max_search_radius_meters;
+  const float sq_interpolation_distance =
+      config_.routing.interpolation_distance_meters * config_.routing.interpolation_distance_meters;
+
+  // Separate the measurements like AppendMeasurements does, only that we don't know yet which is last
+  for (const auto& measurement : measurements) {
+    if (container_.size() == 0) {
+      AppendMeasurement(measurement, sq_max_search_radius);
+      continue;
+    }
+    const auto time = container_.size() - 1;
+    if (sq_interpolation_distance <
+        GreatCircleDistanceSquared(container_.measurement(time), measurement)) {
+      const auto found = online_interpolated_.find(time);
+      if (found != online_interpolated_.end()) {
+        SetLeaveTime(time, found->second, measurement);
+      }
+      AppendMeasurement(measurement, sq_max_search_radius);
+    } else {
+      online_interpolated_[time].push_back(measurement);
+    }
+  }
+  if (container_.size() == 0) {
+    return {};
+  }
+
+  // Always match the last measurement
+  auto interpolated = online_interpolated_.find(container_.size() - 1);
+  if (finish && interpolated != online_interpolated_.end() && !interpolated->second.empty()) {
+    const auto last = interpolated->second.back();
+    interpolated->second.pop_back();
+    SetLeaveTime(container_.size() - 1, interpolated->second, last);
+    AppendMeasurement(last, sq_max_search_radius);
+  }
+
+  // Find the optimal paths to all the candidates of the latest measurement and keep the part of
+  // the path they all share
+  vs_.SearchColumn(container_.size() - 1);
+  const auto begin = online_path_.empty() ? online_path_.first_time() : online_path_.size() - 1;
+  const auto path = vs_.ConvergedPath(begin, finish);
+  for (auto stateid = path.cbegin(); stateid != path.cend(); ++stateid) {
+    if (stateid != path.cbegin() || online_path_.empty()) {
+      online_path_.push_back(*stateid);
+    }
+  }
+  // The search doesn't know about measurements at the end which have no candidates
+  while (finish && online_path_.size() < container_.size()) {
+    online_path_.push_back(StateId());
+  }
+
+  // A result needs the state after it and the points interpolated after it need the result after
+  // that, so unless the trace ends here the results of the last two states have to wait
+  auto end = online_path_.size();
+  if (!finish) {
+    end = online_time_ + 2 < end ? end - 2 : online_time_;
+  }
+  const auto first = online_time_;
+  std::vector<MatchResult> matched;
+  for (auto time = first; time <= end && time < online_path_.size(); ++time) {
+    matched.push_back(
+        FindMatchResult(*this, online_path_, online_path_.first_time(), time, graphreader_));
+  }
+
+  // Insert the interpolated results in between
+  std::vector<MatchResult> results;
+  for (; online_time_ < end; ++online_time_) {
+    const auto& result = matched[online_time_ - first];
+    results.push_back(result);
+
+    interpolated = online_interpolated_.find(online_time_);
+    if (interpolated == online_interpolated_.end()) {
+      continue;
+    }
+    if (!interpolated->second.empty()) {
+      const auto interpolated_results =
+          InterpolateMeasurements(*this, interpolated->second, online_path_[online_time_],
+                                  online_path_[online_time_ + 1], result,
+                                  matched[online_time_ + 1 - first]);
+      results.insert(results.cend(), interpolated_results.cbegin(), interpolated_results.cend());
+    }
+    online_interpolated_.erase(interpolated);
+  }
+
+  if (finish) {
+    Clear();
+  } else if (1 < online_time_) {
+    // The next result only looks back as far as the state before it
+    container_.Prune(online_time_ - 1);
+    vs_.Prune(online_time_ - 1);
+    online_path_.prune(online_time_ - 1);
+  }
+
+  return results;
+}
+
 std::unordered_map<StateId::Time, std::vector<Measurement>>
 MapMatcher::AppendMeasurements(const std::vector<Measurement>& measurements) {
   const float sq_max_search_radius = config_.candidate_search.max_search_radius_meters *
@@ -831,27 +936,17 @@ MapMatcher::AppendMeasurements(const std::vector<Measurement>& measurements) {
   // Always match the first measurement
   auto last = measurements.cbegin();
   auto time = AppendMeasurement(*last, sq_max_search_radius);
-  double interpolated_epoch_time = -1;
   for (auto m = std::next(last); m != measurements.end(); ++m) {
     const auto sq_distance = GreatCircleDistanceSquared(*last, *m);
     // Always match the last measurement and if its far enough away
     if (sq_interpolation_distance < sq_distance || std::next(m) == measurements.end()) {
-      // If there were interpolated points between these two points with time information
-      if (interpolated_epoch_time != -1) {
-        // Project the last interpolated point onto the line between the two match points
-        auto p = interpolated[time].back().lnglat().Project(last->lnglat(), m->lnglat());
-        // If its significantly closer to the previous match point then it looks like the trace
-        // lingered so we use the time information of the last interpolation point as the actual
-        // time they started traveling towards the next match point which will help us determine
-        // what paths are really likely
-        if (p.Distance(last->lnglat()) / last->lnglat().Distance(m->lnglat()) < .2f) {
-          container_.SetMeasurementLeaveTime(time, interpolated_epoch_time);
-        }
+      const auto found = interpolated.find(time);
+      if (found != interpolated.end()) {
+        SetLeaveTime(time, found->second, *m);
       }
       // This one isnt interpolated so we make room for its state
       time = AppendMeasurement(*m, sq_max_search_radius);
       last = m;
-      interpolated_epoch_time = -1;
     } // TODO: if its the last measurement and it wants to be interpolated
     // then what we need to do is make last match interpolated
     // and copy its epoch_time into the last measurements epoch time
@@ -859,13 +954,32 @@ MapMatcher::AppendMeasurements(const std::vector<Measurement>& measurements) {
     // This one is so close to the last match that we will just interpolate it
     else {
       interpolated[time].push_back(*m);
-      interpolated_epoch_time = m->epoch_time();
     }
   }
 
   return interpolated;
 }
 
+void MapMatcher::SetLeaveTime(StateId::Time time,
+                              const std::vector<Measurement>& interpolated,
+                              const Measurement& next) {
+  // If there were interpolated points between these two points with time information
+  if (interpolated.empty() || interpolated.back().epoch_time() == -1) {
+    return;
+  }
+
+  // Project the last interpolated point onto the line between the two match points
+  const auto& last = container_.measurement(time);
+  auto p = interpolated.back().lnglat().Project(last.lnglat(), next.lnglat());
+  // If its significantly closer to the previous match point then it looks like the trace
+  // lingered so we use the time information of the last interpolation point as the actual
+  // time they started traveling towards the next match point which will help us determine
+  // what paths are really likely
+  if (p.Distance(last.lnglat()) / last.lnglat().Distance(next.lnglat()) < .2f) {
+    container_.SetMeasurementLeaveTime(time, interpolated.back().epoch_time());
+  }
+}
+
 StateId::Time MapMatcher::AppendMeasurement(const Measurement& measurement,
                                             const float sq_max_search_radius) {
   // Test interrupt
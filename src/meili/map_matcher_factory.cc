@@ -22,14 +22,16 @@ namespace valhalla {
 namespace meili {
 
 MapMatcherFactory::MapMatcherFactory(const boost::property_tree::ptree& root,
-                                     const std::shared_ptr<baldr::GraphReader>& graph_reader)
+                                     const std::shared_ptr<baldr::GraphReader>& graph_reader,
+                                     const std::shared_ptr<CandidateGridCache>& grid_cache)
     : config_(root.get_child("meili")), graphreader_(graph_reader) {
   if (!graphreader_)
     graphreader_ = std::make_shared<baldr::GraphReader>(root.get_child("mjolnir"));
   candidatequery_ =
       std::make_shared<CandidateGridQuery>(*graphreader_,
                                            local_tile_size() / config_.candidate_search.grid_size,
-                                           local_tile_size() / config_.candidate_search.grid_size);
+                                           local_tile_size() / config_.candidate_search.grid_size,
+                                           grid_cache);
 }
 
 MapMatcherFactory::~MapMatcherFactory() {
@@ -0,0 +1,151 @@
+#include "argparse_utils.h"
+#include "meili/map_matcher_factory.h"
+#include "meili/measurement.h"
+#include "midgard/logging.h"
+
+#include <boost/property_tree/ptree.hpp>
+#include <cxxopts.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace valhalla::midgard;
+using namespace valhalla::meili;
+
+namespace {
+
+// Reads the traces in the format valhalla_run_map_match reads them in, a lon and lat per line and
+// an empty line between the traces
+std::vector<std::vector<Measurement>>
+read_traces(std::istream& input, float gps_accuracy, float search_radius) {
+  std::vector<std::vector<Measurement>> traces(1);
+  std::string line;
+  while (std::getline(input, line)) {
+    if (line.empty()) {
+      if (!traces.back().empty()) {
+        traces.emplace_back();
+      }
+      continue;
+    }
+    float lng, lat;
+    std::stringstream stream(line);
+    stream >> lng >> lat;
+    traces.back().emplace_back(PointLL(lng, lat), gps_accuracy, search_radius);
+  }
+  if (traces.back().empty()) {
+    traces.pop_back();
+  }
+  return traces;
+}
+
+// The edge each measurement of each trace was matched to, invalid for unmatched measurements
+using matches_t = std::vector<std::vector<valhalla::baldr::GraphId>>;
+
+matches_t match(MapMatcher& matcher,
+                const std::vector<std::vector<Measurement>>& traces,
+                double& seconds) {
+  matches_t matches;
+  auto start = std::chrono::steady_clock::now();
+  for (const auto& trace : traces) {
+    matches.emplace_back();
+    for (const auto& result : matcher.OfflineMatch(trace).front().results) {
+      matches.back().push_back(result.HasState() ? result.edgeid : valhalla::baldr::GraphId{});
+    }
+  }
+  seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return matches;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  const auto program = std::filesystem::path(__FILE__).stem().string();
+  // args
+  boost::property_tree::ptree config;
+  std::vector<size_t> beam_widths;
+
+  try {
+    // clang-format off
+    cxxopts::Options options(
+      program,
+      program + " " + VALHALLA_PRINT_VERSION + "\n\n"
+      "a program which map matches the traces read from stdin (a lon lat per line and an\n"
+      "empty line between traces, like valhalla_run_map_match reads them) with several beam\n"
+      "widths of the viterbi search. For every width it reports the time per trace and how\n"
+      "many of the measurements were matched to the same edge as without a beam, which is\n"
+      "the exact search.\n\n");
+
+    options.add_options()
+      ("h,help", "Print this help message.")
+      ("v,version", "Print the version of this software.")
+      ("c,config", "Path to the json configuration file.", cxxopts::value<std::string>())
+      ("w,beam-widths", "The beam widths to compare", cxxopts::value<std::vector<size_t>>(beam_widths)->default_value("1,2,4,8,16"));
+    // clang-format on
+
+    auto result = options.parse(argc, argv);
+    if (!parse_common_args(program, options, result, &config, "mjolnir.logging"))
+      return EXIT_SUCCESS;
+  } catch (cxxopts::exceptions::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  valhalla::Costing::Type costing;
+  if (!valhalla::Costing_Enum_Parse(config.get<std::string>("meili.mode", "auto"), &costing)) {
+    std::cerr << "No costing method found for meili.mode" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // the exact search first, every beam width is compared to it
+  config.put("meili.default.beam_width", 0);
+  MapMatcherFactory exact_factory(config);
+  const auto meili_config = exact_factory.MergeConfig({});
+  const auto traces = read_traces(std::cin, meili_config.emission_cost.gps_accuracy_meters,
+                                  meili_config.candidate_search.search_radius_meters);
+  if (traces.empty()) {
+    std::cerr << "No traces on stdin" << std::endl;
+    return EXIT_FAILURE;
+  }
+  size_t measurement_count = 0;
+  for (const auto& trace : traces) {
+    measurement_count += trace.size();
+  }
+
+  double seconds;
+  std::unique_ptr<MapMatcher> exact_matcher(exact_factory.Create(costing));
+  const auto exact = match(*exact_matcher, traces, seconds);
+  LOG_INFO("No beam: " + std::to_string(seconds * 1000 / traces.size()) + " ms per trace");
+
+  for (const auto beam_width : beam_widths) {
+    config.put("meili.default.beam_width", beam_width);
+    MapMatcherFactory factory(config, exact_factory.graphreader(), exact_factory.grid_cache());
+    std::unique_ptr<MapMatcher> matcher(factory.Create(costing));
+    const auto matches = match(*matcher, traces, seconds);
+
+    size_t same_measurements = 0, same_traces = 0;
+    for (size_t i = 0; i < traces.size(); ++i) {
+      for (size_t j = 0; j < matches[i].size(); ++j) {
+        same_measurements += matches[i][j] == exact[i][j];
+      }
+      same_traces += matches[i] == exact[i];
+    }
+    LOG_INFO("Beam width " + std::to_string(beam_width) + ": " +
+             std::to_string(seconds * 1000 / traces.size()) + " ms per trace, " +
+             std::to_string(100.0 * same_measurements / measurement_count) +
+             "% of the measurements and " + std::to_string(100.0 * same_traces / traces.size()) +
+             "% of the traces matched like without a beam");
+  }
+  LOG_INFO("Done Benchmark!");
+
+  return EXIT_SUCCESS;
+}
@@ -1,9 +1,22 @@
 #include "baldr/rapidjson_utils.h"
 #include "meili/map_matcher_factory.h"
 #include "meili/measurement.h"
+#include "midgard/logging.h"
 
 #include <boost/property_tree/ptree.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
 using namespace valhalla::midgard;
 using namespace valhalla::meili;
 
@@ -35,9 +48,106 @@ ReadMeasurements(istream_t& istream, float default_gps_accuracy, float default_s
   return measurements;
 }
 
+struct batch_t {
+  size_t index;
+  size_t first_sequence;
+  std::vector<std::vector<Measurement>> traces;
+};
+
+// Hands out the traces of the input in batches and writes the output of the batches back out in
+// the order they were read in
+class batch_queue_t {
+public:
+  batch_queue_t(std::istream& input,
+                size_t batch_size,
+                float default_gps_accuracy,
+                float default_search_radius)
+      : input_(input), batch_size_(batch_size), default_gps_accuracy_(default_gps_accuracy),
+        default_search_radius_(default_search_radius) {
+  }
+
+  bool next(batch_t& batch) {
+    std::lock_guard<std::mutex> lock(input_mutex_);
+    batch.traces.clear();
+    while (batch.traces.size() < batch_size_) {
+      auto measurements = ReadMeasurements(input_, default_gps_accuracy_, default_search_radius_);
+      if (measurements.empty()) {
+        break;
+      }
+      batch.traces.emplace_back(std::move(measurements));
+    }
+    if (batch.traces.empty()) {
+      return false;
+    }
+    batch.index = batch_count_++;
+    batch.first_sequence = sequence_count_;
+    sequence_count_ += batch.traces.size();
+    return true;
+  }
+
+  void write(const batch_t& batch, const std::string& output) {
+    std::unique_lock<std::mutex> lock(output_mutex_);
+    output_turn_.wait(lock, [this, &batch]() { return written_count_ == batch.index; });
+    std::cout << output;
+    ++written_count_;
+    output_turn_.notify_all();
+  }
+
+private:
+  std::istream& input_;
+  size_t batch_size_;
+  float default_gps_accuracy_;
+  float default_search_radius_;
+
+  std::mutex input_mutex_;
+  size_t batch_count_ = 0;
+  size_t sequence_count_ = 0;
+
+  std::mutex output_mutex_;
+  std::condition_variable output_turn_;
+  size_t written_count_ = 0;
+};
+
+void match(MapMatcherFactory& matcher_factory,
+           const valhalla::Costing::Type costing,
+           batch_queue_t& queue,
+           std::atomic<size_t>& point_count) {
+  std::unique_ptr<MapMatcher> mapmatcher(matcher_factory.Create(costing));
+  batch_t batch;
+  while (queue.next(batch)) {
+    std::ostringstream output;
+    for (size_t i = 0; i < batch.traces.size(); ++i) {
+      const auto& measurements = batch.traces[i];
+
+      // Offline match
+      output << "Sequence " << batch.first_sequence + i << std::endl;
+      auto results = mapmatcher->OfflineMatch(measurements).front().results;
+
+      // Show results
+      size_t mmt_id = 0, count = 0;
+      for (const auto& result : results) {
+        if (result.HasState()) {
+          output << mmt_id << " ";
+          output << result.distance_from << std::endl;
+          count++;
+        }
+        mmt_id++;
+      }
+
+      // Summary
+      output << count << "/" << measurements.size() << std::endl << std::endl;
+      point_count += measurements.size();
+    }
+
+    // Clean up
+    matcher_factory.ClearFullCache();
+    queue.write(batch, output.str());
+  }
+}
+
 int main(int argc, char* argv[]) {
   if (argc < 2) {
-    std::cout << "usage: map_matching CONFIG" << std::endl;
+    std::cout << "usage: map_matching CONFIG [CONCURRENCY] [BATCH_SIZE]" << std::endl;
     return 1;
   }
 
@@ -48,43 +158,45 @@ int main(int argc, char* argv[]) {
   if (!valhalla::Costing_Enum_Parse(modename, &costing)) {
     throw std::runtime_error("No costing method found");
   }
-
-  MapMatcherFactory matcher_factory(config);
-  auto mapmatcher = matcher_factory.Create(costing);
-
-  const float default_gps_accuracy = mapmatcher->config().emission_cost.gps_accuracy_meters,
-              default_search_radius = mapmatcher->config().candidate_search.search_radius_meters;
-
-  size_t index = 0;
-  for (auto measurements = ReadMeasurements(std::cin, default_gps_accuracy, default_search_radius);
-       !measurements.empty();
-       measurements = ReadMeasurements(std::cin, default_gps_accuracy, default_search_radius)) {
-
-    // Offline match
-    std::cout << "Sequence " << index++ << std::endl;
-    auto results = mapmatcher->OfflineMatch(measurements).front().results;
-
-    // Show results
-    size_t mmt_id = 0, count = 0;
-    for (const auto& result : results) {
-      if (result.HasState()) {
-        std::cout << mmt_id << " ";
-        std::cout << result.distance_from << std::endl;
-        count++;
-      }
-      mmt_id++;
-    }
-
-    // Summary
-    std::cout << count << "/" << measurements.size() << std::endl << std::endl;
-
-    // Clean up
-    measurements.clear();
-    matcher_factory.ClearFullCache();
+  const size_t thread_count =
+      argc > 2 ? std::max<size_t>(std::stoul(argv[2]), 1)
+               : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  const size_t batch_size = argc > 3 ? std::max<size_t>(std::stoul(argv[3]), 1) : 16;
+
+  // Every thread matches with its own factory (and graph reader), the tiles are shared through
+  // the tile extract or the concurrent tile cache if the config has them and the candidate grids
+  // are always shared
+  std::list<MapMatcherFactory> matcher_factories;
+  matcher_factories.emplace_back(config);
+  const auto grid_cache = matcher_factories.front().grid_cache();
+  while (matcher_factories.size() < thread_count) {
+    matcher_factories.emplace_back(config, nullptr, grid_cache);
   }
 
-  delete mapmatcher;
-  matcher_factory.ClearCache();
+  const auto& meili_config = matcher_factories.front().MergeConfig({});
+  batch_queue_t queue(std::cin, batch_size, meili_config.emission_cost.gps_accuracy_meters,
+                      meili_config.candidate_search.search_radius_meters);
+
+  // Match the batches of traces as they come in
+  std::atomic<size_t> point_count(0);
+  auto start = std::chrono::steady_clock::now();
+  std::list<std::thread> threads;
+  for (auto& matcher_factory : matcher_factories) {
+    threads.emplace_back(match, std::ref(matcher_factory), costing, std::ref(queue),
+                         std::ref(point_count));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  LOG_INFO("Matched " + std::to_string(point_count.load()) + " points with " +
+           std::to_string(thread_count) + " threads in " + std::to_string(elapsed.count()) +
+           " seconds, " + std::to_string(point_count / std::max(elapsed.count(), 1e-9)) +
+           " points per second");
+
+  for (auto& matcher_factory : matcher_factories) {
+    matcher_factory.ClearCache();
+  }
 
   return 0;
 }
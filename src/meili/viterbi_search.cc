@@ -131,6 +131,14 @@ bool IViterbiSearch::RemoveStateId(const StateId& stateid) {
   return added_states_.erase(stateid) > 0;
 }
 
+void IViterbiSearch::Prune(StateId::Time time) {
+  for (auto stateid = added_states_.begin(); stateid != added_states_.end();) {
+    stateid = stateid->time() < time ? added_states_.erase(stateid) : std::next(stateid);
+  }
+  states_by_time.prune(time);
+  winner_by_time.prune(time);
+}
+
 bool IViterbiSearch::HasStateId(const StateId& stateid) const {
   return added_states_.find(stateid) != added_states_.end();
 }
@@ -183,8 +191,8 @@ template <bool Maximize> void NaiveViterbiSearch<Maximize>::Clear() {
 }
 
 template <bool Maximize> void NaiveViterbiSearch<Maximize>::ClearSearch() {
-  history_.clear();
-  winner_by_time.clear();
+  history_ = TimeWindow<std::vector<StateLabel>>(states_by_time.first_time());
+  winner_by_time = TimeWindow<StateId>(states_by_time.first_time());
 }
 
 template <bool Maximize> bool NaiveViterbiSearch<Maximize>::AddStateId(const StateId& stateid) {
@@ -217,6 +225,11 @@ template <bool Maximize> bool NaiveViterbiSearch<Maximize>::RemoveStateId(const
   return true;
 }
 
+template <bool Maximize> void NaiveViterbiSearch<Maximize>::Prune(StateId::Time time) {
+  IViterbiSearch::Prune(time);
+  history_.prune(time);
+}
+
 template <bool Maximize>
 double NaiveViterbiSearch<Maximize>::AccumulatedCost(const StateId& stateid) const {
   return stateid.IsValid() ? GetLabel(stateid).costsofar() : kInvalidCost;
@@ -237,7 +250,7 @@ template <bool Maximize> StateId NaiveViterbiSearch<Maximize>::SearchWinner(Stat
     std::vector<StateLabel> labels;
 
     // Update labels
-    if (time == 0) {
+    if (time == history_.first_time()) {
       labels = InitLabels(column, true);
     } else {
       labels = InitLabels(column, false);
@@ -380,6 +393,17 @@ bool ViterbiSearch::AddStateId(const StateId& stateid) {
   return true;
 }
 
+void ViterbiSearch::Prune(StateId::Time time) {
+  IViterbiSearch::Prune(time);
+  unreached_states_by_time.prune(time);
+  scanned_count_by_time_.prune(time);
+  for (auto label = scanned_labels_.begin(); label != scanned_labels_.end();) {
+    label = label->first.time() < time ? scanned_labels_.erase(label) : std::next(label);
+  }
+  // Whatever is left in the queue from before can't be part of the path anymore
+  earliest_time_ = std::max(earliest_time_, time);
+}
+
 bool ViterbiSearch::RemoveStateId(const StateId& stateid) {
   const auto removed = IViterbiSearch::RemoveStateId(stateid);
   if (!removed) {
@@ -426,6 +450,72 @@ StateId ViterbiSearch::SearchWinner(StateId::Time time) {
   return {};
 }
 
+StateId ViterbiSearch::SearchColumn(StateId::Time time) {
+  // The search can't get past the last time which has states
+  const auto winner = SearchWinner(time);
+  if (winner_by_time.empty()) {
+    return winner;
+  }
+  time = winner_by_time.size() - 1;
+
+  // Scan whatever is left in the queue, only the states before the time may have successors
+  while (!queue_.empty()) {
+    const auto label = queue_.top();
+    queue_.pop();
+    if (label.stateid().time() < earliest_time_) {
+      continue;
+    }
+
+    if (!Scan(label)) {
+      continue;
+    }
+    if (label.stateid().time() < time) {
+      AddSuccessorsToQueue(label.stateid());
+    } else {
+      unexpanded_.push_back(label.stateid());
+    }
+  }
+
+  return winner;
+}
+
+std::vector<StateId> ViterbiSearch::ConvergedPath(StateId::Time begin, bool last) const {
+  if (winner_by_time.size() <= begin) {
+    return {};
+  }
+  if (!last && !queue_.empty()) {
+    throw std::logic_error("the latest column must be searched by SearchColumn");
+  }
+
+  // Follow the paths to all the states of the latest column back until they meet
+  StateId::Time time = winner_by_time.size() - 1;
+  std::unordered_set<StateId> states{winner_by_time[time]};
+  if (!last) {
+    states.insert(unexpanded_.cbegin(), unexpanded_.cend());
+  }
+  for (; begin < time && 1 < states.size(); --time) {
+    std::unordered_set<StateId> predecessors;
+    for (const auto& stateid : states) {
+      predecessors.insert(PathPredecessor(stateid, time));
+    }
+    states.swap(predecessors);
+  }
+  if (1 < states.size()) {
+    return {};
+  }
+
+  // From there on back there is only one path
+  std::vector<StateId> path(time - begin + 1);
+  auto stateid = *states.begin();
+  for (auto state = path.rbegin(); state != path.rend(); ++state, --time) {
+    *state = stateid;
+    if (begin < time) {
+      stateid = PathPredecessor(stateid, time);
+    }
+  }
+  return path;
+}
+
 StateId ViterbiSearch::Predecessor(const StateId& stateid) const {
   const auto it = scanned_labels_.find(stateid);
   if (it == scanned_labels_.end()) {
@@ -451,10 +541,12 @@ void ViterbiSearch::Clear() {
 }
 
 void ViterbiSearch::ClearSearch() {
-  earliest_time_ = 0;
+  earliest_time_ = states_by_time.first_time();
   queue_.clear();
   scanned_labels_.clear();
-  winner_by_time.clear();
+  unexpanded_.clear();
+  scanned_count_by_time_ = TimeWindow<uint32_t>(states_by_time.first_time());
+  winner_by_time = TimeWindow<StateId>(states_by_time.first_time());
   unreached_states_by_time = states_by_time;
 }
 
@@ -486,6 +578,11 @@ void ViterbiSearch::AddSuccessorsToQueue(const StateId& stateid) {
     throw std::logic_error("impossible to get invalid cost from scanned labels");
   }
 
+  // None of the successors would be expanded anyway
+  if (IsBeamFull(stateid.time() + 1)) {
+    return;
+  }
+
   // Optimal states have been removed from unreached_states_by_time so no
   // worry about optimality
   for (const auto& next_stateid : unreached_states_by_time[stateid.time() + 1]) {
@@ -531,10 +628,14 @@ StateId::Time ViterbiSearch::IterativeSearch(StateId::Time target, bool request_
   if (!request_new_start && !winner_by_time.empty() && winner_by_time.back().IsValid()) {
     source = winner_by_time.size() - 1;
     AddSuccessorsToQueue(winner_by_time[source]);
+    for (const auto& stateid : unexpanded_) {
+      AddSuccessorsToQueue(stateid);
+    }
   } else {
     source = winner_by_time.size();
     InitQueue(unreached_states_by_time[source]);
   }
+  unexpanded_.clear();
 
   // Start with the source time, which will be searched anyhow
   auto searched_time = source;
@@ -554,26 +655,7 @@ StateId::Time ViterbiSearch::IterativeSearch(StateId::Time target, bool request_
     }
 
     // Mark it as scanned and remember its cost and predecessor
-    const auto& inserted = scanned_labels_.emplace(stateid, label);
-    if (!inserted.second) {
-      throw std::logic_error("the principle of optimality is violated in the viterbi search,"
-                             " probably negative costs occurred");
-    }
-
-    // Remove it from its column
-    auto& column = unreached_states_by_time[stateid.time()];
-    const auto it = std::find(column.begin(), column.end(), stateid);
-    if (it == column.end()) {
-      throw std::logic_error("the state must exist in the column");
-    }
-    column.erase(it);
-
-    // Since current column is empty now, earlier labels can't reach
-    // future winners in a optimal way any more, so we mark time + 1
-    // as the earliest time to skip all earlier labels
-    if (column.empty()) {
-      earliest_time_ = stateid.time() + 1;
-    }
+    const auto in_beam = Scan(label);
 
     // If it's the first state that arrives at this column, mark it as
     // the winner at this time
@@ -596,7 +678,9 @@ StateId::Time ViterbiSearch::IterativeSearch(StateId::Time target, bool request_
       break;
     }
 
-    AddSuccessorsToQueue(stateid);
+    if (in_beam) {
+      AddSuccessorsToQueue(stateid);
+    }
   }
 
   // Guarantee that either winner (if found) or invalid stateid (not
@@ -613,6 +697,53 @@ StateId::Time ViterbiSearch::IterativeSearch(StateId::Time target, bool request_
   return searched_time;
 }
 
+bool ViterbiSearch::Scan(const StateLabel& label) {
+  const auto& stateid = label.stateid();
+  const auto& inserted = scanned_labels_.emplace(stateid, label);
+  if (!inserted.second) {
+    throw std::logic_error("the principle of optimality is violated in the viterbi search,"
+                           " probably negative costs occurred");
+  }
+
+  // Remove it from its column
+  auto& column = unreached_states_by_time[stateid.time()];
+  const auto it = std::find(column.begin(), column.end(), stateid);
+  if (it == column.end()) {
+    throw std::logic_error("the state must exist in the column");
+  }
+  column.erase(it);
+
+  // Since current column is empty now, earlier labels can't reach
+  // future winners in a optimal way any more, so we mark time + 1
+  // as the earliest time to skip all earlier labels
+  if (column.empty()) {
+    earliest_time_ = stateid.time() + 1;
+  }
+
+  if (scanned_count_by_time_.size() <= stateid.time()) {
+    scanned_count_by_time_.resize(stateid.time() + 1);
+  }
+  const auto scanned_count = ++scanned_count_by_time_[stateid.time()];
+
+  // Once the beam is full earlier labels can't get into it any more, so the same goes for them
+  if (beam_width_ != 0 && scanned_count == beam_width_) {
+    earliest_time_ = std::max(earliest_time_, stateid.time());
+  }
+  return beam_width_ == 0 || scanned_count <= beam_width_;
+}
+
+bool ViterbiSearch::IsBeamFull(StateId::Time time) const {
+  return beam_width_ != 0 && time < scanned_count_by_time_.size() &&
+         beam_width_ <= scanned_count_by_time_[time];
+}
+
+StateId ViterbiSearch::PathPredecessor(const StateId& stateid, StateId::Time time) const {
+  // Like walking the path with SearchPathVS without breaks and starting over at the winner before
+  // a break, which is how the path is put together in the end
+  const auto predecessor = Predecessor(stateid);
+  return predecessor.IsValid() ? predecessor : winner_by_time[time - 1];
+}
+
 constexpr bool ViterbiSearch::IsInvalidCost(double cost) {
   return cost < 0.f;
 }
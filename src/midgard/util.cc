@@ -23,6 +23,16 @@
 #include <random>
 #include <vector>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VALHALLA_PROJECT_SSE2
+// the avx2 kernel is compiled for its own target and only used when the cpu has it
+#if defined(__GNUC__) || defined(__clang__)
+#include <immintrin.h>
+#define VALHALLA_PROJECT_AVX2
+#endif
+#endif
+
 namespace {
 
 std::vector<valhalla::midgard::PointLL>
@@ -852,5 +862,205 @@ std::string decode64(const std::string& encoded) {
   return decoded;
 }
 
+namespace {
+
+// the closest projection found so far
+struct closest_t {
+  PointLL point;
+  double sq_distance;
+  size_t index;
+};
+
+static_assert(sizeof(PointLL) == 2 * sizeof(double), "The shape has to be contiguous coordinates");
+
+// takes the closest of the lanes, on a tie the first segment is the closest like when they are
+// projected onto one at a time
+inline void reduce_lanes(const double* sq_distances,
+                         const double* xs,
+                         const double* ys,
+                         const double* indices,
+                         const size_t lanes,
+                         closest_t& closest) {
+  for (size_t lane = 0; lane < lanes; ++lane) {
+    if (indices[lane] < 0) {
+      continue;
+    }
+    const auto index = static_cast<size_t>(indices[lane]);
+    if (sq_distances[lane] < closest.sq_distance ||
+        (sq_distances[lane] == closest.sq_distance && index < closest.index)) {
+      closest = {{xs[lane], ys[lane]}, sq_distances[lane], index};
+    }
+  }
+}
+
+#ifdef VALHALLA_PROJECT_SSE2
+inline __m128d select(const __m128d mask, const __m128d a, const __m128d b) {
+  return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+}
+
+// projects onto 2 segments at a time, returns the first segment it didnt get to
+size_t
+project_sse2(const projector_t& p, const PointLL* shape, const size_t count, closest_t& closest) {
+  if (count < 3) {
+    return 0;
+  }
+  const __m128d lng = _mm_set1_pd(p.lng), lat = _mm_set1_pd(p.lat);
+  const __m128d lon_scale = _mm_set1_pd(p.lon_scale), zero = _mm_setzero_pd();
+  const __m128d m_per_lat = _mm_set1_pd(kMetersPerDegreeLat);
+  const __m128d m_per_lng = _mm_set1_pd(p.approx.GetLngScale() * kMetersPerDegreeLat);
+  const __m128d two = _mm_set1_pd(2.0);
+  __m128d best_d = _mm_set1_pd(std::numeric_limits<double>::max());
+  __m128d best_x = zero, best_y = zero, best_i = _mm_set1_pd(-1.0);
+  __m128d index = _mm_set_pd(1.0, 0.0);
+
+  size_t i = 0;
+  __m128d a = _mm_loadu_pd(&shape[0].first);
+  for (; i + 2 < count; i += 2) {
+    const __m128d b = _mm_loadu_pd(&shape[i + 1].first);
+    const __m128d c = _mm_loadu_pd(&shape[i + 2].first);
+    const __m128d ux = _mm_unpacklo_pd(a, b), uy = _mm_unpackhi_pd(a, b);
+    const __m128d vx = _mm_unpacklo_pd(b, c), vy = _mm_unpackhi_pd(b, c);
+    a = c;
+
+    // the same arithmetic as projector_t::operator() for single segments
+    const __m128d bx = _mm_sub_pd(vx, ux), by = _mm_sub_pd(vy, uy);
+    const __m128d bx2 = _mm_mul_pd(bx, lon_scale);
+    const __m128d sq = _mm_add_pd(_mm_mul_pd(bx2, bx2), _mm_mul_pd(by, by));
+    const __m128d scale = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(_mm_sub_pd(lng, ux), lon_scale), bx2),
+                                     _mm_mul_pd(_mm_sub_pd(lat, uy), by));
+    const __m128d before = _mm_cmple_pd(scale, zero), after = _mm_cmpge_pd(scale, sq);
+    const __m128d along = _mm_div_pd(scale, sq);
+    __m128d x = _mm_add_pd(ux, _mm_mul_pd(bx, along)), y = _mm_add_pd(uy, _mm_mul_pd(by, along));
+    x = select(before, ux, select(after, vx, x));
+    y = select(before, uy, select(after, vy, y));
+
+    // the same arithmetic as DistanceApproximator::DistanceSquared
+    const __m128d dy = _mm_mul_pd(_mm_sub_pd(y, lat), m_per_lat);
+    const __m128d dx = _mm_mul_pd(_mm_sub_pd(x, lng), m_per_lng);
+    const __m128d d = _mm_add_pd(_mm_mul_pd(dy, dy), _mm_mul_pd(dx, dx));
+
+    const __m128d closer = _mm_cmplt_pd(d, best_d);
+    best_d = select(closer, d, best_d);
+    best_x = select(closer, x, best_x);
+    best_y = select(closer, y, best_y);
+    best_i = select(closer, index, best_i);
+    index = _mm_add_pd(index, two);
+  }
+
+  alignas(16) double ds[2], xs[2], ys[2], is[2];
+  _mm_store_pd(ds, best_d);
+  _mm_store_pd(xs, best_x);
+  _mm_store_pd(ys, best_y);
+  _mm_store_pd(is, best_i);
+  reduce_lanes(ds, xs, ys, is, 2, closest);
+  return i;
+}
+#endif
+
+#ifdef VALHALLA_PROJECT_AVX2
+// loads the coordinates of 4 consecutive points
+__attribute__((target("avx2"))) inline void
+load4(const PointLL* points, __m256d& xs, __m256d& ys) {
+  const __m256d a = _mm256_loadu_pd(&points[0].first);
+  const __m256d b = _mm256_loadu_pd(&points[2].first);
+  // the unpacking works within 128 bit lanes, the permute puts the points back in order
+  xs = _mm256_permute4x64_pd(_mm256_unpacklo_pd(a, b), 0xD8);
+  ys = _mm256_permute4x64_pd(_mm256_unpackhi_pd(a, b), 0xD8);
+}
+
+// projects onto 4 segments at a time, returns the first segment it didnt get to
+__attribute__((target("avx2"))) size_t
+project_avx2(const projector_t& p, const PointLL* shape, const size_t count, closest_t& closest) {
+  const __m256d lng = _mm256_set1_pd(p.lng), lat = _mm256_set1_pd(p.lat);
+  const __m256d lon_scale = _mm256_set1_pd(p.lon_scale), zero = _mm256_setzero_pd();
+  const __m256d m_per_lat = _mm256_set1_pd(kMetersPerDegreeLat);
+  const __m256d m_per_lng = _mm256_set1_pd(p.approx.GetLngScale() * kMetersPerDegreeLat);
+  const __m256d four = _mm256_set1_pd(4.0);
+  __m256d best_d = _mm256_set1_pd(std::numeric_limits<double>::max());
+  __m256d best_x = zero, best_y = zero, best_i = _mm256_set1_pd(-1.0);
+  __m256d index = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+
+  size_t i = 0;
+  for (; i + 4 < count; i += 4) {
+    __m256d ux, uy, vx, vy;
+    load4(shape + i, ux, uy);
+    load4(shape + i + 1, vx, vy);
+
+    // the same arithmetic as projector_t::operator() for single segments
+    const __m256d bx = _mm256_sub_pd(vx, ux), by = _mm256_sub_pd(vy, uy);
+    const __m256d bx2 = _mm256_mul_pd(bx, lon_scale);
+    const __m256d sq = _mm256_add_pd(_mm256_mul_pd(bx2, bx2), _mm256_mul_pd(by, by));
+    const __m256d scale =
+        _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(_mm256_sub_pd(lng, ux), lon_scale), bx2),
+                      _mm256_mul_pd(_mm256_sub_pd(lat, uy), by));
+    const __m256d before = _mm256_cmp_pd(scale, zero, _CMP_LE_OQ);
+    const __m256d after = _mm256_cmp_pd(scale, sq, _CMP_GE_OQ);
+    const __m256d along = _mm256_div_pd(scale, sq);
+    __m256d x = _mm256_add_pd(ux, _mm256_mul_pd(bx, along));
+    __m256d y = _mm256_add_pd(uy, _mm256_mul_pd(by, along));
+    x = _mm256_blendv_pd(_mm256_blendv_pd(x, vx, after), ux, before);
+    y = _mm256_blendv_pd(_mm256_blendv_pd(y, vy, after), uy, before);
+
+    // the same arithmetic as DistanceApproximator::DistanceSquared
+    const __m256d dy = _mm256_mul_pd(_mm256_sub_pd(y, lat), m_per_lat);
+    const __m256d dx = _mm256_mul_pd(_mm256_sub_pd(x, lng), m_per_lng);
+    const __m256d d = _mm256_add_pd(_mm256_mul_pd(dy, dy), _mm256_mul_pd(dx, dx));
+
+    const __m256d closer = _mm256_cmp_pd(d, best_d, _CMP_LT_OQ);
+    best_d = _mm256_blendv_pd(best_d, d, closer);
+    best_x = _mm256_blendv_pd(best_x, x, closer);
+    best_y = _mm256_blendv_pd(best_y, y, closer);
+    best_i = _mm256_blendv_pd(best_i, index, closer);
+    index = _mm256_add_pd(index, four);
+  }
+
+  alignas(32) double ds[4], xs[4], ys[4], is[4];
+  _mm256_store_pd(ds, best_d);
+  _mm256_store_pd(xs, best_x);
+  _mm256_store_pd(ys, best_y);
+  _mm256_store_pd(is, best_i);
+  reduce_lanes(ds, xs, ys, is, 4, closest);
+  return i;
+}
+
+const bool has_avx2 = []() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}();
+#endif
+
+} // namespace
+
+size_t projector_t::operator()(const std::vector<PointLL>& shape,
+                               PointLL& point,
+                               double& sq_distance) const {
+  closest_t closest{point, std::numeric_limits<double>::max(), 0};
+
+  // as many segments as possible at once
+  size_t i = 0;
+#ifdef VALHALLA_PROJECT_AVX2
+  if (has_avx2) {
+    i = project_avx2(*this, shape.data(), shape.size(), closest);
+  } else {
+    i = project_sse2(*this, shape.data(), shape.size(), closest);
+  }
+#elif defined(VALHALLA_PROJECT_SSE2)
+  i = project_sse2(*this, shape.data(), shape.size(), closest);
+#endif
+
+  // the rest of them one at a time
+  for (; i + 1 < shape.size(); ++i) {
+    auto projection = (*this)(shape[i], shape[i + 1]);
+    auto distance = approx.DistanceSquared(projection);
+    if (distance < closest.sq_distance) {
+      closest = {projection, distance, i};
+    }
+  }
+
+  point = closest.point;
+  sq_distance = closest.sq_distance;
+  return closest.index;
+}
+
 } // namespace midgard
 } // namespace valhalla
@@ -0,0 +1,168 @@
+#include "mjolnir/candidateindexbuilder.h"
+#include "baldr/candidateindex.h"
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/tilehierarchy.h"
+#include "meili/grid_traversal.h"
+#include "midgard/logging.h"
+#include "mjolnir/graphtilebuilder.h"
+#include "scoped_timer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+// no index unless asked for, at the default meili grid size the offsets of the cells alone take
+// up 1MB per tile
+constexpr uint32_t kDefaultGridSize = 0;
+// keeps the offsets of the cells of a tile under 4MB
+constexpr uint32_t kMaxGridSize = 1000;
+
+void add_candidate_index(const boost::property_tree::ptree& pt,
+                         const std::vector<GraphId>& tile_ids,
+                         std::atomic<size_t>& next_tile,
+                         const uint32_t grid_size) {
+  GraphReader reader(pt.get_child("mjolnir"));
+  const auto tile_size = TileHierarchy::levels().back().tiles.TileSize();
+
+  // the same cells a meili grid of the same size would have
+  CandidateIndexHeader index_header{};
+  index_header.cell_width = tile_size / grid_size;
+  index_header.cell_height = tile_size / grid_size;
+
+  std::unordered_map<uint64_t, uint32_t> edge_indices;
+  std::vector<CandidateIndexEdge> edges;
+  std::vector<std::pair<uint32_t, uint32_t>> cell_edges;
+  std::vector<uint32_t> cells, entries;
+  for (size_t i = next_tile++; i < tile_ids.size(); i = next_tile++) {
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+    auto tile = reader.GetGraphTile(tile_ids[i]);
+    if (!tile) {
+      continue;
+    }
+
+    const auto bbox = tile->BoundingBox();
+    index_header.columns = std::ceil((bbox.maxx() - bbox.minx()) / index_header.cell_width);
+    index_header.rows = std::ceil((bbox.maxy() - bbox.miny()) / index_header.cell_height);
+    const valhalla::meili::GridTraversal<PointLL> grid(bbox.minx(), bbox.miny(),
+                                                       index_header.cell_width,
+                                                       index_header.cell_height,
+                                                       index_header.columns, index_header.rows);
+
+    // every cell each segment of each edge of the bins passes through
+    edge_indices.clear();
+    edges.clear();
+    cell_edges.clear();
+    for (size_t bin = 0; bin < kBinCount; ++bin) {
+      for (const auto edge_id : tile->GetBin(bin)) {
+        // edges in a bin can be in a neighboring tile if they pass through this one
+        auto edge_tile = tile;
+        if (!reader.GetGraphTile(edge_id, edge_tile)) {
+          continue;
+        }
+        auto shape = edge_tile->edgeinfo(edge_tile->directededge(edge_id)).lazy_shape();
+        if (shape.empty()) {
+          continue;
+        }
+
+        const auto inserted = edge_indices.emplace(edge_id.value, edges.size());
+        if (inserted.second) {
+          edges.push_back({static_cast<uint32_t>(edge_id.Tile_Base().value), edge_id.id()});
+        }
+        PointLL v = shape.pop();
+        while (!shape.empty()) {
+          const PointLL u = v;
+          v = shape.pop();
+          for (const auto& square : grid.Traverse(u, v)) {
+            cell_edges.emplace_back(square.second * index_header.columns + square.first,
+                                    inserted.first->second);
+          }
+        }
+      }
+    }
+    std::sort(cell_edges.begin(), cell_edges.end());
+    cell_edges.erase(std::unique(cell_edges.begin(), cell_edges.end()), cell_edges.end());
+
+    // the entries of the cells one after the other, each cell knows where its entries begin
+    cells.assign(index_header.columns * index_header.rows + 1, 0);
+    entries.clear();
+    entries.reserve(cell_edges.size());
+    auto cell_edge = cell_edges.cbegin();
+    for (uint32_t cell = 0; cell < cells.size(); ++cell) {
+      cells[cell] = entries.size();
+      for (; cell_edge != cell_edges.cend() && cell_edge->first == cell; ++cell_edge) {
+        entries.push_back(cell_edge->second);
+      }
+    }
+    index_header.edge_count = edges.size();
+    index_header.entry_count = entries.size();
+
+    try {
+      GraphTileBuilder::AddCandidateIndex(pt.get<std::string>("mjolnir.tile_dir"), tile,
+                                          index_header, edges, cells, entries);
+    } catch (const std::exception& e) {
+      LOG_ERROR("Failed to store the candidate index of tile " + std::to_string(tile_ids[i]) +
+                ": " + e.what());
+    }
+  }
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+void CandidateIndexBuilder::Build(const boost::property_tree::ptree& pt) {
+  const auto grid_size = pt.get<uint32_t>("mjolnir.candidate_index.grid_size", kDefaultGridSize);
+  if (grid_size == 0) {
+    LOG_INFO("Skipping candidate index builder");
+    return;
+  }
+  if (grid_size > kMaxGridSize) {
+    throw std::runtime_error("The candidate index can have at most " +
+                             std::to_string(kMaxGridSize) + " cells along each side of a tile");
+  }
+
+  SCOPED_TIMER();
+  std::vector<GraphId> tile_ids;
+  {
+    GraphReader reader(pt.get_child("mjolnir"));
+    const auto local_level = TileHierarchy::levels().back().level;
+    for (const auto& tile_id : reader.GetTileSet(local_level)) {
+      tile_ids.push_back(tile_id);
+    }
+  }
+
+  // tiles are handed out one at a time, some take much longer than others
+  const auto nthreads =
+      std::max(static_cast<uint32_t>(1),
+               pt.get<uint32_t>("mjolnir.concurrency", std::thread::hardware_concurrency()));
+  LOG_INFO("Storing the candidate index of " + std::to_string(tile_ids.size()) +
+           " tiles with " + std::to_string(nthreads) + " threads...");
+  std::atomic<size_t> next_tile(0);
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < nthreads; ++i) {
+    threads.emplace_back(add_candidate_index, std::cref(pt), std::cref(tile_ids),
+                         std::ref(next_tile), grid_size);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  LOG_INFO("Finished");
+}
+
+} // namespace mjolnir
+} // namespace valhalla
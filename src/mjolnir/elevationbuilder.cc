@@ -2,6 +2,7 @@
 #include "baldr/graphconstants.h"
 #include "baldr/graphid.h"
 #include "baldr/graphreader.h"
+#include "baldr/tilehierarchy.h"
 #include "midgard/elevation_encoding.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
@@ -9,14 +10,21 @@
 #include "midgard/polyline2.h"
 #include "midgard/util.h"
 #include "mjolnir/graphtilebuilder.h"
+#include "mjolnir/tilescheduler.h"
 #include "scoped_timer.h"
 #include "skadi/sample.h"
 #include "skadi/util.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <filesystem>
-#include <random>
+#include <map>
 #include <thread>
+#include <tuple>
 #include <utility>
+#include <vector>
 
 using namespace valhalla::midgard;
 using namespace valhalla::baldr;
@@ -36,19 +44,7 @@ using cache_t =
 /**
  * Encode elevation along an edge to store in tiles.
  */
-std::vector<int8_t> encode_edge_elevation(const std::unique_ptr<valhalla::skadi::sample>& sample,
-                                          const std::vector<PointLL>& shape,
-                                          const uint32_t length,
-                                          uint32_t wayid) {
-  // Uniformly resample the polyline to create the desired number of vertices
-  uint32_t n = encoded_elevation_count(length) + 2;
-  std::vector<PointLL> resampled =
-      valhalla::midgard::uniform_resample_spherical_polyline(shape, length, n);
-
-  // Get elevation (height) at each sampled point along the edge.
-  std::vector<double> heights(resampled.size());
-  heights = sample->get_all(resampled);
-
+std::vector<int8_t> encode_edge_elevation(const std::vector<double>& heights, uint32_t wayid) {
   // Encode the elevation.
   bool error = false;
   std::vector<int8_t> encoded = encode_elevation(heights, error);
@@ -68,17 +64,11 @@ std::vector<int8_t> encode_edge_elevation(const std::unique_ptr<valhalla::skadi:
 /**
  * Encode elevation for a bridge, tunnel, ferry.
  */
-std::vector<int8_t> encode_btf_elevation(const std::unique_ptr<valhalla::skadi::sample>& sample,
-                                         const std::vector<PointLL>& shape,
-                                         const uint32_t length,
-                                         uint32_t wayid) {
+std::vector<int8_t>
+encode_btf_elevation(const double h1, const double h2, const uint32_t length, uint32_t wayid) {
   // Compute a uniform sampling interval along the edge based on its length.
   double interval = sampling_interval(length);
 
-  // Sample at the first and last shape point
-  double h1 = sample->get(shape.front());
-  double h2 = sample->get(shape.back());
-
   // Use linear interpolation from h1 to h2 along the length of the edge
   uint32_t n = static_cast<uint32_t>(length / interval) + 1;
   std::vector<double> heights(n);
@@ -105,11 +95,40 @@ std::vector<int8_t> encode_btf_elevation(const std::unique_ptr<valhalla::skadi::
   return e;
 }
 
+// How much of the work is done, for the throughput once it is all done
+struct progress_t {
+  std::atomic<uint64_t> tiles{0};
+  std::atomic<uint64_t> edges{0};
+  std::atomic<uint64_t> postings{0};
+};
+
+// The postings of a shape in the postings of its whole tile
+struct postings_range_t {
+  size_t begin;
+  size_t count;
+
+  std::vector<double> heights(const std::vector<double>& all) const {
+    return {all.cbegin() + begin, all.cbegin() + begin + count};
+  }
+};
+
+// Where to find the heights of an edge info, all of the shape postings of a tile are sampled at
+// once so that each elevation tile is looked up once per graph tile and sampled in bulk
+struct edge_postings_t {
+  // For the grades, the resampled shape or just its ends for bridges, tunnels and ferries
+  postings_range_t grade;
+  // How many points the shape was resampled to, the grades are computed over as many heights
+  size_t resampled_count;
+  // For the encoded elevation along the edge, the ends of the shape for bridges, tunnels and ferries
+  postings_range_t encoded;
+};
+
 void add_elevations_to_single_tile(GraphReader& graphreader,
                                    std::mutex& graphreader_lck,
                                    cache_t& cache,
                                    const std::unique_ptr<valhalla::skadi::sample>& sample,
-                                   GraphId& tile_id) {
+                                   GraphId& tile_id,
+                                   progress_t& progress) {
   // Get the tile. Serialize the entire tile?
   GraphTileBuilder tilebuilder(graphreader.tile_dir(), tile_id, true);
 
@@ -117,13 +136,17 @@ void add_elevations_to_single_tile(GraphReader& graphreader,
   // retrieved/used?
   tilebuilder.header_builder().set_has_elevation(true);
 
-  // Iterate through the nodes edges, get the node lat,lng, sample and store elevation.
+  // Everything in the tile that needs a height, starting with the nodes
+  std::vector<PointLL> postings;
+  postings.reserve(tilebuilder.header()->nodecount());
   for (uint32_t i = 0; i < tilebuilder.header()->nodecount(); ++i) {
-    // Get a writeable reference to the node edge
-    NodeInfo& nodeinfo = tilebuilder.node_builder(i);
-    PointLL ll = nodeinfo.latlng(tilebuilder.header()->base_ll());
-    nodeinfo.set_elevation(sample->get(ll));
+    postings.push_back(tilebuilder.node_builder(i).latlng(tilebuilder.header()->base_ll()));
   }
+  auto add_postings = [&postings](const std::vector<PointLL>& points) {
+    postings_range_t range{postings.size(), points.size()};
+    postings.insert(postings.end(), points.cbegin(), points.cend());
+    return range;
+  };
 
   // Reserve twice the number of directed edges in the tile. We do not directly know
   // how many EdgeInfo records exist but it cannot be more than 2x the directed edge count.
@@ -139,6 +162,46 @@ void add_elevations_to_single_tile(GraphReader& graphreader,
     edge_info_offsets.insert(std::pair<uint32_t, uint32_t>(edge_info_offset, i));
   }
 
+  // Then the shape of each edge info
+  std::unordered_map<uint32_t, edge_postings_t> edge_postings;
+  edge_postings.reserve(2 * count);
+  for (auto& elem : edge_info_offsets) {
+    if (edge_postings.count(elem.first)) {
+      continue;
+    }
+    DirectedEdge& directededge = tilebuilder.directededge_builder(elem.second);
+
+    // Get the shape and length
+    auto shape = tilebuilder.edgeinfo(&directededge).shape();
+    auto length = directededge.length();
+
+    // Evenly sample the shape and add the last shape point. TODO - if close to the end do not!
+    std::vector<PointLL> resampled =
+        valhalla::midgard::resample_spherical_polyline(shape, POSTING_INTERVAL);
+    resampled.push_back(shape.back());
+
+    // Bridges, tunnels and ferries are interpolated between their ends
+    edge_postings_t edge;
+    edge.resampled_count = resampled.size();
+    if (directededge.bridge() || directededge.tunnel() || directededge.use() == Use::kFerry) {
+      edge.grade = add_postings({resampled.front(), resampled.back()});
+      edge.encoded = add_postings({shape.front(), shape.back()});
+    } else {
+      edge.grade = add_postings(resampled);
+      // Uniformly resample the polyline to create the desired number of vertices
+      uint32_t n = encoded_elevation_count(length) + 2;
+      edge.encoded =
+          add_postings(valhalla::midgard::uniform_resample_spherical_polyline(shape, length, n));
+    }
+    edge_postings.emplace(elem.first, edge);
+  }
+
+  // Get the heights of all of them at once
+  const auto heights = sample->get_all(postings);
+  for (uint32_t i = 0; i < tilebuilder.header()->nodecount(); ++i) {
+    tilebuilder.node_builder(i).set_elevation(heights[i]);
+  }
+
   // Map existing edge info offsets to new (after adding encoded elevation)
   std::unordered_map<uint32_t, uint32_t> new_offsets;
 
@@ -154,40 +217,31 @@ void add_elevations_to_single_tile(GraphReader& graphreader,
     // Check if this edge has been cached (based on edge info offset)
     auto found = cache.find(edge_info_offset);
     if (found == cache.cend()) {
-      // Get the shape and length
-      auto shape = tilebuilder.edgeinfo(&directededge).shape();
+      const auto& edge = edge_postings.find(edge_info_offset)->second;
       auto length = directededge.length();
+      bool btf = directededge.bridge() || directededge.tunnel() || directededge.use() == Use::kFerry;
 
       // Grade estimation and max slopes
       std::tuple<double, double, double, double> forward_grades(0.0, 0.0, 0.0, 0.0);
       std::tuple<double, double, double, double> reverse_grades(0.0, 0.0, 0.0, 0.0);
 
-      // Evenly sample the shape and add the last shape point. TODO - if close to the end do not!
-      std::vector<PointLL> resampled =
-          valhalla::midgard::resample_spherical_polyline(shape, POSTING_INTERVAL);
-      resampled.push_back(shape.back());
-
       // Get the heights at each sampled point.
-      std::vector<double> heights(resampled.size());
-      if (directededge.bridge() || directededge.tunnel() || directededge.use() == Use::kFerry) {
+      std::vector<double> grade_heights(edge.resampled_count);
+      if (btf) {
         // Get height at beginning and end of bridge/tunnel
-        std::vector<PointLL> tmp;
-        tmp.emplace_back(resampled.front());
-        tmp.emplace_back(resampled.back());
-        auto h = sample->get_all(tmp);
-        heights[0] = h[0];
-        float dh = (h[1] - heights[0]) / heights.size();
-        for (size_t i = 1; i < heights.size(); ++i) {
-          heights[i] = heights[i - 1] + dh;
+        grade_heights[0] = heights[edge.grade.begin];
+        float dh = (heights[edge.grade.begin + 1] - grade_heights[0]) / grade_heights.size();
+        for (size_t i = 1; i < grade_heights.size(); ++i) {
+          grade_heights[i] = grade_heights[i - 1] + dh;
         }
       } else {
-        heights = sample->get_all(resampled);
+        grade_heights = edge.grade.heights(heights);
       }
 
       // Compute "weighted" grades as well as max grades in both directions. Valid range
       // for weighted grades is between -10 and +15 which is then mapped to a value
       // between 0 to 15 for use in costing.
-      auto grades = valhalla::skadi::weighted_grade(heights, POSTING_INTERVAL);
+      auto grades = valhalla::skadi::weighted_grade(grade_heights, POSTING_INTERVAL);
       if (length < kMinimumInterval) {
         // Keep the default grades - but set the mean elevation
         forward_grades = std::make_tuple(0.0, 0.0, 0.0, std::get<3>(grades));
@@ -196,8 +250,8 @@ void add_elevations_to_single_tile(GraphReader& graphreader,
         // Set the forward grades. Reverse the path and compute the
         // weighted grade in reverse direction.
         forward_grades = grades;
-        std::reverse(heights.begin(), heights.end());
-        reverse_grades = valhalla::skadi::weighted_grade(heights, POSTING_INTERVAL);
+        std::reverse(grade_heights.begin(), grade_heights.end());
+        reverse_grades = valhalla::skadi::weighted_grade(grade_heights, POSTING_INTERVAL);
       }
 
       // Add elevation info to the geo attribute cache.
@@ -218,10 +272,11 @@ void add_elevations_to_single_tile(GraphReader& graphreader,
       // Bridges, tunnels, ferries are special cases. Increment the new edge info offset.
       std::vector<int8_t> encoded;
       auto wayid = tilebuilder.edgeinfo(&directededge).wayid();
-      if (directededge.bridge() || directededge.tunnel() || directededge.use() == Use::kFerry) {
-        encoded = encode_btf_elevation(sample, shape, length, wayid);
+      if (btf) {
+        encoded = encode_btf_elevation(heights[edge.encoded.begin], heights[edge.encoded.begin + 1],
+                                       length, wayid);
       } else {
-        encoded = encode_edge_elevation(sample, shape, length, wayid);
+        encoded = encode_edge_elevation(edge.encoded.heights(heights), wayid);
       }
       ei_offset += tilebuilder.set_elevation(edge_info_offset, mean_elevation, encoded);
     }
@@ -251,6 +306,9 @@ void add_elevations_to_single_tile(GraphReader& graphreader,
 
   // Update the tile
   tilebuilder.StoreTileData();
+  progress.tiles++;
+  progress.edges += edge_postings.size();
+  progress.postings += postings.size();
 
   // Check if we need to clear the tile cache
   if (graphreader.OverCommitted()) {
@@ -261,12 +319,13 @@ void add_elevations_to_single_tile(GraphReader& graphreader,
 }
 
 /**
- * Adds elevation to a set of tiles. Each thread pulls a tile of the queue
+ * Adds elevation to a set of tiles. Each thread gets its tiles from the scheduler
  */
 void add_elevations_to_multiple_tiles(const boost::property_tree::ptree& pt,
-                                      std::deque<GraphId>& tilequeue,
+                                      TileScheduler::Worker& worker,
                                       std::mutex& lock,
-                                      const std::unique_ptr<valhalla::skadi::sample>& sample) {
+                                      const std::unique_ptr<valhalla::skadi::sample>& sample,
+                                      progress_t& progress) {
   // Local Graphreader
   GraphReader graphreader(pt.get_child("mjolnir"));
 
@@ -276,35 +335,52 @@ void add_elevations_to_multiple_tiles(const boost::property_tree::ptree& pt,
   cache_t geo_attribute_cache;
 
   // Check for more tiles
-  while (true) {
-    lock.lock();
-    if (tilequeue.empty()) {
-      lock.unlock();
-      break;
-    }
-    // Get the next tile Id
-    GraphId tile_id = tilequeue.front();
-    tilequeue.pop_front();
-    lock.unlock();
-
-    add_elevations_to_single_tile(graphreader, lock, geo_attribute_cache, sample, tile_id);
+  GraphId tile_id;
+  while (worker.next(tile_id)) {
+    add_elevations_to_single_tile(graphreader, lock, geo_attribute_cache, sample, tile_id,
+                                  progress);
   }
 }
 
 std::deque<GraphId> get_tile_ids(const boost::property_tree::ptree& pt) {
   std::deque<GraphId> tilequeue;
   GraphReader reader(pt.get_child("mjolnir"));
-  // Create a randomized queue of tiles (at all levels) to work from
+  // Create a queue of tiles (at all levels) to work from
   auto tileset = reader.GetTileSet();
   for (const auto& id : tileset)
     tilequeue.emplace_back(id);
 
-  std::random_device rd;
-  std::shuffle(tilequeue.begin(), tilequeue.end(), std::mt19937(rd()));
-
   return tilequeue;
 }
 
+/**
+ * Schedules the tiles grouped by the elevation tile their center is in. The threads take the tiles
+ * in turn, so they all work on the same few elevation tiles at any time and the sampler keeps those
+ * unpacked instead of unpacking and evicting tiles all over the world. The groups with the most
+ * graph tile bytes go first, every tile of a group is weighted by the size of the whole group.
+ */
+void schedule_by_elevation_tile(TileScheduler& scheduler,
+                                const std::deque<GraphId>& tile_ids,
+                                const std::string& tile_dir) {
+  auto elevation_tile = [](const GraphId& id) {
+    auto center = TileHierarchy::get_tiling(id.level()).Center(id.tileid());
+    return std::make_pair(static_cast<int>(std::floor(center.lat())),
+                          static_cast<int>(std::floor(center.lng())));
+  };
+  std::map<std::pair<int, int>, std::pair<uint64_t, std::vector<GraphId>>> groups;
+  for (const auto& id : tile_ids) {
+    auto& group = groups[elevation_tile(id)];
+    group.first += TileScheduler::tile_size(tile_dir, id);
+    group.second.push_back(id);
+  }
+  for (auto& group : groups) {
+    std::sort(group.second.second.begin(), group.second.second.end());
+    for (const auto& id : group.second.second) {
+      scheduler.add(id, group.second.first);
+    }
+  }
+}
+
 } // namespace
 
 namespace valhalla {
@@ -327,22 +403,25 @@ void ElevationBuilder::Build(const boost::property_tree::ptree& pt,
 
   if (tile_ids.empty())
     tile_ids = get_tile_ids(pt);
-
-  std::vector<std::shared_ptr<std::thread>> threads(nthreads);
+  TileScheduler scheduler("Adding elevation", nthreads);
+  schedule_by_elevation_tile(scheduler, tile_ids, pt.get<std::string>("mjolnir.tile_dir", ""));
 
   LOG_INFO("Adding elevation to " + std::to_string(tile_ids.size()) + " tiles with " +
            std::to_string(nthreads) + " threads...");
   std::mutex lock;
-  for (auto& thread : threads) {
-    thread = std::make_shared<std::thread>(add_elevations_to_multiple_tiles, std::cref(pt),
-                                           std::ref(tile_ids), std::ref(lock), std::ref(sample));
-  }
-
-  for (auto& thread : threads) {
-    thread->join();
-  }
-
-  LOG_INFO("Finished");
+  progress_t progress;
+  const auto start = std::chrono::steady_clock::now();
+  scheduler.run([&](TileScheduler::Worker& worker) {
+    add_elevations_to_multiple_tiles(pt, worker, lock, sample, progress);
+  });
+
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  const auto seconds = std::max(elapsed.count(), 1e-9);
+  LOG_INFO("Finished adding elevation to " + std::to_string(progress.tiles) + " tiles, " +
+           std::to_string(progress.edges) + " edge shapes and " +
+           std::to_string(progress.postings) + " postings in " + std::to_string(elapsed.count()) +
+           "s (" + std::to_string(static_cast<uint64_t>(progress.tiles / seconds)) + " tiles/s, " +
+           std::to_string(static_cast<uint64_t>(progress.postings / seconds)) + " postings/s)");
 }
 
 } // namespace mjolnir
@@ -20,6 +20,7 @@
 #include "mjolnir/linkclassification.h"
 #include "mjolnir/node_expander.h"
 #include "mjolnir/sqlite3.h"
+#include "mjolnir/tilescheduler.h"
 #include "mjolnir/util.h"
 #include "scoped_timer.h"
 
@@ -43,22 +44,26 @@ namespace {
  * we also need to then update the edges that pointed to them
  *
  */
-std::map<GraphId, size_t> SortGraph(const std::string& nodes_file, const std::string& edges_file) {
+std::map<GraphId, size_t> SortGraph(const std::string& nodes_file,
+                                    const std::string& edges_file,
+                                    const size_t concurrency) {
   LOG_INFO("Sorting graph...");
 
   // Sort nodes by graphid then by grid within the tile. This sorts nodes geo-spatially which
   // helps performance by improving memory coherence.
   sequence<Node> nodes(nodes_file, false);
-  nodes.sort([](const Node& a, const Node& b) {
-    if (a.graph_id == b.graph_id) {
-      if (a.grid_id == b.grid_id) {
-        return a.node.osmid_ < b.node.osmid_;
-      } else {
-        return a.grid_id < b.grid_id;
-      }
-    }
-    return a.graph_id < b.graph_id;
-  });
+  nodes.sort(
+      [](const Node& a, const Node& b) {
+        if (a.graph_id == b.graph_id) {
+          if (a.grid_id == b.grid_id) {
+            return a.node.osmid_ < b.node.osmid_;
+          } else {
+            return a.grid_id < b.grid_id;
+          }
+        }
+        return a.graph_id < b.graph_id;
+      },
+      sequence<Node>::default_sort_buffer_size, concurrency);
 
   // run through the sorted nodes, going back to the edges they reference and updating each edge
   // to point to the first (out of the duplicates) nodes index. at the end of this there will be
@@ -412,8 +417,8 @@ void BuildTileSet(const std::string& ways_file,
                   const std::string& linguistic_node_file,
                   const std::string& tile_dir,
                   const OSMData& osmdata,
-                  std::queue<std::pair<GraphId, size_t>>& tiles,
-                  std::mutex& tiles_lock,
+                  const std::map<GraphId, size_t>& tiles,
+                  TileScheduler::Worker& worker,
                   const uint32_t tile_creation_date,
                   const boost::property_tree::ptree& pt,
                   std::promise<DataQuality>& result) {
@@ -474,17 +479,9 @@ void BuildTileSet(const std::string& ways_file,
   std::map<std::pair<uint8_t, uint8_t>, uint32_t> langMap;
   ////////////////////////////////////////////////////////////////////////////
   // Iterate over tiles
-  while (true) {
-    tiles_lock.lock();
-    if (tiles.empty()) {
-      // all work done
-      tiles_lock.unlock();
-      break;
-    }
-
-    auto tile = tiles.front();
-    tiles.pop();
-    tiles_lock.unlock();
+  GraphId next_tile;
+  while (worker.next(next_tile)) {
+    const auto& tile = *tiles.find(next_tile);
 
     try {
       // What actually writes the tile
@@ -1311,6 +1308,21 @@ void BuildTileSet(const std::string& ways_file,
 }
 
 // Build tiles for the local graph hierarchy
+// Counts the nodes of a tile, they are sorted by tile and the tile knows where its first one is
+size_t tile_node_count(sequence<Node>& nodes, const std::pair<const GraphId, size_t>& tile) {
+  const GraphId tile_id = tile.first.Tile_Base();
+  size_t low = tile.second, high = nodes.size();
+  while (low < high) {
+    const size_t mid = low + (high - low) / 2;
+    if ((*nodes[mid]).graph_id.Tile_Base() == tile_id) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low - tile.second;
+}
+
 void BuildLocalTiles(const unsigned int thread_count,
                      const OSMData& osmdata,
                      const std::string& ways_file,
@@ -1332,37 +1344,22 @@ void BuildLocalTiles(const unsigned int thread_count,
   LOG_INFO("Building " + std::to_string(tiles.size()) + " tiles with " +
            std::to_string(thread_count) + " threads...");
 
-  // A place to hold worker threads and their results, be they exceptions or otherwise
-  std::vector<std::shared_ptr<std::thread>> threads(thread_count);
-
-  // Hold the results (DataQuality/stats) for the threads
-  std::vector<std::promise<DataQuality>> results(threads.size());
-
-  // Divvy up the work
-  std::queue<std::pair<GraphId, size_t>> tile_queue;
-  std::mutex tile_lock;
-  for (auto id : tiles) {
-    tile_queue.emplace(id);
-  }
-
-  // Atomically pass around stats info
-  for (size_t i = 0; i < threads.size(); ++i) {
-    // Make the thread
-    threads[i] =
-        std::make_shared<std::thread>(BuildTileSet, std::cref(ways_file), std::cref(way_nodes_file),
-                                      std::cref(nodes_file), std::cref(edges_file),
-                                      std::cref(complex_from_restriction_file),
-                                      std::cref(complex_to_restriction_file),
-                                      std::cref(linguistic_node_file), std::cref(tile_dir),
-                                      std::cref(osmdata), std::ref(tile_queue), std::ref(tile_lock),
-                                      tile_creation_date, std::cref(pt.get_child("mjolnir")),
-                                      std::ref(results[i]));
+  // Divvy up the work, the tiles with the most nodes first
+  TileScheduler scheduler("Building tiles", thread_count);
+  {
+    sequence<Node> nodes(nodes_file, false);
+    for (const auto& tile : tiles) {
+      scheduler.add(tile.first, tile_node_count(nodes, tile));
+    }
   }
 
-  // Join all the threads to wait for them to finish up their work
-  for (auto& thread : threads) {
-    thread->join();
-  }
+  // Hold the results (DataQuality/stats) for the threads
+  std::vector<std::promise<DataQuality>> results(scheduler.concurrency());
+  scheduler.run([&](TileScheduler::Worker& worker) {
+    BuildTileSet(ways_file, way_nodes_file, nodes_file, edges_file, complex_from_restriction_file,
+                 complex_to_restriction_file, linguistic_node_file, tile_dir, osmdata, tiles, worker,
+                 tile_creation_date, pt.get_child("mjolnir"), results[worker.index()]);
+  });
 
   LOG_INFO("Finished");
 
@@ -1439,7 +1436,9 @@ std::map<GraphId, size_t> GraphBuilder::BuildEdges(const boost::property_tree::p
       },
       pt.get<bool>("mjolnir.data_processing.infer_turn_channels", true));
 
-  return SortGraph(nodes_file, edges_file);
+  return SortGraph(nodes_file, edges_file,
+                   std::max(1U, pt.get<unsigned int>("mjolnir.concurrency",
+                                                     std::thread::hardware_concurrency())));
 }
 
 // Build the graph from the input
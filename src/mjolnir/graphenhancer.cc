@@ -16,6 +16,7 @@
 #include "mjolnir/countryaccess.h"
 #include "mjolnir/graphtilebuilder.h"
 #include "mjolnir/osmaccess.h"
+#include "mjolnir/tilescheduler.h"
 #include "mjolnir/util.h"
 #include "scoped_timer.h"
 #include "speed_assigner.h"
@@ -26,11 +27,8 @@
 #include <functional>
 #include <future>
 #include <limits>
-#include <list>
 #include <memory>
 #include <mutex>
-#include <queue>
-#include <random>
 #include <set>
 #include <stdexcept>
 #include <thread>
@@ -1376,12 +1374,12 @@ bool ConsistentNames(const std::string& country_code,
 }
 
 // We make sure to lock on reading and writing because we dont want to race
-// since difference threads, use for the tilequeue as well
+// between the threads
 void enhance(const boost::property_tree::ptree& pt,
              const OSMData& osmdata,
              const std::string& access_file,
              const boost::property_tree::ptree& hierarchy_properties,
-             std::queue<GraphId>& tilequeue,
+             TileScheduler::Worker& worker,
              std::mutex& lock,
              std::promise<enhancer_stats>& result) {
 
@@ -1419,17 +1417,11 @@ void enhance(const boost::property_tree::ptree& pt,
   enhancer_stats stats{std::numeric_limits<float>::min(), 0, 0, 0, 0, 0, 0, {}};
   const TileLevel& tile_level = TileHierarchy::levels().back();
 
-  // Iterate through the tiles in the queue and perform enhancements
-  while (true) {
-    // Get the next tile Id from the queue and get writeable and readable
-    // tile. Lock while we access the tile queue and get the tile.
+  // Iterate through the tiles the scheduler hands us and perform enhancements
+  GraphId tile_id;
+  while (worker.next(tile_id)) {
+    // Get writeable and readable tile. Lock while we get the tile.
     lock.lock();
-    if (tilequeue.empty()) {
-      lock.unlock();
-      break;
-    }
-    GraphId tile_id = tilequeue.front();
-    tilequeue.pop();
 
     // Get a readable tile.If the tile is empty, skip it. Empty tiles are
     // added where ways go through a tile but no end not is within the tile.
@@ -1825,43 +1817,29 @@ void GraphEnhancer::Enhance(const boost::property_tree::ptree& pt,
   SCOPED_TIMER();
   LOG_INFO("Enhancing local graph...");
 
-  // A place to hold worker threads and their results, exceptions or otherwise
-  std::vector<std::shared_ptr<std::thread>> threads(
-      std::max(static_cast<unsigned int>(1),
-               pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency())));
-
-  // A place to hold the results of those threads, exceptions or otherwise
-  std::list<std::promise<enhancer_stats>> results;
-
-  // Create a randomized queue of tiles to work from
-  std::deque<GraphId> tempqueue;
+  // Schedule the tiles to work on, the largest first
+  TileScheduler scheduler("Enhancing tiles",
+                          pt.get<unsigned int>("mjolnir.concurrency",
+                                               std::thread::hardware_concurrency()));
   boost::property_tree::ptree hierarchy_properties = pt.get_child("mjolnir");
   auto local_level = TileHierarchy::levels().back().level;
   GraphReader reader(hierarchy_properties);
   auto local_tiles = reader.GetTileSet(local_level);
   for (const auto& tile_id : local_tiles) {
-    tempqueue.emplace_back(tile_id);
+    scheduler.add(tile_id, TileScheduler::tile_size(reader.tile_dir(), tile_id));
   }
-  std::random_device rd;
-  std::shuffle(tempqueue.begin(), tempqueue.end(), std::mt19937(rd()));
-  std::queue<GraphId> tilequeue(tempqueue);
+
+  // A place to hold the results of those threads, exceptions or otherwise
+  std::vector<std::promise<enhancer_stats>> results(scheduler.concurrency());
 
   // An atomic object we can use to do the synchronization
   std::mutex lock;
 
-  // Start the threads
-  for (auto& thread : threads) {
-    results.emplace_back();
-    thread =
-        std::make_shared<std::thread>(enhance, std::cref(hierarchy_properties), std::cref(osmdata),
-                                      std::cref(access_file), std::ref(hierarchy_properties),
-                                      std::ref(tilequeue), std::ref(lock), std::ref(results.back()));
-  }
-
-  // Wait for them to finish up their work
-  for (auto& thread : threads) {
-    thread->join();
-  }
+  // Run the threads and wait for them to finish up their work
+  scheduler.run([&](TileScheduler::Worker& worker) {
+    enhance(hierarchy_properties, osmdata, access_file, hierarchy_properties, worker, lock,
+            results[worker.index()]);
+  });
 
   // Check all of the outcomes, to see about maximum density (km/km2)
   enhancer_stats stats{std::numeric_limits<float>::min(), 0, 0, 0, 0, 0, 0, {0}};
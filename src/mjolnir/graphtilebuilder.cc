@@ -253,9 +253,11 @@ void GraphTileBuilder::StoreTileData() {
     std::filesystem::create_directories(filename.parent_path());
   }
 
-  // Open file and truncate
+  // Write to a temporary file and rename it over the tile, readers may have the old one mapped
+  auto tmp_filename = filename;
+  tmp_filename += ".tmp";
   std::stringstream in_mem;
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  std::ofstream file(tmp_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
   if (file.is_open()) {
     // Write the nodes
     header_builder_.set_nodecount(nodes_builder_.size());
@@ -389,9 +391,12 @@ void GraphTileBuilder::StoreTileData() {
     in_mem.write(reinterpret_cast<const char*>(lane_connectivity_builder_.data()),
                  lane_connectivity_builder_.size() * sizeof(LaneConnectivity));
 
-    // Set the end offset
+    // Set the end offset, the candidate index and the stored reach are not rewritten since edges
+    // may have changed
     header_builder_.set_end_offset(header_builder_.lane_connectivity_offset() +
                                    (lane_connectivity_builder_.size() * sizeof(LaneConnectivity)));
+    header_builder_.set_candidate_index_offset(0);
+    header_builder_.set_reach_offset(0);
 
     // Sanity check for the end offset
     uint32_t curr =
@@ -417,8 +422,9 @@ void GraphTileBuilder::StoreTileData() {
     file.write(reinterpret_cast<const char*>(&header_builder_), sizeof(GraphTileHeader));
     file << in_mem.rdbuf();
     file.close();
+    std::filesystem::rename(tmp_filename, filename);
   } else {
-    throw std::runtime_error("Failed to open file " + filename.string());
+    throw std::runtime_error("Failed to open file " + tmp_filename.string());
   }
 }
 
@@ -435,8 +441,10 @@ void GraphTileBuilder::Update(const std::vector<NodeInfo>& nodes,
     std::filesystem::create_directories(filename.parent_path());
   }
 
-  // Open file. Truncate so we replace the contents.
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  // Write to a temporary file and rename it over the tile, readers may have the old one mapped
+  auto tmp_filename = filename;
+  tmp_filename += ".tmp";
+  std::ofstream file(tmp_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
   if (file.is_open()) {
     // Write the header
     file.write(reinterpret_cast<const char*>(header_), sizeof(GraphTileHeader));
@@ -466,8 +474,10 @@ void GraphTileBuilder::Update(const std::vector<NodeInfo>& nodes,
     auto end = reinterpret_cast<const char*>(header()) + header()->end_offset();
     file.write(begin, end - begin);
     file.close();
+    std::filesystem::rename(tmp_filename, filename);
   } else {
-    throw std::runtime_error("GraphTileBuilder::Update - Failed to open file " + filename.string());
+    throw std::runtime_error("GraphTileBuilder::Update - Failed to open file " +
+                             tmp_filename.string());
   }
 }
 
@@ -1164,6 +1174,12 @@ void GraphTileBuilder::AddBins(const std::string& tile_dir,
   header.set_edgeinfo_offset(header.edgeinfo_offset() + shift);
   header.set_textlist_offset(header.textlist_offset() + shift);
   header.set_lane_connectivity_offset(header.lane_connectivity_offset() + shift);
+  if (header.candidate_index_offset() > 0) {
+    header.set_candidate_index_offset(header.candidate_index_offset() + shift);
+  }
+  if (header.reach_offset() > 0) {
+    header.set_reach_offset(header.reach_offset() + shift);
+  }
   header.set_end_offset(header.end_offset() + shift);
   // rewrite the tile
   std::filesystem::path filename{tile_dir};
@@ -1171,7 +1187,10 @@ void GraphTileBuilder::AddBins(const std::string& tile_dir,
   if (!std::filesystem::exists(filename.parent_path())) {
     std::filesystem::create_directories(filename.parent_path());
   }
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  // write to a temporary file and rename it over the tile, readers may have the old one mapped
+  auto tmp_filename = filename;
+  tmp_filename += ".tmp";
+  std::ofstream file(tmp_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
   // open it
   if (file.is_open()) {
     // new header
@@ -1188,10 +1207,108 @@ void GraphTileBuilder::AddBins(const std::string& tile_dir,
     begin = reinterpret_cast<const char*>(tile->GetBin(kBinsDim - 1, kBinsDim - 1).end());
     end = reinterpret_cast<const char*>(tile->header()) + tile->header()->end_offset();
     file.write(begin, end - begin);
+    file.close();
+    std::filesystem::rename(tmp_filename, filename);
   } // failed
   else {
-    throw std::runtime_error("Failed to open file " + filename.string());
+    throw std::runtime_error("Failed to open file " + tmp_filename.string());
+  }
+}
+
+void GraphTileBuilder::AddReach(const std::string& tile_dir,
+                                const graph_tile_ptr& tile,
+                                const StoredReachHeader& reach_header,
+                                const std::vector<StoredReach>& reaches) {
+  assert(tile);
+  const auto* old_header = tile->header();
+  if (reaches.size() != reach_header.costing_count * old_header->directededgecount()) {
+    throw std::runtime_error("GraphTileBuilder::AddReach - reach count does not match edge count");
+  }
+
+  // a previously stored reach is replaced, everything before it is copied as is
+  const uint32_t offset =
+      old_header->reach_offset() > 0 ? old_header->reach_offset() : old_header->end_offset();
+  GraphTileHeader header = *old_header;
+  header.set_reach_offset(offset);
+  header.set_end_offset(offset + sizeof(StoredReachHeader) + reaches.size() * sizeof(StoredReach));
+
+  // other threads may be reading this tile, so only replace it once it is complete
+  std::filesystem::path filename{tile_dir};
+  filename.append(GraphTile::FileSuffix(header.graphid()));
+  if (!std::filesystem::exists(filename.parent_path())) {
+    std::filesystem::create_directories(filename.parent_path());
+  }
+  auto tmp_filename = filename;
+  tmp_filename += ".tmp_reach";
+  {
+    std::ofstream file(tmp_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      throw std::runtime_error("Failed to open file " + tmp_filename.string());
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(GraphTileHeader));
+    file.write(reinterpret_cast<const char*>(old_header) + sizeof(GraphTileHeader),
+               offset - sizeof(GraphTileHeader));
+    file.write(reinterpret_cast<const char*>(&reach_header), sizeof(StoredReachHeader));
+    file.write(reinterpret_cast<const char*>(reaches.data()), reaches.size() * sizeof(StoredReach));
   }
+  std::filesystem::rename(tmp_filename, filename);
+}
+
+void GraphTileBuilder::AddCandidateIndex(const std::string& tile_dir,
+                                         const graph_tile_ptr& tile,
+                                         const CandidateIndexHeader& index_header,
+                                         const std::vector<CandidateIndexEdge>& edges,
+                                         const std::vector<uint32_t>& cells,
+                                         const std::vector<uint32_t>& entries) {
+  assert(tile);
+  if (edges.size() != index_header.edge_count || entries.size() != index_header.entry_count ||
+      cells.size() != static_cast<size_t>(index_header.columns) * index_header.rows + 1) {
+    throw std::runtime_error("GraphTileBuilder::AddCandidateIndex - sizes do not match the header");
+  }
+
+  // a previously stored index is replaced, everything before it is copied as is and the stored
+  // reach is moved after it
+  const auto* old_header = tile->header();
+  const uint32_t offset = old_header->candidate_index_offset() > 0
+                              ? old_header->candidate_index_offset()
+                          : old_header->reach_offset() > 0 ? old_header->reach_offset()
+                                                           : old_header->end_offset();
+  const uint32_t reach_size =
+      old_header->reach_offset() > 0 ? old_header->end_offset() - old_header->reach_offset() : 0;
+  const uint32_t index_size = sizeof(CandidateIndexHeader) +
+                              edges.size() * sizeof(CandidateIndexEdge) +
+                              (cells.size() + entries.size()) * sizeof(uint32_t);
+  GraphTileHeader header = *old_header;
+  header.set_candidate_index_offset(offset);
+  if (reach_size > 0) {
+    header.set_reach_offset(offset + index_size);
+  }
+  header.set_end_offset(offset + index_size + reach_size);
+
+  // other threads may be reading this tile, so only replace it once it is complete
+  std::filesystem::path filename{tile_dir};
+  filename.append(GraphTile::FileSuffix(header.graphid()));
+  if (!std::filesystem::exists(filename.parent_path())) {
+    std::filesystem::create_directories(filename.parent_path());
+  }
+  auto tmp_filename = filename;
+  tmp_filename += ".tmp_candidates";
+  {
+    std::ofstream file(tmp_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      throw std::runtime_error("Failed to open file " + tmp_filename.string());
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(GraphTileHeader));
+    file.write(reinterpret_cast<const char*>(old_header) + sizeof(GraphTileHeader),
+               offset - sizeof(GraphTileHeader));
+    file.write(reinterpret_cast<const char*>(&index_header), sizeof(CandidateIndexHeader));
+    file.write(reinterpret_cast<const char*>(edges.data()),
+               edges.size() * sizeof(CandidateIndexEdge));
+    file.write(reinterpret_cast<const char*>(cells.data()), cells.size() * sizeof(uint32_t));
+    file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(uint32_t));
+    file.write(reinterpret_cast<const char*>(old_header) + old_header->reach_offset(), reach_size);
+  }
+  std::filesystem::rename(tmp_filename, filename);
 }
 
 // Add a predicted speed profile for a directed edge.
@@ -1232,16 +1349,30 @@ void GraphTileBuilder::UpdatePredictedSpeeds(const std::vector<DirectedEdge>& di
   if (!std::filesystem::exists(filename.parent_path()))
     std::filesystem::create_directories(filename.parent_path());
 
-  // Open file and truncate
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  // Write to a temporary file and rename it over the tile, readers may have the old one mapped
+  auto tmp_filename = filename;
+  tmp_filename += ".tmp";
+  std::ofstream file(tmp_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
   if (file.is_open()) {
     // Write a new header - add the offset to predicted speed data and the profile count.
-    // Update the end offset (shift by the amount of predicted speed data added).
-    size_t offset = header_->end_offset();
-    header_builder_.set_end_offset(header_->end_offset() +
-                                   (speed_profile_offset_builder_.size() * sizeof(uint32_t)) +
-                                   (speed_profile_builder_.size() * sizeof(int16_t)));
+    // Update the end offset (shift by the amount of predicted speed data added). The candidate
+    // index and the stored reach stay the last sections of the tile
+    const size_t trailing_offset = header_->candidate_index_offset() > 0
+                                       ? header_->candidate_index_offset()
+                                   : header_->reach_offset() > 0 ? header_->reach_offset()
+                                                                 : header_->end_offset();
+    const size_t trailing_size = header_->end_offset() - trailing_offset;
+    size_t offset = trailing_offset;
+    const size_t speeds_size = (speed_profile_offset_builder_.size() * sizeof(uint32_t)) +
+                               (speed_profile_builder_.size() * sizeof(int16_t));
+    header_builder_.set_end_offset(header_->end_offset() + speeds_size);
     header_builder_.set_predictedspeeds_offset(offset);
+    if (header_->candidate_index_offset() > 0) {
+      header_builder_.set_candidate_index_offset(header_->candidate_index_offset() + speeds_size);
+    }
+    if (header_->reach_offset() > 0) {
+      header_builder_.set_reach_offset(header_->reach_offset() + speeds_size);
+    }
     header_builder_.set_predictedspeeds_count(speed_profile_builder_.size() / kCoefficientCount);
     file.write(reinterpret_cast<const char*>(&header_builder_), sizeof(GraphTileHeader));
 
@@ -1270,11 +1401,12 @@ void GraphTileBuilder::UpdatePredictedSpeeds(const std::vector<DirectedEdge>& di
     file.write(reinterpret_cast<const char*>(speed_profile_builder_.data()),
                speed_profile_builder_.size() * sizeof(int16_t));
 
-    // Write the rest of the tiles. TBD (if anything is added after the speed profiles
-    // then this will need to be updated)
+    // Write the candidate index and the stored reach after them
+    file.write(reinterpret_cast<const char*>(header()) + offset, trailing_size);
 
-    // Close the file
+    // Close the file and replace the tile
     file.close();
+    std::filesystem::rename(tmp_filename, filename);
   }
 }
 
@@ -8,18 +8,16 @@
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
 #include "mjolnir/graphtilebuilder.h"
+#include "mjolnir/tilescheduler.h"
 #include "mjolnir/util.h"
 #include "scoped_timer.h"
 
 #include <boost/format.hpp>
 
 #include <algorithm>
-#include <deque>
 #include <future>
-#include <list>
 #include <mutex>
 #include <numeric>
-#include <random>
 #include <set>
 #include <string>
 #include <thread>
@@ -253,7 +251,7 @@ uint32_t GetOpposingEdgeIndex(const GraphId& startnode,
 using tweeners_t = GraphTileBuilder::tweeners_t;
 void validate(
     const boost::property_tree::ptree& pt,
-    std::deque<GraphId>& tilequeue,
+    TileScheduler::Worker& worker,
     std::mutex& lock,
     std::promise<std::tuple<std::vector<uint32_t>, std::vector<std::vector<float>>, tweeners_t>>&
         result) {
@@ -275,16 +273,8 @@ void validate(
   std::set<uint32_t> problem_ways;
 
   // Check for more tiles
-  while (true) {
-    lock.lock();
-    if (tilequeue.empty()) {
-      lock.unlock();
-      break;
-    }
-    // Get the next tile Id
-    GraphId tile_id = tilequeue.front();
-    tilequeue.pop_front();
-    lock.unlock();
+  GraphId tile_id;
+  while (worker.next(tile_id)) {
 
     // Point tiles to the set we need for current level
     const auto& tiles = tile_id.level() == TileHierarchy::GetTransitLevel().level
@@ -562,45 +552,34 @@ void GraphValidator::Validate(const boost::property_tree::ptree& pt) {
   auto hierarchy_properties = pt.get_child("mjolnir");
   std::string tile_dir = hierarchy_properties.get<std::string>("tile_dir");
 
-  // Create a randomized queue of tiles (at all levels) to work from
-  std::deque<GraphId> tilequeue;
+  // Schedule the tiles (at all levels) to work on, the largest first
+  TileScheduler scheduler("Validating tiles",
+                          pt.get<unsigned int>("mjolnir.concurrency",
+                                               std::thread::hardware_concurrency()));
   GraphReader reader(pt.get_child("mjolnir"));
   auto tileset = reader.GetTileSet();
   for (const auto& id : tileset) {
-    tilequeue.emplace_back(id);
+    scheduler.add(id, TileScheduler::tile_size(tile_dir, id));
   }
-  // fixed seed for reproducible tile build
-  std::shuffle(tilequeue.begin(), tilequeue.end(), std::mt19937(3));
 
   // Remember what the dataset id is in case we have to make some tiles
-  graph_tile_ptr first_tile = GraphTile::Create(tile_dir, *tilequeue.begin());
-  assert(tilequeue.size() && first_tile);
+  assert(!tileset.empty());
+  graph_tile_ptr first_tile = GraphTile::Create(tile_dir, *tileset.begin());
+  assert(first_tile);
   auto dataset_id = first_tile->header()->dataset_id();
 
   // An mutex we can use to do the synchronization
   std::mutex lock;
 
-  // Setup threads
-  std::vector<std::shared_ptr<std::thread>> threads(
-      std::max(static_cast<unsigned int>(1),
-               pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency())));
-
   // Setup promises
-  std::list<
+  std::vector<
       std::promise<std::tuple<std::vector<uint32_t>, std::vector<std::vector<float>>, tweeners_t>>>
-      results;
+      results(scheduler.concurrency());
 
-  // Spawn the threads
-  for (auto& thread : threads) {
-    results.emplace_back();
-    thread = std::make_shared<std::thread>(validate, std::cref(pt), std::ref(tilequeue),
-                                           std::ref(lock), std::ref(results.back()));
-  }
-
-  // Wait for threads to finish
-  for (auto& thread : threads) {
-    thread->join();
-  }
+  // Run the threads and wait for them to finish
+  scheduler.run([&](TileScheduler::Worker& worker) {
+    validate(pt, worker, lock, results[worker.index()]);
+  });
   // Get the promise from the future
   std::vector<uint32_t> duplicates(TileHierarchy::levels().size(), 0);
   std::vector<std::vector<float>> densities(3);
@@ -623,6 +602,7 @@ void GraphValidator::Validate(const boost::property_tree::ptree& pt) {
   LOG_INFO("Binning inter-tile edges...");
   auto start = tweeners.begin();
   auto end = tweeners.end();
+  std::vector<std::shared_ptr<std::thread>> threads(scheduler.concurrency());
   for (auto& thread : threads) {
     thread = std::make_shared<std::thread>(bin_tweeners, std::cref(tile_dir), std::ref(start),
                                            std::cref(end), dataset_id, std::ref(lock));
@@ -0,0 +1,326 @@
+#include "mjolnir/incrementalbuilder.h"
+#include "baldr/datetime.h"
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/graphtileheader.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "midgard/sequence.h"
+#include "mjolnir/osmdata.h"
+#include "mjolnir/osmway.h"
+#include "scoped_timer.h"
+
+#include <boost/algorithm/string/join.hpp>
+#include <osmium/handler.hpp>
+#include <osmium/io/gzip_compression.hpp>
+#include <osmium/io/xml_input.hpp>
+#include <osmium/visitor.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <unordered_set>
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+// What is kept of the last build next to its local tiles
+const std::string kKeptWaysFile = "ways.bin";
+const std::string kKeptWayNodesFile = "way_nodes.bin";
+
+// The OSM elements which a set of change files creates, modifies or deletes
+struct osm_changes_t : public osmium::handler::Handler {
+  std::unordered_set<uint64_t> nodes;
+  std::unordered_set<uint64_t> ways;
+
+  void node(const osmium::Node& node) {
+    nodes.insert(node.positive_id());
+  }
+
+  void way(const osmium::Way& way) {
+    ways.insert(way.positive_id());
+  }
+
+  void relation(const osmium::Relation& relation) {
+    // only these relations end up on the edges of the local tiles. a deleted relation lists no
+    // members, the ways it was on are only rebuilt if they changed as well
+    const char* type = relation.tags()["type"];
+    if (!type || (std::strcmp(type, "restriction") != 0 && std::strcmp(type, "route") != 0 &&
+                  std::strcmp(type, "connectivity") != 0)) {
+      return;
+    }
+    for (const auto& member : relation.members()) {
+      if (member.type() == osmium::item_type::way) {
+        ways.insert(member.positive_ref());
+      } else if (member.type() == osmium::item_type::node) {
+        nodes.insert(member.positive_ref());
+      }
+    }
+  }
+};
+
+osm_changes_t read_changes(const std::vector<std::string>& change_files) {
+  osm_changes_t changes;
+  for (const auto& change_file : change_files) {
+    osmium::io::Reader reader(change_file, osmium::osm_entity_bits::nwr);
+    osmium::apply(reader, changes);
+    reader.close();
+  }
+  return changes;
+}
+
+/**
+ * Adds the local tiles of every way which changed, or which uses a node that changed, according
+ * to the ways and way nodes of one build.
+ */
+void add_touched_tiles(const osm_changes_t& changes,
+                       const std::string& ways_file,
+                       const std::string& way_nodes_file,
+                       std::unordered_set<GraphId>& tiles) {
+  sequence<OSMWay> ways(ways_file, false);
+  sequence<OSMWayNode> way_nodes(way_nodes_file, false);
+
+  std::vector<bool> touched(ways.size(), false);
+  for (size_t i = 0; i < ways.size(); ++i) {
+    touched[i] = changes.ways.count((*ways[i]).way_id()) > 0;
+  }
+  for (size_t i = 0; i < way_nodes.size(); ++i) {
+    const auto way_node = *way_nodes[i];
+    if (changes.nodes.count(way_node.node.osmid_)) {
+      touched[way_node.way_index] = true;
+    }
+  }
+
+  const auto& local_level = TileHierarchy::levels().back();
+  for (size_t i = 0; i < way_nodes.size(); ++i) {
+    const auto way_node = *way_nodes[i];
+    const auto ll = way_node.node.latlng();
+    if (touched[way_node.way_index] && ll.IsValid()) {
+      tiles.emplace(local_level.tiles.TileId(ll), local_level.level, 0);
+    }
+  }
+}
+
+/**
+ * Stamps a tile copied from the last build the way this build stamps the tiles it builds.
+ */
+void restamp(const std::filesystem::path& tile_file,
+             const uint64_t dataset_id,
+             const uint32_t date_created) {
+  std::fstream file(tile_file, std::ios::in | std::ios::out | std::ios::binary);
+  GraphTileHeader header;
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  header.set_dataset_id(dataset_id);
+  header.set_date_created(date_created);
+  file.seekp(0);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+bool same_tile(const GraphTile& a, const GraphTile& b) {
+  const auto end_offset = a.header()->end_offset();
+  if (end_offset != b.header()->end_offset()) {
+    return false;
+  }
+
+  // when and from what the tiles were built does not matter
+  const auto header_bytes = [](const GraphTile& tile) {
+    std::string bytes(reinterpret_cast<const char*>(tile.header()), sizeof(GraphTileHeader));
+    auto* header = reinterpret_cast<GraphTileHeader*>(&bytes[0]);
+    header->set_dataset_id(0);
+    header->set_date_created(0);
+    return bytes;
+  };
+  const auto* a_data = reinterpret_cast<const char*>(a.header());
+  const auto* b_data = reinterpret_cast<const char*>(b.header());
+  return header_bytes(a) == header_bytes(b) &&
+         std::memcmp(a_data + sizeof(GraphTileHeader), b_data + sizeof(GraphTileHeader),
+                     end_offset - sizeof(GraphTileHeader)) == 0;
+}
+
+GraphReader tile_reader(const std::string& tile_dir) {
+  boost::property_tree::ptree config;
+  config.put("tile_dir", tile_dir);
+  return GraphReader(config);
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+std::map<GraphId, size_t>
+IncrementalBuilder::Restore(const boost::property_tree::ptree& pt,
+                            const std::vector<std::string>& change_files,
+                            const std::string& ways_file,
+                            const std::string& way_nodes_file,
+                            const std::map<GraphId, size_t>& tiles,
+                            const uint64_t dataset_id) {
+  SCOPED_TIMER();
+  const std::filesystem::path incremental_dir =
+      pt.get<std::string>("mjolnir.incremental_dir", "");
+  const auto kept_ways_file = incremental_dir / kKeptWaysFile;
+  const auto kept_way_nodes_file = incremental_dir / kKeptWayNodesFile;
+  if (incremental_dir.empty() || !std::filesystem::exists(kept_ways_file) ||
+      !std::filesystem::exists(kept_way_nodes_file)) {
+    LOG_WARN("No complete last build in mjolnir.incremental_dir, building all tiles");
+    return tiles;
+  }
+
+  LOG_INFO("Reading changes from " + boost::algorithm::join(change_files, ", "));
+  const auto changes = read_changes(change_files);
+  LOG_INFO(std::to_string(changes.nodes.size()) + " nodes and " +
+           std::to_string(changes.ways.size()) + " ways changed");
+
+  // where the changed ways were and where they are now
+  std::unordered_set<GraphId> touched;
+  add_touched_tiles(changes, kept_ways_file.string(), kept_way_nodes_file.string(), touched);
+  add_touched_tiles(changes, ways_file, way_nodes_file, touched);
+
+  // the nodes of a rebuilt tile can be numbered differently, so the tiles with edges ending in it
+  // have to be rebuilt as well
+  auto kept = tile_reader(incremental_dir.string());
+  const auto kept_tiles = kept.GetTileSet(TileHierarchy::levels().back().level);
+  auto rebuild = touched;
+  for (const auto& tile_id : kept_tiles) {
+    if (kept.OverCommitted()) {
+      kept.Trim();
+    }
+    auto tile = touched.count(tile_id) ? nullptr : kept.GetGraphTile(tile_id);
+    if (!tile) {
+      continue;
+    }
+    for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
+      if (touched.count(tile->directededge(i)->endnode().Tile_Base())) {
+        rebuild.insert(tile_id);
+        break;
+      }
+    }
+  }
+
+  // copy the tiles that nothing changed in, the new ones and the touched ones are left to build
+  auto tz = DateTime::get_tz_db().from_index(DateTime::get_tz_db().to_index("America/New_York"));
+  uint32_t tile_creation_date =
+      DateTime::days_from_pivot_date(DateTime::get_formatted_date(DateTime::iso_date_time(tz)));
+  const std::filesystem::path tile_dir = pt.get<std::string>("mjolnir.tile_dir");
+  std::map<GraphId, size_t> build;
+  for (const auto& tile : tiles) {
+    if (rebuild.count(tile.first) || !kept_tiles.count(tile.first)) {
+      build.insert(tile);
+      continue;
+    }
+    const auto suffix = GraphTile::FileSuffix(tile.first);
+    const auto tile_file = tile_dir / suffix;
+    std::filesystem::create_directories(tile_file.parent_path());
+    // the tile may be mapped by a reader, so it is replaced rather than overwritten
+    auto tmp_file = tile_file;
+    tmp_file += ".tmp";
+    std::filesystem::copy_file(incremental_dir / suffix, tmp_file,
+                               std::filesystem::copy_options::overwrite_existing);
+    restamp(tmp_file, dataset_id, tile_creation_date);
+    std::filesystem::rename(tmp_file, tile_file);
+  }
+
+  LOG_INFO("Changes touched " + std::to_string(touched.size()) + " tiles, copied " +
+           std::to_string(tiles.size() - build.size()) + " tiles from the last build, " +
+           std::to_string(build.size()) + " are left to build");
+  return build;
+}
+
+void IncrementalBuilder::Save(const boost::property_tree::ptree& pt,
+                              const std::map<GraphId, size_t>& built,
+                              const std::map<GraphId, size_t>& tiles) {
+  SCOPED_TIMER();
+  const std::filesystem::path incremental_dir = pt.get<std::string>("mjolnir.incremental_dir");
+  const std::filesystem::path tile_dir = pt.get<std::string>("mjolnir.tile_dir");
+  LOG_INFO("Keeping " + std::to_string(built.size()) + " built tiles in " +
+           incremental_dir.string());
+
+  // the ways of the last build no longer go with the kept tiles
+  std::filesystem::create_directories(incremental_dir);
+  std::filesystem::remove(incremental_dir / kKeptWaysFile);
+  std::filesystem::remove(incremental_dir / kKeptWayNodesFile);
+
+  for (const auto& tile : built) {
+    const auto suffix = GraphTile::FileSuffix(tile.first);
+    const auto kept_file = incremental_dir / suffix;
+    if (std::filesystem::exists(tile_dir / suffix)) {
+      std::filesystem::create_directories(kept_file.parent_path());
+      std::filesystem::copy_file(tile_dir / suffix, kept_file,
+                                 std::filesystem::copy_options::overwrite_existing);
+    } else {
+      std::filesystem::remove(kept_file);
+    }
+  }
+
+  for (const auto& tile_id :
+       tile_reader(incremental_dir.string()).GetTileSet(TileHierarchy::levels().back().level)) {
+    if (!tiles.count(tile_id)) {
+      std::filesystem::remove(incremental_dir / GraphTile::FileSuffix(tile_id));
+    }
+  }
+}
+
+void IncrementalBuilder::SaveWays(const boost::property_tree::ptree& pt,
+                                  const std::string& ways_file,
+                                  const std::string& way_nodes_file) {
+  const std::filesystem::path incremental_dir = pt.get<std::string>("mjolnir.incremental_dir");
+  for (const auto& file : {std::make_pair(std::filesystem::path(ways_file), kKeptWaysFile),
+                           std::make_pair(std::filesystem::path(way_nodes_file),
+                                          kKeptWayNodesFile)}) {
+    if (!std::filesystem::exists(file.first)) {
+      LOG_WARN(file.first.string() + " does not exist, the next build will build all tiles");
+      continue;
+    }
+    // a rename does not work across file systems
+    std::error_code ec;
+    std::filesystem::rename(file.first, incremental_dir / file.second, ec);
+    if (ec) {
+      std::filesystem::copy_file(file.first, incremental_dir / file.second,
+                                 std::filesystem::copy_options::overwrite_existing);
+      std::filesystem::remove(file.first);
+    }
+  }
+  LOG_INFO("Kept the ways of this build in " + incremental_dir.string());
+}
+
+size_t IncrementalBuilder::Compare(const std::string& tile_dir, const std::string& other_tile_dir) {
+  SCOPED_TIMER();
+  auto reader = tile_reader(tile_dir);
+  auto other_reader = tile_reader(other_tile_dir);
+  auto tile_ids = reader.GetTileSet();
+  const auto other_tile_ids = other_reader.GetTileSet();
+  tile_ids.insert(other_tile_ids.begin(), other_tile_ids.end());
+
+  size_t differences = 0;
+  for (const auto& tile_id : tile_ids) {
+    auto tile = reader.GetGraphTile(tile_id);
+    auto other_tile = other_reader.GetGraphTile(tile_id);
+    std::string difference;
+    if (!tile || !other_tile) {
+      difference = " only exists in " + (tile ? tile_dir : other_tile_dir);
+    } else if (!same_tile(*tile, *other_tile)) {
+      difference = " differs";
+    }
+    if (!difference.empty()) {
+      LOG_ERROR("Tile " + GraphTile::FileSuffix(tile_id) + difference);
+      ++differences;
+    }
+
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+    if (other_reader.OverCommitted()) {
+      other_reader.Trim();
+    }
+  }
+
+  LOG_INFO(std::to_string(differences) + " of " + std::to_string(tile_ids.size()) +
+           " tiles differ");
+  return differences;
+}
+
+} // namespace mjolnir
+} // namespace valhalla
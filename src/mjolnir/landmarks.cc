@@ -7,6 +7,7 @@
 #include "midgard/sequence.h"
 #include "mjolnir/graphtilebuilder.h"
 #include "mjolnir/sqlite3.h"
+#include "mjolnir/tilescheduler.h"
 #include "mjolnir/util.h"
 #include "sif/nocost.h"
 
@@ -18,6 +19,7 @@
 #include <string_view>
 #include <thread>
 #include <tuple>
+#include <unordered_map>
 
 using namespace valhalla::baldr;
 using namespace valhalla::mjolnir;
@@ -299,9 +301,7 @@ bool BuildLandmarkFromPBF(const boost::property_tree::ptree& pt,
 // Find landmarks in the tiles and the edges correlated to each landmark,
 // and return the sequence file name where we wrote the correlations
 void FindLandmarkEdges(const boost::property_tree::ptree& pt,
-                       const std::vector<GraphId>& tileset,
-                       const size_t& thread_number,
-                       const size_t& total_threads,
+                       TileScheduler::Worker& worker,
                        std::promise<std::string>& seq_file_name) {
   // Open the database and create a graph reader
   const std::string db_name = pt.get<std::string>("landmarks", "");
@@ -309,48 +309,46 @@ void FindLandmarkEdges(const boost::property_tree::ptree& pt,
   LandmarkDatabase db(db_name, true);
   GraphReader reader(pt);
   // create the sequence file
-  std::string file_name = "landmark_dump_" + std::to_string(thread_number);
+  std::string file_name = "landmark_dump_" + std::to_string(worker.index());
   midgard::sequence<std::pair<GraphId, uint64_t>> seq_file(file_name, true);
 
-  for (size_t i = 0; i < tileset.size(); ++i) {
-    // every i'th thread works on every i'th tile
-    if (i % total_threads == thread_number) {
-      // get landmarks in the tile
-      midgard::AABB2<PointLL> bbox = baldr::TileHierarchy::GetGraphIdBoundingBox(tileset[i]);
-
-      std::vector<Landmark> landmarks = db.get_landmarks_by_bbox(bbox.minx() - kLandmarkQueryBuffer,
-                                                                 bbox.miny() - kLandmarkQueryBuffer,
-                                                                 bbox.maxx() + kLandmarkQueryBuffer,
-                                                                 bbox.maxy() + kLandmarkQueryBuffer);
-
-      // find and collect all nearby path locations for the landmarks
-      for (const auto& landmark : landmarks) {
-        baldr::Location landmark_location(midgard::PointLL{landmark.lng, landmark.lat},
-                                          baldr::Location::StopType::BREAK, 0, 0, kLandmarkRadius);
-        landmark_location.search_cutoff_ = kLandmarkSearchCutoff;
-
-        // call loki::Search to get nearby edges to each landmark
-        std::unordered_map<valhalla::baldr::Location, PathLocation> result =
-            loki::Search({landmark_location}, reader, sif::CreateNoCost({}));
-
-        // we only have one landmark as input so the return size should be no more than one
-        if (result.size() > 1) {
-          throw std::logic_error(
-              "Error occurred in finding nearby edges to a landmark. Result size is " +
-              std::to_string(result.size()) + ", but should be one or zero");
-        }
-        // if the landmark should not be associated with any edge
-        if (result.size() == 0) {
-          continue;
-        }
+  GraphId tile_id;
+  while (worker.next(tile_id)) {
+    // get landmarks in the tile
+    midgard::AABB2<PointLL> bbox = baldr::TileHierarchy::GetGraphIdBoundingBox(tile_id);
+
+    std::vector<Landmark> landmarks = db.get_landmarks_by_bbox(bbox.minx() - kLandmarkQueryBuffer,
+                                                               bbox.miny() - kLandmarkQueryBuffer,
+                                                               bbox.maxx() + kLandmarkQueryBuffer,
+                                                               bbox.maxy() + kLandmarkQueryBuffer);
+
+    // find and collect all nearby path locations for the landmarks
+    for (const auto& landmark : landmarks) {
+      baldr::Location landmark_location(midgard::PointLL{landmark.lng, landmark.lat},
+                                        baldr::Location::StopType::BREAK, 0, 0, kLandmarkRadius);
+      landmark_location.search_cutoff_ = kLandmarkSearchCutoff;
+
+      // call loki::Search to get nearby edges to each landmark
+      std::unordered_map<valhalla::baldr::Location, PathLocation> result =
+          loki::Search({landmark_location}, reader, sif::CreateNoCost({}));
+
+      // we only have one landmark as input so the return size should be no more than one
+      if (result.size() > 1) {
+        throw std::logic_error(
+            "Error occurred in finding nearby edges to a landmark. Result size is " +
+            std::to_string(result.size()) + ", but should be one or zero");
+      }
+      // if the landmark should not be associated with any edge
+      if (result.size() == 0) {
+        continue;
+      }
 
-        std::vector<PathLocation::PathEdge> edges = result.begin()->second.edges;
-        // for each edge insert edgeid - landmark_pkey pair into the sequence file
-        // TODO: maybe do some filtering and only keep some of the edges it finds? (now we have the
-        //  75m search cutoff)
-        for (const auto& edge : edges) {
-          seq_file.push_back(std::make_pair(edge.id, landmark.id));
-        }
+      std::vector<PathLocation::PathEdge> edges = result.begin()->second.edges;
+      // for each edge insert edgeid - landmark_pkey pair into the sequence file
+      // TODO: maybe do some filtering and only keep some of the edges it finds? (now we have the
+      //  75m search cutoff)
+      for (const auto& edge : edges) {
+        seq_file.push_back(std::make_pair(edge.id, landmark.id));
       }
     }
   }
@@ -362,73 +360,49 @@ void FindLandmarkEdges(const boost::property_tree::ptree& pt,
 // tiles, edges, and landmarks. NOTE: the input sequence file seq_file is passed by reference, but
 // should not be modified by these threads.
 void UpdateTiles(midgard::sequence<std::pair<GraphId, uint64_t>>& seq_file,
+                 const std::unordered_map<GraphId, std::pair<size_t, size_t>>& tile_ranges,
                  const std::string& tile_dir,
                  const std::string& db_name,
-                 const size_t& thread_number,
-                 const size_t& total_threads,
+                 TileScheduler::Worker& worker,
                  std::promise<std::tuple<size_t, size_t, size_t>>& stats) {
-  // open the database and initialize a unique pointer to graph tile builder
-  std::unique_ptr<GraphTileBuilder> tile_builder_ptr = nullptr;
-
   LandmarkDatabase db(db_name, true);
 
   // stats to record how many tiles, edges and landmarks are updated
   size_t updated_tiles = 0, updated_edges = 0, updated_landmarks = 0;
-  GraphId last_edge, last_tile;
-
-  size_t tile_count = static_cast<size_t>(-1);
-  // every i'th thread works on every i'th tile
-  for (auto it = seq_file.begin(); it != seq_file.end(); ++it) {
-    // if the current tile is not the same as the last one, increase counter by one
-    if ((*it).first.Tile_Base() != last_tile) {
-      last_tile = (*it).first.Tile_Base();
-      tile_count++;
-    }
-    // decide whether this tile is a "every i'th tile". if not, the thread should skip it
-    if (tile_count % total_threads != thread_number) {
-      continue;
-    }
 
-    // now this pair is on a "every i'th tile". the thread should process it.
-
-    // if this pair is on a new tile, then store the previous tile and move to the new tile
-    if (!tile_builder_ptr ||
-        tile_builder_ptr->header_builder().graphid().Tile_Base() != (*it).first.Tile_Base()) {
-      // store the previously updated tile
-      if (tile_builder_ptr) {
-        tile_builder_ptr->StoreTileData();
-        updated_tiles++;
+  // each tile has the range of pairs in the sequence file which are on it
+  GraphId tile_id;
+  while (worker.next(tile_id)) {
+    const auto& range = tile_ranges.at(tile_id);
+    GraphTileBuilder tile_builder(tile_dir, tile_id, true);
+    GraphId last_edge;
+    for (size_t i = range.first; i < range.second; ++i) {
+      const auto pair = *seq_file[i];
+
+      // retrieve the landmark to be added
+      // TODO: in the future we can do batches of ids, though it will complicate the code it will
+      // likely speed up the processing
+      const std::vector<Landmark> landmark =
+          db.get_landmarks_by_ids({static_cast<int64_t>(pair.second)});
+      if (landmark.size() != 1) {
+        throw std::logic_error("Incorrect result size " + std::to_string(landmark.size()) +
+                               " of retrieved landmarks, which should be 1");
+      }
+      // add the landmark to the tile
+      tile_builder.AddLandmark(pair.first, landmark[0]);
+
+      // update the stats
+      updated_landmarks++;
+      // a single edge can have multiple landmarks
+      // record the number of unique edges updated (pairs with the same edge should appear
+      // consecutively in the sequence)
+      if (last_edge != pair.first) {
+        updated_edges++;
+        last_edge = pair.first;
       }
-      // reset the tile builder to this new tile
-      tile_builder_ptr = std::make_unique<GraphTileBuilder>(tile_dir, (*it).first.Tile_Base(), true);
-    }
-
-    // retrieve the landmark to be added
-    // TODO: in the future we can do batches of ids, though it will complicate the code it will likely
-    // speed up the processing
-    const std::vector<Landmark> landmark =
-        db.get_landmarks_by_ids({static_cast<int64_t>((*it).second)});
-    if (landmark.size() != 1) {
-      throw std::logic_error("Incorrect result size " + std::to_string(landmark.size()) +
-                             " of retrieved landmarks, which should be 1");
-    }
-    // add the landmark to the tile
-    GraphId edge_id = (*it).first;
-    tile_builder_ptr->AddLandmark(edge_id, landmark[0]);
-
-    // update the stats
-    updated_landmarks++;
-    // a single edge can have multiple landmarks
-    // record the number of unique edges updated (pairs with the same edge should appear consecutively
-    // in the sequence)
-    if (last_edge != (*it).first) {
-      updated_edges++;
-      last_edge = (*it).first;
     }
-  }
-  // store the last updated tile
-  if (tile_builder_ptr) {
-    tile_builder_ptr->StoreTileData();
+    // store the updated tile
+    tile_builder.StoreTileData();
     updated_tiles++;
   }
 
@@ -447,32 +421,21 @@ bool AddLandmarks(const boost::property_tree::ptree& pt) {
   // get tile access
   baldr::GraphReader reader(pt.get_child("mjolnir"));
 
-  // get all tile ids and sort the tiles in descending order by size to balance the threads
+  // get all tile ids and schedule the tiles in descending order by size to balance the threads
   // TODO: it is possible in a global tileset that we have coverage only at level 2 for some places
   // and we'd still like to get landmarks there. we'll probably need to fix this.
-  auto tileset = reader.GetTileSet(1);
-  std::vector<GraphId> vec_tileset(tileset.begin(),
-                                   tileset.end()); // turn the unordered_set into a vector for sorting
-
-  std::sort(vec_tileset.begin(), vec_tileset.end(), [&](const auto id_a, const auto id_b) {
-    return reader.GetGraphTile(id_a)->header()->nodecount() >
-           reader.GetGraphTile(id_b)->header()->nodecount();
-  });
+  TileScheduler finder("Finding landmark edges", num_threads);
+  for (const auto& tile_id : reader.GetTileSet(1)) {
+    finder.add(tile_id, reader.GetGraphTile(tile_id)->header()->nodecount());
+  }
 
   LOG_INFO("Finding landmarks and their correlated edges...");
 
-  std::vector<std::shared_ptr<std::thread>> threads(num_threads);
-  std::vector<std::promise<std::string>> sequence_file_names(num_threads);
-  for (size_t i = 0; i < num_threads; ++i) {
-    threads[i] = std::make_shared<std::thread>(FindLandmarkEdges, std::cref(pt.get_child("mjolnir")),
-                                               std::cref(vec_tileset), i, num_threads,
-                                               std::ref(sequence_file_names[i]));
-  }
-
-  // join all the threads and collect the sequence file names
-  for (auto& thread : threads) {
-    thread->join();
-  }
+  // run the threads and collect the sequence file names
+  std::vector<std::promise<std::string>> sequence_file_names(finder.concurrency());
+  finder.run([&](TileScheduler::Worker& worker) {
+    FindLandmarkEdges(pt.get_child("mjolnir"), worker, sequence_file_names[worker.index()]);
+  });
 
   std::vector<std::string> seq_names{};
   seq_names.reserve(sequence_file_names.size());
@@ -498,20 +461,29 @@ bool AddLandmarks(const boost::property_tree::ptree& pt) {
 
   LOG_INFO("Updating tiles...");
 
-  // re-open the thread pool to update tiles
-  std::vector<std::promise<std::tuple<size_t, size_t, size_t>>> stats_info(
-      num_threads); // tiles, edges, landmarks
-
-  const std::string tile_dir = reader.tile_dir();
-  for (size_t i = 0; i < num_threads; ++i) {
-    // assume the data size that each thread processes doesn't affect performance a lot
-    threads[i] = std::make_shared<std::thread>(UpdateTiles, std::ref(merged_sequence_file), tile_dir,
-                                               db_name, i, num_threads, std::ref(stats_info[i]));
+  // find the range of pairs of each tile, the tiles with the most landmarks are updated first
+  std::unordered_map<GraphId, std::pair<size_t, size_t>> tile_ranges;
+  TileScheduler updater("Updating landmark tiles", num_threads);
+  for (size_t i = 0; i < merged_sequence_file.size();) {
+    const GraphId tile_id = (*merged_sequence_file[i]).first.Tile_Base();
+    size_t end = i + 1;
+    while (end < merged_sequence_file.size() &&
+           (*merged_sequence_file[end]).first.Tile_Base() == tile_id) {
+      ++end;
+    }
+    tile_ranges.emplace(tile_id, std::make_pair(i, end));
+    updater.add(tile_id, end - i);
+    i = end;
   }
 
-  for (auto& thread : threads) {
-    thread->join();
-  }
+  // run the threads to update the tiles
+  std::vector<std::promise<std::tuple<size_t, size_t, size_t>>> stats_info(
+      updater.concurrency()); // tiles, edges, landmarks
+  const std::string tile_dir = reader.tile_dir();
+  updater.run([&](TileScheduler::Worker& worker) {
+    UpdateTiles(merged_sequence_file, tile_ranges, tile_dir, db_name, worker,
+                stats_info[worker.index()]);
+  });
 
   // collect and log the stats
   [[maybe_unused]] size_t tiles = 0, edges = 0, landmarks = 0;
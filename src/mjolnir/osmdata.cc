@@ -10,7 +10,6 @@
 #include <fstream>
 
 using namespace valhalla::mjolnir;
-using valhalla::baldr::ConditionalSpeedLimit;
 
 namespace {
 
@@ -30,15 +29,6 @@ const std::string language_file = "osmdata_language_file.bin";
 const std::string conditional_speed_limit_file = "osmdata_conditional_speed_limit_file.bin";
 
 // Data structures to assist writing and reading data
-struct TempRestriction {
-  uint64_t way_id;
-  OSMRestriction restriction;
-  TempRestriction() : way_id(0), restriction(OSMRestriction()) {
-  }
-  TempRestriction(const uint64_t w, const OSMRestriction& r) : way_id(w), restriction(r) {
-  }
-};
-
 struct TempWayRef {
   uint64_t way_id;
   uint32_t name_index;
@@ -48,64 +38,6 @@ struct TempWayRef {
   }
 };
 
-struct BikeRelation {
-  uint64_t way_id;
-  OSMBike relation;
-  BikeRelation() : way_id(0), relation(OSMBike()) {
-  }
-  BikeRelation(const uint64_t w, const OSMBike& r) : way_id(w), relation(r) {
-  }
-};
-
-struct TempAccessRestriction {
-  uint64_t way_id;
-  OSMAccessRestriction restriction;
-  TempAccessRestriction() : way_id(0), restriction(OSMAccessRestriction()) {
-  }
-  TempAccessRestriction(const uint64_t w, const OSMAccessRestriction& r) : way_id(w), restriction(r) {
-  }
-};
-
-struct TempLaneConnectivity {
-  uint64_t way_id;
-  OSMLaneConnectivity lane;
-  TempLaneConnectivity() : way_id(0), lane(OSMLaneConnectivity()) {
-  }
-  TempLaneConnectivity(const uint64_t w, const OSMLaneConnectivity& l) : way_id(w), lane(l) {
-  }
-};
-
-struct TempLinguistic {
-  uint64_t way_id;
-  OSMLinguistic linguistic;
-  TempLinguistic() : way_id(0), linguistic(OSMLinguistic()) {
-  }
-  TempLinguistic(const uint64_t w, const OSMLinguistic& l) : way_id(w), linguistic(l) {
-  }
-};
-
-bool write_restrictions(const std::string& filename, const RestrictionsMultiMap& res_map) {
-  // Open file and truncate
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
-  if (!file.is_open()) {
-    LOG_ERROR("write_restrictions failed to open output file: " + filename);
-    return false;
-  }
-
-  // Convert the multi map into a vector of TempRestriction
-  std::vector<TempRestriction> res;
-  for (auto it = res_map.cbegin(); it != res_map.cend(); ++it) {
-    res.emplace_back(it->first, it->second);
-  }
-
-  // Write the count and then the via ids
-  uint32_t sz = res.size();
-  file.write(reinterpret_cast<const char*>(&sz), sizeof(uint32_t));
-  file.write(reinterpret_cast<const char*>(res.data()), res.size() * sizeof(TempRestriction));
-  file.close();
-  return true;
-}
-
 bool write_viaset(const std::string& filename, const ViaSet& via_set) {
   // Open file and truncate
   std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
@@ -130,53 +62,6 @@ bool write_viaset(const std::string& filename, const ViaSet& via_set) {
   return true;
 }
 
-bool write_access_restrictions(const std::string& filename,
-                               const AccessRestrictionsMultiMap& access_map) {
-  // Open file and truncate
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
-  if (!file.is_open()) {
-    LOG_ERROR("write_access_restrictions failed to open output file: " + filename);
-    return false;
-  }
-
-  // Convert the multi map into a vector of TempAccessRestriction
-  std::vector<TempAccessRestriction> res;
-  for (auto it = access_map.cbegin(); it != access_map.cend(); ++it) {
-    res.emplace_back(it->first, it->second);
-  }
-
-  // Write the count and then the via ids
-  uint32_t sz = res.size();
-  file.write(reinterpret_cast<const char*>(&sz), sizeof(uint32_t));
-  file.write(reinterpret_cast<const char*>(res.data()), res.size() * sizeof(TempAccessRestriction));
-  file.close();
-  return true;
-}
-
-bool write_bike_relations(const std::string& filename, const BikeMultiMap& bike_relations) {
-  // Open file and truncate
-  std::stringstream in_mem;
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
-  if (!file.is_open()) {
-    LOG_ERROR("write_bike_relations failed to open output file: " + filename);
-    return false;
-  }
-
-  // Create a vector of bike relations from the multimap
-  std::vector<BikeRelation> relations;
-  for (auto it = bike_relations.cbegin(); it != bike_relations.cend(); ++it) {
-    relations.emplace_back(it->first, it->second);
-  }
-
-  // Write the count and then the bike relations
-  uint32_t sz = relations.size();
-  file.write(reinterpret_cast<const char*>(&sz), sizeof(uint32_t));
-  file.write(reinterpret_cast<const char*>(relations.data()),
-             relations.size() * sizeof(BikeRelation));
-  file.close();
-  return true;
-}
-
 bool write_way_refs(const std::string& filename, const OSMStringMap& way_refs) {
   // Open file and truncate
   std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
@@ -203,153 +88,6 @@ bool write_way_refs(const std::string& filename, const OSMStringMap& way_refs) {
   return true;
 }
 
-bool write_node_names(const std::string& filename, const UniqueNames& names) {
-  // Open file and truncate
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
-  if (!file.is_open()) {
-    LOG_ERROR("write_node_names failed to open output file: " + filename);
-    return false;
-  }
-
-  // Store a count of strings followed by an array of string lengths
-  uint32_t name_count = names.Size();
-  std::vector<uint32_t> lengths(name_count);
-  std::vector<char> namebuf;
-  for (uint32_t n = 0; n < name_count; ++n) {
-    const auto& str = names.name(n + 1); // Add 1 since the first name is blank
-    lengths[n] = str.length() + 1;       // Add 1 for the null terminator
-
-    // Copy the string to the namebuf and add a terminator
-    std::copy(str.c_str(), str.c_str() + str.length(), back_inserter(namebuf));
-    namebuf.push_back(0);
-  }
-
-  // Write to file
-  file.write(reinterpret_cast<const char*>(&name_count), sizeof(uint32_t));
-  file.write(reinterpret_cast<const char*>(lengths.data()), lengths.size() * sizeof(uint32_t));
-  uint32_t sz = namebuf.size();
-  file.write(reinterpret_cast<const char*>(&sz), sizeof(uint32_t));
-  file.write(reinterpret_cast<const char*>(namebuf.data()), namebuf.size());
-  return true;
-}
-
-bool write_unique_names(const std::string& filename, const UniqueNames& names) {
-  // Open file and truncate
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
-  if (!file.is_open()) {
-    LOG_ERROR("write_unique_names failed to open output file: " + filename);
-    return false;
-  }
-
-  // Store a count of strings followed by an array of string lengths
-  uint32_t name_count = names.Size();
-  std::vector<uint32_t> lengths(name_count);
-  std::vector<char> namebuf;
-  for (uint32_t n = 0; n < name_count; ++n) {
-    const auto& str = names.name(n + 1); // Add 1 since the first name is blank
-    lengths[n] = str.length() + 1;       // Add 1 for the null terminator
-
-    // Copy the string to the namebuf and add a terminator
-    std::copy(str.c_str(), str.c_str() + str.length(), back_inserter(namebuf));
-    namebuf.push_back(0);
-  }
-
-  // Write to file
-  file.write(reinterpret_cast<const char*>(&name_count), sizeof(uint32_t));
-  file.write(reinterpret_cast<const char*>(lengths.data()), lengths.size() * sizeof(uint32_t));
-  uint32_t sz = namebuf.size();
-  file.write(reinterpret_cast<const char*>(&sz), sizeof(uint32_t));
-  file.write(reinterpret_cast<const char*>(namebuf.data()), namebuf.size());
-  return true;
-}
-
-bool write_lane_connectivity(const std::string& filename,
-                             const OSMLaneConnectivityMultiMap& lane_map) {
-  // Open file and truncate
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
-  if (!file.is_open()) {
-    LOG_ERROR("write_lane_connectivity failed to open output file: " + filename);
-    return false;
-  }
-
-  // Convert the multi map into a vector of TempLaneConnectivity
-  std::vector<TempLaneConnectivity> lanes;
-  for (auto it = lane_map.cbegin(); it != lane_map.cend(); ++it) {
-    lanes.emplace_back(it->first, it->second);
-  }
-
-  // Write the count and then the via ids
-  uint32_t sz = lanes.size();
-  file.write(reinterpret_cast<const char*>(&sz), sizeof(uint32_t));
-  file.write(reinterpret_cast<const char*>(lanes.data()),
-             lanes.size() * sizeof(TempLaneConnectivity));
-  file.close();
-  return true;
-  return true;
-}
-
-bool write_linguistic(const std::string& filename, const LinguisticMultiMap& ling_map) {
-  // Open file and truncate
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
-  if (!file.is_open()) {
-    LOG_ERROR("write_linguistic failed to open output file: " + filename);
-    return false;
-  }
-
-  // Convert the multi map into a vector of TempLinguistic
-  std::vector<TempLinguistic> ling;
-  for (auto it = ling_map.cbegin(); it != ling_map.cend(); ++it) {
-    ling.emplace_back(it->first, it->second);
-  }
-
-  // Write the count and then the via ids
-  uint32_t sz = ling.size();
-  file.write(reinterpret_cast<const char*>(&sz), sizeof(uint32_t));
-  file.write(reinterpret_cast<const char*>(ling.data()), ling.size() * sizeof(TempLinguistic));
-  file.close();
-  return true;
-}
-
-bool write_conditional_speed_limits(const std::string& filename,
-                                    const ConditionalSpeedLimitsMultiMap& speed_map) {
-  // Open file and truncate
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
-  if (!file.is_open()) {
-    LOG_ERROR("write_linguistic failed to open output file: " + filename);
-    return false;
-  }
-
-  uint32_t sz = speed_map.size();
-  file.write(reinterpret_cast<const char*>(&sz), sizeof(uint32_t));
-  for (const std::pair<const uint64_t, ConditionalSpeedLimit>& sp : speed_map) {
-    file.write(reinterpret_cast<const char*>(&sp), sizeof(sp));
-  }
-  file.close();
-  return true;
-}
-
-bool read_restrictions(const std::string& filename, RestrictionsMultiMap& res_map) {
-  // Open file and truncate
-  std::ifstream file(filename, std::ios::in | std::ios::binary);
-  if (!file.is_open()) {
-    LOG_ERROR("read_restrictions failed to open input file: " + filename);
-    return false;
-  }
-
-  // Read the count and then the temporary restriction list
-  uint32_t count = 0;
-  file.read(reinterpret_cast<char*>(&count), sizeof(uint32_t));
-  std::vector<TempRestriction> access_res(count);
-  file.read(reinterpret_cast<char*>(access_res.data()), count * sizeof(TempRestriction));
-  file.close();
-
-  // Iterate through the temporary restriction list and add to the restriction multi-map
-  for (const auto& r : access_res) {
-    res_map.insert({r.way_id, r.restriction});
-  }
-  return true;
-}
-
 bool read_viaset(const std::string& filename, ViaSet& via_set) {
   // Open file and truncate
   std::ifstream file(filename, std::ios::in | std::ios::binary);
@@ -372,50 +110,6 @@ bool read_viaset(const std::string& filename, ViaSet& via_set) {
   return true;
 }
 
-bool read_access_restrictions(const std::string& filename, AccessRestrictionsMultiMap& access_map) {
-  // Open file and truncate
-  std::ifstream file(filename, std::ios::in | std::ios::binary);
-  if (!file.is_open()) {
-    LOG_ERROR("read_access_restrictions failed to open input file: " + filename);
-    return false;
-  }
-
-  // Read the count and then the temporary access restriction list
-  uint32_t count = 0;
-  file.read(reinterpret_cast<char*>(&count), sizeof(uint32_t));
-  std::vector<TempAccessRestriction> access_res(count);
-  file.read(reinterpret_cast<char*>(access_res.data()), count * sizeof(TempAccessRestriction));
-  file.close();
-
-  // Iterate through the temporary access restriction list and add to the restriction multi-map
-  for (const auto& r : access_res) {
-    access_map.insert({r.way_id, r.restriction});
-  }
-  return true;
-}
-
-bool read_bike_relations(const std::string& filename, BikeMultiMap& bike_relations) {
-  // Open file and truncate
-  std::ifstream file(filename, std::ios::in | std::ios::binary);
-  if (!file.is_open()) {
-    LOG_ERROR("read_bike_relations failed to open input file: " + filename);
-    return false;
-  }
-
-  // Read the count and then the bike relations list
-  uint32_t count = 0;
-  file.read(reinterpret_cast<char*>(&count), sizeof(uint32_t));
-  std::vector<BikeRelation> rel(count);
-  file.read(reinterpret_cast<char*>(rel.data()), count * sizeof(BikeRelation));
-  file.close();
-
-  // Iterate through the temporary bike relations list and add to the bike relations multi-map
-  for (const auto& r : rel) {
-    bike_relations.insert({r.way_id, r.relation});
-  }
-  return true;
-}
-
 bool read_way_refs(const std::string& filename, OSMStringMap& way_refs) {
   // Open file and truncate
   std::ifstream file(filename, std::ios::in | std::ios::binary);
@@ -437,133 +131,35 @@ bool read_way_refs(const std::string& filename, OSMStringMap& way_refs) {
   return true;
 }
 
-bool read_node_names(const std::string& filename, UniqueNames& names) {
-  // Open file and truncate
-  std::ifstream file(filename, std::ios::in | std::ios::binary);
-  if (!file.is_open()) {
-    LOG_ERROR("read_node_names failed to open input file: " + filename);
-    return false;
-  }
-
-  // Read from file
-  uint32_t count = 0;
-  file.read(reinterpret_cast<char*>(&count), sizeof(uint32_t));
-  std::vector<uint32_t> lengths(count);
-  file.read(reinterpret_cast<char*>(lengths.data()), count * sizeof(uint32_t));
-  uint32_t bufsize = 0;
-  file.read(reinterpret_cast<char*>(&bufsize), sizeof(uint32_t));
-  std::vector<char> namebuf(bufsize);
-  file.read(reinterpret_cast<char*>(namebuf.data()), bufsize);
-
-  // Iterate through the temporary data and add the unique names
-  uint32_t offset = 0;
-  for (uint32_t n = 0; n < count; ++n) {
-    std::string name(&namebuf[offset]);
-    names.index(name);
-    offset += lengths[n];
-
-    if ((name.length() + 1) != lengths[n]) {
-      LOG_ERROR("name " + name + " length should be " + std::to_string(lengths[n]));
-    }
-  }
-  return true;
-}
-
-bool read_unique_names(const std::string& filename, UniqueNames& names) {
-  // Open file and truncate
-  std::ifstream file(filename, std::ios::in | std::ios::binary);
-  if (!file.is_open()) {
-    LOG_ERROR("read_unique_names failed to open input file: " + filename);
+template <typename T> bool write_multimap(const std::string& filename, SortedMultiMap<T>& map) {
+  if (!map.write(filename)) {
+    LOG_ERROR("write_multimap failed to write output file: " + filename);
     return false;
   }
-
-  // Read from file
-  uint32_t count = 0;
-  file.read(reinterpret_cast<char*>(&count), sizeof(uint32_t));
-  std::vector<uint32_t> lengths(count);
-  file.read(reinterpret_cast<char*>(lengths.data()), count * sizeof(uint32_t));
-  uint32_t bufsize = 0;
-  file.read(reinterpret_cast<char*>(&bufsize), sizeof(uint32_t));
-  std::vector<char> namebuf(bufsize);
-  file.read(reinterpret_cast<char*>(namebuf.data()), bufsize);
-
-  // Iterate through the temporary data and add the unique names
-  uint32_t offset = 0;
-  for (uint32_t n = 0; n < count; ++n) {
-    std::string name(&namebuf[offset]);
-    names.index(name);
-    offset += lengths[n];
-
-    if ((name.length() + 1) != lengths[n]) {
-      LOG_ERROR("name " + name + " length should be " + std::to_string(lengths[n]));
-    }
-  }
   return true;
 }
 
-bool read_lane_connectivity(const std::string& filename, OSMLaneConnectivityMultiMap& lane_map) {
-  // Open file and truncate
-  std::ifstream file(filename, std::ios::in | std::ios::binary);
-  if (!file.is_open()) {
-    LOG_ERROR("read_lane_connectivity failed to open input file: " + filename);
+template <typename T> bool map_multimap(const std::string& filename, SortedMultiMap<T>& map) {
+  if (!map.map(filename)) {
+    LOG_ERROR("map_multimap failed to map input file: " + filename);
     return false;
   }
-
-  // Read the count and then the temporary lane connectivity list
-  uint32_t count = 0;
-  file.read(reinterpret_cast<char*>(&count), sizeof(uint32_t));
-  std::vector<TempLaneConnectivity> lanes(count);
-  file.read(reinterpret_cast<char*>(lanes.data()), count * sizeof(TempLaneConnectivity));
-  file.close();
-
-  // Iterate through the temporary lane connectivity list and add to the lane connectivity multi-map
-  for (const auto& l : lanes) {
-    lane_map.insert({l.way_id, l.lane});
-  }
   return true;
 }
 
-bool read_linguistic(const std::string& filename, LinguisticMultiMap& ling_map) {
-  // Open file and truncate
-  std::ifstream file(filename, std::ios::in | std::ios::binary);
-  if (!file.is_open()) {
-    LOG_ERROR("read_linguistic failed to open input file: " + filename);
+bool write_names(const std::string& filename, const UniqueNames& names) {
+  if (!names.write(filename)) {
+    LOG_ERROR("write_names failed to write output file: " + filename);
     return false;
   }
-
-  // Read the count and then the temporary access restriction list
-  uint32_t count = 0;
-  file.read(reinterpret_cast<char*>(&count), sizeof(uint32_t));
-  std::vector<TempLinguistic> ling(count);
-  file.read(reinterpret_cast<char*>(ling.data()), count * sizeof(TempLinguistic));
-  file.close();
-
-  // Iterate through the temporary access restriction list and add to the restriction multi-map
-  for (const auto& l : ling) {
-    ling_map.insert({l.way_id, l.linguistic});
-  }
   return true;
 }
 
-bool read_conditional_speed_limits(const std::string& filename,
-                                   ConditionalSpeedLimitsMultiMap& speed_map) {
-  // Open file and truncate
-  std::ifstream file(filename, std::ios::in | std::ios::binary);
-  if (!file.is_open()) {
-    LOG_ERROR("read_conditional_speed_limits failed to open input file: " + filename);
+bool map_names(const std::string& filename, UniqueNames& names) {
+  if (!names.map(filename)) {
+    LOG_ERROR("map_names failed to map input file: " + filename);
     return false;
   }
-
-  // Read the count and following conditional speed limits
-  uint32_t count = 0;
-  file.read(reinterpret_cast<char*>(&count), sizeof(uint32_t));
-  speed_map.reserve(count);
-  while (count--) {
-    std::pair<uint64_t, ConditionalSpeedLimit> sp = {{}, {}};
-    file.read(reinterpret_cast<char*>(&sp), sizeof(sp));
-    speed_map.emplace(std::move(sp));
-  }
-  file.close();
   return true;
 }
 
@@ -597,19 +193,18 @@ bool OSMData::write_to_temp_files(const std::string& tile_dir) {
   file.close();
 
   // Write the rest of OSMData
-  bool status =
-      write_restrictions(tile_dir + restrictions_file, restrictions) &&
-      write_viaset(tile_dir + viaset_file, via_set) &&
-      write_access_restrictions(tile_dir + access_restrictions_file, access_restrictions) &&
-      write_bike_relations(tile_dir + bike_relations_file, bike_relations) &&
-      write_way_refs(tile_dir + way_ref_file, way_ref) &&
-      write_way_refs(tile_dir + way_ref_rev_file, way_ref_rev) &&
-      write_node_names(tile_dir + node_names_file, node_names) &&
-      write_unique_names(tile_dir + unique_names_file, name_offset_map) &&
-      write_lane_connectivity(tile_dir + lane_connectivity_file, lane_connectivity_map) &&
-      write_linguistic(tile_dir + pronunciation_file, pronunciations) &&
-      write_linguistic(tile_dir + language_file, langs) &&
-      write_conditional_speed_limits(tile_dir + conditional_speed_limit_file, conditional_speeds);
+  bool status = write_multimap(tile_dir + restrictions_file, restrictions) &&
+                write_viaset(tile_dir + viaset_file, via_set) &&
+                write_multimap(tile_dir + access_restrictions_file, access_restrictions) &&
+                write_multimap(tile_dir + bike_relations_file, bike_relations) &&
+                write_way_refs(tile_dir + way_ref_file, way_ref) &&
+                write_way_refs(tile_dir + way_ref_rev_file, way_ref_rev) &&
+                write_names(tile_dir + node_names_file, node_names) &&
+                write_names(tile_dir + unique_names_file, name_offset_map) &&
+                write_multimap(tile_dir + lane_connectivity_file, lane_connectivity_map) &&
+                write_multimap(tile_dir + pronunciation_file, pronunciations) &&
+                write_multimap(tile_dir + language_file, langs) &&
+                write_multimap(tile_dir + conditional_speed_limit_file, conditional_speeds);
   LOG_INFO("Done");
   return status;
 }
@@ -645,18 +240,18 @@ bool OSMData::read_from_temp_files(const std::string& tile_dir) {
 
   // Read the other data
   bool status =
-      read_restrictions(tile_directory + restrictions_file, restrictions) &&
+      map_multimap(tile_directory + restrictions_file, restrictions) &&
       read_viaset(tile_directory + viaset_file, via_set) &&
-      read_access_restrictions(tile_directory + access_restrictions_file, access_restrictions) &&
-      read_bike_relations(tile_directory + bike_relations_file, bike_relations) &&
+      map_multimap(tile_directory + access_restrictions_file, access_restrictions) &&
+      map_multimap(tile_directory + bike_relations_file, bike_relations) &&
       read_way_refs(tile_directory + way_ref_file, way_ref) &&
       read_way_refs(tile_directory + way_ref_rev_file, way_ref_rev) &&
-      read_node_names(tile_directory + node_names_file, node_names) &&
-      read_unique_names(tile_directory + unique_names_file, name_offset_map) &&
-      read_lane_connectivity(tile_directory + lane_connectivity_file, lane_connectivity_map) &&
-      read_linguistic(tile_directory + pronunciation_file, pronunciations) &&
-      read_linguistic(tile_directory + language_file, langs) &&
-      read_conditional_speed_limits(tile_directory + lane_connectivity_file, conditional_speeds);
+      map_names(tile_directory + node_names_file, node_names) &&
+      map_names(tile_directory + unique_names_file, name_offset_map) &&
+      map_multimap(tile_directory + lane_connectivity_file, lane_connectivity_map) &&
+      map_multimap(tile_directory + pronunciation_file, pronunciations) &&
+      map_multimap(tile_directory + language_file, langs) &&
+      map_multimap(tile_directory + conditional_speed_limit_file, conditional_speeds);
   LOG_INFO("Done");
   initialized = status;
   return status;
@@ -668,11 +263,22 @@ bool OSMData::read_from_unique_names_file(const std::string& tile_dir) {
   LOG_INFO("Read OSMData unique_names from temp file");
 
   // Read the other data
-  bool status = read_unique_names(tile_dir + unique_names_file, name_offset_map);
+  bool status = map_names(tile_dir + unique_names_file, name_offset_map);
   LOG_INFO("Done");
   return status;
 }
 
+void OSMData::sort_multimaps() {
+  SCOPED_TIMER();
+  restrictions.sort();
+  access_restrictions.sort();
+  bike_relations.sort();
+  lane_connectivity_map.sort();
+  pronunciations.sort();
+  langs.sort();
+  conditional_speeds.sort();
+}
+
 // add the direction information to the forward or reverse map for relations.
 void OSMData::add_to_name_map(const uint64_t member_id,
                               const std::string& direction,
@@ -0,0 +1,78 @@
+#include "mjolnir/overlaybuilder.h"
+#include "baldr/graphoverlay.h"
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "scoped_timer.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace valhalla::baldr;
+
+namespace valhalla {
+namespace mjolnir {
+
+void OverlayBuilder::Build(const boost::property_tree::ptree& pt) {
+  SCOPED_TIMER();
+  const auto overlay_file = pt.get<std::string>("mjolnir.overlay");
+  GraphReader reader(pt.get_child("mjolnir"));
+
+  // Every highway edge leaving its tile is an exit of its own cell and an entry of the cell it
+  // leads into. Shortcuts are left out since the cells are searched edge by edge. The search of a
+  // cell starts over at each entry, so complex restrictions crossing the boundary are only
+  // honored if both cells are searched edge by edge at route time
+  const auto level = TileHierarchy::levels().front().level;
+  std::map<GraphId, GraphOverlay::Cell> cells;
+  size_t boundary_edges = 0;
+  for (const auto& tile_id : reader.GetTileSet(level)) {
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+    auto tile = reader.GetGraphTile(tile_id);
+    if (!tile) {
+      continue;
+    }
+
+    GraphId edge_id = tile_id;
+    for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i, ++edge_id) {
+      const auto* edge = tile->directededge(i);
+      if (!edge->leaves_tile() || edge->is_shortcut() || edge->endnode().level() != level) {
+        continue;
+      }
+      auto& exit_cell = cells[tile_id];
+      exit_cell.tile_id = tile_id;
+      exit_cell.exits.push_back(edge_id);
+
+      auto& entry_cell = cells[edge->endnode().Tile_Base()];
+      entry_cell.tile_id = edge->endnode().Tile_Base();
+      entry_cell.entries.push_back(edge_id);
+      ++boundary_edges;
+
+      if (edge->part_of_complex_restriction() || edge->start_restriction() ||
+          edge->end_restriction()) {
+        exit_cell.restricted = entry_cell.restricted = true;
+      }
+    }
+  }
+
+  std::vector<GraphOverlay::Cell> overlay_cells;
+  overlay_cells.reserve(cells.size());
+  for (auto& cell : cells) {
+    overlay_cells.emplace_back(std::move(cell.second));
+  }
+  GraphOverlay overlay(std::move(overlay_cells));
+  overlay.Write(overlay_file);
+
+  auto restricted = std::count_if(overlay.cells().begin(), overlay.cells().end(),
+                                  [](const GraphOverlay::Cell& cell) { return cell.restricted; });
+  LOG_INFO("Wrote overlay with " + std::to_string(overlay.cells().size()) + " cells (" +
+           std::to_string(restricted) + " with restrictions on their boundary) and " +
+           std::to_string(boundary_edges) + " boundary edges to " + overlay_file);
+}
+
+} // namespace mjolnir
+} // namespace valhalla
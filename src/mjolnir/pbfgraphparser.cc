@@ -15,8 +15,15 @@
 
 #include <boost/algorithm/string.hpp>
 #include <osmium/io/pbf_input.hpp>
+#include <osmium/thread/queue.hpp>
 
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <future>
+#include <optional>
 #include <thread>
+#include <type_traits>
 #include <utility>
 
 using namespace valhalla::midgard;
@@ -25,15 +32,15 @@ using namespace valhalla::mjolnir;
 
 namespace {
 
-// Limits number of Lua workers in `PBFGraphParser::ParseWays()`.
+// Limits number of Lua workers in `parse_in_order()`.
 // Increase this number if downstream processing can handle more.
 constexpr size_t kMaxLuaConcurrency = 8;
-// Number of OSM pbf buffers per Lua worker in `PBFGraphParser::ParseWays()`.
+// Number of OSM pbf buffers per Lua worker in `parse_in_order()`.
 constexpr size_t kOsmBuffersPerLua = 4;
-// Number of processed OSM pbf buffers (buffer has many ways) per Lua worker. That one should be
-// reasonably big because `PBFGraphParser::ParseWays()` keeps original order of OSM ways and this
-// buffer allows Lua workers not to stuck if next needed buffer takes more time than others.
-constexpr size_t kWaysChunksPerLua = 8;
+// Number of processed OSM pbf buffers (buffer has many entities) per Lua worker. That one should be
+// reasonably big because `parse_in_order()` keeps original order of OSM entities and this buffer
+// allows Lua workers not to stuck if next needed buffer takes more time than others.
+constexpr size_t kChunksPerLua = 8;
 constexpr char kExceptDestinationRestrictionFlag = '~';
 
 // Convenience method to get a number from a string. Uses try/catch in case
@@ -180,7 +187,6 @@ struct graph_parser {
     use_admin_db_ = pt.get<bool>("data_processing.use_admin_db", true);
 
     empty_node_tags_ = lua_.Transform(OSMType::kNode, 0, {});
-    empty_relation_tags_ = lua_.Transform(OSMType::kRelation, 0, {});
 
     tag_handlers_["driving_side"] = [this]() {
       if (!use_admin_db_) {
@@ -1977,18 +1983,23 @@ struct graph_parser {
     return std::string(lua_graph_lua, lua_graph_lua + lua_graph_lua_len);
   }
 
-  // Handle bike share stations separately
-  void bss_node(const osmium::Node& node) {
-    const uint64_t osmid = node.id();
-    // unsorted extracts are just plain nasty, so they can bugger off!
-    if (osmid < last_node_) {
-      throw std::runtime_error("Detected unsorted input data");
-    }
-    last_node_ = osmid;
+  // Intermediate structure that represents a bike share station found (by Lua) among osm nodes
+  struct BSSNode {
+    OSMNode node;
+    std::string bss_info;
+  };
 
+  // Handle bike share stations separately
+  static void transform_bss_node(const osmium::Node& node,
+                                 LuaTagTransform& lua,
+                                 const Tags& empty_node_tags,
+                                 std::vector<BSSNode>& transformed) {
     // Get tags - do't bother with Lua callout if the taglist is empty
-    const Tags tags = node.tags().empty() ? empty_node_tags_
-                                          : lua_.Transform(OSMType::kNode, node.id(), node.tags());
+    Tags node_tags;
+    if (!node.tags().empty()) {
+      node_tags = lua.Transform(OSMType::kNode, node.id(), node.tags());
+    }
+    const Tags& tags = node.tags().empty() ? empty_node_tags : node_tags;
 
     // bail if there is nothing bike related
     Tags::const_iterator found = tags.find("amenity");
@@ -1997,7 +2008,7 @@ struct graph_parser {
     }
 
     // Create a new node and set its attributes
-    OSMNode n{osmid};
+    OSMNode n{static_cast<uint64_t>(node.id())};
     n.set_latlng(node.location().lon(), node.location().lat());
     n.set_type(NodeType::kBikeShare);
     valhalla::BikeShareStationInfo bss_info;
@@ -2021,49 +2032,67 @@ struct graph_parser {
 
     std::string buffer;
     bss_info.SerializeToString(&buffer);
-    const uint32_t bss_info_index = osmdata_.node_names.index(buffer);
-    ++osmdata_.node_name_count;
-
-    bss_nodes_->push_back({n, bss_info_index});
+    transformed.emplace_back(BSSNode{n, std::move(buffer)});
   }
 
-  void node(const osmium::Node& node) {
-    changeset(node.changeset());
+  void bss_node(const BSSNode& node) {
+    const uint32_t bss_info_index = osmdata_.node_names.index(node.bss_info);
+    ++osmdata_.node_name_count;
 
-    const uint64_t osmid = node.id();
-    // unsorted extracts are just plain nasty, so they can bugger off!
-    if (osmid < last_node_) {
-      throw std::runtime_error("Detected unsorted input data");
-    }
-    last_node_ = osmid;
+    bss_nodes_->push_back({node.node, bss_info_index});
+  }
 
+  // Moves the index to the first way node reference of the node with the given id, if the ways
+  // use it at all. The references are sorted by node id so the index only ever moves forward.
+  bool find_way_node(const uint64_t osmid, size_t& index) {
     // if we found all of the node ids we were looking for already we can bail
-    if (current_way_node_index_ >= way_nodes_->size()) {
-      return;
+    if (index >= way_nodes_->size()) {
+      return false;
     }
 
     // if the current osmid of this node of this pbf file is greater than the waynode we are looking
     // for then it must be in another pbf file. so we need to move on to the next waynode that could
     // possibly actually be in this pbf file
-    if (osmid > (*(*way_nodes_)[current_way_node_index_]).node.osmid_) {
-      current_way_node_index_ = way_nodes_->find_first_of(
+    if (osmid > (*(*way_nodes_)[index]).node.osmid_) {
+      index = way_nodes_->find_first_of(
           OSMWayNode{{osmid}},
           [](const OSMWayNode& a, const OSMWayNode& b) { return a.node.osmid_ <= b.node.osmid_; },
-          current_way_node_index_);
+          index);
     }
 
     // if this nodes id is less than the waynode we are looking for then we know its a node we can
     // skip because it means there were no ways that we kept that referenced it. also we could run out
     // of waynodes to look for and in that case we are done as well
-    if (current_way_node_index_ >= way_nodes_->size() ||
-        osmid < (*(*way_nodes_)[current_way_node_index_]).node.osmid_) {
-      return;
+    return index < way_nodes_->size() && osmid == (*(*way_nodes_)[index]).node.osmid_;
+  }
+
+  // Intermediate structure that represents transformed (by Lua) osm node used by a way
+  struct Node {
+    uint64_t osmid;
+    osmium::Location location;
+    // not set when the node has no tags at all
+    std::optional<Tags> tags;
+  };
+
+  static void transform_node(const osmium::Node& node,
+                             LuaTagTransform& lua,
+                             const Tags& /*empty_node_tags*/,
+                             std::vector<Node>& transformed) {
+    // Don't bother calling Lua if there are no OSM tags to process.
+    std::optional<Tags> tags;
+    if (!node.tags().empty()) {
+      tags = lua.Transform(OSMType::kNode, node.id(), node.tags());
     }
+    transformed.emplace_back(
+        Node{static_cast<uint64_t>(node.id()), node.location(), std::move(tags)});
+  }
+
+  void node(const Node& node) {
+    const uint64_t osmid = node.osmid;
+    // only the nodes the ways use were transformed, this finds where their references start
+    find_way_node(osmid, current_way_node_index_);
 
-    // Get tags if not already available.  Don't bother calling Lua if there
-    // are no OSM tags to process.
-    const Tags tags =
-        node.tags().empty() ? empty_node_tags_ : lua_.Transform(OSMType::kNode, osmid, node.tags());
+    const Tags& tags = node.tags ? *node.tags : empty_node_tags_;
 
     const auto highway = tags.find("highway");
     bool is_highway_junction = ((highway != tags.end()) && (highway->second == "motorway_junction"));
@@ -2087,7 +2116,7 @@ struct graph_parser {
     OSMNode n;
     OSMNodeLinguistic linguistics;
     n.set_id(osmid);
-    n.set_latlng(node.location().lon(), node.location().lat());
+    n.set_latlng(node.location.lon(), node.location.lat());
     bool intersection = false;
     if (is_highway_junction) {
       n.set_type(NodeType::kMotorWayJunction);
@@ -2382,11 +2411,6 @@ struct graph_parser {
     changeset(way.changeset_id);
 
     osmid_ = way.osmid;
-    // unsorted extracts are just plain nasty, so they can bugger off!
-    if (osmid_ < last_way_) {
-      throw std::runtime_error("Detected unsorted input data");
-    }
-    last_way_ = osmid_;
 
     const auto& nodes = way.nodes;
     const auto& tags = way.tags;
@@ -3806,24 +3830,46 @@ struct graph_parser {
     ways_->push_back(way_);
   }
 
-  void relation(const osmium::Relation& relation) {
-    changeset(relation.changeset());
+  // Intermediate structure that represents transformed (by Lua) osm relation
+  struct Relation {
+    struct Member {
+      osmium::item_type member_type;
+      uint64_t member_id;
+      std::string role;
+    };
 
-    const uint64_t osmid = relation.id();
-    // unsorted extracts are just plain nasty, so they can bugger off!
-    if (osmid < last_relation_) {
-      throw std::runtime_error("Detected unsorted input data");
-    }
-    last_relation_ = osmid;
+    uint64_t osmid;
+    Tags tags;
+    std::vector<Member> members;
+  };
 
+  static void transform_relation(const osmium::Relation& relation,
+                                 LuaTagTransform& lua,
+                                 const Tags& empty_relation_tags,
+                                 std::vector<Relation>& transformed) {
     // Get tags
-    const Tags tags = relation.tags().empty()
-                          ? empty_relation_tags_
-                          : lua_.Transform(OSMType::kRelation, osmid, relation.tags());
+    Tags tags = relation.tags().empty()
+                    ? empty_relation_tags
+                    : lua.Transform(OSMType::kRelation, relation.id(), relation.tags());
     if (tags.empty()) {
       return;
     }
 
+    std::vector<Relation::Member> members;
+    members.reserve(relation.members().size());
+    for (const auto& member : relation.members()) {
+      members.push_back(
+          Relation::Member{member.type(), static_cast<uint64_t>(member.ref()), member.role()});
+    }
+
+    transformed.emplace_back(
+        Relation{static_cast<uint64_t>(relation.id()), std::move(tags), std::move(members)});
+  }
+
+  void relation(const Relation& relation) {
+    const uint64_t osmid = relation.osmid;
+    const auto& tags = relation.tags;
+
     OSMRestriction restriction{};
     OSMRestriction to_restriction{};
 
@@ -3999,18 +4045,7 @@ struct graph_parser {
         special_network = true;
     }
 
-    // Convert into a vector of helper structs to simplify processing by using
-    // `std::string_view` for `role` instead of original `const char*`.
-    struct Member {
-      osmium::item_type member_type;
-      uint64_t member_id;
-      std::string_view role;
-    };
-    std::vector<Member> members;
-    members.reserve(relation.members().size());
-    for (const auto& member : relation.members()) {
-      members.push_back(Member{member.type(), static_cast<uint64_t>(member.ref()), member.role()});
-    }
+    const auto& members = relation.members;
 
     if (isBicycle && isRoute && !network.empty()) {
       OSMBike bike;
@@ -5082,7 +5117,6 @@ struct graph_parser {
 
   // empty objects initialized with defaults to use when no tags are present on objects
   Tags empty_node_tags_;
-  Tags empty_relation_tags_;
 
   uint32_t get_pronunciation_index(const uint8_t type, const uint8_t alpha) {
     auto itr = pronunciationMap.find(std::make_pair(type, alpha));
@@ -5101,6 +5135,178 @@ struct graph_parser {
   }
 };
 
+/**
+ * Reads one OSM file and transforms the tags of its entities with Lua on several threads while
+ * handing them to the graph parser in the original order of the file, which it relies on.
+ * Asymmetric multithreading (in data flow order):
+ * - osmium::thread::pool for parsing PBF file
+ * - 1 thread to read the file and hand its buffers over in order
+ * - current thread for checking the order of the entities and selecting the ones to transform
+ * - `lua_concurrency` threads for lua transform, no more than `kMaxLuaConcurrency`
+ * - current thread again for working with OSMData on the transformed entities, in order
+ * None of them will saturate the full CPU core, so total count can be bigger than
+ * `std::thread::hardware_concurrency()` or "concurrency" parameter.
+ *
+ * @param file         the OSM file to read the entities from
+ * @param lua_script   the Lua script each transform thread runs
+ * @param concurrency  the "concurrency" parameter
+ * @param last_id      the id of the last entity read, the entities must not go below it
+ * @param select       called in order for every entity, returns whether to transform it
+ * @param transform    called on a Lua thread for every selected entity, adds what it keeps to
+ *                     the chunk of its buffer
+ * @param apply        called in order for everything the transform kept
+ * @return the number of entities read from the file
+ */
+template <typename Entity, typename Transformed, typename Select, typename Transform, typename Apply>
+size_t parse_in_order(const std::string& file,
+                      const std::string& lua_script,
+                      const size_t concurrency,
+                      uint64_t& last_id,
+                      Select select,
+                      Transform transform,
+                      Apply apply) {
+  constexpr OSMType osm_type = std::is_same_v<Entity, osmium::Node>  ? OSMType::kNode
+                               : std::is_same_v<Entity, osmium::Way> ? OSMType::kWay
+                                                                     : OSMType::kRelation;
+  const size_t lua_concurrency =
+      std::clamp(concurrency - 1, static_cast<size_t>(1), kMaxLuaConcurrency);
+
+  // Single reader thread that keeps the order of the buffers. An invalid buffer ends the file.
+  osmium::thread::Queue<osmium::memory::Buffer> read_queue(lua_concurrency * kOsmBuffersPerLua);
+  std::exception_ptr reader_error;
+  std::thread reader_thread([&file, &read_queue, &reader_error] {
+    try {
+      osmium::io::Reader reader(file, osmium::osm_entity_bits::from_item_type(Entity::itemtype));
+      while (osmium::memory::Buffer buffer = reader.read()) {
+        read_queue.push(std::move(buffer)); // Blocks if queue is full.
+      }
+      reader.close(); // Explicit close to get an exception in case of an error.
+    } catch (...) {
+      reader_error = std::current_exception();
+    }
+    read_queue.push(osmium::memory::Buffer{});
+  });
+
+  // These two maintain the order of the transformed entities. The Lua workers take the selected
+  // entities along with their buffer and a promise, the current thread keeps the futures of those
+  // promises in the order of the file.
+  using Chunk = std::vector<Transformed>;
+  using Selected = std::pair<osmium::memory::Buffer, std::vector<const Entity*>>;
+  osmium::thread::Queue<std::pair<Selected, std::promise<Chunk>>> transform_queue(
+      lua_concurrency * kOsmBuffersPerLua);
+  std::deque<std::future<Chunk>> chunks;
+
+  // Thread pool for Lua processing.
+  std::vector<std::thread> lua_pool;
+  lua_pool.reserve(lua_concurrency);
+  for (size_t i = 0; i < lua_concurrency; ++i) {
+    lua_pool.emplace_back(std::thread([&lua_script, &transform_queue, &transform] {
+      LuaTagTransform lua(lua_script);
+      const Tags empty_tags = lua.Transform(osm_type, 0, {});
+
+      while (true) {
+        std::pair<Selected, std::promise<Chunk>> selected_promise;
+        transform_queue.wait_and_pop(selected_promise);
+        if (!selected_promise.first.first) {
+          break; // End of the queue
+        }
+
+        try {
+          Chunk transformed;
+          for (const Entity* entity : selected_promise.first.second) {
+            transform(*entity, lua, empty_tags, transformed);
+          }
+          selected_promise.second.set_value(std::move(transformed));
+        } catch (...) { selected_promise.second.set_exception(std::current_exception()); }
+      }
+    }));
+  }
+
+  auto apply_chunk = [&chunks, &apply]() {
+    Chunk transformed = chunks.front().get();
+    chunks.pop_front();
+    for (const auto& t : transformed) {
+      apply(t);
+    }
+  };
+
+  size_t count = 0;
+  bool read_all = false;
+  std::exception_ptr error;
+  try {
+    while (true) {
+      osmium::memory::Buffer buffer;
+      read_queue.wait_and_pop(buffer);
+      if (!buffer) {
+        read_all = true;
+        break; // End of the file
+      }
+
+      std::vector<const Entity*> selected;
+      for (const Entity& entity : buffer.select<Entity>()) {
+        const uint64_t osmid = entity.id();
+        // unsorted extracts are just plain nasty, so they can bugger off!
+        if (osmid < last_id) {
+          throw std::runtime_error("Detected unsorted input data");
+        }
+        last_id = osmid;
+        ++count;
+        if (select(entity)) {
+          selected.push_back(&entity);
+        }
+      }
+
+      std::promise<Chunk> promise;
+      chunks.push_back(promise.get_future());
+      transform_queue.push(
+          std::make_pair(std::make_pair(std::move(buffer), std::move(selected)), std::move(promise)));
+
+      // Apply whatever is ready in order, only wait for the Lua workers when too much is pending.
+      while (!chunks.empty() &&
+             (chunks.size() >= lua_concurrency * kChunksPerLua ||
+              chunks.front().wait_for(std::chrono::seconds(0)) == std::future_status::ready)) {
+        apply_chunk();
+      }
+    }
+
+    while (!chunks.empty()) {
+      apply_chunk();
+    }
+  } catch (...) {
+    error = std::current_exception();
+    // Let the reader thread run to the end so that it can be joined.
+    for (osmium::memory::Buffer buffer; !read_all; read_all = !buffer) {
+      read_queue.wait_and_pop(buffer);
+    }
+  }
+
+  // Send stop signals to all threads.
+  for (size_t i = 0; i < lua_concurrency; ++i) {
+    transform_queue.push({});
+  }
+  reader_thread.join();
+  for (auto& t : lua_pool) {
+    t.join();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  if (reader_error) {
+    std::rethrow_exception(reader_error);
+  }
+  return count;
+}
+
+// Sums up the sizes of the input files, for reporting how fast they were parsed.
+size_t file_sizes(const std::vector<std::string>& input_files) {
+  size_t bytes = 0;
+  for (const auto& file : input_files) {
+    bytes += std::filesystem::file_size(file);
+  }
+  return bytes;
+}
+
 } // namespace
 
 namespace valhalla {
@@ -5117,18 +5323,10 @@ OSMData PBFGraphParser::ParseWays(const boost::property_tree::ptree& pt,
   graph_parser parser(pt, osmdata);
   const auto lua_script = graph_parser::get_lua(pt);
 
-  // Asymmetric multithreading (in data flow order):
-  // - osmium::thread::pool for parsing PBF file
-  // - 1 thread to feed the lua transform pool and guarantee the order of ways
-  // - `lua_concurrency` threads for lua transform, no more than `kMaxLuaConcurrency`
-  // - current thread for working with OSMData in `graph_parser::way()`
-  // None of them will saturate the full CPU core, so total count can be bigger than
-  // `std::thread::hardware_concurrency()` or "concurrency" parameter.
+  // The Lua transform runs on more threads than this, see `parse_in_order()`
   const size_t concurrency =
       std::max(static_cast<size_t>(1),
                pt.get<size_t>("concurrency", std::thread::hardware_concurrency()));
-  const size_t lua_concurrency =
-      std::clamp(concurrency - 1, static_cast<size_t>(1), kMaxLuaConcurrency);
 
   LOG_INFO("Parsing files for ways: " + boost::algorithm::join(input_files, ", "));
 
@@ -5137,76 +5335,15 @@ OSMData PBFGraphParser::ParseWays(const boost::property_tree::ptree& pt,
   // Parse the ways and find all node Ids needed (those that are part of a
   // way's node list. Iterate through each pbf input file.
   LOG_INFO("Parsing ways...");
-  for (auto& file : input_files) {
-    parser.current_way_node_index_ = parser.last_node_ = parser.last_way_ = parser.last_relation_ = 0;
-
-    // These two queues maintains the order of processed ways by holding futures that correspond
-    // to the promises sent to the Lua workers. Lua workers take that promises and corresponding
-    // osmium buffers, process them and set the value of the promise.
-    using Ways = std::vector<graph_parser::Way>;
-    osmium::thread::Queue<std::future<Ways>> ways_queue(lua_concurrency * kWaysChunksPerLua);
-    osmium::thread::Queue<std::pair<osmium::memory::Buffer, std::promise<Ways>>> buffer_queue(
-        lua_concurrency * kOsmBuffersPerLua);
-
-    // Single reader thread that guarantees the order of ways via future/promise magic.
-    std::thread reader_thread([&file, &ways_queue, &buffer_queue, lua_concurrency] {
-      osmium::io::Reader reader(file, osmium::osm_entity_bits::way);
-      while (osmium::memory::Buffer buffer = reader.read()) {
-        std::promise<Ways> promise;
-        ways_queue.push(promise.get_future()); // Blocks if queue is full.
-        buffer_queue.push(std::make_pair(std::move(buffer), std::move(promise)));
-      }
-
-      // Send stop signals to all threads.
-      ways_queue.push({});
-      for (size_t i = 0; i < lua_concurrency; ++i) {
-        buffer_queue.push({});
-      }
-
-      reader.close(); // Explicit close to get an exception in case of an error.
-    });
-
-    // Thread pool for Lua processing.
-    std::vector<std::thread> lua_pool;
-    lua_pool.reserve(lua_concurrency);
-    for (size_t i = 0; i < lua_concurrency; ++i) {
-      lua_pool.emplace_back(std::thread([&lua_script, &buffer_queue] {
-        LuaTagTransform lua(lua_script);
-        const Tags empty_way_tags = lua.Transform(OSMType::kWay, 0, {});
-
-        while (true) {
-          std::pair<osmium::memory::Buffer, std::promise<Ways>> buffer_promise;
-          buffer_queue.wait_and_pop(buffer_promise);
-          if (!buffer_promise.first) {
-            break; // End of the queue
-          }
-
-          Ways transformed;
-          for (const osmium::memory::Item& item : buffer_promise.first) {
-            graph_parser::transform_way(static_cast<const osmium::Way&>(item), lua, empty_way_tags,
-                                        transformed);
-          }
-          buffer_promise.second.set_value(std::move(transformed));
-        }
-      }));
-    }
-
-    while (true) {
-      std::future<Ways> future;
-      ways_queue.wait_and_pop(future);
-      if (!future.valid()) {
-        break; // End of the queue
-      }
-
-      Ways transformed = future.get();
-      for (const auto& way : transformed) {
-        parser.way(way);
-      }
-    }
-
-    reader_thread.join();
-    for (auto& t : lua_pool) {
-      t.join();
+  {
+    size_t ways = 0, bytes = file_sizes(input_files);
+    SCOPED_THROUGHPUT_TIMER("ways", ways, bytes);
+    for (auto& file : input_files) {
+      parser.current_way_node_index_ = parser.last_node_ = parser.last_way_ = parser.last_relation_ =
+          0;
+      ways += parse_in_order<osmium::Way, graph_parser::Way>(
+          file, lua_script, concurrency, parser.last_way_, [](const osmium::Way&) { return true; },
+          graph_parser::transform_way, [&parser](const graph_parser::Way& way) { parser.way(way); });
     }
   }
 
@@ -5222,9 +5359,12 @@ OSMData PBFGraphParser::ParseWays(const boost::property_tree::ptree& pt,
   LOG_INFO("Sorting osm access tags by way id...");
   {
     sequence<OSMAccess> access(access_file, false);
-    access.sort([](const OSMAccess& a, const OSMAccess& b) { return a.way_id() < b.way_id(); });
+    access.sort([](const OSMAccess& a, const OSMAccess& b) { return a.way_id() < b.way_id(); },
+                sequence<OSMAccess>::default_sort_buffer_size, concurrency);
   }
 
+  // the lookups of the later stages need the multimaps sorted by way id
+  osmdata.sort_multimaps();
   LOG_INFO("Finished");
 
   // Return OSM data
@@ -5237,13 +5377,6 @@ void PBFGraphParser::ParseRelations(const boost::property_tree::ptree& pt,
                                     const std::string& complex_restriction_from_file,
                                     const std::string& complex_restriction_to_file,
                                     OSMData& osmdata) {
-  // TODO: option 1: each one threads makes an osmdata and we splice them together at the end
-  // option 2: synchronize around adding things to a single osmdata. will have to test to see
-  // which is the least expensive (memory and speed). leaning towards option 2
-  //  unsigned int threads =
-  //      std::max(static_cast<unsigned int>(1),
-  //               pt.get<unsigned int>("concurrency", std::thread::hardware_concurrency()));
-
   // Create OSM data. Set the member pointer so that the parsing callback methods can use it.
   SCOPED_TIMER();
   graph_parser parser(pt, osmdata);
@@ -5252,6 +5385,12 @@ void PBFGraphParser::ParseRelations(const boost::property_tree::ptree& pt,
   if (!osmdata.initialized)
     parser.osmdata_.read_from_temp_files(pt.get<std::string>("tile_dir"));
 
+  // The Lua transform runs on more threads than this, see `parse_in_order()`
+  const size_t concurrency =
+      std::max(static_cast<size_t>(1),
+               pt.get<size_t>("concurrency", std::thread::hardware_concurrency()));
+  const auto lua_script = graph_parser::get_lua(pt);
+
   LOG_INFO("Parsing files for relations: " + boost::algorithm::join(input_files, ", "));
 
   parser.reset(nullptr, nullptr, nullptr,
@@ -5260,17 +5399,23 @@ void PBFGraphParser::ParseRelations(const boost::property_tree::ptree& pt,
 
   // Parse relations.
   LOG_INFO("Parsing relations...");
-  for (auto& file : input_files) {
-    parser.current_way_node_index_ = parser.last_node_ = parser.last_way_ = parser.last_relation_ = 0;
-
-    osmium::io::Reader reader(file, osmium::osm_entity_bits::relation);
-    while (const osmium::memory::Buffer buffer = reader.read()) {
-      for (const osmium::memory::Item& item : buffer) {
-        parser.relation(static_cast<const osmium::Relation&>(item));
-      }
+  {
+    size_t relations = 0, bytes = file_sizes(input_files);
+    SCOPED_THROUGHPUT_TIMER("relations", relations, bytes);
+    for (auto& file : input_files) {
+      parser.current_way_node_index_ = parser.last_node_ = parser.last_way_ = parser.last_relation_ =
+          0;
+      relations += parse_in_order<osmium::Relation, graph_parser::Relation>(
+          file, lua_script, concurrency, parser.last_relation_,
+          [&parser](const osmium::Relation& relation) {
+            parser.changeset(relation.changeset());
+            return true;
+          },
+          graph_parser::transform_relation,
+          [&parser](const graph_parser::Relation& relation) { parser.relation(relation); });
     }
-    reader.close(); // Explicit close to get an exception in case of an error.
   }
+  osmdata.sort_multimaps();
   LOG_INFO("Finished with " + std::to_string(osmdata.restrictions.size()) +
            " simple turn restrictions");
   LOG_INFO("Finished with " + std::to_string(osmdata.lane_connectivity_map.size()) +
@@ -5283,7 +5428,8 @@ void PBFGraphParser::ParseRelations(const boost::property_tree::ptree& pt,
   {
     sequence<OSMRestriction> complex_restrictions_from(complex_restriction_from_file, false);
     complex_restrictions_from.sort(
-        [](const OSMRestriction& a, const OSMRestriction& b) { return a < b; });
+        [](const OSMRestriction& a, const OSMRestriction& b) { return a < b; },
+        sequence<OSMRestriction>::default_sort_buffer_size, concurrency);
   }
 
   // Sort complex restrictions. Keep this scoped so the file handles are closed when done sorting.
@@ -5291,7 +5437,8 @@ void PBFGraphParser::ParseRelations(const boost::property_tree::ptree& pt,
   {
     sequence<OSMRestriction> complex_restrictions_to(complex_restriction_to_file, false);
     complex_restrictions_to.sort(
-        [](const OSMRestriction& a, const OSMRestriction& b) { return a < b; });
+        [](const OSMRestriction& a, const OSMRestriction& b) { return a < b; },
+        sequence<OSMRestriction>::default_sort_buffer_size, concurrency);
   }
   LOG_INFO("Finished");
 }
@@ -5302,13 +5449,6 @@ void PBFGraphParser::ParseNodes(const boost::property_tree::ptree& pt,
                                 const std::string& bss_nodes_file,
                                 const std::string& linguistic_node_file,
                                 OSMData& osmdata) {
-  // TODO: option 1: each one threads makes an osmdata and we splice them together at the end
-  // option 2: synchronize around adding things to a single osmdata. will have to test to see
-  // which is the least expensive (memory and speed). leaning towards option 2
-  //  unsigned int threads =
-  //      std::max(static_cast<unsigned int>(1),
-  //               pt.get<unsigned int>("concurrency", std::thread::hardware_concurrency()));
-
   // Create OSM data. Set the member pointer so that the parsing callback methods can use it.
   SCOPED_TIMER();
   graph_parser parser(pt, osmdata);
@@ -5317,11 +5457,20 @@ void PBFGraphParser::ParseNodes(const boost::property_tree::ptree& pt,
   if (!osmdata.initialized)
     parser.osmdata_.read_from_temp_files(pt.get<std::string>("tile_dir"));
 
+  // the way node references are sorted on as many threads, the Lua transform runs on more threads
+  // than this, see `parse_in_order()`
+  const size_t concurrency =
+      std::max(static_cast<size_t>(1),
+               pt.get<size_t>("concurrency", std::thread::hardware_concurrency()));
+  const auto lua_script = graph_parser::get_lua(pt);
+
   LOG_INFO("Parsing files for nodes: " + boost::algorithm::join(input_files, ", "));
 
   if (pt.get<bool>("import_bike_share_stations", false)) {
     LOG_INFO("Parsing bss nodes...");
 
+    size_t nodes = 0, bytes = file_sizes(input_files);
+    SCOPED_THROUGHPUT_TIMER("bss nodes", nodes, bytes);
     bool create = true;
     for (auto& file : input_files) {
       parser.current_way_node_index_ = parser.last_node_ = parser.last_way_ = parser.last_relation_ =
@@ -5331,13 +5480,10 @@ void PBFGraphParser::ParseNodes(const boost::property_tree::ptree& pt,
                    new sequence<OSMBSSNode>(bss_nodes_file, create), nullptr);
       create = false;
 
-      osmium::io::Reader reader(file, osmium::osm_entity_bits::node);
-      while (const osmium::memory::Buffer buffer = reader.read()) {
-        for (const osmium::memory::Item& item : buffer) {
-          parser.bss_node(static_cast<const osmium::Node&>(item));
-        }
-      }
-      reader.close(); // Explicit close to get an exception in case of an error.
+      nodes += parse_in_order<osmium::Node, graph_parser::BSSNode>(
+          file, lua_script, concurrency, parser.last_node_, [](const osmium::Node&) { return true; },
+          graph_parser::transform_bss_node,
+          [&parser](const graph_parser::BSSNode& node) { parser.bss_node(node); });
     }
     // Since the sequence must be flushed before reading it...
     parser.reset(nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
@@ -5352,28 +5498,37 @@ void PBFGraphParser::ParseNodes(const boost::property_tree::ptree& pt,
   LOG_INFO("Sorting osm way node references by node id...");
   {
     sequence<OSMWayNode> way_nodes(way_nodes_file, false);
-    way_nodes.sort(
-        [](const OSMWayNode& a, const OSMWayNode& b) { return a.node.osmid_ < b.node.osmid_; });
+    way_nodes.sort_by_key([](const OSMWayNode& a) { return a.node.osmid_; },
+                          sequence<OSMWayNode>::default_sort_buffer_size, concurrency);
   }
 
   // Parse node in all the input files. Skip any that are not marked from
   // being used in a way.
   // TODO: we know how many knows we expect, stop early once we have that many
   LOG_INFO("Parsing nodes...");
-  for (auto& file : input_files) {
-    // each time we parse nodes we have to run through the way nodes file from the beginning because
-    // because osm node ids are only sorted at the single pbf file level
-    parser.reset(nullptr, new sequence<OSMWayNode>(way_nodes_file, false), nullptr, nullptr, nullptr,
-                 nullptr, new sequence<OSMNodeLinguistic>(linguistic_node_file, true));
-    parser.current_way_node_index_ = parser.last_node_ = parser.last_way_ = parser.last_relation_ = 0;
-
-    osmium::io::Reader reader(file, osmium::osm_entity_bits::node);
-    while (const osmium::memory::Buffer buffer = reader.read()) {
-      for (const osmium::memory::Item& item : buffer) {
-        parser.node(static_cast<const osmium::Node&>(item));
-      }
+  {
+    size_t nodes = 0, bytes = file_sizes(input_files);
+    SCOPED_THROUGHPUT_TIMER("nodes", nodes, bytes);
+    for (auto& file : input_files) {
+      // each time we parse nodes we have to run through the way nodes file from the beginning
+      // because osm node ids are only sorted at the single pbf file level
+      parser.reset(nullptr, new sequence<OSMWayNode>(way_nodes_file, false), nullptr, nullptr,
+                   nullptr, nullptr, new sequence<OSMNodeLinguistic>(linguistic_node_file, true));
+      parser.current_way_node_index_ = parser.last_node_ = parser.last_way_ = parser.last_relation_ =
+          0;
+
+      // only the nodes the ways use are transformed, the selection runs ahead of the updates so it
+      // keeps its own place in the way node references
+      size_t selected_way_node_index = 0;
+      nodes += parse_in_order<osmium::Node, graph_parser::Node>(
+          file, lua_script, concurrency, parser.last_node_,
+          [&parser, &selected_way_node_index](const osmium::Node& node) {
+            parser.changeset(node.changeset());
+            return parser.find_way_node(node.id(), selected_way_node_index);
+          },
+          graph_parser::transform_node,
+          [&parser](const graph_parser::Node& node) { parser.node(node); });
     }
-    reader.close(); // Explicit close to get an exception in case of an error.
   }
   uint64_t max_osm_id = parser.last_node_;
   parser.reset(nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
@@ -5385,13 +5540,12 @@ void PBFGraphParser::ParseNodes(const boost::property_tree::ptree& pt,
   LOG_INFO("Sorting osm way node references by way index and node shape index...");
   {
     sequence<OSMWayNode> way_nodes(way_nodes_file, false);
-    way_nodes.sort([](const OSMWayNode& a, const OSMWayNode& b) {
-      if (a.way_index == b.way_index) {
-        // TODO: if its equal we have screwed something up, should we check and throw here?
-        return a.way_shape_node_index < b.way_shape_node_index;
-      }
-      return a.way_index < b.way_index;
-    });
+    // TODO: if both are equal we have screwed something up, should we check and throw here?
+    way_nodes.sort_by_key(
+        [](const OSMWayNode& a) {
+          return static_cast<uint64_t>(a.way_index) << 32 | a.way_shape_node_index;
+        },
+        sequence<OSMWayNode>::default_sort_buffer_size, concurrency);
   }
 
   // Some OSM extracts do not have changeset Ids. For these set the max changeset Id
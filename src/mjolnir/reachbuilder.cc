@@ -0,0 +1,134 @@
+#include "mjolnir/reachbuilder.h"
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/rapidjson_utils.h"
+#include "baldr/storedreach.h"
+#include "midgard/logging.h"
+#include "mjolnir/graphtilebuilder.h"
+#include "proto_conversions.h"
+#include "scoped_timer.h"
+#include "sif/costfactory.h"
+#include "thor/reach.h"
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace valhalla::baldr;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+// reach loki asks for by default is 50, leave some room for requests asking for more
+constexpr uint32_t kDefaultMaxReach = 100;
+
+void add_reach(const boost::property_tree::ptree& pt,
+               const std::vector<GraphId>& tile_ids,
+               std::atomic<size_t>& next_tile,
+               const std::vector<valhalla::Costing::Type>& costing_types,
+               const uint32_t max_reach) {
+  GraphReader reader(pt.get_child("mjolnir"));
+  valhalla::thor::Reach reach_finder;
+
+  // the reach is expanded with the default options the way loki would for a request without any
+  valhalla::sif::CostFactory factory;
+  std::vector<valhalla::sif::cost_ptr_t> costings;
+  StoredReachHeader reach_header{};
+  reach_header.max_reach = static_cast<uint8_t>(max_reach);
+  for (const auto type : costing_types) {
+    rapidjson::Document doc;
+    doc.SetObject();
+    valhalla::Costing costing;
+    valhalla::sif::ParseCosting(doc, "/costing_options/" + valhalla::Costing_Enum_Name(type),
+                                &costing, type);
+    costings.push_back(factory.Create(costing));
+    reach_header.costings[reach_header.costing_count++] = static_cast<uint8_t>(type);
+  }
+
+  std::vector<StoredReach> reaches;
+  for (size_t i = next_tile++; i < tile_ids.size(); i = next_tile++) {
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+    auto tile = reader.GetGraphTile(tile_ids[i]);
+    if (!tile) {
+      continue;
+    }
+
+    const uint32_t edge_count = tile->header()->directededgecount();
+    reaches.assign(costings.size() * edge_count, StoredReach{});
+    try {
+      for (size_t c = 0; c < costings.size(); ++c) {
+        GraphId edge_id = tile_ids[i];
+        for (uint32_t e = 0; e < edge_count; ++e, ++edge_id) {
+          const auto reach = reach_finder(tile->directededge(e), edge_id, max_reach, reader,
+                                          costings[c]);
+          reaches[c * edge_count + e] = {static_cast<uint8_t>(reach.outbound),
+                                         static_cast<uint8_t>(reach.inbound)};
+        }
+      }
+      GraphTileBuilder::AddReach(pt.get<std::string>("mjolnir.tile_dir"), tile, reach_header,
+                                 reaches);
+    } catch (const std::exception& e) {
+      LOG_ERROR("Failed to store the reach of tile " + std::to_string(tile_ids[i]) + ": " +
+                e.what());
+    }
+  }
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+void ReachBuilder::Build(const boost::property_tree::ptree& pt) {
+  std::vector<Costing::Type> costing_types;
+  for (const auto& kv : pt.get_child("mjolnir.reach.costings", {})) {
+    const auto name = kv.second.get_value<std::string>();
+    Costing::Type type;
+    if (!Costing_Enum_Parse(name, &type)) {
+      throw std::runtime_error("Unknown costing to store the reach for: " + name);
+    }
+    costing_types.push_back(type);
+  }
+  if (costing_types.empty()) {
+    LOG_INFO("Skipping reach builder");
+    return;
+  }
+  if (costing_types.size() > kMaxStoredReachCostings) {
+    throw std::runtime_error("The reach can be stored for at most " +
+                             std::to_string(kMaxStoredReachCostings) + " costings");
+  }
+  const auto max_reach =
+      std::min(pt.get<uint32_t>("mjolnir.reach.max_reach", kDefaultMaxReach), kMaxStoredReach);
+
+  SCOPED_TIMER();
+  std::vector<GraphId> tile_ids;
+  {
+    GraphReader reader(pt.get_child("mjolnir"));
+    const auto tile_set = reader.GetTileSet();
+    tile_ids.assign(tile_set.begin(), tile_set.end());
+  }
+
+  // tiles are handed out one at a time, some take much longer than others
+  const auto nthreads =
+      std::max(static_cast<uint32_t>(1),
+               pt.get<uint32_t>("mjolnir.concurrency", std::thread::hardware_concurrency()));
+  LOG_INFO("Storing the reach of " + std::to_string(tile_ids.size()) + " tiles with " +
+           std::to_string(nthreads) + " threads...");
+  std::atomic<size_t> next_tile(0);
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < nthreads; ++i) {
+    threads.emplace_back(add_reach, std::cref(pt), std::cref(tile_ids), std::ref(next_tile),
+                         std::cref(costing_types), max_reach);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  LOG_INFO("Finished");
+}
+
+} // namespace mjolnir
+} // namespace valhalla
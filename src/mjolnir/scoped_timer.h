@@ -4,6 +4,7 @@
 #include <midgard/logging.h>
 #include <midgard/util.h>
 
+#include <algorithm>
 #include <chrono>
 #include <string>
 
@@ -28,5 +29,32 @@ namespace mjolnir {
                                         " [TIMING] ");                                               \
       })
 
+// Like SCOPED_TIMER but for one stage of a function, it also reports how many elements and bytes
+// the stage went through per second. Both are read when the scope ends so they can be counted up
+// along the way, they have to be declared before the timer.
+#define SCOPED_THROUGHPUT_TIMER(stage, elements, bytes)                                              \
+  auto _throughput_timer_start = std::chrono::high_resolution_clock::now();                          \
+  auto _throughput_timer_finally = valhalla::midgard::make_finally(                                  \
+      [_throughput_timer_start, func_name = __func__, stage_name = std::string(stage), &elements,    \
+       &bytes]() {                                                                                   \
+        auto _throughput_timer_end = std::chrono::high_resolution_clock::now();                      \
+        auto _throughput_timer_duration =                                                            \
+            std::chrono::duration<double>(_throughput_timer_end - _throughput_timer_start).count();  \
+        double _throughput_timer_seconds = std::max(_throughput_timer_duration, 1e-3);               \
+        std::string file_path = __FILE__;                                                            \
+        std::string valhalla_dir_str = VALHALLA_STRINGIZE(VALHALLA_SOURCE_DIR);                      \
+        size_t len = valhalla_dir_str.length();                                                      \
+        std::string relative_file_path = file_path.substr(len + 1);                                  \
+        valhalla::midgard::logging::Log(                                                             \
+            std::string(relative_file_path) + "::" + std::string(func_name) + " " + stage_name +     \
+                " took " + std::to_string(static_cast<uint64_t>(_throughput_timer_duration)) +       \
+                "s, " +                                                                              \
+                std::to_string(static_cast<uint64_t>(elements / _throughput_timer_seconds)) +        \
+                " elements/s, " +                                                                    \
+                std::to_string(static_cast<uint64_t>(bytes / _throughput_timer_seconds)) +           \
+                " bytes/s",                                                                          \
+            " [TIMING] ");                                                                           \
+      })
+
 } // namespace mjolnir
 } // namespace valhalla
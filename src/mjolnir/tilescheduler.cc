@@ -0,0 +1,176 @@
+#include "mjolnir/tilescheduler.h"
+#include "baldr/graphtile.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+using namespace valhalla::baldr;
+
+namespace {
+
+std::string seconds(const double duration) {
+  std::ostringstream stream;
+  stream << std::fixed << std::setprecision(1) << duration << "s";
+  return stream.str();
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+bool TileScheduler::Worker::next(GraphId& tile_id) {
+  if (working_) {
+    busy_ += std::chrono::steady_clock::now() - started_;
+    working_ = false;
+  }
+  if (!scheduler_.take(index_, tile_id)) {
+    return false;
+  }
+  ++tiles_;
+  started_ = std::chrono::steady_clock::now();
+  working_ = true;
+  return true;
+}
+
+TileScheduler::TileScheduler(const std::string& stage, const size_t concurrency)
+    : stage_(stage), concurrency_(std::max(concurrency, static_cast<size_t>(1))) {
+}
+
+void TileScheduler::add(const GraphId& tile_id, const uint64_t weight) {
+  tasks_.emplace_back(weight, tile_id);
+}
+
+bool TileScheduler::take(const size_t index, GraphId& tile_id) {
+  // the heaviest tile left in our own queue
+  {
+    auto& own = *queues_[index];
+    std::lock_guard<std::mutex> lock(own.lock);
+    if (!own.tiles.empty()) {
+      tile_id = own.tiles.front();
+      own.tiles.pop_front();
+      --own.size;
+      return true;
+    }
+  }
+
+  // otherwise the lightest tile of the fullest queue, its owner takes from the other end
+  while (true) {
+    Queue* victim = nullptr;
+    size_t most = 0;
+    for (const auto& queue : queues_) {
+      const size_t size = queue->size;
+      if (size > most) {
+        most = size;
+        victim = queue.get();
+      }
+    }
+    if (!victim) {
+      break;
+    }
+    std::lock_guard<std::mutex> lock(victim->lock);
+    if (!victim->tiles.empty()) {
+      tile_id = victim->tiles.back();
+      victim->tiles.pop_back();
+      --victim->size;
+      ++stolen_;
+      return true;
+    }
+  }
+
+  // no tiles are added while running so from here on the stage only finishes what it started
+  if (!drained_.exchange(true)) {
+    drained_at_ = std::chrono::steady_clock::now();
+  }
+  return false;
+}
+
+void TileScheduler::run(const std::function<void(Worker&)>& work) {
+  // deal the tiles out heaviest first so that every thread starts on its share of the heavy ones
+  std::stable_sort(tasks_.begin(), tasks_.end(),
+                   [](const auto& a, const auto& b) { return a.first > b.first; });
+  queues_.clear();
+  for (size_t i = 0; i < concurrency_; ++i) {
+    queues_.emplace_back(new Queue);
+  }
+  for (size_t i = 0; i < tasks_.size(); ++i) {
+    queues_[i % concurrency_]->tiles.push_back(tasks_[i].second);
+  }
+  for (auto& queue : queues_) {
+    queue->size = queue->tiles.size();
+  }
+  stolen_ = 0;
+  drained_ = false;
+
+  std::vector<Worker> workers;
+  workers.reserve(concurrency_);
+  for (size_t i = 0; i < concurrency_; ++i) {
+    workers.push_back(Worker(*this, i));
+  }
+
+  // run the work on each thread and keep what it throws for when they are all done
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::exception_ptr> errors(concurrency_);
+  std::vector<std::thread> threads;
+  threads.reserve(concurrency_);
+  for (size_t i = 0; i < concurrency_; ++i) {
+    threads.emplace_back([&work, &workers, &errors, i]() {
+      auto& worker = workers[i];
+      try {
+        work(worker);
+      } catch (...) { errors[i] = std::current_exception(); }
+      if (worker.working_) {
+        worker.busy_ += std::chrono::steady_clock::now() - worker.started_;
+        worker.working_ = false;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  // how much of the time the threads spent on tiles and how long the tail of the stage was
+  const std::chrono::duration<double> elapsed = end - start;
+  std::chrono::duration<double> busy{0};
+  size_t most_tiles = 0;
+  for (const auto& worker : workers) {
+    busy += worker.busy_;
+    most_tiles = std::max(most_tiles, worker.tiles_);
+  }
+  const double utilization =
+      elapsed.count() > 0 ? 100.0 * busy.count() / (elapsed.count() * concurrency_) : 100.0;
+  const std::chrono::duration<double> tail =
+      drained_ ? end - drained_at_ : std::chrono::steady_clock::duration{0};
+  midgard::logging::Log(stage_ + " ran " + std::to_string(tasks_.size()) + " tiles on " +
+                            std::to_string(concurrency_) + " threads in " +
+                            seconds(elapsed.count()) + ", " +
+                            std::to_string(static_cast<int>(utilization)) +
+                            "% utilization, " + seconds(tail.count()) +
+                            " tail after the last tile started, " + std::to_string(stolen_) +
+                            " tiles stolen, at most " + std::to_string(most_tiles) +
+                            " tiles on one thread",
+                        " [TIMING] ");
+
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+uint64_t TileScheduler::tile_size(const std::string& tile_dir, const GraphId& tile_id) {
+  std::filesystem::path tile_path{tile_dir};
+  tile_path.append(GraphTile::FileSuffix(tile_id));
+  std::error_code ec;
+  const auto size = std::filesystem::file_size(tile_path, ec);
+  return ec ? 0 : size;
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -3,13 +3,17 @@
 #include "baldr/tilehierarchy.h"
 #include "midgard/logging.h"
 #include "mjolnir/bssbuilder.h"
+#include "mjolnir/candidateindexbuilder.h"
 #include "mjolnir/elevationbuilder.h"
 #include "mjolnir/graphbuilder.h"
 #include "mjolnir/graphenhancer.h"
 #include "mjolnir/graphfilter.h"
 #include "mjolnir/graphvalidator.h"
 #include "mjolnir/hierarchybuilder.h"
+#include "mjolnir/incrementalbuilder.h"
+#include "mjolnir/overlaybuilder.h"
 #include "mjolnir/pbfgraphparser.h"
+#include "mjolnir/reachbuilder.h"
 #include "mjolnir/restrictionbuilder.h"
 #include "mjolnir/shortcutbuilder.h"
 #include "mjolnir/transitbuilder.h"
@@ -194,7 +198,8 @@ uint32_t GetOpposingEdgeIndex(const graph_tile_ptr& endnodetile,
 bool build_tile_set(const boost::property_tree::ptree& original_config,
                     const std::vector<std::string>& input_files,
                     const BuildStage start_stage,
-                    const BuildStage end_stage) {
+                    const BuildStage end_stage,
+                    const std::vector<std::string>& change_files) {
   SCOPED_TIMER();
   auto remove_temp_file = [](const std::string& fname) {
     if (std::filesystem::exists(fname)) {
@@ -202,6 +207,12 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
     }
   };
 
+  // whether a stage is part of this run, in pipeline order rather than by enum value
+  auto runs = [&](const BuildStage stage) {
+    return stage_position(start_stage) <= stage_position(stage) &&
+           stage_position(stage) <= stage_position(end_stage);
+  };
+
   if (input_files.size() > 1) {
     LOG_WARN(
         "Tile building using more than one osm.pbf extract is discouraged. Consider merging the extracts into one file. See this issue for more info: https://github.com/valhalla/valhalla/issues/3925 ");
@@ -243,6 +254,13 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
     std::filesystem::create_directories(tile_dir);
   }
 
+  // Whether to keep what the next build needs to only rebuild the tiles its changes touch
+  const bool incremental = !config.get<std::string>("mjolnir.incremental_dir", "").empty();
+  if (!change_files.empty() && !incremental) {
+    LOG_ERROR("Building from change files requires mjolnir.incremental_dir");
+    return false;
+  }
+
   // Set up the temporary (*.bin) files used during processing
   std::string ways_bin = tile_dir + ways_file;
   std::string way_nodes_bin = tile_dir + way_nodes_file;
@@ -261,7 +279,7 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
   OSMData osm_data{0};
 
   // Parse the ways
-  if (start_stage <= BuildStage::kParseWays && BuildStage::kParseWays <= end_stage) {
+  if (runs(BuildStage::kParseWays)) {
     // Read the OSM protocol buffer file. Callbacks for ways are defined within the PBFParser class
     osm_data = PBFGraphParser::ParseWays(config.get_child("mjolnir"), input_files, ways_bin,
                                          way_nodes_bin, access_bin);
@@ -273,7 +291,7 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
   }
 
   // Parse OSM data
-  if (start_stage <= BuildStage::kParseRelations && BuildStage::kParseRelations <= end_stage) {
+  if (runs(BuildStage::kParseRelations)) {
 
     // Read the OSM protocol buffer file. Callbacks for relations are defined within the PBFParser
     // class
@@ -287,21 +305,24 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
   }
 
   // Parse OSM data
-  if (start_stage <= BuildStage::kParseNodes && BuildStage::kParseNodes <= end_stage) {
+  if (runs(BuildStage::kParseNodes)) {
     // Read the OSM protocol buffer file. Callbacks for nodes
     // are defined within the PBFParser class
     PBFGraphParser::ParseNodes(config.get_child("mjolnir"), input_files, way_nodes_bin, bss_nodes_bin,
                                linguistic_node_bin, osm_data);
 
-    // Write the OSMData to files if the end stage is less than enhancing
-    if (end_stage <= BuildStage::kEnhance) {
-      osm_data.write_to_temp_files(tile_dir);
+    // Write the OSMData to files. If the graph is built next the files are mapped back so that
+    // the multimaps and names of the parsers no longer take up the heap while building
+    osm_data.write_to_temp_files(tile_dir);
+    if (BuildStage::kBuild <= end_stage) {
+      osm_data = OSMData{0};
+      osm_data.read_from_temp_files(tile_dir);
     }
   }
 
   // Construct edges
   std::map<baldr::GraphId, size_t> tiles;
-  if (start_stage <= BuildStage::kConstructEdges && BuildStage::kConstructEdges <= end_stage) {
+  if (runs(BuildStage::kConstructEdges)) {
 
     // Read OSMData from files if construct edges is the first stage
     if (start_stage == BuildStage::kConstructEdges)
@@ -314,7 +335,7 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
   }
 
   // Build Valhalla routing tiles
-  if (start_stage <= BuildStage::kBuild && BuildStage::kBuild <= end_stage) {
+  if (runs(BuildStage::kBuild)) {
     if (start_stage == BuildStage::kBuild) {
       // Read OSMData from files if building tiles is the first stage
       osm_data.read_from_temp_files(tile_dir);
@@ -328,15 +349,27 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
       }
     }
 
+    // Only build the tiles the changes touched, the others are copied from the last build
+    auto build_tiles = tiles;
+    if (!change_files.empty()) {
+      build_tiles = IncrementalBuilder::Restore(config, change_files, ways_bin, way_nodes_bin, tiles,
+                                                osm_data.max_changeset_id_);
+    }
+
     // Build the graph using the OSMNodes and OSMWays from the parser
     GraphBuilder::Build(config, osm_data, ways_bin, way_nodes_bin, nodes_bin, edges_bin, cr_from_bin,
-                        cr_to_bin, linguistic_node_bin, tiles);
+                        cr_to_bin, linguistic_node_bin, build_tiles);
+
+    // Keep the local tiles as they are now so that the next build can start from them
+    if (incremental) {
+      IncrementalBuilder::Save(config, build_tiles, tiles);
+    }
   }
 
   // Enhance the local level of the graph. This adds information to the local
   // level that is usable across all levels (density, administrative
   // information (and country based attribution), edge transition logic, etc.
-  if (start_stage <= BuildStage::kEnhance && BuildStage::kEnhance <= end_stage) {
+  if (runs(BuildStage::kEnhance)) {
     // Read OSMData names from file if enhancing tiles is the first stage
     if (start_stage == BuildStage::kEnhance) {
       osm_data.read_from_unique_names_file(tile_dir);
@@ -345,17 +378,17 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
   }
 
   // Perform optional edge filtering (remove edges and nodes for specific access modes)
-  if (start_stage <= BuildStage::kFilter && BuildStage::kFilter <= end_stage) {
+  if (runs(BuildStage::kFilter)) {
     GraphFilter::Filter(config);
   }
 
   // Add transit
-  if (start_stage <= BuildStage::kTransit && BuildStage::kTransit <= end_stage) {
+  if (runs(BuildStage::kTransit)) {
     TransitBuilder::Build(config);
   }
 
   // Build bike share stations
-  if (start_stage <= BuildStage::kBss && BuildStage::kBss <= end_stage) {
+  if (runs(BuildStage::kBss)) {
     if (start_stage == BuildStage::kBss) {
       osm_data.read_from_unique_names_file(tile_dir);
     }
@@ -366,7 +399,7 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
   // (directed edges) are formed between nodes at adjacent levels.
   auto build_hierarchy = config.get<bool>("mjolnir.hierarchy", true);
   if (build_hierarchy) {
-    if (start_stage <= BuildStage::kHierarchy && BuildStage::kHierarchy <= end_stage) {
+    if (runs(BuildStage::kHierarchy)) {
       HierarchyBuilder::Build(config, new_to_old_bin, old_to_new_bin);
     }
 
@@ -374,7 +407,7 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
     // applied if hierarchies are also generated.
     auto build_shortcuts = config.get<bool>("mjolnir.shortcuts", true);
     if (build_shortcuts) {
-      if (start_stage <= BuildStage::kShortcuts && BuildStage::kShortcuts <= end_stage) {
+      if (runs(BuildStage::kShortcuts)) {
         ShortcutBuilder::Build(config);
       }
     } else {
@@ -385,7 +418,7 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
   }
 
   // Add elevation to the tiles
-  if (start_stage <= BuildStage::kElevation && BuildStage::kElevation <= end_stage) {
+  if (runs(BuildStage::kElevation)) {
     ElevationBuilder::Build(config);
   }
 
@@ -393,18 +426,40 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
   // ComplexRestrictions must be done after elevation. The reason is that building
   // elevation into the tiles reads each tile and serializes the data to "builders"
   // within the tile. However, there is no serialization currently available for complex restrictions.
-  if (start_stage <= BuildStage::kRestrictions && BuildStage::kRestrictions <= end_stage) {
+  if (runs(BuildStage::kRestrictions)) {
     RestrictionBuilder::Build(config, cr_from_bin, cr_to_bin);
   }
 
   // Validate the graph and add information that cannot be added until full graph is formed.
-  if (start_stage <= BuildStage::kValidate && BuildStage::kValidate <= end_stage) {
+  if (runs(BuildStage::kValidate)) {
     GraphValidator::Validate(config);
   }
 
+  // Build the route planning overlay on top of the highway level if an output file is configured
+  if (runs(BuildStage::kOverlay)) {
+    if (build_hierarchy && config.get_optional<std::string>("mjolnir.overlay")) {
+      OverlayBuilder::Build(config);
+    } else {
+      LOG_INFO("Skipping overlay builder");
+    }
+  }
+
+  // Store the reach of every edge for the configured costings so loki can look it up
+  if (runs(BuildStage::kReach)) {
+    ReachBuilder::Build(config);
+  }
+
+  // Index the edges of the local tiles so map matching does not have to index them on the fly
+  if (runs(BuildStage::kCandidateIndex)) {
+    CandidateIndexBuilder::Build(config);
+  }
+
   // Cleanup bin files
-  if (start_stage <= BuildStage::kCleanup && BuildStage::kCleanup <= end_stage) {
+  if (runs(BuildStage::kCleanup)) {
     LOG_INFO("Cleaning up temporary *.bin files within " + tile_dir);
+    if (incremental) {
+      IncrementalBuilder::SaveWays(config, ways_bin, way_nodes_bin);
+    }
     remove_temp_file(ways_bin);
     remove_temp_file(way_nodes_bin);
     remove_temp_file(nodes_bin);
@@ -417,6 +472,8 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
     remove_temp_file(new_to_old_bin);
     remove_temp_file(old_to_new_bin);
     remove_temp_file(tile_manifest);
+    // drop what is mapped from the files before removing them
+    osm_data = OSMData{0};
     OSMData::cleanup_temp_files(tile_dir);
   }
   return true;
@@ -0,0 +1,140 @@
+#include "argparse_utils.h"
+#include "midgard/logging.h"
+#include "midgard/sequence.h"
+#include "mjolnir/osmdata.h"
+
+#include <boost/property_tree/ptree.hpp>
+#include <cxxopts.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+
+using namespace valhalla::midgard;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+/**
+ * Writes way node references which look like the ones of an extract: ways are written one after
+ * another, each with a handful of shape nodes whose ids are spread over the whole id range
+ */
+void write_way_nodes(const std::string& file_name, size_t count) {
+  std::mt19937_64 generator(17);
+  std::uniform_int_distribution<uint64_t> osmids(1, 10000000000ull);
+  std::uniform_int_distribution<uint32_t> way_lengths(2, 30);
+  sequence<OSMWayNode> way_nodes(file_name, true);
+  uint32_t way_index = 0, shape_index = 0, way_length = way_lengths(generator);
+  for (size_t i = 0; i < count; ++i) {
+    OSMWayNode way_node;
+    way_node.node.osmid_ = osmids(generator);
+    way_node.way_index = way_index;
+    way_node.way_shape_node_index = shape_index;
+    way_nodes.push_back(way_node);
+    if (++shape_index == way_length) {
+      ++way_index;
+      shape_index = 0;
+      way_length = way_lengths(generator);
+    }
+  }
+}
+
+bool benchmark(const std::string& name,
+               const std::string& file_name,
+               size_t count,
+               const std::function<void(sequence<OSMWayNode>&)>& sort) {
+  write_way_nodes(file_name, count);
+  auto start = std::chrono::steady_clock::now();
+  {
+    sequence<OSMWayNode> way_nodes(file_name, false);
+    sort(way_nodes);
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  LOG_INFO(name + ": " + std::to_string(count) + " way nodes in " + std::to_string(elapsed) +
+           " ms, " + std::to_string(count / std::max<int64_t>(elapsed, 1)) + " per ms");
+
+  // make sure the sort actually sorted
+  sequence<OSMWayNode> way_nodes(file_name, false);
+  uint64_t previous = 0;
+  for (size_t i = 0; i < way_nodes.size(); ++i) {
+    const OSMWayNode way_node = *way_nodes[i];
+    if (way_node.node.osmid_ < previous) {
+      LOG_ERROR(name + " did not sort the way nodes");
+      return false;
+    }
+    previous = way_node.node.osmid_;
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  const auto program = std::filesystem::path(__FILE__).stem().string();
+  // args
+  std::string file_name;
+  size_t count, buffer_size;
+  uint32_t concurrency;
+
+  try {
+    // clang-format off
+    cxxopts::Options options(
+      program,
+      program + " " + VALHALLA_PRINT_VERSION + "\n\n"
+      "a program which writes a sequence of synthetic way node references like the ones the\n"
+      "graph parser writes and times sorting them by node id with a comparator on one thread,\n"
+      "with a comparator on all threads and with the radix sort by key on all threads.\n\n");
+
+    options.add_options()
+      ("h,help", "Print this help message.")
+      ("v,version", "Print the version of this software.")
+      ("f,file", "Where to write the sequence", cxxopts::value<std::string>(file_name)->default_value("way_nodes_benchmark.bin"))
+      ("n,count", "How many way nodes to write", cxxopts::value<size_t>(count)->default_value("50000000"))
+      ("b,buffer", "How many way nodes to sort in memory at once", cxxopts::value<size_t>(buffer_size)->default_value(std::to_string(sequence<OSMWayNode>::default_sort_buffer_size)))
+      ("j,concurrency", "Number of threads to use. Defaults to all threads.", cxxopts::value<uint32_t>());
+    // clang-format on
+
+    auto result = options.parse(argc, argv);
+    if (!parse_common_args(program, options, result, nullptr, "", true))
+      return EXIT_SUCCESS;
+
+    concurrency = std::max(1U, result.count("concurrency") ? result["concurrency"].as<uint32_t>()
+                                                           : std::thread::hardware_concurrency());
+  } catch (cxxopts::exceptions::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto threads = std::to_string(concurrency);
+  auto by_osmid = [](const OSMWayNode& a, const OSMWayNode& b) {
+    return a.node.osmid_ < b.node.osmid_;
+  };
+  auto osmid = [](const OSMWayNode& a) { return a.node.osmid_; };
+  bool sorted = benchmark("Comparator on 1 thread", file_name, count,
+                          [&](sequence<OSMWayNode>& s) { s.sort(by_osmid, buffer_size); });
+  sorted = sorted && benchmark("Comparator on " + threads + " threads", file_name, count,
+                               [&](sequence<OSMWayNode>& s) {
+                                 s.sort(by_osmid, buffer_size, concurrency);
+                               });
+  sorted = sorted && benchmark("Key on " + threads + " threads", file_name, count,
+                               [&](sequence<OSMWayNode>& s) {
+                                 s.sort_by_key(osmid, buffer_size, concurrency);
+                               });
+  std::filesystem::remove(file_name);
+  if (!sorted) {
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("Done Benchmark!");
+
+  return EXIT_SUCCESS;
+}
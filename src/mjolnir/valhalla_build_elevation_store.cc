@@ -0,0 +1,64 @@
+#include "argparse_utils.h"
+#include "skadi/sample.h"
+
+#include <boost/property_tree/ptree.hpp>
+#include <cxxopts.hpp>
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+
+int main(int argc, char** argv) {
+  const auto program = std::filesystem::path(__FILE__).stem().string();
+  // args
+  boost::property_tree::ptree config;
+  std::string elevation, store;
+
+  try {
+    // clang-format off
+    cxxopts::Options options(
+      program,
+      program + " " + VALHALLA_PRINT_VERSION + "\n\n"
+      "valhalla_build_elevation_store is a program that unpacks all of the (compressed) elevation \n"
+      "tiles of an elevation directory into a single indexed file. The file is memory mapped and \n"
+      "sampled from without decompressing or locking when it is configured as the elevation_store."
+      "\n\n");
+
+    options.add_options()
+      ("h,help", "Print this help message.")
+      ("v,version", "Print the version of this software.")
+      ("c,config", "Path to the json configuration file.", cxxopts::value<std::string>())
+      ("i,inline-config", "Inline JSON config", cxxopts::value<std::string>())
+      ("e,elevation", "Elevation directory to read the tiles from. Defaults to additional_data.elevation.", cxxopts::value<std::string>(elevation))
+      ("o,output", "Elevation store to write. Defaults to additional_data.elevation_store.", cxxopts::value<std::string>(store));
+    // clang-format on
+
+    auto result = options.parse(argc, argv);
+    if (!parse_common_args(program, options, result, &config, "mjolnir.logging"))
+      return EXIT_SUCCESS;
+
+    if (!result.count("elevation")) {
+      elevation = config.get<std::string>("additional_data.elevation", "");
+    }
+    if (!result.count("output")) {
+      store = config.get<std::string>("additional_data.elevation_store", "");
+    }
+    if (elevation.empty() || store.empty()) {
+      throw cxxopts::exceptions::exception(
+          "Both an elevation directory and an elevation store are required\n\n" + options.help());
+    }
+  } catch (cxxopts::exceptions::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  if (!valhalla::skadi::build_elevation_store(elevation, store)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -1,5 +1,6 @@
 #include "argparse_utils.h"
 #include "midgard/logging.h"
+#include "mjolnir/incrementalbuilder.h"
 #include "mjolnir/util.h"
 
 #include <boost/property_tree/ptree.hpp>
@@ -15,16 +16,16 @@ using namespace valhalla::mjolnir;
 // List the build stages
 void list_stages() {
   std::cout << "Build stage strings (in order)" << std::endl;
-  for (int i = static_cast<int>(BuildStage::kInitialize); i <= static_cast<int>(BuildStage::kCleanup);
-       ++i) {
-    std::cout << "    " << to_string(static_cast<BuildStage>(i)) << std::endl;
+  for (const auto stage : kBuildStages) {
+    std::cout << "    " << to_string(stage) << std::endl;
   }
 }
 
 int main(int argc, char** argv) {
   const auto program = std::filesystem::path(__FILE__).stem().string();
   // args
-  std::vector<std::string> input_files;
+  std::vector<std::string> input_files, change_files;
+  std::string compare_dir;
   BuildStage start_stage = BuildStage::kInitialize;
   BuildStage end_stage = BuildStage::kCleanup;
   boost::property_tree::ptree config;
@@ -47,6 +48,8 @@ int main(int argc, char** argv) {
       ("i,inline-config", "Inline JSON config", cxxopts::value<std::string>())
       ("s,start", "Starting stage of the build pipeline", cxxopts::value<std::string>()->default_value("initialize"))
       ("e,end", "End stage of the build pipeline", cxxopts::value<std::string>()->default_value("cleanup"))
+      ("changes", "OSM change files (.osc) from the extract of the build kept in mjolnir.incremental_dir to the input file(s). Only the local tiles they touch are built in the build stage", cxxopts::value<std::vector<std::string>>(change_files))
+      ("compare", "Compares the tiles of the tile_dir to the tiles of this directory, e.g. of a full build of the changed extract, and exits", cxxopts::value<std::string>(compare_dir))
       ("input_files", "positional arguments", cxxopts::value<std::vector<std::string>>(input_files))
       ("j,concurrency", "Number of threads to use. Defaults to all threads.", cxxopts::value<uint32_t>());
     // clang-format on
@@ -75,14 +78,21 @@ int main(int argc, char** argv) {
     LOG_INFO("Start stage = " + to_string(start_stage) + " End stage = " + to_string(end_stage));
 
     // Make sure start stage < end stage
-    if (static_cast<int>(start_stage) > static_cast<int>(end_stage)) {
+    if (stage_position(start_stage) > stage_position(end_stage)) {
       list_stages();
       throw cxxopts::exceptions::exception(
           "Starting build stage is after ending build stage in pipeline, see above");
     }
 
-    if (!result.count("input_files") && start_stage <= BuildStage::kParseNodes &&
-        end_stage >= BuildStage::kParseWays) {
+    if (result.count("changes") &&
+        (stage_position(start_stage) > stage_position(BuildStage::kBuild) ||
+         stage_position(end_stage) < stage_position(BuildStage::kBuild))) {
+      throw cxxopts::exceptions::exception("Change files are only used by the build stage");
+    }
+
+    if (!result.count("input_files") && !result.count("compare") &&
+        stage_position(start_stage) <= stage_position(BuildStage::kParseNodes) &&
+        stage_position(end_stage) >= stage_position(BuildStage::kParseWays)) {
       throw cxxopts::exceptions::exception("Input file is required\n\n" + options.help() + "\n\n");
     }
   } catch (cxxopts::exceptions::exception& e) {
@@ -94,8 +104,14 @@ int main(int argc, char** argv) {
     return EXIT_FAILURE;
   }
 
+  // Check that tiles built from change files are the same as the ones of a full build
+  if (!compare_dir.empty()) {
+    const auto tile_dir = config.get<std::string>("mjolnir.tile_dir");
+    return IncrementalBuilder::Compare(tile_dir, compare_dir) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
   // Build some tiles!
-  if (build_tile_set(config, input_files, start_stage, end_stage)) {
+  if (build_tile_set(config, input_files, start_stage, end_stage, change_files)) {
     return EXIT_SUCCESS;
   } else {
     return EXIT_FAILURE;
@@ -11,6 +11,7 @@ const std::string& MatrixAlgoToString(const valhalla::Matrix::Algorithm algo) {
       {valhalla::Matrix::CostMatrix, "costmatrix"},
       {valhalla::Matrix::TimeDistanceMatrix, "timedistancematrix"},
       {valhalla::Matrix::TimeDistanceBSSMatrix, "timedistancebssmatrix"},
+      {valhalla::Matrix::BucketMatrix, "bucketmatrix"},
   };
   auto i = algos.find(algo);
   return i == algos.cend() ? empty_str : i->second;
@@ -124,6 +125,7 @@ bool Options_Action_Enum_Parse(const std::string& action, Options::Action* a) {
       {"expansion", Options::expansion},
       {"centroid", Options::centroid},
       {"status", Options::status},
+      {"batch_route", Options::batch_route},
   };
   auto i = actions.find(action);
   if (i == actions.cend())
@@ -158,6 +160,7 @@ const std::string& Options_Action_Enum_Name(const Options::Action action) {
       {Options::expansion, "expansion"},
       {Options::centroid, "centroid"},
       {Options::status, "status"},
+      {Options::batch_route, "batch_route"},
   };
   auto i = actions.find(action);
   return i == actions.cend() ? empty_str : i->second;
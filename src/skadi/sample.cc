@@ -9,16 +9,31 @@
 #include <lz4frame.h>
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
 #include <future>
 #include <list>
+#include <map>
+#include <numeric>
 #include <optional>
 #include <regex>
 #include <unordered_map>
 #include <unordered_set>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VALHALLA_SAMPLE_SSE2
+// the avx2 kernel is compiled for its own target and only used when the cpu has it
+#if defined(__GNUC__) || defined(__clang__)
+#include <immintrin.h>
+#define VALHALLA_SAMPLE_AVX2
+#endif
+#endif
+
 namespace {
 // srtmgl1 holds 1x1 degree tiles but oversamples the edge of the tile
 // by .5 seconds on all sides. that means that the center of pixel 0 is
@@ -32,6 +47,10 @@ constexpr int16_t NO_DATA_HIGH = 16384;
 constexpr int16_t NO_DATA_LOW = -16384;
 constexpr size_t TILE_COUNT = 180 * 360;
 constexpr int8_t UNPACKED_TILES_COUNT = 50;
+// identifies an elevation store and the version of its layout
+constexpr char STORE_MAGIC[8] = {'V', 'H', 'E', 'L', 'E', 'V', '0', '1'};
+// tiles in an elevation store start at page boundaries so that each one is mapped on its own
+constexpr uint64_t STORE_ALIGNMENT = 4096;
 
 // macro is faster than inline function for this...
 #define out_of_range(v) v > NO_DATA_HIGH || v < NO_DATA_LOW
@@ -40,6 +59,10 @@ int16_t flip(int16_t value) {
   return ((value & 0xFF) << 8) | ((value >> 8) & 0xFF);
 }
 
+uint64_t align(uint64_t offset) {
+  return (offset + STORE_ALIGNMENT - 1) / STORE_ALIGNMENT * STORE_ALIGNMENT;
+}
+
 uint64_t file_size(const std::string& file_name) {
   // TODO: detect gzip and actually validate the uncompressed size?
   struct stat s {};
@@ -183,6 +206,141 @@ public:
   }
 };
 
+namespace {
+
+// reads the 4 pixels around each of the lanes the same way tile_data::get does, the ones below
+// only if there is a row below
+inline void gather(const int16_t* data,
+                   const int32_t* xs,
+                   const int32_t* ys,
+                   const size_t lanes,
+                   double* as,
+                   double* bs,
+                   double* cs,
+                   double* ds) {
+  for (size_t lane = 0; lane < lanes; ++lane) {
+    const auto* pixel = data + static_cast<size_t>(ys[lane]) * HGT_DIM + xs[lane];
+    as[lane] = flip(pixel[0]);
+    bs[lane] = flip(pixel[1]);
+    const bool below = static_cast<size_t>(ys[lane]) < HGT_DIM - 1;
+    cs[lane] = below ? flip(pixel[HGT_DIM]) : 0;
+    ds[lane] = below ? flip(pixel[HGT_DIM + 1]) : 0;
+  }
+}
+
+#ifdef VALHALLA_SAMPLE_SSE2
+inline __m128d select(const __m128d mask, const __m128d a, const __m128d b) {
+  return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+}
+
+inline __m128d in_range(const __m128d v) {
+  return _mm_and_pd(_mm_cmple_pd(v, _mm_set1_pd(NO_DATA_HIGH)),
+                    _mm_cmpge_pd(v, _mm_set1_pd(NO_DATA_LOW)));
+}
+
+// interpolates 2 postings at a time, returns the first posting it didnt get to
+size_t get_sse2(const int16_t* data,
+                const double* us,
+                const double* vs,
+                const size_t count,
+                double* values) {
+  const __m128d one = _mm_set1_pd(1.0), zero = _mm_setzero_pd();
+  const __m128d last_row = _mm_set1_pd(HGT_DIM - 1), no_data = _mm_set1_pd(NO_DATA_VALUE);
+  alignas(16) int32_t xs[4], ys[4];
+  alignas(16) double as[2], bs[2], cs[2], ds[2];
+
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    // integer pixel, the fractional pixels are never negative so truncating is flooring
+    const __m128d u = _mm_loadu_pd(us + i), v = _mm_loadu_pd(vs + i);
+    const __m128i xi = _mm_cvttpd_epi32(u), yi = _mm_cvttpd_epi32(v);
+    _mm_store_si128(reinterpret_cast<__m128i*>(xs), xi);
+    _mm_store_si128(reinterpret_cast<__m128i*>(ys), yi);
+    const __m128d x = _mm_cvtepi32_pd(xi), y = _mm_cvtepi32_pd(yi);
+    gather(data, xs, ys, 2, as, bs, cs, ds);
+
+    // the same arithmetic as tile_data::get
+    const __m128d u_ratio = _mm_sub_pd(u, x), v_ratio = _mm_sub_pd(v, y);
+    const __m128d u_inv = _mm_sub_pd(one, u_ratio), v_inv = _mm_sub_pd(one, v_ratio);
+    const __m128d a = _mm_load_pd(as), b = _mm_load_pd(bs), c = _mm_load_pd(cs),
+                  d = _mm_load_pd(ds);
+    const __m128d below = _mm_cmplt_pd(y, last_row);
+    const __m128d a_coef = _mm_and_pd(in_range(a), _mm_mul_pd(u_inv, v_inv));
+    const __m128d b_coef = _mm_and_pd(in_range(b), _mm_mul_pd(u_ratio, v_inv));
+    const __m128d c_coef = _mm_and_pd(in_range(c), _mm_mul_pd(u_inv, v_ratio));
+    const __m128d d_coef = _mm_and_pd(in_range(d), _mm_mul_pd(u_ratio, v_ratio));
+    __m128d value = _mm_add_pd(_mm_mul_pd(a, a_coef), _mm_mul_pd(b, b_coef));
+    __m128d adjust = _mm_add_pd(a_coef, b_coef);
+    value = select(below,
+                   _mm_add_pd(value, _mm_add_pd(_mm_mul_pd(c, c_coef), _mm_mul_pd(d, d_coef))),
+                   value);
+    adjust = select(below, _mm_add_pd(adjust, _mm_add_pd(c_coef, d_coef)), adjust);
+    value = select(_mm_cmpeq_pd(adjust, zero), no_data, _mm_div_pd(value, adjust));
+    _mm_storeu_pd(values + i, value);
+  }
+  return i;
+}
+#endif
+
+#ifdef VALHALLA_SAMPLE_AVX2
+__attribute__((target("avx2"))) inline __m256d in_range(const __m256d v) {
+  return _mm256_and_pd(_mm256_cmp_pd(v, _mm256_set1_pd(NO_DATA_HIGH), _CMP_LE_OQ),
+                       _mm256_cmp_pd(v, _mm256_set1_pd(NO_DATA_LOW), _CMP_GE_OQ));
+}
+
+// interpolates 4 postings at a time, returns the first posting it didnt get to
+__attribute__((target("avx2"))) size_t get_avx2(const int16_t* data,
+                                                const double* us,
+                                                const double* vs,
+                                                const size_t count,
+                                                double* values) {
+  const __m256d one = _mm256_set1_pd(1.0), zero = _mm256_setzero_pd();
+  const __m256d last_row = _mm256_set1_pd(HGT_DIM - 1), no_data = _mm256_set1_pd(NO_DATA_VALUE);
+  alignas(16) int32_t xs[4], ys[4];
+  alignas(32) double as[4], bs[4], cs[4], ds[4];
+
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    // integer pixel, the fractional pixels are never negative so truncating is flooring
+    const __m256d u = _mm256_loadu_pd(us + i), v = _mm256_loadu_pd(vs + i);
+    const __m128i xi = _mm256_cvttpd_epi32(u), yi = _mm256_cvttpd_epi32(v);
+    _mm_store_si128(reinterpret_cast<__m128i*>(xs), xi);
+    _mm_store_si128(reinterpret_cast<__m128i*>(ys), yi);
+    const __m256d x = _mm256_cvtepi32_pd(xi), y = _mm256_cvtepi32_pd(yi);
+    gather(data, xs, ys, 4, as, bs, cs, ds);
+
+    // the same arithmetic as tile_data::get
+    const __m256d u_ratio = _mm256_sub_pd(u, x), v_ratio = _mm256_sub_pd(v, y);
+    const __m256d u_inv = _mm256_sub_pd(one, u_ratio), v_inv = _mm256_sub_pd(one, v_ratio);
+    const __m256d a = _mm256_load_pd(as), b = _mm256_load_pd(bs), c = _mm256_load_pd(cs),
+                  d = _mm256_load_pd(ds);
+    const __m256d below = _mm256_cmp_pd(y, last_row, _CMP_LT_OQ);
+    const __m256d a_coef = _mm256_and_pd(in_range(a), _mm256_mul_pd(u_inv, v_inv));
+    const __m256d b_coef = _mm256_and_pd(in_range(b), _mm256_mul_pd(u_ratio, v_inv));
+    const __m256d c_coef = _mm256_and_pd(in_range(c), _mm256_mul_pd(u_inv, v_ratio));
+    const __m256d d_coef = _mm256_and_pd(in_range(d), _mm256_mul_pd(u_ratio, v_ratio));
+    __m256d value = _mm256_add_pd(_mm256_mul_pd(a, a_coef), _mm256_mul_pd(b, b_coef));
+    __m256d adjust = _mm256_add_pd(a_coef, b_coef);
+    value = _mm256_blendv_pd(value,
+                             _mm256_add_pd(value, _mm256_add_pd(_mm256_mul_pd(c, c_coef),
+                                                                _mm256_mul_pd(d, d_coef))),
+                             below);
+    adjust = _mm256_blendv_pd(adjust, _mm256_add_pd(adjust, _mm256_add_pd(c_coef, d_coef)), below);
+    value = _mm256_blendv_pd(_mm256_div_pd(value, adjust), no_data,
+                             _mm256_cmp_pd(adjust, zero, _CMP_EQ_OQ));
+    _mm256_storeu_pd(values + i, value);
+  }
+  return i;
+}
+
+const bool has_avx2 = []() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}();
+#endif
+
+} // namespace
+
 // tile_data object holds unpacked elevation tile data
 class tile_data {
 private:
@@ -274,6 +432,25 @@ public:
     // if we were missing some we need to adjust by that
     return value / adjust;
   }
+
+  // the same as get for each of the fractional pixels, as many at once as the cpu can
+  void get_all(const double* us, const double* vs, size_t count, double* values) const {
+    size_t i = 0;
+#ifdef VALHALLA_SAMPLE_AVX2
+    if (has_avx2) {
+      i = get_avx2(data, us, vs, count, values);
+    } else {
+      i = get_sse2(data, us, vs, count, values);
+    }
+#elif defined(VALHALLA_SAMPLE_SSE2)
+    i = get_sse2(data, us, vs, count, values);
+#endif
+
+    // the rest of them one at a time
+    for (; i < count; ++i) {
+      values[i] = get(us[i], vs[i]);
+    }
+  }
 };
 
 struct cache_t {
@@ -388,6 +565,51 @@ tile_data cache_t::source(uint16_t index) {
   return rv;
 }
 
+// An elevation store is a single file with all of the tiles of an elevation directory unpacked:
+// the magic, the offset of every tile of the world in the file (0 when it has none) and then the
+// raw hgt data of the tiles. It is mapped once and never changes, so it is read without any locks
+// and the tiles are never unpacked or evicted
+struct store_header_t {
+  char magic[sizeof(STORE_MAGIC)];
+  uint64_t offsets[TILE_COUNT];
+};
+
+class elevation_store_t {
+private:
+  valhalla::midgard::mem_map<char> data;
+
+public:
+  bool init(const std::string& path) {
+    auto size = file_size(path);
+    if (size == static_cast<uint64_t>(-1) || size < sizeof(store_header_t)) {
+      return false;
+    }
+    data.map(path, size, POSIX_MADV_RANDOM, true);
+    if (std::memcmp(header().magic, STORE_MAGIC, sizeof(STORE_MAGIC)) != 0) {
+      data.unmap();
+      return false;
+    }
+    return true;
+  }
+
+  inline const store_header_t& header() const {
+    return *reinterpret_cast<const store_header_t*>(data.get());
+  }
+
+  // the raw data of a tile or nullptr if it is not in the store
+  inline const int16_t* get(uint16_t index) const {
+    if (index >= TILE_COUNT) {
+      return nullptr;
+    }
+    auto offset = header().offsets[index];
+    // a truncated store still has the tiles before the cut
+    if (offset == 0 || offset + HGT_BYTES > data.size()) {
+      return nullptr;
+    }
+    return reinterpret_cast<const int16_t*>(data.get() + offset);
+  }
+};
+
 tile_data::tile_data(cache_t* c, uint16_t index, bool reusable, const int16_t* data)
     : c(c), data(data), index(index), reusable(reusable) {
   if (reusable)
@@ -425,9 +647,22 @@ sample::sample(const boost::property_tree::ptree& pt)
 
   // this line used only for testing, for more details check elevation_builder.cc
   remote_path_ = pt.get<std::string>("additional_data.elevation_dir", "");
+
+  // tiles in the store are used first, the directory and the url only for the ones it doesn't have
+  auto store_path = pt.get<std::string>("additional_data.elevation_store", "");
+  if (!store_path.empty()) {
+    store_initialisation(store_path);
+  }
 }
 
 sample::sample(const std::string& data_source) {
+  // an elevation store can stand in for the directory
+  if (std::filesystem::is_regular_file(data_source)) {
+    cache_initialisation("");
+    store_initialisation(data_source);
+    return;
+  }
+
   // cache initialization logic moved to different a method
   // to make future constructor merging easier, see sample.h
   cache_initialisation(data_source);
@@ -436,6 +671,28 @@ sample::sample(const std::string& data_source) {
 sample::~sample() {
 }
 
+bool sample::source(uint16_t index, tile_data& tile) {
+  // tiles in the store are unpacked already and never go away, there is nothing to lock or count
+  const int16_t* stored = store_ ? store_->get(index) : nullptr;
+  if (stored) {
+    tile = tile_data(cache_.get(), index, false, stored);
+    return true;
+  }
+
+  {
+    std::lock_guard<std::mutex> _(cache_lck);
+    tile = cache_->source(index);
+  }
+  if (!tile) {
+    if (!fetch(index))
+      return false;
+
+    if (!(tile = cache_->source(index)))
+      return false;
+  }
+  return true;
+}
+
 template <class coord_t> double sample::get(const coord_t& coord, tile_data& tile) {
   // check the cache and load
   auto lon = std::floor(coord.first);
@@ -443,18 +700,8 @@ template <class coord_t> double sample::get(const coord_t& coord, tile_data& til
   auto index = static_cast<uint16_t>(lat + 90) * 360 + static_cast<uint16_t>(lon + 180);
 
   // the caller can pass a cached tile, so we only fetch one if its not the one they already have
-  if (index != tile.get_index()) {
-    {
-      std::lock_guard<std::mutex> _(cache_lck);
-      tile = cache_->source(index);
-    }
-    if (!tile) {
-      if (!fetch(index))
-        return get_no_data_value();
-
-      if (!(tile = cache_->source(index)))
-        return get_no_data_value();
-    }
+  if (index != tile.get_index() && !source(index, tile)) {
+    return get_no_data_value();
   }
 
   // figure out what row and column we need from the array of data
@@ -473,12 +720,46 @@ template <class coord_t> double sample::get(const coord_t& coord) {
 }
 
 template <class coords_t> std::vector<double> sample::get_all(const coords_t& coords) {
-  std::vector<double> values;
-  values.reserve(coords.size());
+  // the tile and fractional pixel of each posting, the same as get works them out
+  std::vector<uint16_t> indices;
+  std::vector<double> us, vs;
+  indices.reserve(coords.size());
+  us.reserve(coords.size());
+  vs.reserve(coords.size());
+  for (const auto& coord : coords) {
+    auto lon = std::floor(coord.first);
+    auto lat = std::floor(coord.second);
+    indices.push_back(get_tile_index(coord));
+    us.push_back((coord.first - lon) * (HGT_DIM - 1));
+    vs.push_back((1.0 - (coord.second - lat)) * (HGT_DIM - 1));
+  }
+
+  // group the postings by tile so that each tile is only looked up once
+  std::vector<uint32_t> order(coords.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&indices](uint32_t a, uint32_t b) { return indices[a] < indices[b]; });
 
+  std::vector<double> values(coords.size(), get_no_data_value());
+  std::vector<double> group_us, group_vs, group_values;
   tile_data tile;
-  for (const auto& coord : coords) {
-    values.emplace_back(get(coord, tile));
+  for (auto begin = order.cbegin(); begin != order.cend();) {
+    const auto index = indices[*begin];
+    auto end = std::find_if(begin, order.cend(), [&](uint32_t i) { return indices[i] != index; });
+    if (source(index, tile)) {
+      group_us.clear();
+      group_vs.clear();
+      for (auto i = begin; i != end; ++i) {
+        group_us.push_back(us[*i]);
+        group_vs.push_back(vs[*i]);
+      }
+      group_values.resize(group_us.size());
+      tile.get_all(group_us.data(), group_vs.data(), group_us.size(), group_values.data());
+      for (auto i = begin; i != end; ++i) {
+        values[*i] = group_values[i - begin];
+      }
+    }
+    begin = end;
   }
 
   return values;
@@ -635,6 +916,94 @@ void sample::cache_initialisation(const std::string& data_source) {
   }
 }
 
+void sample::store_initialisation(const std::string& store_path) {
+  auto store = std::make_unique<elevation_store_t>();
+  if (!store->init(store_path)) {
+    LOG_WARN("Invalid elevation store: " + store_path);
+    return;
+  }
+  store_ = std::move(store);
+}
+
+bool build_elevation_store(const std::string& data_source, const std::string& store_path) {
+  if (!std::filesystem::is_directory(data_source)) {
+    LOG_ERROR("Elevation directory does not exist: " + data_source);
+    return false;
+  }
+
+  // in the order of their index so that neighbouring tiles end up near each other in the store
+  std::map<uint16_t, std::pair<std::string, format_t>> tiles;
+  for (const auto& f : std::filesystem::recursive_directory_iterator(data_source)) {
+    if (!f.is_regular_file())
+      continue;
+    const auto fp_str = f.path().string();
+    auto data = cache_item_t::parse_hgt_name(fp_str);
+    if (data && data->second != format_t::UNKNOWN &&
+        !tiles.emplace(data->first, std::make_pair(fp_str, data->second)).second) {
+      LOG_WARN("Skipping duplicate elevation data: " + fp_str);
+    }
+  }
+
+  // the store may be mapped by a running service, so a new one is written next to it and only
+  // renamed over it once complete
+  const auto tmp_path = store_path + ".tmp";
+  std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    LOG_ERROR("Failed to open elevation store for writing: " + tmp_path);
+    return false;
+  }
+
+  // value initialized so that all of the tiles are missing to begin with
+  auto header = std::make_unique<store_header_t>();
+  std::memcpy(header->magic, STORE_MAGIC, sizeof(STORE_MAGIC));
+  uint64_t offset = align(sizeof(store_header_t));
+  std::vector<char> unpacked(HGT_BYTES);
+  for (const auto& tile : tiles) {
+    cache_item_t item;
+    if (!item.init(tile.second.first, tile.second.second)) {
+      LOG_WARN("Corrupt elevation data: " + tile.second.first);
+      continue;
+    }
+
+    const char* data = item.get_data();
+    if (item.get_format() != format_t::RAW) {
+      // the buffer is ours, the item must not free it
+      auto unpacked_ok = item.unpack(unpacked.data());
+      item.detach_unpacked();
+      if (!unpacked_ok) {
+        continue;
+      }
+      data = unpacked.data();
+    }
+
+    file.seekp(offset);
+    file.write(data, HGT_BYTES);
+    header->offsets[tile.first] = offset;
+    offset = align(offset + HGT_BYTES);
+  }
+
+  file.seekp(0);
+  file.write(static_cast<const char*>(static_cast<void*>(header.get())), sizeof(store_header_t));
+  file.close();
+  if (file.fail()) {
+    LOG_ERROR("Failed to write elevation store: " + tmp_path);
+    std::filesystem::remove(tmp_path);
+    return false;
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp_path, store_path, ec);
+  if (ec) {
+    LOG_ERROR("Failed to replace elevation store " + store_path + ": " + ec.message());
+    std::filesystem::remove(tmp_path, ec);
+    return false;
+  }
+
+  auto count = std::count_if(std::begin(header->offsets), std::end(header->offsets),
+                             [](uint64_t offset) { return offset != 0; });
+  LOG_INFO("Stored " + std::to_string(count) + " elevation tiles in " + store_path);
+  return true;
+}
+
 double get_no_data_value() {
   return NO_DATA_VALUE;
 }
@@ -0,0 +1,168 @@
+#include "midgard/logging.h"
+#include "thor/worker.h"
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::thor;
+
+namespace {
+
+// thrown in the other workers of a batch to stop them, never caught as the failure of a pair
+struct batch_cancelled_t {};
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+void thor_worker_t::batch_route(Api& request) {
+  // time this whole method and save that statistic
+  auto _ = measure_scope_time(request);
+
+  auto& options = *request.mutable_options();
+  adjust_scores(options);
+
+  // every pair gets a route at its own index, the ones that fail only say why
+  auto& routes = *request.mutable_trip()->mutable_routes();
+  routes.Clear();
+  routes.Reserve(options.sources_size());
+  for (int i = 0; i < options.sources_size(); ++i) {
+    routes.Add();
+  }
+
+  // pairs are handed out one at a time so that long routes dont hold up the others
+  std::atomic<int> next_pair(0);
+  size_t concurrency =
+      std::max<size_t>(1, std::min<size_t>(batch_concurrency, options.sources_size()));
+  std::vector<Info> infos(concurrency);
+  std::atomic<bool> cancelled(false);
+  if (concurrency < 2) {
+    route_pairs(options, routes, next_pair, infos.front(), cancelled);
+  } else {
+    // the extra workers each have their own reader and algorithms, they are kept between requests
+    while (batch_workers.size() < concurrency - 1) {
+      batch_workers.emplace_back(std::make_unique<thor_worker_t>(batch_config));
+    }
+
+    // the interrupt can only be checked from this thread, the other workers just follow along
+    std::function<void()> follow_interrupt = [&cancelled]() {
+      if (cancelled.load()) {
+        throw batch_cancelled_t{};
+      }
+    };
+
+    // the error that stopped the batch, the workers it cancelled only stop without one
+    std::mutex error_lock;
+    std::exception_ptr error;
+    auto fail = [&](std::exception_ptr e) {
+      std::lock_guard<std::mutex> lock(error_lock);
+      if (!error) {
+        error = e;
+      }
+      cancelled = true;
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(concurrency - 1);
+    for (size_t i = 0; i < concurrency - 1; ++i) {
+      threads.emplace_back([&, i]() {
+        auto& worker = *batch_workers[i];
+        worker.set_interrupt(&follow_interrupt);
+        try {
+          worker.route_pairs(options, routes, next_pair, infos[i + 1], cancelled);
+        } catch (const batch_cancelled_t&) {
+          // stopped because another worker failed or the request was interrupted
+        } catch (...) { fail(std::current_exception()); }
+        worker.set_interrupt(nullptr);
+      });
+    }
+
+    // this thread routes pairs too
+    try {
+      route_pairs(options, routes, next_pair, infos.front(), cancelled);
+    } catch (...) { fail(std::current_exception()); }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  // warnings are only worth mentioning once per batch
+  std::unordered_set<uint64_t> codes;
+  for (const auto& warning : request.info().warnings()) {
+    codes.insert(warning.code());
+  }
+  for (const auto& info : infos) {
+    for (const auto& warning : info.warnings()) {
+      if (codes.insert(warning.code()).second) {
+        request.mutable_info()->mutable_warnings()->Add()->CopyFrom(warning);
+      }
+    }
+  }
+}
+
+void thor_worker_t::route_pairs(const Options& options,
+                                google::protobuf::RepeatedPtrField<TripRoute>& routes,
+                                std::atomic<int>& next_pair,
+                                Info& info,
+                                const std::atomic<bool>& cancelled) {
+  // each pair is routed like a route request of its own which only differs in its locations
+  Api pair;
+  auto& pair_options = *pair.mutable_options();
+  pair_options.CopyFrom(options);
+  pair_options.clear_sources();
+  pair_options.clear_targets();
+  pair_options.set_action(Options::route);
+  pair_options.set_alternates(0);
+
+  // so the costing is only set up once, but pairs must not see what previous ones did to it
+  controller = AttributesController(pair_options);
+  auto costing = parse_costing(pair);
+  auto& cost = mode_costing[static_cast<uint32_t>(mode)];
+  const auto hierarchy_limits = cost->GetHierarchyLimits();
+
+  for (int i = next_pair++; i < options.sources_size() && !cancelled.load(); i = next_pair++) {
+    auto& locations = *pair_options.mutable_locations();
+    locations.Clear();
+    locations.Add()->CopyFrom(options.sources(i));
+    locations.Add()->CopyFrom(options.targets(i));
+    locations.Mutable(0)->mutable_correlation()->set_original_index(0);
+    locations.Mutable(1)->mutable_correlation()->set_original_index(1);
+    pair.clear_trip();
+    pair.mutable_info()->clear_warnings();
+    cost->SetHierarchyLimits(hierarchy_limits);
+    cost->set_allow_conditional_destination(false);
+
+    auto& route = *routes.Mutable(i);
+    try {
+      // loki leaves the locations it could not find for the pairs to fail on their own
+      if (locations.Get(0).correlation().edges_size() == 0 ||
+          locations.Get(1).correlation().edges_size() == 0) {
+        throw valhalla_exception_t{171};
+      }
+
+      if (pair_options.date_time_type() == Options::arrive_by) {
+        path_arrive_by(pair, costing);
+      } else {
+        path_depart_at(pair, costing);
+      }
+      route.Swap(pair.mutable_trip()->mutable_routes(0));
+    } catch (const valhalla_exception_t& e) {
+      LOG_DEBUG("Batch route pair " + std::to_string(i) + " failed: " + e.message);
+      route.set_error_code(e.code);
+      route.set_error(e.message);
+    }
+    info.mutable_warnings()->MergeFrom(pair.info().warnings());
+  }
+}
+
+} // namespace thor
+} // namespace valhalla
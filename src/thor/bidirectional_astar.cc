@@ -54,6 +54,9 @@ BidirectionalAStar::BidirectionalAStar(const boost::property_tree::ptree& config
                                          kInitialEdgeLabelCountBidirAstar),
                     config.get<bool>("clear_reserved_memory", false)),
       extended_search_(config.get<bool>("extended_search", false)) {
+  const bool adaptive_queue = config.get<bool>("bidirectional_astar.adaptive_queue", false);
+  adjacencylist_forward_.set_adaptive(adaptive_queue);
+  adjacencylist_reverse_.set_adaptive(adaptive_queue);
   cost_threshold_ = 0;
   iterations_threshold_ = 0;
   desired_paths_count_ = 1;
@@ -86,8 +89,8 @@ void BidirectionalAStar::Clear() {
 
   adjacencylist_forward_.clear();
   adjacencylist_reverse_.clear();
-  edgestatus_forward_.clear();
-  edgestatus_reverse_.clear();
+  edgestatus_forward_.clear(clear_reserved_memory_);
+  edgestatus_reverse_.clear(clear_reserved_memory_);
 
   // Set the ferry flag to false
   has_ferry_ = false;
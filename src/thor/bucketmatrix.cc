@@ -0,0 +1,132 @@
+#include "thor/bucketmatrix.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+constexpr float kDefaultDetourFactor = 2.0f;
+// searches always go at least this far (in meters), short paths around a block can be long detours
+constexpr float kMinSearchRadius = 2000.0f;
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+BucketMatrix::BucketMatrix(const boost::property_tree::ptree& config)
+    : CostMatrix(config),
+      detour_factor_(config.get<float>("bucketmatrix.detour_factor", kDefaultDetourFactor)) {
+  // the targets are done before the sources start, there is nothing to find on their side
+  check_reverse_connection_ = false;
+}
+
+// Form a time distance matrix from the set of source locations
+// to the set of target locations.
+bool BucketMatrix::SourceToTarget(Api& request,
+                                  baldr::GraphReader& graphreader,
+                                  const sif::mode_costing_t& mode_costing,
+                                  const sif::travel_mode_t mode,
+                                  const float max_matrix_distance) {
+  request.mutable_matrix()->set_algorithm(Matrix::BucketMatrix);
+  bool invariant = request.options().date_time_type() == Options::invariant;
+
+  // Set the mode and costing
+  mode_ = mode;
+  costing_ = mode_costing[static_cast<uint32_t>(mode_)];
+  access_mode_ = costing_->access_mode();
+
+  auto& source_location_list = *request.mutable_options()->mutable_sources();
+  auto& target_location_list = *request.mutable_options()->mutable_targets();
+
+  current_pathdist_threshold_ =
+      GetSearchRadius(source_location_list, target_location_list, max_matrix_distance);
+
+  auto time_infos = SetOriginTimes(source_location_list, graphreader);
+
+  // Initialize best connections and status. Any locations that are the
+  // same get set to 0 time, distance and are not added to the remaining
+  // location set.
+  Initialize(source_location_list, target_location_list, request.matrix());
+
+  // The buckets have to cover all directions around a target, not only the one towards the closest
+  // source, so the targets are searched without A* heuristic
+  const uint32_t bucketsize = costing_->UnitSize();
+  for (uint32_t i = 0; i < locs_count_[MATRIX_REV]; i++) {
+    locs_status_[MATRIX_REV][i].unfound_connections.clear();
+    adjacency_[MATRIX_REV][i].reuse(0.0f, kBucketCount * bucketsize, bucketsize,
+                                    &edgelabel_[MATRIX_REV][i]);
+  }
+
+  // Set the source and target locations
+  SetSources(graphreader, source_location_list, time_infos);
+  SetTargets(graphreader, target_location_list);
+
+  // Run the backward search of all targets, each one leaves its buckets on the edges it reached.
+  // The interrupt can only be checked on this thread
+  const auto caller = std::this_thread::get_id();
+  RunLocations(locs_count_[MATRIX_REV], graphreader, [&](const uint32_t i, GraphReader& reader) {
+    Search<MatrixExpansionType::reverse>(i, reader, request.options(), TimeInfo::invalid(),
+                                         invariant, std::this_thread::get_id() == caller);
+  });
+  for (uint32_t i = 0; i < locs_count_[MATRIX_REV]; i++) {
+    MarkReached(MATRIX_REV, i);
+  }
+
+  // Run the forward search of all sources, the connection check scans the buckets
+  RunLocations(locs_count_[MATRIX_FORW], graphreader, [&](const uint32_t i, GraphReader& reader) {
+    Search<MatrixExpansionType::forward>(i, reader, request.options(), time_infos[i], invariant,
+                                         std::this_thread::get_id() == caller);
+  });
+
+  return FormMatrix(request, graphreader, time_infos, invariant);
+}
+
+float BucketMatrix::GetSearchRadius(
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& sources,
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& targets,
+    const float max_matrix_distance) const {
+  float max_beeline = 0.0f;
+  for (const auto& source : sources) {
+    const PointLL source_ll{source.ll().lng(), source.ll().lat()};
+    for (const auto& target : targets) {
+      max_beeline = std::max(max_beeline, static_cast<float>(source_ll.Distance(
+                                              {target.ll().lng(), target.ll().lat()})));
+    }
+  }
+
+  // both searches go half of the way
+  return std::min(max_matrix_distance, std::max(kMinSearchRadius, detour_factor_ * max_beeline)) /
+         2.0f;
+}
+
+template <const MatrixExpansionType expansion_direction, const bool FORWARD>
+void BucketMatrix::Search(const uint32_t index,
+                          GraphReader& graphreader,
+                          const valhalla::Options& options,
+                          const baldr::TimeInfo& time_info,
+                          const bool invariant,
+                          const bool interruptible) {
+  // a target only stops when it is out of edges or too far away, a source also stops a while after
+  // it has found all of its targets
+  auto& status = locs_status_[FORWARD][index];
+  uint32_t n = 0;
+  while (status.threshold > 0) {
+    status.threshold--;
+    Expand<expansion_direction>(index, n, graphreader, options, time_info, invariant);
+
+    // Allow this process to be aborted
+    if (interruptible && interrupt_ && (n % kInterruptIterationsInterval) == 0) {
+      (*interrupt_)();
+    }
+    n++;
+  }
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -8,7 +8,13 @@
 #include <ankerl/unordered_dense.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 using namespace valhalla::baldr;
@@ -54,6 +60,103 @@ namespace thor {
 class CostMatrix::ReachedMap : public ankerl::unordered_dense::map<uint64_t, std::vector<uint32_t>> {
 };
 
+// Threads which are kept around to run the iterations of the sources or targets. The calling thread
+// takes part as well, so there is one thread less than readers to expand with.
+class CostMatrix::ExpansionPool {
+public:
+  using expand_t = std::function<void(const uint32_t, baldr::GraphReader&)>;
+
+  ExpansionPool(const std::vector<std::shared_ptr<baldr::GraphReader>>& readers) {
+    threads_.reserve(readers.size());
+    for (const auto& reader : readers) {
+      threads_.emplace_back([this, reader]() { wait(*reader); });
+    }
+  }
+
+  ~ExpansionPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    start_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  size_t size() const {
+    return threads_.size() + 1;
+  }
+
+  // expands each of count locations once, returns when all of them are done
+  void run(const uint32_t count, baldr::GraphReader& reader, const expand_t& expand) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      expand_ = &expand;
+      count_ = count;
+      next_ = 0;
+      running_ = threads_.size();
+      exception_ = nullptr;
+      ++generation_;
+    }
+    start_.notify_all();
+    work(reader);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return running_ == 0; });
+    if (exception_) {
+      std::rethrow_exception(exception_);
+    }
+  }
+
+private:
+  void wait(baldr::GraphReader& reader) {
+    uint64_t generation = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        start_.wait(lock, [this, generation]() { return stop_ || generation_ != generation; });
+        if (stop_) {
+          return;
+        }
+        generation = generation_;
+      }
+      work(reader);
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--running_ == 0) {
+        done_.notify_one();
+      }
+    }
+  }
+
+  void work(baldr::GraphReader& reader) {
+    for (uint32_t i = next_++; i < count_; i = next_++) {
+      try {
+        (*expand_)(i, reader);
+      } catch (...) {
+        // stop handing out locations, the first failure is rethrown by the calling thread
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!exception_) {
+          exception_ = std::current_exception();
+        }
+        next_ = count_;
+      }
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  uint64_t generation_ = 0;
+  size_t running_ = 0;
+  bool stop_ = false;
+  const expand_t* expand_ = nullptr;
+  uint32_t count_ = 0;
+  std::atomic<uint32_t> next_{0};
+  std::exception_ptr exception_;
+};
+
 // Constructor with cost threshold.
 CostMatrix::CostMatrix(const boost::property_tree::ptree& config)
     : MatrixAlgorithm(config),
@@ -64,6 +167,7 @@ CostMatrix::CostMatrix(const boost::property_tree::ptree& config)
       check_reverse_connection_(config.get<bool>("costmatrix.check_reverse_connection", true)),
       max_iterations_(std::max(config.get<uint32_t>("costmatrix.max_iterations", kDefaultIterations),
                                static_cast<uint32_t>(1))),
+      adaptive_queue_(config.get<bool>("costmatrix.adaptive_queue", false)),
       access_mode_(kAutoAccess),
       mode_(travel_mode_t::kDrive), locs_count_{0, 0}, locs_remaining_{0, 0},
       current_pathdist_threshold_(0), targets_{new ReachedMap}, sources_{new ReachedMap} {
@@ -72,6 +176,10 @@ CostMatrix::CostMatrix(const boost::property_tree::ptree& config)
 CostMatrix::~CostMatrix() {
 }
 
+void CostMatrix::set_thread_readers(const std::vector<std::shared_ptr<baldr::GraphReader>>& readers) {
+  pool_.reset(readers.empty() ? nullptr : new ExpansionPool(readers));
+}
+
 // Clear the temporary information generated during time + distance matrix
 // construction.
 void CostMatrix::Clear() {
@@ -95,6 +203,8 @@ void CostMatrix::Clear() {
       edgestatus_[is_fwd].shrink_to_fit();
       astar_heuristics_[is_fwd].resize(locs_reservation);
       astar_heuristics_[is_fwd].shrink_to_fit();
+      deferred_status_[is_fwd].resize(locs_reservation);
+      deferred_status_[is_fwd].shrink_to_fit();
     }
     for (auto& iter : edgelabel_[is_fwd]) {
       if (iter.size() > label_reservation) {
@@ -104,11 +214,16 @@ void CostMatrix::Clear() {
       iter.clear();
     }
     for (auto& iter : edgestatus_[is_fwd]) {
-      iter.clear();
+      iter.clear(clear_reserved_memory_);
     }
     for (auto& iter : adjacency_[is_fwd]) {
       iter.clear();
     }
+    for (auto& iter : deferred_status_[is_fwd]) {
+      iter.reached.clear();
+      iter.done.clear();
+      iter.exhausted = false;
+    }
     hierarchy_limits_[is_fwd].clear();
     locs_status_[is_fwd].clear();
     astar_heuristics_[is_fwd].clear();
@@ -159,76 +274,10 @@ bool CostMatrix::SourceToTarget(Api& request,
     // First iterate over all targets, then over all sources: we only for sure
     // check the connection between both trees on the forward search, so reverse
     // has to come first
-    for (uint32_t i = 0; i < locs_count_[MATRIX_REV]; i++) {
-      if (locs_status_[MATRIX_REV][i].threshold > 0) {
-        locs_status_[MATRIX_REV][i].threshold--;
-        Expand<MatrixExpansionType::reverse>(i, n, graphreader, request.options());
-        // if we exhausted this search
-        if (locs_status_[MATRIX_REV][i].threshold == 0) {
-          for (uint32_t source = 0; source < locs_count_[MATRIX_FORW]; source++) {
-            // update the target for each source's remaining targets, if it still exists
-            auto& targets = locs_status_[MATRIX_FORW][source].unfound_connections;
-            auto it = targets.find(i);
-            if (it != targets.end()) {
-              // remove the target so we don't come here again
-              targets.erase(it);
-              // if there's no more target and the current source has not exhausted
-              // we update the source's threshold so that it doesn't enter its outer "if" statement
-              // anymore
-              if (targets.empty() && locs_status_[MATRIX_FORW][source].threshold > 0) {
-                // TODO(nils): shouldn't we extend the search here similar to bidir A*
-                //   i.e. if pruning was disabled we extend the search in the other direction
-                locs_status_[MATRIX_FORW][source].threshold = -1;
-                if (locs_remaining_[MATRIX_FORW] > 0) {
-                  locs_remaining_[MATRIX_FORW]--;
-                }
-              }
-            }
-          }
-          // in any case make sure this was the last time we looked at this target
-          locs_status_[MATRIX_REV][i].threshold = -1;
-          if (locs_remaining_[MATRIX_REV] > 0) {
-            locs_remaining_[MATRIX_REV]--;
-          }
-        }
-      }
-    }
-
-    for (uint32_t i = 0; i < locs_count_[MATRIX_FORW]; i++) {
-      if (locs_status_[MATRIX_FORW][i].threshold > 0) {
-        locs_status_[MATRIX_FORW][i].threshold--;
-        Expand<MatrixExpansionType::forward>(i, n, graphreader, request.options(), time_infos[i],
-                                             invariant);
-        // if we exhausted this search
-        if (locs_status_[MATRIX_FORW][i].threshold == 0) {
-          for (uint32_t target = 0; target < locs_count_[MATRIX_REV]; target++) {
-            // if we still didn't find the connection between this pair
-            auto& sources = locs_status_[MATRIX_REV][target].unfound_connections;
-            auto it = sources.find(i);
-            if (it != sources.end()) {
-              // remove the source so we don't come here again
-              sources.erase(it);
-              // if there's no more sources and the current target has not exhausted
-              // we update the target's threshold so that it doesn't enter this outer "if" statement
-              // anymore
-              if (sources.empty() && locs_status_[MATRIX_REV][target].threshold > 0) {
-                // TODO(nils): shouldn't we extend the search here similar to bidir A*
-                //   i.e. if pruning was disabled we extend the search in the other direction
-                locs_status_[MATRIX_REV][target].threshold = -1;
-                if (locs_remaining_[MATRIX_REV] > 0) {
-                  locs_remaining_[MATRIX_REV]--;
-                }
-              }
-            }
-          }
-          // in any case make sure this was the last time we looked at this source
-          locs_status_[MATRIX_FORW][i].threshold = -1;
-          if (locs_remaining_[MATRIX_FORW] > 0) {
-            locs_remaining_[MATRIX_FORW]--;
-          }
-        }
-      }
-    }
+    IterateLocations<MatrixExpansionType::reverse>(n, graphreader, request.options(), time_infos,
+                                                   invariant);
+    IterateLocations<MatrixExpansionType::forward>(n, graphreader, request.options(), time_infos,
+                                                   invariant);
 
     // Break out when remaining sources and targets to expand are both 0
     if (locs_remaining_[MATRIX_FORW] == 0 && locs_remaining_[MATRIX_REV] == 0) {
@@ -248,6 +297,17 @@ bool CostMatrix::SourceToTarget(Api& request,
     n++;
   }
 
+  return FormMatrix(request, graphreader, time_infos, invariant);
+}
+
+// Form the matrix from the best connections. Returns false if any connection was not found.
+bool CostMatrix::FormMatrix(Api& request,
+                            GraphReader& graphreader,
+                            const std::vector<baldr::TimeInfo>& time_infos,
+                            const bool invariant) {
+  auto& source_location_list = *request.mutable_options()->mutable_sources();
+  auto& target_location_list = *request.mutable_options()->mutable_targets();
+
   // resize/reserve all properties of Matrix on first pass only
   valhalla::Matrix& matrix = *request.mutable_matrix();
   reserve_pbf_arrays(matrix, best_connection_.size(), request.options().verbose(), costing_->pass());
@@ -335,6 +395,7 @@ void CostMatrix::Initialize(
     adjacency_[is_fwd].resize(count);
     edgestatus_[is_fwd].resize(count);
     edgelabel_[is_fwd].resize(count);
+    deferred_status_[is_fwd].resize(count);
     for (uint32_t i = 0; i < count; i++) {
       // Allocate the adjacency list and hierarchy limits for this source.
       // Use the cost threshold to size the adjacency list.
@@ -356,6 +417,7 @@ void CostMatrix::Initialize(
       // which would lead to tons of RAM if a high value was chosen in the config; ideally
       // this would be chosen based on the request (e.g. some factor to the A* distance)
       adjacency_[is_fwd][i].reuse(min_heuristic, range, bucketsize, &edgelabel_[is_fwd][i]);
+      adjacency_[is_fwd][i].set_adaptive(adaptive_queue_);
     }
   }
 
@@ -570,10 +632,8 @@ bool CostMatrix::ExpandInner(baldr::GraphReader& graphreader,
   adj.add(idx);
 
   // mark the edge as settled for the connection check
-  if (!FORWARD) {
-    (*targets_)[meta.edge_id].push_back(index);
-  } else if (check_reverse_connection_) {
-    (*sources_)[meta.edge_id].push_back(index);
+  if (!FORWARD || check_reverse_connection_) {
+    deferred_status_[FORWARD][index].reached.push_back(meta.edge_id);
   }
 
   // setting this edge as reached
@@ -603,9 +663,9 @@ bool CostMatrix::Expand(const uint32_t index,
     // extend searches more than we need to
     for (uint32_t st = 0; st < locs_count_[!FORWARD]; st++) {
       if (FORWARD) {
-        UpdateStatus(index, st);
+        UpdateStatus<expansion_direction>(index, st);
       } else {
-        UpdateStatus(st, index);
+        UpdateStatus<expansion_direction>(st, index);
       }
     }
     locs_status_[FORWARD][index].threshold = 0;
@@ -840,7 +900,7 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
 
       // Update status and update threshold if this is the last location
       // to find for this source or target
-      UpdateStatus(source, target);
+      UpdateStatus<MatrixExpansionType::forward>(source, target);
     } else {
       // at this point, the found connection might still be somewhat trivial:
       // the connecting edge might be an initial edge for either the given source or target
@@ -869,7 +929,7 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
 
         // Update status and update threshold if this is the last location
         // to find for this source or target
-        UpdateStatus(source, target);
+        UpdateStatus<MatrixExpansionType::forward>(source, target);
       }
     }
     // setting this edge as connected
@@ -961,7 +1021,7 @@ void CostMatrix::CheckReverseConnections(const uint32_t target,
 
         // Update status and update threshold if this is the last location
         // to find for this source or target
-        UpdateStatus(source, target);
+        UpdateStatus<MatrixExpansionType::reverse>(source, target);
       } else {
         // at this point, the found connection might still be somewhat trivial:
         // the connecting edge might be an initial edge for either the given source or target
@@ -992,7 +1052,7 @@ void CostMatrix::CheckReverseConnections(const uint32_t target,
 
           // Update status and update threshold if this is the last location
           // to find for this source or target
-          UpdateStatus(source, target);
+          UpdateStatus<MatrixExpansionType::reverse>(source, target);
         }
       }
       // setting this edge as connected
@@ -1012,38 +1072,137 @@ void CostMatrix::CheckReverseConnections(const uint32_t target,
 }
 
 // Update status when a connection is found.
+template <const MatrixExpansionType expansion_direction, const bool FORWARD>
 void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target) {
-  // Remove the target from the source status
-  auto& s = locs_status_[MATRIX_FORW][source].unfound_connections;
-  auto it = s.find(target);
-  if (it != s.end()) {
-    s.erase(it);
-    if (s.empty() && locs_status_[MATRIX_FORW][source].threshold > 0) {
-      // At least 1 connection has been found to each target for this source.
-      // Set a threshold to continue search for a limited number of times.
-      locs_status_[MATRIX_FORW][source].threshold =
-          GetThreshold(mode_,
-                       edgelabel_[MATRIX_FORW][source].size() + edgelabel_[MATRIX_REV][target].size(),
-                       max_iterations_);
+  const uint32_t index = FORWARD ? source : target;
+  const uint32_t other_index = FORWARD ? target : source;
+
+  // At least 1 connection has been found to each target for this source or to each source for this
+  // target. Set a threshold to continue search for a limited number of times.
+  const int threshold =
+      GetThreshold(mode_,
+                   edgelabel_[MATRIX_FORW][source].size() + edgelabel_[MATRIX_REV][target].size(),
+                   max_iterations_);
+
+  // Remove the other location from this location's status
+  auto& status = locs_status_[FORWARD][index];
+  auto it = status.unfound_connections.find(other_index);
+  if (it != status.unfound_connections.end()) {
+    status.unfound_connections.erase(it);
+    if (status.unfound_connections.empty() && status.threshold > 0) {
+      status.threshold = threshold;
     }
   }
 
-  // Remove the source from the target status
-  auto& t = locs_status_[MATRIX_REV][target].unfound_connections;
-  it = t.find(source);
-  if (it != t.end()) {
-    t.erase(it);
-    if (t.empty() && locs_status_[MATRIX_REV][target].threshold > 0) {
-      // At least 1 connection has been found to each source for this target.
-      // Set a threshold to continue search for a limited number of times.
-      locs_status_[MATRIX_REV][target].threshold =
-          GetThreshold(mode_,
-                       edgelabel_[MATRIX_FORW][source].size() + edgelabel_[MATRIX_REV][target].size(),
-                       max_iterations_);
+  // The other direction is not expanding right now, it learns about this afterwards
+  deferred_status_[FORWARD][index].done.emplace_back(other_index, threshold);
+}
+
+template <const MatrixExpansionType expansion_direction, const bool FORWARD>
+void CostMatrix::IterateLocations(const uint32_t n,
+                                  GraphReader& graphreader,
+                                  const valhalla::Options& options,
+                                  const std::vector<baldr::TimeInfo>& time_infos,
+                                  const bool invariant) {
+  // the locations of one direction only share what they change for the other direction, which is
+  // deferred, so they can expand concurrently. The expansion callback expects to be called in order
+  const uint32_t count = locs_count_[FORWARD];
+  RunLocations(count, graphreader, [&](const uint32_t i, GraphReader& reader) {
+    Iterate<expansion_direction>(i, n, reader, options,
+                                 FORWARD ? time_infos[i] : TimeInfo::invalid(), invariant);
+  });
+
+  // apply the changes in the order of the locations, which is the order they were expanded in
+  // before there were threads
+  for (uint32_t i = 0; i < count; i++) {
+    ApplyDeferredStatus<expansion_direction>(i);
+  }
+}
+
+void CostMatrix::RunLocations(const uint32_t count,
+                              GraphReader& graphreader,
+                              const std::function<void(const uint32_t, GraphReader&)>& run) {
+  // the expansion callback expects to be called in order
+  if (pool_ && !expansion_callback_ && count >= pool_->size()) {
+    pool_->run(count, graphreader, run);
+  } else {
+    for (uint32_t i = 0; i < count; i++) {
+      run(i, graphreader);
     }
   }
 }
 
+template <const MatrixExpansionType expansion_direction, const bool FORWARD>
+void CostMatrix::Iterate(const uint32_t index,
+                         const uint32_t n,
+                         GraphReader& graphreader,
+                         const valhalla::Options& options,
+                         const baldr::TimeInfo& time_info,
+                         const bool invariant) {
+  auto& status = locs_status_[FORWARD][index];
+  if (status.threshold <= 0) {
+    return;
+  }
+
+  status.threshold--;
+  Expand<expansion_direction>(index, n, graphreader, options, time_info, invariant);
+  // if we exhausted this search
+  if (status.threshold == 0) {
+    // the other direction's locations which still wait for this one won't find it anymore
+    // TODO(nils): shouldn't we extend the search here similar to bidir A*
+    //   i.e. if pruning was disabled we extend the search in the other direction
+    auto& deferred = deferred_status_[FORWARD][index];
+    for (uint32_t other_index = 0; other_index < locs_count_[!FORWARD]; other_index++) {
+      deferred.done.emplace_back(other_index, kExhaustedThreshold);
+    }
+    // in any case make sure this was the last time we looked at this location
+    status.threshold = kExhaustedThreshold;
+    deferred.exhausted = true;
+  }
+}
+
+template <const MatrixExpansionType expansion_direction, const bool FORWARD>
+void CostMatrix::ApplyDeferredStatus(const uint32_t index) {
+  MarkReached(FORWARD, index);
+
+  auto& deferred = deferred_status_[FORWARD][index];
+  for (const auto& done : deferred.done) {
+    // remove this location so we don't come here again
+    auto& status = locs_status_[!FORWARD][done.first];
+    auto it = status.unfound_connections.find(index);
+    if (it == status.unfound_connections.end()) {
+      continue;
+    }
+    status.unfound_connections.erase(it);
+    // if there's no more locations to find and the other location has not exhausted we update its
+    // threshold, if this one was exhausted the other one doesn't enter its outer "if" statement
+    // anymore
+    if (status.unfound_connections.empty() && status.threshold > 0) {
+      status.threshold = done.second;
+      if (done.second == kExhaustedThreshold && locs_remaining_[!FORWARD] > 0) {
+        locs_remaining_[!FORWARD]--;
+      }
+    }
+  }
+
+  if (deferred.exhausted && locs_remaining_[FORWARD] > 0) {
+    locs_remaining_[FORWARD]--;
+  }
+
+  deferred.done.clear();
+  deferred.exhausted = false;
+}
+
+// Mark the edges a location reached as settled for the connection check of the other direction
+void CostMatrix::MarkReached(const bool forward, const uint32_t index) {
+  auto& deferred = deferred_status_[forward][index];
+  auto& reached = forward ? *sources_ : *targets_;
+  for (const auto& edge_id : deferred.reached) {
+    reached[edge_id].push_back(index);
+  }
+  deferred.reached.clear();
+}
+
 // Sets the source/origin locations. Search expands forward from these
 // locations.
 void CostMatrix::SetSources(GraphReader& graphreader,
@@ -1377,6 +1536,21 @@ std::string CostMatrix::RecostFormPath(GraphReader& graphreader,
   return encode<decltype(points)>(points, request.options().shape_format() != polyline5 ? 1e6 : 1e5);
 }
 
+template bool
+CostMatrix::Expand<MatrixExpansionType::forward, true>(const uint32_t index,
+                                                       const uint32_t n,
+                                                       baldr::GraphReader& graphreader,
+                                                       const valhalla::Options& options,
+                                                       const baldr::TimeInfo& time_info,
+                                                       const bool invariant);
+template bool
+CostMatrix::Expand<MatrixExpansionType::reverse, false>(const uint32_t index,
+                                                        const uint32_t n,
+                                                        baldr::GraphReader& graphreader,
+                                                        const valhalla::Options& options,
+                                                        const baldr::TimeInfo& time_info,
+                                                        const bool invariant);
+
 template <const MatrixExpansionType expansion_direction, const bool FORWARD>
 float CostMatrix::GetAstarHeuristic(const uint32_t loc_idx, const PointLL& ll) const {
   if (locs_status_[FORWARD][loc_idx].unfound_connections.empty()) {
@@ -45,6 +45,9 @@ Dijkstras::Dijkstras(const boost::property_tree::ptree& config)
       max_reserved_labels_count_(config.get<uint32_t>("max_reserved_labels_count_dijkstras",
                                                       kInitialEdgeLabelCountDijkstras)),
       clear_reserved_memory_(config.get<bool>("clear_reserved_memory", false)), multipath_(false) {
+  const bool adaptive_queue = config.get<bool>("dijkstras.adaptive_queue", false);
+  adjacencylist_.set_adaptive(adaptive_queue);
+  mmadjacencylist_.set_adaptive(adaptive_queue);
 }
 
 // Clear the temporary information generated during path construction.
@@ -65,7 +68,7 @@ void Dijkstras::Clear() {
 
   adjacencylist_.clear();
   mmadjacencylist_.clear();
-  edgestatus_.clear();
+  edgestatus_.clear(clear_reserved_memory_);
 }
 
 // Initialize - create adjacency list, edgestatus support, and reserve
@@ -1,6 +1,7 @@
 #include "sif/autocost.h"
 #include "sif/bicyclecost.h"
 #include "sif/pedestriancost.h"
+#include "thor/bucketmatrix.h"
 #include "thor/costmatrix.h"
 #include "thor/timedistancebssmatrix.h"
 #include "thor/timedistancematrix.h"
@@ -65,6 +66,9 @@ thor_worker_t::get_matrix_algorithm(Api& request, const bool has_time, const std
     case TIME_DISTANCE_MATRIX:
       config_algo = Matrix::TimeDistanceMatrix;
       break;
+    case BUCKET_MATRIX:
+      config_algo = Matrix::BucketMatrix;
+      break;
   }
 
   // similar to routing: prefer the exact unidirectional algo if not requested otherwise
@@ -74,12 +78,15 @@ thor_worker_t::get_matrix_algorithm(Api& request, const bool has_time, const std
     return &time_distance_matrix_;
   } else if (has_time && request.options().prioritize_bidirectional() &&
              source_to_target_algorithm != TIME_DISTANCE_MATRIX) {
-    return &costmatrix_;
+    return config_algo == Matrix::BucketMatrix ? static_cast<MatrixAlgorithm*>(&bucketmatrix_)
+                                               : &costmatrix_;
   } else if (config_algo == Matrix::CostMatrix) {
     if (has_time && !request.options().prioritize_bidirectional()) {
       add_warning(request, 301);
     }
     return &costmatrix_;
+  } else if (config_algo == Matrix::BucketMatrix) {
+    return &bucketmatrix_;
   } else {
     // if this happens, the server config only allows for timedist matrix
     if (has_time && request.options().prioritize_bidirectional()) {
@@ -104,6 +111,7 @@ std::string thor_worker_t::matrix(Api& request) {
   // allow all algos to be cancelled
   for (auto* alg : std::vector<MatrixAlgorithm*>{
            &costmatrix_,
+           &bucketmatrix_,
            &time_distance_matrix_,
            &time_distance_bss_matrix_,
        }) {
@@ -122,13 +130,13 @@ std::string thor_worker_t::matrix(Api& request) {
   LOG_INFO("matrix::" + std::string(algo->name()));
 
   // TODO(nils): TDMatrix doesn't care about either destonly or no_thru
-  if (algo->name() != "costmatrix") {
+  if (algo->name() != "costmatrix" && algo->name() != "bucketmatrix") {
     algo->SourceToTarget(request, *reader, mode_costing, mode,
                          max_matrix_distance.find(costing)->second);
     return tyr::serializeMatrix(request);
   }
 
-  // for costmatrix try a second pass if the first didn't work out
+  // for costmatrix (and the bucket matrix built on it) try a second pass if the first didn't work out
   valhalla::sif::cost_ptr_t cost = mode_costing[static_cast<uint32_t>(mode)];
   cost->set_allow_destination_only(false);
   cost->set_pass(0);
@@ -0,0 +1,658 @@
+#include "thor/overlay_astar.h"
+#include "baldr/rapidjson_utils.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/util.h"
+#include "midgard/logging.h"
+#include "sif/costfactory.h"
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <thread>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+// Default distance between the locations below which the overlay is not worth it
+constexpr float kDefaultOverlayMinDistance = 200000.0f;
+
+// Same as the forward A*
+constexpr uint32_t kMaxIterationsWithoutConvergence = 1800000;
+
+// Cell of tiles around the locations which are expanded edge by edge
+constexpr uint32_t kRegularCell = GraphOverlay::kInvalidIndex - 1;
+
+// How many requests with the same costing options it takes to customize a metric for them
+constexpr uint32_t kDefaultCustomizeAfter = 20;
+
+// Metrics kept at most, each takes about as much memory as the overlay itself
+constexpr uint32_t kDefaultMaxMetrics = 8;
+
+// Bounds the bookkeeping of options that did not make it to a metric (yet)
+constexpr size_t kMaxTrackedOptions = 4096;
+
+// Protobuf maps (like the hierarchy limits) are only serialized in a stable order on request
+std::string serialize(const valhalla::Costing& costing) {
+  std::string bytes;
+  {
+    google::protobuf::io::StringOutputStream stream(&bytes);
+    google::protobuf::io::CodedOutputStream coded(&stream);
+    coded.SetSerializationDeterministic(true);
+    costing.SerializeToCodedStream(&coded);
+  }
+  return bytes;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+void CellSearch::Run(GraphReader& reader,
+                     const DynamicCost& costing,
+                     const GraphOverlay::Cell& cell,
+                     const GraphId& entry,
+                     const GraphId& target) {
+  labels_.clear();
+  edgestatus_.clear();
+  uint32_t bucketsize = costing.UnitSize();
+  adjacencylist_.reuse(0.0f, kBucketCount * bucketsize, bucketsize, &labels_);
+
+  auto tile = reader.GetGraphTile(entry);
+  if (!tile) {
+    return;
+  }
+
+  // The entry is only the predecessor of the first turn into the cell, it is never expanded again
+  const auto* edge = tile->directededge(entry);
+  labels_.emplace_back(kInvalidLabel, entry, GraphId(), edge, Cost{}, 0.0f, 0.0f,
+                       costing.travel_mode(), Cost{}, false, !costing.IsClosed(edge, tile), false,
+                       InternalTurn::kNoTurn, kInvalidRestriction, 0,
+                       edge->destonly() || (costing.is_hgv() && edge->destonly_hgv()),
+                       edge->forwardaccess() & kTruckAccess);
+  labels_.back().Update(kInvalidLabel, Cost{}, 0.0f, Cost{}, 0, kInvalidRestriction);
+  edgestatus_.Set(entry, EdgeSet::kPermanent, 0, tile);
+  Expand(reader, costing, cell.tile_id, 0);
+
+  size_t exits_left = target.Is_Valid() ? 1 : cell.exits.size();
+  while (exits_left > 0) {
+    const uint32_t predindex = adjacencylist_.pop();
+    if (predindex == kInvalidLabel) {
+      break;
+    }
+    const auto& pred = labels_[predindex];
+    edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
+
+    // Exits end the path within the cell
+    if (pred.endnode().Tile_Base() != cell.tile_id) {
+      exits_left -= !target.Is_Valid() || pred.edgeid() == target;
+      continue;
+    }
+    Expand(reader, costing, cell.tile_id, predindex);
+  }
+}
+
+void CellSearch::Expand(GraphReader& reader,
+                        const DynamicCost& costing,
+                        const GraphId& cell_tile,
+                        const uint32_t pred_idx) {
+  // Copy the predecessor since adding labels may move it
+  const BDEdgeLabel pred = labels_[pred_idx];
+  const GraphId node = pred.endnode();
+  auto tile = reader.GetGraphTile(node);
+  if (!tile || tile->id() != cell_tile) {
+    return;
+  }
+  const NodeInfo* nodeinfo = tile->node(node);
+  if (!costing.Allowed(nodeinfo)) {
+    return;
+  }
+
+  auto reader_getter = [&reader]() { return LimitedGraphReader(reader); };
+  GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
+  EdgeStatusInfo* es = edgestatus_.GetPtr(edgeid, tile);
+  const DirectedEdge* edge = tile->directededge(edgeid);
+  for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++edge, ++edgeid, ++es) {
+    // Shortcuts are not part of the cell, u-turns are left to the regular expansion
+    if (edge->is_shortcut() || es->set() == EdgeSet::kPermanent ||
+        pred.opp_local_idx() == edge->localedgeidx()) {
+      continue;
+    }
+
+    uint8_t restriction_idx = kInvalidRestriction;
+    if (!costing.Allowed(edge, false, pred, tile, edgeid, 0, nodeinfo->timezone(),
+                         restriction_idx) ||
+        costing.Restricted(edge, pred, labels_, tile, edgeid, true, &edgestatus_, 0,
+                           nodeinfo->timezone())) {
+      continue;
+    }
+
+    uint8_t flow_sources;
+    Cost transition_cost = costing.TransitionCost(edge, nodeinfo, pred, tile, reader_getter);
+    Cost cost = pred.cost() + transition_cost +
+                costing.EdgeCost(edge, tile, TimeInfo::invalid(), flow_sources);
+    uint32_t path_distance = pred.path_distance() + edge->length();
+
+    if (es->set() == EdgeSet::kTemporary) {
+      auto& lab = labels_[es->index()];
+      if (cost.cost < lab.cost().cost) {
+        adjacencylist_.decrease(es->index(), cost.cost);
+        lab.Update(pred_idx, cost, cost.cost, transition_cost, path_distance, restriction_idx);
+      }
+      continue;
+    }
+
+    uint32_t idx = labels_.size();
+    labels_.emplace_back(pred_idx, edgeid, GraphId(), edge, cost, cost.cost, 0.0f,
+                         costing.travel_mode(), transition_cost,
+                         pred.not_thru_pruning() || !edge->not_thru(),
+                         pred.closure_pruning() || !costing.IsClosed(edge, tile),
+                         0 != (flow_sources & kDefaultFlowMask),
+                         costing.TurnType(pred.opp_local_idx(), nodeinfo, edge), restriction_idx, 0,
+                         edge->destonly() || (costing.is_hgv() && edge->destonly_hgv()),
+                         edge->forwardaccess() & kTruckAccess);
+    labels_.back().Update(pred_idx, cost, cost.cost, transition_cost, path_distance,
+                          restriction_idx);
+    adjacencylist_.add(idx);
+    *es = {EdgeSet::kTemporary, idx};
+  }
+}
+
+const BDEdgeLabel* CellSearch::label(const GraphId& exit) const {
+  auto status = edgestatus_.Get(exit);
+  return status.set() == EdgeSet::kPermanent ? &labels_[status.index()] : nullptr;
+}
+
+std::vector<const BDEdgeLabel*> CellSearch::path(const GraphId& exit) const {
+  std::vector<const BDEdgeLabel*> path;
+  const auto* label = this->label(exit);
+  while (label && label->predecessor() != kInvalidLabel) {
+    path.push_back(label);
+    label = &labels_[label->predecessor()];
+  }
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+OverlayMetric::OverlayMetric(std::shared_ptr<const GraphOverlay> overlay,
+                             const boost::property_tree::ptree& mjolnir_config,
+                             const Costing& costing,
+                             const uint32_t concurrency)
+    : overlay_(std::move(overlay)), costing_(serialize(costing)) {
+  const auto& cells = overlay_->cells();
+  weights_.resize(cells.size());
+
+  // Every thread takes the next cell until there are none left
+  std::atomic<uint32_t> next_cell(0);
+  auto customize = [&]() {
+    GraphReader reader(mjolnir_config);
+    auto cost = CostFactory().Create(costing);
+    CellSearch search;
+    for (uint32_t c = next_cell++; c < cells.size(); c = next_cell++) {
+      const auto& cell = cells[c];
+      auto& weights = weights_[c];
+      weights.resize(cell.entries.size() * cell.exits.size());
+      if (cell.restricted) {
+        continue; // routes never hop over it
+      }
+      for (uint32_t entry = 0; entry < cell.entries.size(); ++entry) {
+        search.Run(reader, *cost, cell, cell.entries[entry]);
+        for (uint32_t exit = 0; exit < cell.exits.size(); ++exit) {
+          if (const auto* label = search.label(cell.exits[exit])) {
+            weights[entry * cell.exits.size() + exit] = {label->cost(), label->path_distance()};
+          }
+        }
+      }
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
+    }
+  };
+
+  std::vector<std::exception_ptr> errors(std::max(concurrency, 1u));
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < errors.size(); ++i) {
+    threads.emplace_back([&customize, &error = errors[i]]() {
+      try {
+        customize();
+      } catch (...) { error = std::current_exception(); }
+    });
+  }
+  try {
+    customize();
+  } catch (...) { errors.front() = std::current_exception(); }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+uint64_t OverlayMetric::fingerprint(const Costing& costing) {
+  return std::hash<std::string>()(serialize(costing));
+}
+
+bool OverlayMetric::matches(const Costing& costing) const {
+  return serialize(costing) == costing_;
+}
+
+OverlayMetricCache::OverlayMetricCache(std::shared_ptr<const GraphOverlay> overlay,
+                                       const boost::property_tree::ptree& config)
+    : overlay_(std::move(overlay)), mjolnir_config_(config.get_child("mjolnir")),
+      concurrency_(config.get<uint32_t>("thor.overlay_astar.concurrency",
+                                        std::thread::hardware_concurrency())),
+      customize_after_(config.get<uint32_t>("thor.overlay_astar.customize_after",
+                                            kDefaultCustomizeAfter)),
+      max_metrics_(config.get<uint32_t>("thor.overlay_astar.max_metrics", kDefaultMaxMetrics)) {
+}
+
+bool OverlayMetricCache::supports(const Costing::Type costing_type) {
+  switch (costing_type) {
+    case Costing::auto_:
+    case Costing::bus:
+    case Costing::taxi:
+    case Costing::truck:
+    case Costing::motorcycle:
+      return true;
+    default:
+      return false;
+  }
+}
+
+std::shared_ptr<const OverlayMetric> OverlayMetricCache::get(const Costing& costing) {
+  if (!supports(costing.type())) {
+    return nullptr;
+  }
+
+  const auto fingerprint = OverlayMetric::fingerprint(costing);
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto cached = metrics_.find(fingerprint);
+  if (cached != metrics_.end()) {
+    cached->second.last_use = ++uses_;
+    auto metric = cached->second.metric;
+    lock.unlock();
+    if (metric.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      return nullptr;
+    }
+    // failed customizations are logged when they happen and stay cached as nullptr
+    auto ready = metric.get();
+    return ready && ready->matches(costing) ? ready : nullptr;
+  }
+
+  // Options that are requested often enough are worth customizing
+  if (requests_.size() >= kMaxTrackedOptions) {
+    requests_.clear();
+  }
+  if (++requests_[fingerprint] >= customize_after_ && make_room()) {
+    requests_.erase(fingerprint);
+    start(fingerprint, costing);
+  }
+  return nullptr;
+}
+
+void OverlayMetricCache::customize(const Costing& costing) {
+  const auto fingerprint = OverlayMetric::fingerprint(costing);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (supports(costing.type()) && !metrics_.count(fingerprint) && make_room()) {
+    start(fingerprint, costing);
+  }
+}
+
+void OverlayMetricCache::wait() {
+  std::vector<metric_future_t> pending;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& cached : metrics_) {
+      pending.push_back(cached.second.metric);
+    }
+  }
+  for (const auto& metric : pending) {
+    metric.wait();
+  }
+}
+
+bool OverlayMetricCache::make_room() {
+  if (metrics_.size() < max_metrics_) {
+    return true;
+  }
+  // only metrics that are done customizing can be dropped, running customizations are not cancelable
+  auto oldest = metrics_.end();
+  for (auto cached = metrics_.begin(); cached != metrics_.end(); ++cached) {
+    if (cached->second.metric.wait_for(std::chrono::seconds(0)) == std::future_status::ready &&
+        (oldest == metrics_.end() || cached->second.last_use < oldest->second.last_use)) {
+      oldest = cached;
+    }
+  }
+  if (oldest == metrics_.end()) {
+    return false;
+  }
+  metrics_.erase(oldest);
+  return true;
+}
+
+void OverlayMetricCache::start(const uint64_t fingerprint, const Costing& costing) {
+  // The metric is customized on threads of its own so the request that triggered it is not held up
+  auto metric = std::async(std::launch::async, [overlay = overlay_, config = mjolnir_config_,
+                                                costing, concurrency = concurrency_]() {
+    const auto& costing_str = Costing_Enum_Name(costing.type());
+    try {
+      auto start = std::chrono::steady_clock::now();
+      auto metric = std::make_shared<const OverlayMetric>(overlay, config, costing, concurrency);
+      auto msecs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+      LOG_INFO("Customized overlay for " + costing_str + " costing in " + std::to_string(msecs) +
+               " ms");
+      return std::shared_ptr<const OverlayMetric>(std::move(metric));
+    } catch (const std::exception& e) {
+      LOG_WARN("Failed to customize overlay for " + costing_str + " costing: " + e.what());
+      return std::shared_ptr<const OverlayMetric>();
+    }
+  });
+  metrics_[fingerprint] = {metric.share(), ++uses_};
+}
+
+std::shared_ptr<OverlayMetricCache> get_overlay_metric_cache(const boost::property_tree::ptree& config) {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::shared_ptr<OverlayMetricCache>> caches;
+  const auto overlay_file = config.get<std::string>("mjolnir.overlay");
+  std::lock_guard<std::mutex> lock(mutex);
+  auto inserted = caches.emplace(overlay_file, nullptr);
+  if (!inserted.second) {
+    return inserted.first->second;
+  }
+
+  try {
+    auto overlay = std::make_shared<const GraphOverlay>(GraphOverlay::Read(overlay_file));
+    LOG_INFO("Loaded overlay with " + std::to_string(overlay->cells().size()) + " cells");
+    inserted.first->second = std::make_shared<OverlayMetricCache>(overlay, config);
+
+    // The options of requests without costing options are the most common by far
+    rapidjson::Document doc;
+    doc.SetObject();
+    Costing costing;
+    ParseCosting(doc, "/costing_options/auto", &costing, Costing::auto_);
+    inserted.first->second->customize(costing);
+  } catch (const std::exception& e) {
+    LOG_WARN("Overlay routing disabled, failed to load " + overlay_file + ": " + e.what());
+  }
+  return inserted.first->second;
+}
+
+OverlayAStar::OverlayAStar(const boost::property_tree::ptree& config)
+    : UnidirectionalAStar<ExpansionType::forward>(config),
+      min_distance_(config.get<float>("overlay_astar.min_distance", kDefaultOverlayMinDistance)) {
+}
+
+void OverlayAStar::Clear() {
+  UnidirectionalAStar<ExpansionType::forward>::Clear();
+  regular_cells_.clear();
+  tile_cells_.clear();
+  overlay_hops_.clear();
+}
+
+bool OverlayAStar::CanRoute(const valhalla::Location& origin,
+                            const valhalla::Location& destination,
+                            const Options& options) {
+  // The clique weights do not depend on time and the search finds a single path
+  metric_.reset();
+  if (!metrics_ || !origin.date_time().empty() || !destination.date_time().empty() ||
+      options.date_time_type() != Options::no_time || options.alternates() > 0) {
+    return false;
+  }
+  midgard::PointLL ll1(origin.ll().lng(), origin.ll().lat());
+  midgard::PointLL ll2(destination.ll().lng(), destination.ll().lat());
+  // Without hierarchy pruning the regular search uses all levels everywhere, the cells only have
+  // the highway level. The exclude_locations and exclude_polygons of a request end up as excluded
+  // edges of its costing, they are not worth customizing a metric for a single request
+  auto costing = options.costings().find(options.costing_type());
+  if (ll1.Distance(ll2) < min_distance_ || costing == options.costings().end() ||
+      costing->second.options().disable_hierarchy_pruning() ||
+      costing->second.options().exclude_edges_size() > 0) {
+    return false;
+  }
+  metric_ = metrics_->get(costing->second);
+  return metric_ != nullptr;
+}
+
+uint32_t OverlayAStar::GetCell(const GraphId& node) {
+  auto cell = tile_cells_.emplace(node.tile_value(), kRegularCell);
+  if (cell.second) {
+    auto cell_tile = GraphOverlay::cell_tile(node);
+    if (!regular_cells_.count(cell_tile.value)) {
+      // Cells with complex restrictions across their boundary are always expanded edge by edge
+      const auto& overlay = metric_->overlay();
+      auto index = overlay.cell_index(cell_tile);
+      if (index == GraphOverlay::kInvalidIndex || !overlay.cells()[index].restricted) {
+        cell.first->second = index;
+      }
+    }
+  }
+  return cell.first->second;
+}
+
+std::vector<std::vector<PathInfo>> OverlayAStar::GetBestPath(valhalla::Location& origin,
+                                                             valhalla::Location& destination,
+                                                             GraphReader& graphreader,
+                                                             const sif::mode_costing_t& mode_costing,
+                                                             const sif::TravelMode mode,
+                                                             const Options& /*options*/) {
+  // Set the mode and costing
+  mode_ = mode;
+  costing_ = mode_costing[static_cast<uint32_t>(mode_)];
+  travel_type_ = costing_->travel_type();
+  access_mode_ = costing_->access_mode();
+
+  midgard::PointLL origin_new(origin.correlation().edges(0).ll().lng(),
+                              origin.correlation().edges(0).ll().lat());
+  midgard::PointLL destination_new(destination.correlation().edges(0).ll().lng(),
+                                   destination.correlation().edges(0).ll().lat());
+  Init(origin_new, destination_new);
+  float mindist = astarheuristic_.GetDistance(origin_new);
+
+  auto time_info = TimeInfo::make(origin, graphreader, &tz_cache_);
+
+  // The cells of the candidate edges are expanded edge by edge, so the partial edges at the
+  // locations never need to be part of a clique
+  for (const auto* location : {&origin, &destination}) {
+    for (const auto& edge : location->correlation().edges()) {
+      GraphId edgeid(edge.graph_id());
+      regular_cells_.insert(GraphOverlay::cell_tile(edgeid).value);
+      if (auto tile = graphreader.GetGraphTile(edgeid)) {
+        regular_cells_.insert(GraphOverlay::cell_tile(tile->directededge(edgeid)->endnode()).value);
+      }
+    }
+  }
+
+  uint32_t density = SetDestination(graphreader, destination);
+  SetOrigin(graphreader, origin, destination, time_info);
+  ModifyHierarchyLimits(mindist, density);
+
+  // The lower levels are expanded within some distance of the locations, the cells there are
+  // expanded edge by edge too so that the hops only stand in for the highway level. Limits beyond
+  // the distance between the locations leave no cells to hop over anyway
+  float lower_levels_distance = 0.0f;
+  const size_t levels = std::min<size_t>(hierarchy_limits_.size(), TileHierarchy::levels().size());
+  for (size_t level = 1; level < levels; ++level) {
+    lower_levels_distance =
+        std::max(lower_levels_distance, hierarchy_limits_[level].expand_within_dist());
+  }
+  lower_levels_distance = std::min(lower_levels_distance, mindist);
+  const auto cell_level = TileHierarchy::levels().front().level;
+  for (const auto* location : {&origin, &destination}) {
+    midgard::PointLL ll(location->ll().lng(), location->ll().lat());
+    for (const auto& cell_tile :
+         TileHierarchy::GetGraphIds(midgard::ExpandMeters(ll, lower_levels_distance), cell_level)) {
+      regular_cells_.insert(cell_tile.value);
+    }
+  }
+
+  uint32_t nc = 0;
+  std::pair<int32_t, float> best_path = std::make_pair(-1, 0.0f);
+  size_t n = 0;
+  while (true) {
+    if (interrupt && (++n % kInterruptIterationsInterval) == 0) {
+      (*interrupt)();
+    }
+
+    const uint32_t predindex = adjacencylist_.pop();
+    if (predindex == kInvalidLabel) {
+      LOG_ERROR("Route failed after iterations = " + std::to_string(edgelabels_.size()));
+      return {};
+    }
+
+    BDEdgeLabel pred = edgelabels_[predindex];
+    if (pred.destination()) {
+      return {FormOverlayPath(graphreader, predindex)};
+    }
+
+    if (!pred.origin()) {
+      edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
+    }
+
+    float dist2dest = pred.distance();
+    if (dist2dest < mindist) {
+      mindist = dist2dest;
+      nc = 0;
+    } else if (nc++ > kMaxIterationsWithoutConvergence) {
+      if (best_path.first >= 0) {
+        return {FormOverlayPath(graphreader, best_path.first)};
+      }
+      LOG_ERROR("No convergence to destination after = " + std::to_string(edgelabels_.size()));
+      return {};
+    }
+
+    if (StopExpanding(hierarchy_limits_[pred.endnode().level()], dist2dest)) {
+      continue;
+    }
+
+    // Away from the locations only entries of a cell lead anywhere, through its clique
+    const uint32_t cell = GetCell(pred.endnode());
+    if (cell != kRegularCell) {
+      if (cell != GraphOverlay::kInvalidIndex) {
+        ExpandOverlay(graphreader, pred, predindex, cell);
+      }
+      continue;
+    }
+
+    Expand(graphreader, pred.endnode(), pred, predindex, nullptr, time_info, destination, best_path);
+  }
+  return {}; // Should never get here
+}
+
+void OverlayAStar::ExpandOverlay(GraphReader& graphreader,
+                                 const BDEdgeLabel& pred,
+                                 const uint32_t pred_idx,
+                                 const uint32_t cell) {
+  // Labels arriving on lower levels or on shortcuts are not entries and end here
+  const auto entry = metric_->overlay().entry_index(cell, pred.edgeid());
+  if (entry == GraphOverlay::kInvalidIndex) {
+    return;
+  }
+
+  const auto& exits = metric_->overlay().cells()[cell].exits;
+  const auto* weight = metric_->weights(cell, entry);
+  for (uint32_t i = 0; i < exits.size(); ++i, ++weight) {
+    if (!weight->reachable()) {
+      continue;
+    }
+    const GraphId& edgeid = exits[i];
+    auto tile = graphreader.GetGraphTile(edgeid);
+    if (!tile) {
+      continue;
+    }
+    EdgeStatusInfo* edge_status = edgestatus_.GetPtr(edgeid, tile);
+    if (edge_status->set() == EdgeSet::kPermanent) {
+      continue;
+    }
+
+    Cost cost = pred.cost() + weight->cost;
+    uint32_t path_distance = pred.path_distance() + weight->length;
+    if (edge_status->set() == EdgeSet::kTemporary) {
+      auto& lab = edgelabels_[edge_status->index()];
+      if (cost.cost < lab.cost().cost) {
+        float newsortcost = lab.sortcost() - (lab.cost().cost - cost.cost);
+        adjacencylist_.decrease(edge_status->index(), newsortcost);
+        lab.Update(pred_idx, cost, newsortcost, Cost{}, path_distance, kInvalidRestriction);
+        overlay_hops_[edge_status->index()] = pred_idx;
+      }
+      continue;
+    }
+
+    const DirectedEdge* edge = tile->directededge(edgeid);
+    auto endtile = graphreader.GetGraphTile(edge->endnode());
+    if (!endtile) {
+      continue;
+    }
+    float dist = 0.0f;
+    float sortcost = cost.cost + astarheuristic_.Get(endtile->get_node_ll(edge->endnode()), dist);
+
+    uint32_t idx = edgelabels_.size();
+    edgelabels_.emplace_back(pred_idx, edgeid, GraphId(), edge, cost, sortcost, dist, mode_, Cost{},
+                             pred.not_thru_pruning() || !edge->not_thru(),
+                             pred.closure_pruning() || !costing_->IsClosed(edge, tile), false,
+                             InternalTurn::kNoTurn, kInvalidRestriction, 0,
+                             edge->destonly() || (costing_->is_hgv() && edge->destonly_hgv()),
+                             edge->forwardaccess() & kTruckAccess);
+    edgelabels_.back().Update(pred_idx, cost, sortcost, Cost{}, path_distance, kInvalidRestriction);
+    adjacencylist_.add(idx);
+    *edge_status = {EdgeSet::kTemporary, idx};
+    overlay_hops_[idx] = pred_idx;
+  }
+}
+
+std::vector<PathInfo> OverlayAStar::FormOverlayPath(GraphReader& graphreader, const uint32_t dest) {
+  LOG_DEBUG("path_cost::" + std::to_string(edgelabels_[dest].cost().cost));
+  LOG_DEBUG("path_iterations::" + std::to_string(edgelabels_.size()));
+
+  // Work backwards from the destination
+  std::vector<PathInfo> path;
+  for (auto edgelabel_index = dest; edgelabel_index != kInvalidLabel;
+       edgelabel_index = edgelabels_[edgelabel_index].predecessor()) {
+    const auto& edgelabel = edgelabels_[edgelabel_index];
+    path.emplace_back(edgelabel.mode(), edgelabel.cost(), edgelabel.edgeid(), 0,
+                      edgelabel.path_distance(), edgelabel.restriction_idx(),
+                      edgelabel.transition_cost());
+    has_ferry_ = has_ferry_ || edgelabel.use() == Use::kFerry;
+
+    // A label improved by the regular expansion after its hop keeps a stale entry
+    auto hop = overlay_hops_.find(edgelabel_index);
+    if (hop == overlay_hops_.end() || hop->second != edgelabel.predecessor()) {
+      continue;
+    }
+
+    // Unpack the hop by searching the cell again, this time up to this exit only
+    const auto& pred = edgelabels_[edgelabel.predecessor()];
+    const auto& cell = metric_->overlay().cells()[GetCell(pred.endnode())];
+    cell_search_.Run(graphreader, *costing_, cell, pred.edgeid(), edgelabel.edgeid());
+    auto cell_path = cell_search_.path(edgelabel.edgeid());
+    if (cell_path.empty()) {
+      throw std::logic_error("Could not unpack the overlay path through cell " +
+                             std::to_string(cell.tile_id));
+    }
+
+    // The exit is already on the path, add the edges before it
+    path.back().transition_cost = cell_path.back()->transition_cost();
+    for (auto label = std::next(cell_path.rbegin()); label != cell_path.rend(); ++label) {
+      path.emplace_back((*label)->mode(), pred.cost() + (*label)->cost(), (*label)->edgeid(), 0,
+                        pred.path_distance() + (*label)->path_distance(),
+                        (*label)->restriction_idx(), (*label)->transition_cost());
+      has_ferry_ = has_ferry_ || (*label)->use() == Use::kFerry;
+    }
+  }
+
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -1,9 +1,9 @@
-#include "loki/reach.h"
+#include "thor/reach.h"
 
 using namespace valhalla::baldr;
 
 namespace valhalla {
-namespace loki {
+namespace thor {
 
 Reach::Reach() : Dijkstras() {
   // Mock up the Location struct with the important stuff missing
@@ -243,5 +243,5 @@ void Reach::Clear() {
   Dijkstras::Clear();
 }
 
-} // namespace loki
+} // namespace thor
 } // namespace valhalla
@@ -232,6 +232,7 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
            &multi_modal_astar,
            &timedep_forward,
            &timedep_reverse,
+           &overlay_astar,
            &bidir_astar,
            &bss_astar,
        }) {
@@ -284,6 +285,11 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
     }
   }
 
+  // Long routes with the options the overlay was customized for can hop over its cells
+  if (overlay_astar.CanRoute(origin, destination, options)) {
+    return &overlay_astar;
+  }
+
   // No other special cases we land on bidirectional a*
   return &bidir_astar;
 }
@@ -305,6 +311,11 @@ std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(PathAlgorithm*
   cost->set_pass(0);
   auto paths = path_algorithm->GetBestPath(origin, destination, *reader, mode_costing, mode, options);
 
+  // Relaxing the limits does not help the overlay, path_depart_at falls back to bidirectional A*
+  if (paths.empty() && path_algorithm == &overlay_astar) {
+    return paths;
+  }
+
   // Check if we should run a second pass pedestrian route with different A*
   // (to look for better routes where a ferry is taken)
   // TODO(nils): how would a second pass find a better route, if it changes nothing ferry-related?
@@ -596,10 +607,7 @@ void thor_worker_t::path_depart_at(Api& api, const std::string& costing) {
   bool add_hierarchy_limits_warning = false;
 
   graph_tile_ptr tile = nullptr;
-  auto route_two_locations = [&, this](auto& origin, auto& destination) -> bool {
-    // Get the algorithm type for this location pair
-    thor::PathAlgorithm* path_algorithm =
-        this->get_path_algorithm(costing, *origin, *destination, options);
+  auto use_algorithm = [&, this](thor::PathAlgorithm* path_algorithm) {
     path_algorithm->Clear();
     algorithms.push_back(path_algorithm->name());
     LOG_INFO(std::string("algorithm::") + path_algorithm->name());
@@ -622,6 +630,13 @@ void thor_worker_t::path_depart_at(Api& api, const std::string& costing) {
     // ..and mark hierarchy limits for this algorithm as checked
     is_bidir ? (used_bidir = true) : (used_unidir = true);
     mode_costing[static_cast<uint32_t>(mode)]->SetHierarchyLimits(hierarchy_limits);
+  };
+
+  auto route_two_locations = [&, this](auto& origin, auto& destination) -> bool {
+    // Get the algorithm type for this location pair
+    thor::PathAlgorithm* path_algorithm =
+        this->get_path_algorithm(costing, *origin, *destination, options);
+    use_algorithm(path_algorithm);
 
     // If we are continuing through a location we need to make sure we
     // only allow the edge that was used previously (avoid u-turns)
@@ -631,6 +646,16 @@ void thor_worker_t::path_depart_at(Api& api, const std::string& costing) {
     }
     // Get best path and keep it
     auto temp_paths = this->get_path(path_algorithm, *origin, *destination, costing, options);
+
+    // The overlay only knows the highway level between the cells around the locations, if that
+    // is not enough the route is left to the algorithm it would have used without the overlay
+    if (temp_paths.empty() && path_algorithm == &overlay_astar) {
+      LOG_WARN("Overlay route failed, retrying with " + std::string(bidir_astar.name()));
+      algorithms.pop_back();
+      path_algorithm = &bidir_astar;
+      use_algorithm(path_algorithm);
+      temp_paths = this->get_path(path_algorithm, *origin, *destination, costing, options);
+    }
     if (temp_paths.empty())
       return false;
 
@@ -1991,6 +1991,8 @@ void TripLegBuilder::Build(
 
     uint32_t begin_index = is_first_edge ? 0 : trip_shape.size() - 1;
     auto edgeinfo = graphtile->edgeinfo(directededge);
+    auto decoded_shape = graphreader.GetDecodedShape(graphtile, directededge);
+    const auto& shape = decoded_shape ? decoded_shape->shape : edgeinfo.shape();
     std::pair<std::vector<std::pair<float, float>>, uint32_t> levels = edgeinfo.levels();
     // Add edge to the trip node and set its attributes
     TripLeg_Edge* trip_edge =
@@ -2009,7 +2011,7 @@ void TripLegBuilder::Build(
     if (!edge_trimming.empty() &&
         (trimming = edge_trimming.find(edge_index)) != edge_trimming.end()) {
       // Get edge shape and reverse it if directed edge is not forward.
-      auto edge_shape = edgeinfo.shape();
+      auto edge_shape = shape;
       if (!directededge->forward()) {
         std::reverse(edge_shape.begin(), edge_shape.end());
       }
@@ -2056,7 +2058,7 @@ void TripLegBuilder::Build(
     } // We need to clip the shape if its at the beginning or end
     else if (is_first_edge || is_last_edge) {
       // Get edge shape and reverse it if directed edge is not forward.
-      auto edge_shape = edgeinfo.shape();
+      auto edge_shape = shape;
       if (!directededge->forward()) {
         std::reverse(edge_shape.begin(), edge_shape.end());
       }
@@ -2076,9 +2078,9 @@ void TripLegBuilder::Build(
     } // Just get the shape in there in the right direction no clipping needed
     else {
       if (directededge->forward()) {
-        trip_shape.insert(trip_shape.end(), edgeinfo.shape().begin() + 1, edgeinfo.shape().end());
+        trip_shape.insert(trip_shape.end(), shape.begin() + 1, shape.end());
       } else {
-        trip_shape.insert(trip_shape.end(), edgeinfo.shape().rbegin() + 1, edgeinfo.shape().rend());
+        trip_shape.insert(trip_shape.end(), shape.rbegin() + 1, shape.rend());
       }
     }
 
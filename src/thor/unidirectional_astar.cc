@@ -21,6 +21,7 @@ UnidirectionalAStar<expansion_direction, FORWARD>::UnidirectionalAStar(
                                          kInitialEdgeLabelCountAstar),
                     config.get<bool>("clear_reserved_memory", false)),
       mode_(travel_mode_t::kDrive), travel_type_(0), access_mode_(kAutoAccess) {
+  adjacencylist_.set_adaptive(config.get<bool>("unidirectional_astar.adaptive_queue", false));
 }
 
 // Default constructor
@@ -44,7 +45,7 @@ void UnidirectionalAStar<expansion_direction, FORWARD>::Clear() {
   edgelabels_.clear();
   destinations_.clear();
   adjacencylist_.clear();
-  edgestatus_.clear();
+  edgestatus_.clear(clear_reserved_memory_);
 
   // Set the ferry flag to false
   has_ferry_ = false;
@@ -857,5 +858,30 @@ UnidirectionalAStar<expansion_direction, FORWARD>::SetDestination(GraphReader& g
   return density;
 }
 
+// The forward search is extended by OverlayAStar which needs its building blocks
+template void
+UnidirectionalAStar<ExpansionType::forward>::Init(const midgard::PointLL& origll,
+                                                  const midgard::PointLL& destll);
+template bool
+UnidirectionalAStar<ExpansionType::forward>::Expand(GraphReader& graphreader,
+                                                    const GraphId& node,
+                                                    BDEdgeLabel& pred,
+                                                    const uint32_t pred_idx,
+                                                    const DirectedEdge* opp_pred_edge,
+                                                    const TimeInfo& time_info,
+                                                    const valhalla::Location& destination,
+                                                    std::pair<int32_t, float>& best_path);
+template void
+UnidirectionalAStar<ExpansionType::forward>::ModifyHierarchyLimits(const float dist,
+                                                                   const uint32_t density);
+template void
+UnidirectionalAStar<ExpansionType::forward>::SetOrigin(GraphReader& graphreader,
+                                                       const valhalla::Location& origin,
+                                                       const valhalla::Location& destination,
+                                                       const TimeInfo& time_info);
+template uint32_t
+UnidirectionalAStar<ExpansionType::forward>::SetDestination(GraphReader& graphreader,
+                                                            const valhalla::Location& dest);
+
 } // namespace thor
 } // namespace valhalla
@@ -10,6 +10,7 @@
 #include <functional>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <unordered_map>
 
 using namespace valhalla;
@@ -66,7 +67,8 @@ thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
     : service_worker_t(config), mode(valhalla::sif::TravelMode::kPedestrian),
       bidir_astar(config.get_child("thor")), bss_astar(config.get_child("thor")),
       multi_modal_astar(config.get_child("thor")), timedep_forward(config.get_child("thor")),
-      timedep_reverse(config.get_child("thor")), costmatrix_(config.get_child("thor")),
+      timedep_reverse(config.get_child("thor")), overlay_astar(config.get_child("thor")),
+      costmatrix_(config.get_child("thor")), bucketmatrix_(config.get_child("thor")),
       time_distance_matrix_(config.get_child("thor")),
       time_distance_bss_matrix_(config.get_child("thor")), isochrone_gen(config.get_child("thor")),
       reader(graph_reader ? graph_reader
@@ -83,9 +85,9 @@ thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
         kv.first == "max_radius" || kv.first == "max_timedep_distance" ||
         kv.first == "max_timedep_distance_matrix" || kv.first == "max_alternates" ||
         kv.first == "max_exclude_polygons_length" || kv.first == "skadi" || kv.first == "trace" ||
-        kv.first == "isochrone" || kv.first == "centroid" || kv.first == "status" ||
-        kv.first == "max_distance_disable_hierarchy_culling" || kv.first == "allow_hard_exclusions" ||
-        kv.first == "hierarchy_limits") {
+        kv.first == "isochrone" || kv.first == "centroid" || kv.first == "batch_route" ||
+        kv.first == "status" || kv.first == "max_distance_disable_hierarchy_culling" ||
+        kv.first == "allow_hard_exclusions" || kv.first == "hierarchy_limits") {
       continue;
     }
 
@@ -97,12 +99,27 @@ thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
     source_to_target_algorithm = TIME_DISTANCE_MATRIX;
   } else if (conf_algorithm == "costmatrix") {
     source_to_target_algorithm = COST_MATRIX;
+  } else if (conf_algorithm == "bucketmatrix") {
+    source_to_target_algorithm = BUCKET_MATRIX;
   } else {
     source_to_target_algorithm = SELECT_OPTIMAL;
   }
 
   costmatrix_allow_second_pass = config.get<bool>("thor.costmatrix.allow_second_pass", false);
 
+  // the cost matrix can expand its sources and targets on more threads than this one
+  auto costmatrix_concurrency = config.get<uint32_t>("thor.costmatrix.concurrency", 1);
+  if (costmatrix_concurrency == 0) {
+    costmatrix_concurrency = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (uint32_t i = 1; i < costmatrix_concurrency; ++i) {
+    costmatrix_readers.emplace_back(std::make_shared<baldr::GraphReader>(config.get_child("mjolnir")));
+  }
+  costmatrix_.set_thread_readers(costmatrix_readers);
+  if (source_to_target_algorithm == BUCKET_MATRIX) {
+    bucketmatrix_.set_thread_readers(costmatrix_readers);
+  }
+
   max_timedep_distance =
       config.get<float>("service_limits.max_timedep_distance", kDefaultMaxTimeDependentDistance);
 
@@ -113,6 +130,23 @@ thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
   hierarchy_limits_config_bidirectional_astar =
       parse_hierarchy_limits_from_config(config, "bidirectional_astar", true);
 
+  // long routes can hop over the overlay when one was built and customized for their costing
+  auto overlay_file = config.get<std::string>("mjolnir.overlay", "");
+  if (!overlay_file.empty() && std::filesystem::exists(overlay_file)) {
+    overlay_astar.set_metrics(get_overlay_metric_cache(config));
+  }
+
+  // the extra workers of a batch route only ever route on their own thread
+  batch_concurrency = config.get<uint32_t>("thor.batch_route.concurrency", 1);
+  if (batch_concurrency == 0) {
+    batch_concurrency = std::max(1u, std::thread::hardware_concurrency());
+  }
+  if (batch_concurrency > 1) {
+    batch_config = config;
+    batch_config.put("thor.batch_route.concurrency", 1);
+    batch_config.put("thor.costmatrix.concurrency", 1);
+  }
+
   // signal that the worker started successfully
   started();
 }
@@ -161,6 +195,11 @@ thor_worker_t::work(const std::list<zmq::message_t>& job,
         result.messages.emplace_back(serialize_to_pbf(request));
         break;
       }
+      case Options::batch_route: {
+        batch_route(request);
+        result.messages.emplace_back(serialize_to_pbf(request));
+        break;
+      }
       case Options::trace_route: {
         trace_route(request);
         result.messages.emplace_back(serialize_to_pbf(request));
@@ -195,6 +234,7 @@ thor_worker_t::work(const std::list<zmq::message_t>& job,
   }
 
   // keep track of the metrics if the request is going back to the client
+  record_shape_cache_stats(request, *reader);
   if (!result.intermediate)
     enqueue_statistics(request);
 
@@ -320,18 +360,28 @@ void thor_worker_t::cleanup() {
   bidir_astar.Clear();
   timedep_forward.Clear();
   timedep_reverse.Clear();
+  overlay_astar.Clear();
   multi_modal_astar.Clear();
   bss_astar.Clear();
   trace.clear();
   costmatrix_.Clear();
+  bucketmatrix_.Clear();
   time_distance_matrix_.Clear();
   time_distance_bss_matrix_.Clear();
   isochrone_gen.Clear();
   centroid_gen.Clear();
   matcher_factory.ClearFullCache();
+  for (auto& worker : batch_workers) {
+    worker->cleanup();
+  }
   if (reader->OverCommitted()) {
     reader->Trim();
   }
+  for (auto& costmatrix_reader : costmatrix_readers) {
+    if (costmatrix_reader->OverCommitted()) {
+      costmatrix_reader->Trim();
+    }
+  }
 }
 
 void thor_worker_t::set_interrupt(const std::function<void()>* interrupt_function) {
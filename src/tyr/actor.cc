@@ -32,10 +32,114 @@ struct actor_t::pimpl_t {
     thor_worker.cleanup();
     odin_worker.cleanup();
   }
+  // runs the stages of the action of a parsed request, remembering which one is running
+  std::string dispatch(Api& api) {
+    stage = stage_t::loki;
+    switch (api.options().action()) {
+      case Options::route:
+        // check the request and locate the locations in the graph
+        loki_worker.route(api);
+        // route between the locations in the graph to find the best path
+        stage = stage_t::thor;
+        thor_worker.route(api);
+        // get some directions back from them and serialize
+        stage = stage_t::odin;
+        return odin_worker.narrate(api);
+      case Options::locate:
+        // check the request and locate the locations in the graph
+        return loki_worker.locate(api);
+      case Options::sources_to_targets:
+        // check the request and locate the locations in the graph
+        loki_worker.matrix(api);
+        // compute the matrix
+        stage = stage_t::thor;
+        return thor_worker.matrix(api);
+      case Options::optimized_route:
+        // check the request and locate the locations in the graph
+        loki_worker.matrix(api);
+        // compute compute all pairs and then the shortest path through them all
+        stage = stage_t::thor;
+        thor_worker.optimized_route(api);
+        // get some directions back from them and serialize
+        stage = stage_t::odin;
+        return odin_worker.narrate(api);
+      case Options::isochrone:
+        // check the request and locate the locations in the graph
+        loki_worker.isochrones(api);
+        // compute the isochrones
+        stage = stage_t::thor;
+        return thor_worker.isochrones(api);
+      case Options::trace_route:
+        // check the request and locate the locations in the graph
+        loki_worker.trace(api);
+        // route between the locations in the graph to find the best path
+        stage = stage_t::thor;
+        thor_worker.trace_route(api);
+        // get some directions back from them
+        stage = stage_t::odin;
+        return odin_worker.narrate(api);
+      case Options::trace_attributes:
+        // check the request and locate the locations in the graph
+        loki_worker.trace(api);
+        // get the path and turn it into attribution along it
+        stage = stage_t::thor;
+        return thor_worker.trace_attributes(api);
+      case Options::height:
+        // get the height at each point
+        return loki_worker.height(api);
+      case Options::transit_available:
+        // check the request and locate the locations in the graph
+        return loki_worker.transit_available(api);
+      case Options::expansion:
+        // check the request and locate the locations in the graph
+        if (api.options().expansion_action() == Options::route) {
+          loki_worker.route(api);
+        } else if (api.options().expansion_action() == Options::isochrone) {
+          loki_worker.isochrones(api);
+        } else {
+          loki_worker.matrix(api);
+        }
+        // route between the locations in the graph to find the best path
+        stage = stage_t::thor;
+        return thor_worker.expansion(api);
+      case Options::centroid:
+        // check the request and locate the locations in the graph
+        loki_worker.route(api);
+        // route between the locations in the graph to find the best path
+        stage = stage_t::thor;
+        thor_worker.centroid(api);
+        // get some directions back from them and serialize
+        stage = stage_t::odin;
+        return odin_worker.narrate(api);
+      case Options::status:
+        // check lokis status
+        loki_worker.status(api);
+        // check thors status
+        stage = stage_t::thor;
+        thor_worker.status(api);
+        // check odins status
+        stage = stage_t::odin;
+        odin_worker.status(api);
+        // get the json
+        return tyr::serializeStatus(api);
+      case Options::batch_route:
+        // check the request and locate all the sources and targets in the graph at once
+        loki_worker.batch_route(api);
+        // route between each source and its target
+        stage = stage_t::thor;
+        thor_worker.batch_route(api);
+        // get some directions back from them and serialize
+        stage = stage_t::odin;
+        return odin_worker.narrate(api);
+      default:
+        throw valhalla_exception_t{106};
+    }
+  }
   std::shared_ptr<baldr::GraphReader> reader;
   loki::loki_worker_t loki_worker;
   thor::thor_worker_t thor_worker;
   odin_worker_t odin_worker;
+  stage_t stage = stage_t::loki;
 };
 
 actor_t::actor_t(const boost::property_tree::ptree& config, bool auto_cleanup)
@@ -80,15 +184,31 @@ std::string actor_t::act(Api& api, const std::function<void()>* interrupt) {
       return centroid("", interrupt, &api);
     case Options::status:
       return status("", interrupt, &api);
+    case Options::batch_route:
+      return batch_route("", interrupt, &api);
     default:
       throw valhalla_exception_t{106};
   }
 }
 
-std::string
-actor_t::route(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
+std::string actor_t::dispatch(Api& api, const std::function<void()>* interrupt) {
   // set the interrupts
   pimpl->set_interrupts(interrupt);
+  // run every stage of the action
+  auto bytes = pimpl->dispatch(api);
+  // if they want you do to do the cleanup automatically
+  if (auto_cleanup) {
+    cleanup();
+  }
+  return bytes;
+}
+
+actor_t::stage_t actor_t::stage() const {
+  return pimpl->stage;
+}
+
+std::string
+actor_t::route(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
   // if the caller doesn't want a copy we'll use this dummy
   Api dummy;
   if (!api) {
@@ -96,23 +216,12 @@ actor_t::route(const std::string& request_str, const std::function<void()>* inte
   }
   // parse the request
   ParseApi(request_str, Options::route, *api);
-  // check the request and locate the locations in the graph
-  pimpl->loki_worker.route(*api);
-  // route between the locations in the graph to find the best path
-  pimpl->thor_worker.route(*api);
-  // get some directions back from them and serialize
-  auto bytes = pimpl->odin_worker.narrate(*api);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
-  return bytes;
+  // and run all of its stages
+  return dispatch(*api, interrupt);
 }
 
 std::string
 actor_t::locate(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // if the caller doesn't want a copy we'll use this dummy
   Api dummy;
   if (!api) {
@@ -120,19 +229,12 @@ actor_t::locate(const std::string& request_str, const std::function<void()>* int
   }
   // parse the request
   ParseApi(request_str, Options::locate, *api);
-  // check the request and locate the locations in the graph
-  auto json = pimpl->loki_worker.locate(*api);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
-  return json;
+  // and run all of its stages
+  return dispatch(*api, interrupt);
 }
 
 std::string
 actor_t::matrix(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // if the caller doesn't want a copy we'll use this dummy
   Api dummy;
   if (!api) {
@@ -140,22 +242,13 @@ actor_t::matrix(const std::string& request_str, const std::function<void()>* int
   }
   // parse the request
   ParseApi(request_str, Options::sources_to_targets, *api);
-  // check the request and locate the locations in the graph
-  pimpl->loki_worker.matrix(*api);
-  // compute the matrix
-  auto bytes = pimpl->thor_worker.matrix(*api);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
-  return bytes;
+  // and run all of its stages
+  return dispatch(*api, interrupt);
 }
 
 std::string actor_t::optimized_route(const std::string& request_str,
                                      const std::function<void()>* interrupt,
                                      Api* api) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // if the caller doesn't want a copy we'll use this dummy
   Api dummy;
   if (!api) {
@@ -163,23 +256,12 @@ std::string actor_t::optimized_route(const std::string& request_str,
   }
   // parse the request
   ParseApi(request_str, Options::optimized_route, *api);
-  // check the request and locate the locations in the graph
-  pimpl->loki_worker.matrix(*api);
-  // compute compute all pairs and then the shortest path through them all
-  pimpl->thor_worker.optimized_route(*api);
-  // get some directions back from them and serialize
-  auto bytes = pimpl->odin_worker.narrate(*api);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
-  return bytes;
+  // and run all of its stages
+  return dispatch(*api, interrupt);
 }
 
 std::string
 actor_t::isochrone(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // if the caller doesn't want a copy we'll use this dummy
   Api dummy;
   if (!api) {
@@ -187,22 +269,13 @@ actor_t::isochrone(const std::string& request_str, const std::function<void()>*
   }
   // parse the request
   ParseApi(request_str, Options::isochrone, *api);
-  // check the request and locate the locations in the graph
-  pimpl->loki_worker.isochrones(*api);
-  // compute the isochrones
-  auto json = pimpl->thor_worker.isochrones(*api);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
-  return json;
+  // and run all of its stages
+  return dispatch(*api, interrupt);
 }
 
 std::string actor_t::trace_route(const std::string& request_str,
                                  const std::function<void()>* interrupt,
                                  Api* api) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // if the caller doesn't want a copy we'll use this dummy
   Api dummy;
   if (!api) {
@@ -210,24 +283,13 @@ std::string actor_t::trace_route(const std::string& request_str,
   }
   // parse the request
   ParseApi(request_str, Options::trace_route, *api);
-  // check the request and locate the locations in the graph
-  pimpl->loki_worker.trace(*api);
-  // route between the locations in the graph to find the best path
-  pimpl->thor_worker.trace_route(*api);
-  // get some directions back from them
-  auto bytes = pimpl->odin_worker.narrate(*api);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
-  return bytes;
+  // and run all of its stages
+  return dispatch(*api, interrupt);
 }
 
 std::string actor_t::trace_attributes(const std::string& request_str,
                                       const std::function<void()>* interrupt,
                                       Api* api) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // if the caller doesn't want a copy we'll use this dummy
   Api dummy;
   if (!api) {
@@ -235,21 +297,12 @@ std::string actor_t::trace_attributes(const std::string& request_str,
   }
   // parse the request
   ParseApi(request_str, Options::trace_attributes, *api);
-  // check the request and locate the locations in the graph
-  pimpl->loki_worker.trace(*api);
-  // get the path and turn it into attribution along it
-  auto json = pimpl->thor_worker.trace_attributes(*api);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
-  return json;
+  // and run all of its stages
+  return dispatch(*api, interrupt);
 }
 
 std::string
 actor_t::height(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // if the caller doesn't want a copy we'll use this dummy
   Api dummy;
   if (!api) {
@@ -257,20 +310,13 @@ actor_t::height(const std::string& request_str, const std::function<void()>* int
   }
   // parse the request
   ParseApi(request_str, Options::height, *api);
-  // get the height at each point
-  auto json = pimpl->loki_worker.height(*api);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
-  return json;
+  // and run all of its stages
+  return dispatch(*api, interrupt);
 }
 
 std::string actor_t::transit_available(const std::string& request_str,
                                        const std::function<void()>* interrupt,
                                        Api* api) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // if the caller doesn't want a copy we'll use this dummy
   Api dummy;
   if (!api) {
@@ -278,19 +324,12 @@ std::string actor_t::transit_available(const std::string& request_str,
   }
   // parse the request
   ParseApi(request_str, Options::transit_available, *api);
-  // check the request and locate the locations in the graph
-  auto json = pimpl->loki_worker.transit_available(*api);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
-  return json;
+  // and run all of its stages
+  return dispatch(*api, interrupt);
 }
 
 std::string
 actor_t::expansion(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // if the caller doesn't want a copy we'll use this dummy
   Api dummy;
   if (!api) {
@@ -298,27 +337,12 @@ actor_t::expansion(const std::string& request_str, const std::function<void()>*
   }
   // parse the request
   ParseApi(request_str, Options::expansion, *api);
-  // check the request and locate the locations in the graph
-  if (api->options().expansion_action() == Options::route) {
-    pimpl->loki_worker.route(*api);
-  } else if (api->options().expansion_action() == Options::isochrone) {
-    pimpl->loki_worker.isochrones(*api);
-  } else {
-    pimpl->loki_worker.matrix(*api);
-  }
-  // route between the locations in the graph to find the best path
-  auto json = pimpl->thor_worker.expansion(*api);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
-  return json;
+  // and run all of its stages
+  return dispatch(*api, interrupt);
 }
 
 std::string
 actor_t::centroid(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // if the caller doesn't want a copy we'll use this dummy
   Api dummy;
   if (!api) {
@@ -326,23 +350,26 @@ actor_t::centroid(const std::string& request_str, const std::function<void()>* i
   }
   // parse the request
   ParseApi(request_str, Options::centroid, *api);
-  // check the request and locate the locations in the graph
-  pimpl->loki_worker.route(*api);
-  // route between the locations in the graph to find the best path
-  pimpl->thor_worker.centroid(*api);
-  // get some directions back from them and serialize
-  auto bytes = pimpl->odin_worker.narrate(*api);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
+  // and run all of its stages
+  return dispatch(*api, interrupt);
+}
+
+std::string actor_t::batch_route(const std::string& request_str,
+                                 const std::function<void()>* interrupt,
+                                 Api* api) {
+  // if the caller doesn't want a copy we'll use this dummy
+  Api dummy;
+  if (!api) {
+    api = &dummy;
   }
-  return bytes;
+  // parse the request
+  ParseApi(request_str, Options::batch_route, *api);
+  // and run all of its stages
+  return dispatch(*api, interrupt);
 }
 
 std::string
 actor_t::status(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
-  // set the interrupts
-  pimpl->set_interrupts(interrupt);
   // if the caller doesn't want a copy we'll use this dummy
   Api dummy;
   if (!api) {
@@ -350,19 +377,8 @@ actor_t::status(const std::string& request_str, const std::function<void()>* int
   }
   // parse the request
   ParseApi(request_str, Options::status, *api);
-  // check lokis status
-  pimpl->loki_worker.status(*api);
-  // check thors status
-  pimpl->thor_worker.status(*api);
-  // check odins status
-  pimpl->odin_worker.status(*api);
-  // get the json
-  auto json = tyr::serializeStatus(*api);
-  // if they want you do to do the cleanup automatically
-  if (auto_cleanup) {
-    cleanup();
-  }
-  return json;
+  // and run all of its stages
+  return dispatch(*api, interrupt);
 }
 
 } // namespace tyr
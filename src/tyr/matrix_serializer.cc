@@ -47,7 +47,8 @@ void serialize_shape(const valhalla::Matrix& matrix,
                      const size_t td_count,
                      const ShapeFormat shape_format) {
   // TODO(nils): shapes aren't implemented yet in TDMatrix
-  if (shape_format == no_shape || (matrix.algorithm() != Matrix::CostMatrix))
+  if (shape_format == no_shape ||
+      (matrix.algorithm() != Matrix::CostMatrix && matrix.algorithm() != Matrix::BucketMatrix))
     return;
 
   for (size_t i = start_td; i < start_td + td_count; ++i) {
@@ -258,7 +259,8 @@ std::string serialize(const Api& request, double distance_scale) {
     writer.end_array();
 
     if (!(options.shape_format() == no_shape ||
-          (request.matrix().algorithm() != Matrix::CostMatrix))) {
+          (request.matrix().algorithm() != Matrix::CostMatrix &&
+           request.matrix().algorithm() != Matrix::BucketMatrix))) {
       writer.start_array("shapes");
       for (int source_index = 0; source_index < options.sources_size(); ++source_index) {
         const auto first_td = source_index * options.targets_size();
@@ -0,0 +1,138 @@
+#include "tyr/pipeline_worker.h"
+#include "midgard/logging.h"
+#include "proto_conversions.h"
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <functional>
+#include <string>
+
+using namespace valhalla;
+
+namespace {
+
+// codes of the unknown errors of each stage
+constexpr unsigned kLokiUnknownError = 199;
+constexpr unsigned kOdinUnknownError = 299;
+constexpr unsigned kThorUnknownError = 499;
+
+} // namespace
+
+namespace valhalla {
+namespace tyr {
+
+pipeline_worker_t::pipeline_worker_t(const boost::property_tree::ptree& config,
+                                     const std::shared_ptr<baldr::GraphReader>& graph_reader)
+    : service_worker_t(config),
+      reader(graph_reader ? graph_reader
+                          : std::make_shared<baldr::GraphReader>(config.get_child("mjolnir"))),
+      actor(config, *reader) {
+  // Loki decides which actions are served, keep it that way
+  Options::Action action;
+  for (const auto& kv : config.get_child("loki.actions")) {
+    auto path = kv.second.get_value<std::string>();
+    if (!Options_Action_Enum_Parse(path, &action)) {
+      throw std::runtime_error("Action not supported " + path);
+    }
+    actions.insert(action);
+    action_str.append("'/" + path + "' ");
+  }
+  if (action_str.empty()) {
+    throw std::runtime_error("The config actions for Loki are incorrectly loaded");
+  }
+
+  // signal that the worker started successfully
+  started();
+}
+
+pipeline_worker_t::~pipeline_worker_t() {
+}
+
+void pipeline_worker_t::cleanup() {
+  actor.cleanup();
+}
+
+std::string pipeline_worker_t::act(Api& request) {
+  if (actions.find(request.options().action()) == actions.cend()) {
+    throw valhalla_exception_t{106, action_str};
+  }
+
+  // the same stages the workers of the proxy topology would run, in the same order
+  return actor.dispatch(request, interrupt);
+}
+
+unsigned pipeline_worker_t::unknown_error_code() const {
+  switch (actor.stage()) {
+    case actor_t::stage_t::loki:
+      return kLokiUnknownError;
+    case actor_t::stage_t::thor:
+      return kThorUnknownError;
+    case actor_t::stage_t::odin:
+      return kOdinUnknownError;
+  }
+  return kLokiUnknownError;
+}
+
+#ifdef ENABLE_SERVICES
+prime_server::worker_t::result_t
+pipeline_worker_t::work(const std::list<zmq::message_t>& job,
+                        void* request_info,
+                        const std::function<void()>& interrupt_function) {
+  // grab the request info and make sure to record any metrics before we are done
+  auto& info = *static_cast<prime_server::http_request_info_t*>(request_info);
+  LOG_INFO("Got Pipeline Request " + std::to_string(info.id));
+  Api request;
+  prime_server::worker_t::result_t result{false, {}, {}};
+  try {
+    // request parsing
+    auto http_request =
+        prime_server::http_request_t::from_string(static_cast<const char*>(job.front().data()),
+                                                  job.front().size());
+    ParseApi(http_request, request);
+
+    // Set the interrupt function
+    set_interrupt(&interrupt_function);
+
+    // every stage runs right here
+    result = to_response(act(request), info, request);
+  } catch (const valhalla_exception_t& e) {
+    LOG_WARN("400::" + std::string(e.what()) + " request_id=" + std::to_string(info.id));
+    result = serialize_error(e, info, request);
+  } catch (const std::exception& e) {
+    LOG_ERROR("500::" + std::string(e.what()) + " request_id=" + std::to_string(info.id));
+    result = serialize_error({unknown_error_code(), std::string(e.what())}, info, request);
+  }
+
+  // the request always goes back to the client from here
+  record_shape_cache_stats(request, *reader);
+  enqueue_statistics(request);
+
+  return result;
+}
+
+void run_service(const boost::property_tree::ptree& config) {
+  // gracefully shutdown when asked via SIGTERM
+  prime_server::quiesce(config.get<unsigned int>("httpd.service.drain_seconds", 28),
+                        config.get<unsigned int>("httpd.service.shutting_seconds", 1));
+
+  // gets requests from the http server
+  auto upstream_endpoint = config.get<std::string>("loki.service.proxy") + "_out";
+  // returns the responses back to the server
+  auto loopback_endpoint = config.get<std::string>("httpd.service.loopback");
+  auto interrupt_endpoint = config.get<std::string>("httpd.service.interrupt");
+
+  // listen for requests
+  zmq::context_t context;
+  pipeline_worker_t pipeline_worker(config);
+  prime_server::worker_t worker(context, upstream_endpoint, "ipc:///dev/null", loopback_endpoint,
+                                interrupt_endpoint,
+                                std::bind(&pipeline_worker_t::work, std::ref(pipeline_worker),
+                                          std::placeholders::_1, std::placeholders::_2,
+                                          std::placeholders::_3),
+                                std::bind(&pipeline_worker_t::cleanup, std::ref(pipeline_worker)));
+  worker.work();
+}
+#endif
+
+} // namespace tyr
+} // namespace valhalla
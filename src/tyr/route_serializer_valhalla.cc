@@ -675,38 +675,82 @@ void legs(valhalla::Api& api, int route_index, rapidjson::writer_wrapper_t& writ
   writer.end_array(); // legs
 }
 
-std::string serialize(Api& api) {
-  // build up the json object, reserve 4k bytes
+void trip(valhalla::Api& api,
+          int route_index,
+          bool with_warnings,
+          rapidjson::writer_wrapper_t& writer) {
+  writer.start_object("trip");
+
+  // the locations in the trip
+  locations(api, route_index, writer);
+
+  // the actual meat of the route
+  legs(api, route_index, writer);
+
+  // openlr references of the edges in the route
+  valhalla::tyr::openlr(api, route_index, writer);
+
+  // summary time/distance and other stats
+  summary(api, route_index, writer);
+
+  // get serialized warnings
+  if (with_warnings && api.info().warnings_size() >= 1) {
+    valhalla::tyr::serializeWarnings(api, writer);
+  }
+
+  writer.end_object(); // trip
+}
+
+// a batch has one route per pair of source and target, in their order, or why there was none
+std::string serialize_batch(Api& api) {
   rapidjson::writer_wrapper_t writer(4096);
+  writer.start_object();
 
-  // for each route
+  writer.start_array("routes");
   for (int i = 0; i < api.directions().routes_size(); ++i) {
-    if (i == 1) {
-      writer.start_array("alternates");
+    const auto& route = api.trip().routes(i);
+    writer.start_object();
+    if (route.error_code()) {
+      writer("error_code", route.error_code());
+      writer("error", route.error());
+    } else {
+      trip(api, i, false, writer);
     }
+    writer.end_object();
+  }
+  writer.end_array(); // routes
 
-    // the route itself
-    writer.start_object();
-    writer.start_object("trip");
+  // the warnings of all pairs only once
+  if (api.info().warnings_size() >= 1) {
+    valhalla::tyr::serializeWarnings(api, writer);
+  }
 
-    // the locations in the trip
-    locations(api, i, writer);
+  if (api.options().has_id_case()) {
+    writer("id", api.options().id());
+  }
 
-    // the actual meat of the route
-    legs(api, i, writer);
+  writer.end_object(); // outer object
 
-    // openlr references of the edges in the route
-    valhalla::tyr::openlr(api, i, writer);
+  return writer.get_buffer();
+}
+
+std::string serialize(Api& api) {
+  if (api.options().action() == Options::batch_route) {
+    return serialize_batch(api);
+  }
 
-    // summary time/distance and other stats
-    summary(api, i, writer);
+  // build up the json object, reserve 4k bytes
+  rapidjson::writer_wrapper_t writer(4096);
 
-    // get serialized warnings
-    if (api.info().warnings_size() >= 1) {
-      valhalla::tyr::serializeWarnings(api, writer);
+  // for each route
+  for (int i = 0; i < api.directions().routes_size(); ++i) {
+    if (i == 1) {
+      writer.start_array("alternates");
     }
 
-    writer.end_object(); // trip
+    // the route itself
+    writer.start_object();
+    trip(api, i, true, writer);
 
     // leave space for alternates by closing this one outside the loop
     if (i > 0) {
@@ -6,6 +6,7 @@
 
 #include <cxxopts.hpp>
 
+#include <chrono>
 #include <cstdint>
 #include <filesystem>
 #include <iostream>
@@ -104,6 +105,76 @@ int Benchmark(const uint32_t n, const float maxcost, const float bucketsize) {
   return 0;
 }
 
+// One push or pop of a recorded expansion
+struct operation_t {
+  float cost; // cost of the pushed label, negative for a pop
+};
+
+/**
+ * Records the queue operations of a graph expansion-like search: every settled label pushes a
+ * number of labels whose costs are the settled cost plus a random edge cost. An exact priority
+ * queue drives the recording so the trace does not depend on the queue being benchmarked.
+ */
+std::vector<operation_t>
+RecordExpansion(const uint32_t settle_count, const uint32_t fanout, const float max_edge_cost) {
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> dis(1.f, max_edge_cost);
+  std::priority_queue<float, std::vector<float>, std::greater<float>> pqueue;
+  std::vector<operation_t> trace;
+  trace.reserve(settle_count * (fanout + 1));
+
+  pqueue.push(0.f);
+  trace.push_back({0.f});
+  for (uint32_t i = 0; i < settle_count && !pqueue.empty(); ++i) {
+    float cost = pqueue.top();
+    pqueue.pop();
+    trace.push_back({-1.f});
+    for (uint32_t j = 0; j < fanout; ++j) {
+      float newcost = std::floor(cost + dis(gen));
+      pqueue.push(newcost);
+      trace.push_back({newcost});
+    }
+  }
+  return trace;
+}
+
+/**
+ * Replays a recorded expansion against a double bucket queue and logs the push/pop throughput.
+ * Returns the sum of the popped costs so fixed and adaptive queues can be compared.
+ */
+double ReplayExpansion(const std::string& name,
+                       const std::vector<operation_t>& trace,
+                       const float range,
+                       const uint32_t bucketsize,
+                       const bool adaptive) {
+  std::vector<EdgeLabel> edgelabels;
+  edgelabels.reserve(trace.size());
+  DoubleBucketQueue<EdgeLabel> adjlist;
+  adjlist.set_adaptive(adaptive);
+  adjlist.reuse(0, range, bucketsize, &edgelabels);
+
+  double checksum = 0.;
+  auto start = std::chrono::steady_clock::now();
+  for (const auto& op : trace) {
+    if (op.cost < 0.f) {
+      uint32_t idx = adjlist.pop();
+      checksum += edgelabels[idx].sortcost();
+    } else {
+      EdgeLabel el;
+      el.SetSortCost(op.cost);
+      adjlist.add(edgelabels.size());
+      edgelabels.push_back(std::move(el));
+    }
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  LOG_INFO(name + ": replayed " + std::to_string(trace.size()) + " operations in " +
+           std::to_string(elapsed / 1000) + " ms, " +
+           std::to_string(elapsed * 1000.0 / trace.size()) + " ns/op");
+  return checksum;
+}
+
 int main(int argc, char* argv[]) {
   const auto program = std::filesystem::path(__FILE__).stem().string();
   // args
@@ -135,6 +206,18 @@ int main(int argc, char* argv[]) {
 
   // Benchmark with count, maxcost, and bucketsize
   Benchmark(1000000, 50000, 1);
+
+  // Compare fixed and adaptive bucket ranges on an expansion whose costs outgrow the range
+  auto trace = RecordExpansion(1000000, 4, 500);
+  for (float range : {1000.f, 10000.f, 100000.f}) {
+    auto fixed = ReplayExpansion("Fixed range " + std::to_string(static_cast<int>(range)), trace,
+                                 range, 1, false);
+    auto adaptive = ReplayExpansion("Adaptive range " + std::to_string(static_cast<int>(range)),
+                                    trace, range, 1, true);
+    if (fixed != adaptive) {
+      LOG_WARN("Fixed and adaptive queues popped different costs");
+    }
+  }
   LOG_INFO("Done Benchmark!");
 
   return EXIT_SUCCESS;
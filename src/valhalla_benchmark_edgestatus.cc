@@ -0,0 +1,252 @@
+#include "argparse_utils.h"
+#include "baldr/graphreader.h"
+#include "midgard/logging.h"
+#include "midgard/pointll.h"
+#include "thor/edgestatus.h"
+
+#include <boost/property_tree/ptree.hpp>
+#include <cxxopts.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace valhalla::midgard;
+using namespace valhalla::baldr;
+using namespace valhalla::thor;
+
+namespace {
+
+/**
+ * The hash map based edge status that EdgeStatus used to be, kept as the baseline
+ */
+class MapEdgeStatus {
+public:
+  ~MapEdgeStatus() {
+    clear();
+  }
+  void clear() {
+    for (auto& iter : edgestatus_) {
+      delete[] iter.second;
+    }
+    edgestatus_.clear();
+  }
+  void Set(const GraphId& edgeid, const EdgeSet set, const uint32_t index, const graph_tile_ptr& tile) {
+    GetPtr(edgeid, tile)[0] = {set, index};
+  }
+  void Update(const GraphId& edgeid, const EdgeSet set) {
+    edgestatus_.find(edgeid.tile_value())->second[edgeid.id()].set_ = static_cast<uint32_t>(set);
+  }
+  EdgeStatusInfo Get(const GraphId& edgeid) const {
+    const auto p = edgestatus_.find(edgeid.tile_value());
+    return (p == edgestatus_.end()) ? EdgeStatusInfo() : p->second[edgeid.id()];
+  }
+  EdgeStatusInfo* GetPtr(const GraphId& edgeid, const graph_tile_ptr& tile) {
+    auto p = edgestatus_.find(edgeid.tile_value());
+    if (p == edgestatus_.end()) {
+      p = edgestatus_
+              .emplace(edgeid.tile_value(), new EdgeStatusInfo[tile->header()->directededgecount()])
+              .first;
+    }
+    return &p->second[edgeid.id()];
+  }
+
+private:
+  std::unordered_map<uint32_t, EdgeStatusInfo*> edgestatus_;
+};
+
+// One edge status access recorded from an expansion
+struct operation_t {
+  enum Kind : uint8_t { kGetPtr, kSet, kUpdate, kGet };
+  GraphId edgeid;
+  uint32_t tile_index : 30;
+  uint32_t kind : 2;
+};
+
+struct trace_t {
+  std::vector<graph_tile_ptr> tiles;
+  std::vector<operation_t> operations;
+};
+
+/**
+ * Runs a plain Dijkstra over edge lengths on the graph level of the start point and records every
+ * edge status access the way the path algorithms do them: a pointer to the first edge status of an
+ * expanded node, a Get of the opposing edge, a Set when an edge is reached and an Update when it is
+ * settled.
+ */
+trace_t record_expansion(GraphReader& reader, const PointLL& start, size_t max_edges) {
+  trace_t trace;
+  std::unordered_map<uint32_t, uint32_t> tile_indices;
+  auto tile_index = [&](const graph_tile_ptr& tile) {
+    auto inserted = tile_indices.emplace(tile->id().tile_value(), trace.tiles.size());
+    if (inserted.second) {
+      trace.tiles.push_back(tile);
+    }
+    return inserted.first->second;
+  };
+
+  auto tile = reader.GetGraphTile(start, TileHierarchy::levels().back().level);
+  if (!tile || tile->header()->nodecount() == 0) {
+    throw std::runtime_error("No graph data at the start location");
+  }
+
+  using label_t = std::pair<float, GraphId>;
+  std::priority_queue<label_t, std::vector<label_t>, std::greater<label_t>> adjacency;
+  std::unordered_map<uint64_t, float> reached;
+  GraphId node = tile->header()->graphid();
+  adjacency.emplace(0.f, node);
+  size_t settled = 0;
+  while (!adjacency.empty() && settled < max_edges) {
+    auto label = adjacency.top();
+    adjacency.pop();
+    node = label.second;
+    if (!reader.GetGraphTile(node, tile)) {
+      continue;
+    }
+    const auto* nodeinfo = tile->node(node);
+    GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
+    trace.operations.push_back({edgeid, tile_index(tile), operation_t::kGetPtr});
+    for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++edgeid) {
+      const auto* edge = tile->directededge(edgeid);
+      if (edge->is_shortcut() || edge->IsTransitLine()) {
+        continue;
+      }
+      // the opposing edge is checked for a connection in bidirectional searches
+      auto opp_tile = tile;
+      auto opp_edgeid = reader.GetOpposingEdgeId(edgeid, opp_tile);
+      if (opp_edgeid.Is_Valid()) {
+        trace.operations.push_back({opp_edgeid, tile_index(opp_tile), operation_t::kGet});
+      }
+      float cost = label.first + edge->length();
+      auto found = reached.find(edgeid);
+      if (found == reached.end()) {
+        reached.emplace(edgeid, cost);
+        trace.operations.push_back({edgeid, tile_index(tile), operation_t::kSet});
+        adjacency.emplace(cost, edge->endnode());
+      }
+    }
+    trace.operations.push_back({GraphId(node.tileid(), node.level(), nodeinfo->edge_index()),
+                                tile_index(tile), operation_t::kUpdate});
+    ++settled;
+  }
+  return trace;
+}
+
+template <class edge_status_t> size_t replay(edge_status_t& edgestatus, const trace_t& trace) {
+  size_t checksum = 0;
+  uint32_t label = 0;
+  EdgeStatusInfo* es = nullptr;
+  for (const auto& op : trace.operations) {
+    const auto& tile = trace.tiles[op.tile_index];
+    switch (op.kind) {
+      case operation_t::kGetPtr:
+        es = edgestatus.GetPtr(op.edgeid, tile);
+        checksum += es->set() == EdgeSet::kPermanent;
+        break;
+      case operation_t::kSet:
+        edgestatus.Set(op.edgeid, EdgeSet::kTemporary, label++, tile);
+        break;
+      case operation_t::kUpdate:
+        // the node's first edge may never have been reached
+        if (edgestatus.Get(op.edgeid).set() != EdgeSet::kUnreachedOrReset) {
+          edgestatus.Update(op.edgeid, EdgeSet::kPermanent);
+        }
+        break;
+      case operation_t::kGet:
+        checksum += edgestatus.Get(op.edgeid).index();
+        break;
+    }
+  }
+  return checksum;
+}
+
+template <class edge_status_t>
+size_t benchmark(const std::string& name, const trace_t& trace, size_t rounds) {
+  edge_status_t edgestatus;
+  size_t checksum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < rounds; ++i) {
+    // like a worker answering one request after another
+    checksum = replay(edgestatus, trace);
+    edgestatus.clear();
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  LOG_INFO(name + ": " + std::to_string(rounds) + " rounds of " +
+           std::to_string(trace.operations.size()) + " operations in " +
+           std::to_string(elapsed / 1000) + " ms, " +
+           std::to_string(elapsed * 1000.0 / (rounds * trace.operations.size())) + " ns/op");
+  return checksum;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  const auto program = std::filesystem::path(__FILE__).stem().string();
+  // args
+  boost::property_tree::ptree config;
+  std::string location;
+  size_t max_edges, rounds;
+
+  try {
+    // clang-format off
+    cxxopts::Options options(
+      program,
+      program + " " + VALHALLA_PRINT_VERSION + "\n\n"
+      "a program which records the edge status accesses of a graph expansion from the\n"
+      "given location and replays them against the hash map based edge status that was\n"
+      "used before and the slab based EdgeStatus supplied with Valhalla.\n\n");
+
+    options.add_options()
+      ("h,help", "Print this help message.")
+      ("v,version", "Print the version of this software.")
+      ("c,config", "Path to the json configuration file.", cxxopts::value<std::string>())
+      ("l,location", "Start of the expansion as lon,lat", cxxopts::value<std::string>(location))
+      ("e,edges", "How many edges to settle in the expansion", cxxopts::value<size_t>(max_edges)->default_value("1000000"))
+      ("r,rounds", "How many times to replay the expansion", cxxopts::value<size_t>(rounds)->default_value("10"));
+    // clang-format on
+
+    auto result = options.parse(argc, argv);
+    if (!parse_common_args(program, options, result, &config, "mjolnir.logging"))
+      return EXIT_SUCCESS;
+
+    if (!result.count("location")) {
+      throw cxxopts::exceptions::exception("A start location is required\n\n" + options.help());
+    }
+  } catch (cxxopts::exceptions::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  auto comma = location.find(',');
+  if (comma == std::string::npos) {
+    std::cerr << "Location must be formatted as lon,lat" << std::endl;
+    return EXIT_FAILURE;
+  }
+  PointLL start(std::stod(location.substr(0, comma)), std::stod(location.substr(comma + 1)));
+
+  GraphReader reader(config.get_child("mjolnir"));
+  auto trace = record_expansion(reader, start, max_edges);
+  LOG_INFO("Recorded " + std::to_string(trace.operations.size()) + " operations on " +
+           std::to_string(trace.tiles.size()) + " tiles");
+
+  auto map_checksum = benchmark<MapEdgeStatus>("Hash map edge status", trace, rounds);
+  auto slab_checksum = benchmark<EdgeStatus>("Slab edge status", trace, rounds);
+  if (map_checksum != slab_checksum) {
+    LOG_ERROR("Edge status implementations disagree");
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("Done Benchmark!");
+
+  return EXIT_SUCCESS;
+}
@@ -3,6 +3,7 @@
 #include "loki/search.h"
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
+#include "midgard/util.h"
 #include "sif/costfactory.h"
 #include "worker.h"
 
@@ -14,6 +15,7 @@
 #include <filesystem>
 #include <fstream>
 #include <future>
+#include <limits>
 #include <list>
 #include <set>
 #include <string>
@@ -120,11 +122,77 @@ void work(const boost::property_tree::ptree& config, std::promise<results_t>& pr
   promise.set_value(std::move(results));
 }
 
+// times projecting the locations onto the shapes they are searched against, once one segment at a
+// time and once with all of the segments of a shape at once, the way loki and meili do it
+void benchmark_projection(const boost::property_tree::ptree& config) {
+  valhalla::baldr::GraphReader reader(config.get_child("mjolnir"));
+  std::chrono::nanoseconds segment_time(0), shape_time(0);
+  size_t locations = 0, shapes = 0;
+  double checksum = 0;
+  for (const auto& job : jobs) {
+    for (const auto& location : job) {
+      // the shapes of all of the edges of the local tile the location is in
+      auto tile = reader.GetGraphTile(location.latlng_);
+      if (!tile) {
+        continue;
+      }
+      std::vector<std::vector<valhalla::midgard::PointLL>> edge_shapes;
+      for (const auto& edge : tile->GetDirectedEdges()) {
+        if (edge.forward()) {
+          edge_shapes.emplace_back(tile->edgeinfo(&edge).shape());
+        }
+      }
+      valhalla::midgard::projector_t project(location.latlng_);
+
+      // one segment at a time
+      auto start = std::chrono::high_resolution_clock::now();
+      for (const auto& shape : edge_shapes) {
+        double best = std::numeric_limits<double>::max();
+        for (size_t i = 0; i + 1 < shape.size(); ++i) {
+          best = std::min(best, project.approx.DistanceSquared(project(shape[i], shape[i + 1])));
+        }
+        checksum += best;
+      }
+      auto end = std::chrono::high_resolution_clock::now();
+      segment_time += end - start;
+
+      // all of the segments at once
+      start = std::chrono::high_resolution_clock::now();
+      for (const auto& shape : edge_shapes) {
+        valhalla::midgard::PointLL point;
+        double best;
+        project(shape, point, best);
+        checksum -= best;
+      }
+      end = std::chrono::high_resolution_clock::now();
+      shape_time += end - start;
+
+      ++locations;
+      shapes += edge_shapes.size();
+    }
+  }
+
+  LOG_INFO("Projection Onto Edge Shapes");
+  LOG_INFO("--------------------------------");
+  if (locations) {
+    LOG_INFO("Locations: " + std::to_string(locations) + " Shapes: " + std::to_string(shapes));
+    LOG_INFO("One segment at a time: " + std::to_string(segment_time.count() / locations) +
+             "ns per location");
+    LOG_INFO("All segments at once: " + std::to_string(shape_time.count() / locations) +
+             "ns per location");
+    // keeps the work from being optimized away, both ways find the same distances
+    LOG_INFO("Difference: " + std::to_string(checksum));
+  } else {
+    LOG_INFO("No results");
+  }
+  LOG_INFO("--------------------------------\n\n");
+}
+
 int main(int argc, char** argv) {
   const auto program = std::filesystem::path(__FILE__).stem().string();
   // args
   size_t batch, isolated, radius;
-  bool extrema = false;
+  bool extrema = false, projection = false;
   std::vector<std::string> input_files;
   boost::property_tree::ptree config;
 
@@ -148,6 +216,7 @@ int main(int argc, char** argv) {
       ("i,reach", "How many edges need to be reachable before considering it as connected to the larger network", cxxopts::value<size_t>(isolated)->default_value("50"))
       ("r,radius", "How many meters to search away from the input location", cxxopts::value<size_t>(radius)->default_value("0"))
       ("costing", "Which costing model to use.", cxxopts::value<std::string>(costing_str)->default_value("auto"))
+      ("p,projection", "Also time projecting the locations onto the edge shapes of their tiles, one segment at a time and all segments at once", cxxopts::value<bool>(projection)->default_value("false"))
       ("input_files", "positional arguments", cxxopts::value<std::vector<std::string>>(input_files));
     // clang-format on
 
@@ -310,5 +379,9 @@ int main(int argc, char** argv) {
     LOG_INFO("--------------------------------\n\n");
   }
 
+  if (projection) {
+    benchmark_projection(config);
+  }
+
   return EXIT_SUCCESS;
 }
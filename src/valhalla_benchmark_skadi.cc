@@ -24,6 +24,20 @@ void get_samples(valhalla::skadi::sample& sample,
            " no data values");
 }
 
+std::vector<std::string> split(const std::string& list) {
+  std::vector<std::string> items;
+  std::istringstream iss(list);
+  std::string item;
+  while (std::getline(iss, item, ',')) {
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+// the data sources (elevation directories or stores) and thread counts can be comma separated
+// lists, each data source is sampled with each thread count from a cold start so they compare
 int main(int argc, char** argv) {
 
   // check args
@@ -33,21 +47,17 @@ int main(int argc, char** argv) {
   if (argc < 3) {
     throw std::runtime_error("No coordinate postings provided");
   }
-  size_t thread_count;
+  std::vector<size_t> thread_counts;
   if (argc > 3) {
-    thread_count = std::stoul(argv[3]);
+    for (const auto& thread_count : split(argv[3])) {
+      thread_counts.push_back(std::max<size_t>(std::stoul(thread_count), 1));
+    }
   } else {
-    thread_count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    thread_counts.push_back(std::max<size_t>(std::thread::hardware_concurrency(), 1));
   }
 
-  LOG_INFO("Loading elevation data");
-  valhalla::skadi::sample sample(argv[1]);
-
   LOG_INFO("Loading coordinate postings");
-  std::vector<std::vector<std::pair<double, double>>> postings;
-  postings.resize(thread_count);
-
-  size_t posting_count = 0;
+  std::vector<std::pair<double, double>> all_postings;
   std::ifstream file(argv[2]);
   std::string line;
   while (std::getline(file, line)) {
@@ -56,23 +66,34 @@ int main(int argc, char** argv) {
     if (!(iss >> lat >> lon)) {
       continue; // error
     }
-
-    postings[posting_count % thread_count].emplace_back(lat, lon);
-    posting_count++;
+    all_postings.emplace_back(lat, lon);
   }
 
-  // run the threads
-  auto start = std::chrono::system_clock::now();
-  std::list<std::thread> threads;
-  size_t id = 0;
-  for (const auto& p : postings) {
-    threads.emplace_back(get_samples, std::ref(sample), std::cref(p), id++);
-  }
-  for (auto& t : threads) {
-    t.join();
+  for (const auto& data_source : split(argv[1])) {
+    for (const auto thread_count : thread_counts) {
+      LOG_INFO("Loading elevation data from " + data_source);
+      valhalla::skadi::sample sample(data_source);
+
+      std::vector<std::vector<std::pair<double, double>>> postings(thread_count);
+      for (size_t i = 0; i < all_postings.size(); ++i) {
+        postings[i % thread_count].push_back(all_postings[i]);
+      }
+
+      // run the threads
+      auto start = std::chrono::system_clock::now();
+      std::list<std::thread> threads;
+      size_t id = 0;
+      for (const auto& p : postings) {
+        threads.emplace_back(get_samples, std::ref(sample), std::cref(p), id++);
+      }
+      for (auto& t : threads) {
+        t.join();
+      }
+      std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
+      LOG_INFO(data_source + " with " + std::to_string(thread_count) + " threads: " +
+               std::to_string(all_postings.size() / elapsed.count()) + " postings per second");
+    }
   }
-  std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
-  LOG_INFO(std::to_string(posting_count / elapsed.count()) + " postings per second");
 
   return EXIT_SUCCESS;
 }
@@ -7,6 +7,7 @@
 #include "odin/directionsbuilder.h"
 #include "odin/util.h"
 #include "sif/costfactory.h"
+#include "thor/bucketmatrix.h"
 #include "thor/costmatrix.h"
 #include "thor/optimizer.h"
 #include "thor/timedistancematrix.h"
@@ -15,11 +16,13 @@
 #include <boost/property_tree/ptree.hpp>
 #include <cxxopts.hpp>
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
 #include <filesystem>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -92,6 +95,7 @@ int main(int argc, char* argv[]) {
   uint32_t iterations;
   bool log_details;
   bool optimize;
+  std::vector<uint32_t> thread_counts;
   boost::property_tree::ptree config;
 
   try {
@@ -116,6 +120,7 @@ int main(int argc, char* argv[]) {
       ("m,multi-run", "Generate the route N additional times before exiting.", cxxopts::value<uint32_t>()->default_value("1"))
       ("l,log-details", "Logs details about the solution", cxxopts::value<bool>()->default_value("false"))
       ("o,optimize", "Run optimization", cxxopts::value<bool>()->default_value("false"))
+      ("t,threads", "Also time CostMatrix on each of these numbers of threads to see how it scales, e.g. 2,4,8", cxxopts::value<std::vector<uint32_t>>())
       ("c,config", "Valhalla configuration file", cxxopts::value<std::string>())
       ("i,inline-config", "Inline JSON config", cxxopts::value<std::string>());
     // clang-format on
@@ -133,6 +138,9 @@ int main(int argc, char* argv[]) {
     iterations = result["multi-run"].as<uint32_t>();
     log_details = result["log-details"].as<bool>();
     optimize = result["optimize"].as<bool>();
+    if (result.count("threads")) {
+      thread_counts = result["threads"].as<std::vector<uint32_t>>();
+    }
   } catch (cxxopts::exceptions::exception& e) {
     std::cerr << e.what() << std::endl;
     return EXIT_FAILURE;
@@ -172,13 +180,13 @@ int main(int argc, char* argv[]) {
   std::unordered_map<std::string, float> max_matrix_distance;
   for (const auto& kv : config.get_child("service_limits")) {
     // Skip over any service limits that are not for a costing method
-    if (kv.first == "allow_hard_exclusions" || kv.first == "centroid" ||
-        kv.first == "hierarchy_limits" || kv.first == "isochrone" || kv.first == "max_alternates" ||
-        kv.first == "max_distance_disable_hierarchy_culling" || kv.first == "max_exclude_locations" ||
-        kv.first == "max_exclude_polygons_length" || kv.first == "max_radius" ||
-        kv.first == "max_reachability" || kv.first == "max_timedep_distance" ||
-        kv.first == "max_timedep_distance_matrix" || kv.first == "skadi" || kv.first == "status" ||
-        kv.first == "trace") {
+    if (kv.first == "allow_hard_exclusions" || kv.first == "batch_route" ||
+        kv.first == "centroid" || kv.first == "hierarchy_limits" || kv.first == "isochrone" ||
+        kv.first == "max_alternates" || kv.first == "max_distance_disable_hierarchy_culling" ||
+        kv.first == "max_exclude_locations" || kv.first == "max_exclude_polygons_length" ||
+        kv.first == "max_radius" || kv.first == "max_reachability" ||
+        kv.first == "max_timedep_distance" || kv.first == "max_timedep_distance_matrix" ||
+        kv.first == "skadi" || kv.first == "status" || kv.first == "trace") {
       continue;
     }
     max_matrix_distance.emplace(kv.first, config.get<float>("service_limits." + kv.first +
@@ -233,8 +241,73 @@ int main(int argc, char* argv[]) {
   LOG_INFO("CostMatrix average time to compute: " + std::to_string(avg) + " sec");
   LogResults(optimize, options, request.matrix(), log_details);
 
+  // Scaling of CostMatrix with more threads, which must not change the results
+  const valhalla::Matrix serial_matrix = request.matrix();
+  for (const auto threads : thread_counts) {
+    CostMatrix parallel_matrix(config.get_child("thor"));
+    std::vector<std::shared_ptr<GraphReader>> readers;
+    for (uint32_t i = 1; i < threads; ++i) {
+      readers.emplace_back(std::make_shared<GraphReader>(config.get_child("mjolnir")));
+    }
+    parallel_matrix.set_thread_readers(readers);
+    t0 = std::chrono::high_resolution_clock::now();
+    for (uint32_t n = 0; n < iterations; n++) {
+      request.clear_matrix();
+      parallel_matrix.SourceToTarget(request, reader, mode_costing, mode, max_distance);
+      parallel_matrix.Clear();
+    }
+    t1 = std::chrono::high_resolution_clock::now();
+    ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+    float parallel_avg = (static_cast<float>(ms) / static_cast<float>(iterations)) * 0.001f;
+    LOG_INFO("CostMatrix average time to compute on " + std::to_string(threads) +
+             " threads: " + std::to_string(parallel_avg) + " sec, speedup " +
+             std::to_string(parallel_avg > 0.f ? avg / parallel_avg : 0.f));
+
+    const auto& parallel_result = request.matrix();
+    if (!std::equal(serial_matrix.times().begin(), serial_matrix.times().end(),
+                    parallel_result.times().begin(), parallel_result.times().end()) ||
+        !std::equal(serial_matrix.distances().begin(), serial_matrix.distances().end(),
+                    parallel_result.distances().begin(), parallel_result.distances().end())) {
+      LOG_ERROR("CostMatrix on " + std::to_string(threads) + " threads differs from one thread");
+    }
+  }
+
+  // Run with BucketMatrix, on as many threads as the largest scaling run
+  BucketMatrix bucket_matrix(config.get_child("thor"));
+  const uint32_t bucket_threads =
+      thread_counts.empty() ? 1 : *std::max_element(thread_counts.begin(), thread_counts.end());
+  std::vector<std::shared_ptr<GraphReader>> bucket_readers;
+  for (uint32_t i = 1; i < bucket_threads; ++i) {
+    bucket_readers.emplace_back(std::make_shared<GraphReader>(config.get_child("mjolnir")));
+  }
+  bucket_matrix.set_thread_readers(bucket_readers);
+  t0 = std::chrono::high_resolution_clock::now();
+  for (uint32_t n = 0; n < iterations; n++) {
+    request.clear_matrix();
+    bucket_matrix.SourceToTarget(request, reader, mode_costing, mode, max_distance);
+    bucket_matrix.Clear();
+  }
+  t1 = std::chrono::high_resolution_clock::now();
+  ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+  float bucket_avg = (static_cast<float>(ms) / static_cast<float>(iterations)) * 0.001f;
+  LOG_INFO("BucketMatrix average time to compute on " + std::to_string(bucket_threads) +
+           " threads: " + std::to_string(bucket_avg) + " sec");
+
+  // the bucket searches stop at a fixed radius, so count how many of the CostMatrix paths they got
+  uint32_t found = 0, same = 0;
+  for (int i = 0; i < serial_matrix.times().size(); ++i) {
+    if (serial_matrix.distances(i) >= kMaxCost) {
+      continue;
+    }
+    ++found;
+    same += request.matrix().times(i) == serial_matrix.times(i);
+  }
+  LOG_INFO("BucketMatrix has the same time as CostMatrix for " + std::to_string(same) + " of " +
+           std::to_string(found) + " paths");
+
   // Run with TimeDistanceMatrix
   TimeDistanceMatrix tdm(config.get_child("thor"));
+  t0 = std::chrono::high_resolution_clock::now();
   for (uint32_t n = 0; n < iterations; n++) {
     request.clear_matrix();
     tdm.SourceToTarget(request, reader, mode_costing, mode, max_distance);
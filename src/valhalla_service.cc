@@ -20,6 +20,7 @@ using namespace prime_server;
 #include "odin/worker.h"
 #include "thor/worker.h"
 #include "tyr/actor.h"
+#include "tyr/pipeline_worker.h"
 
 int main(int argc, char** argv) {
   const auto program = std::filesystem::path(__FILE__).stem().string();
@@ -217,6 +218,19 @@ int main(int argc, char** argv) {
   std::thread loki_proxy_thread(
       std::bind(&proxy_t::forward, proxy_t(context, loki_proxy + "_in", loki_proxy + "_out")));
   loki_proxy_thread.detach();
+
+  // in pipeline mode every worker runs loki, thor and odin on a request by itself
+  if (config.get<bool>("httpd.service.pipeline", false)) {
+    LOG_INFO("Running loki, thor and odin in process on each worker");
+    std::list<std::thread> pipeline_worker_threads;
+    for (size_t i = 0; i < worker_concurrency; ++i) {
+      pipeline_worker_threads.emplace_back(valhalla::tyr::run_service, config);
+      pipeline_worker_threads.back().detach();
+    }
+    server_thread.join();
+    return 0;
+  }
+
   std::list<std::thread> loki_worker_threads;
   for (size_t i = 0; i < worker_concurrency; ++i) {
     loki_worker_threads.emplace_back(valhalla::loki::run_service, config);
@@ -1,6 +1,7 @@
 #include "loki/worker.h"
 #include "baldr/datetime.h"
 #include "baldr/graphconstants.h"
+#include "baldr/graphreader.h"
 #include "baldr/location.h"
 #include "baldr/rapidjson_utils.h"
 #include "midgard/encoded.h"
@@ -70,6 +71,7 @@ const std::unordered_map<unsigned, valhalla::valhalla_exception_t> error_codes{
     {126, {126, "No shape provided", 400, HTTP_400, OSRM_INVALID_OPTIONS, "shape_required"}},
     {127, {127, "Recostings require a valid costing parameter", 400, HTTP_400, OSRM_INVALID_OPTIONS, "recosting_parse_failed"}},
     {128, {128, "Recostings require a unique 'name' field for each recosting", 400, HTTP_400, OSRM_INVALID_OPTIONS, "no_recosting_duplicate_names"}},
+    {129, {129, "Batch routes require as many targets as sources", 400, HTTP_400, OSRM_INVALID_OPTIONS, "unpaired_sources_targets"}},
     {130, {130, "Failed to parse location", 400, HTTP_400, OSRM_INVALID_VALUE, "location_parse_failed"}},
     {131, {131, "Failed to parse source", 400, HTTP_400, OSRM_INVALID_VALUE, "source_parse_failed"}},
     {132, {132, "Failed to parse target", 400, HTTP_400, OSRM_INVALID_VALUE, "target_parse_failed"}},
@@ -222,7 +224,8 @@ bool add_date_to_locations(Options& options,
                            const std::string& node) {
   if (options.has_date_time_case() && !locations.empty()) {
     auto dt = options.date_time_type();
-    if (options.action() != Options::sources_to_targets) {
+    if (options.action() != Options::sources_to_targets &&
+        options.action() != Options::batch_route) {
       switch (dt) {
         case Options::current:
           locations.Mutable(0)->set_date_time("current");
@@ -1708,6 +1711,21 @@ midgard::Finally<std::function<void()>> service_worker_t::measure_scope_time(Api
   });
 }
 
+void service_worker_t::record_shape_cache_stats(Api& api, baldr::GraphReader& reader) const {
+  uint64_t hits, misses;
+  if (!reader.TakeShapeCacheStats(hits, misses) || (hits == 0 && misses == 0)) {
+    return;
+  }
+
+  const auto& action = Options_Action_Enum_Name(api.options().action());
+  for (const auto& counter : {std::make_pair("hits", hits), std::make_pair("misses", misses)}) {
+    auto* stat = api.mutable_info()->mutable_statistics()->Add();
+    stat->set_key(action + ".info." + service_name() + ".shape_cache." + counter.first);
+    stat->set_value(counter.second);
+    stat->set_type(count);
+  }
+}
+
 void service_worker_t::started() {
   if (statsd_client) {
     statsd_client->count("none.info." + service_name() + ".worker_started", 1, 1.f,
@@ -131,6 +131,7 @@ TEST(Actor, SupportedFormats) {
       {Options::expansion, &tyr::actor_t::expansion, options},
       {Options::centroid, &tyr::actor_t::centroid, options},
       {Options::status, &tyr::actor_t::status, options},
+      {Options::batch_route, &tyr::actor_t::batch_route, options},
   };
   ASSERT_EQ(std::size(tests), Options::Action_ARRAYSIZE - 1) // -1 for `Options::no_action`
       << "Please add missing action to this test";
@@ -0,0 +1,121 @@
+#include "baldr/rapidjson_utils.h"
+#include "tyr/actor.h"
+#include "test.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#if !defined(VALHALLA_SOURCE_DIR)
+#define VALHALLA_SOURCE_DIR
+#endif
+
+using namespace valhalla;
+
+namespace {
+
+// fake up config against pine grove traffic extract
+const auto conf = test::make_config(VALHALLA_SOURCE_DIR "test/traffic_matcher_tiles");
+
+const std::string a = R"({"lat":40.546115,"lon":-76.385076})";
+const std::string b = R"({"lat":40.544232,"lon":-76.385752})";
+const std::string c = R"({"lat":40.545331,"lon":-76.381613})";
+// no tiles out here so it cant be correlated
+const std::string nowhere = R"({"lat":40.3,"lon":-76.2})";
+
+rapidjson::Document parse(const std::string& json) {
+  rapidjson::Document doc;
+  doc.Parse(json);
+  EXPECT_FALSE(doc.HasParseError()) << json;
+  return doc;
+}
+
+std::string route(tyr::actor_t& actor, const std::string& from, const std::string& to) {
+  return actor.route(R"({"costing":"auto","locations":[)" + from + "," + to + "]}");
+}
+
+std::string batch(tyr::actor_t& actor,
+                  const std::vector<std::pair<std::string, std::string>>& pairs) {
+  std::string sources, targets;
+  for (const auto& pair : pairs) {
+    sources += (sources.empty() ? "" : ",") + pair.first;
+    targets += (targets.empty() ? "" : ",") + pair.second;
+  }
+  return actor.batch_route(R"({"costing":"auto","sources":[)" + sources + R"(],"targets":[)" +
+                           targets + "]}");
+}
+
+TEST(BatchRoute, SameAsRoutes) {
+  tyr::actor_t actor(conf, true);
+  const std::vector<std::pair<std::string, std::string>> pairs = {{a, b}, {b, c}, {c, a}};
+  auto response = parse(batch(actor, pairs));
+  ASSERT_TRUE(response.HasMember("routes"));
+  ASSERT_EQ(response["routes"].Size(), pairs.size());
+
+  for (size_t i = 0; i < pairs.size(); ++i) {
+    auto expected = parse(route(actor, pairs[i].first, pairs[i].second));
+    EXPECT_TRUE(response["routes"][i]["trip"] == expected["trip"]) << "pair " << i;
+  }
+}
+
+TEST(BatchRoute, Parallel) {
+  tyr::actor_t sequential(conf, true);
+  auto config = conf;
+  config.put("thor.batch_route.concurrency", 3);
+  tyr::actor_t parallel(config, true);
+
+  std::vector<std::pair<std::string, std::string>> pairs;
+  for (int i = 0; i < 10; ++i) {
+    pairs.emplace_back(i % 2 ? a : c, i % 3 ? b : a);
+  }
+  EXPECT_EQ(batch(parallel, pairs), batch(sequential, pairs));
+  // the extra workers are kept around for the next batch
+  EXPECT_EQ(batch(parallel, pairs), batch(sequential, pairs));
+}
+
+TEST(BatchRoute, FailedPair) {
+  tyr::actor_t actor(conf, true);
+  auto response = parse(batch(actor, {{a, b}, {a, nowhere}, {b, a}}));
+  ASSERT_EQ(response["routes"].Size(), 3u);
+  EXPECT_TRUE(response["routes"][0].HasMember("trip"));
+  EXPECT_FALSE(response["routes"][1].HasMember("trip"));
+  EXPECT_EQ(response["routes"][1]["error_code"].GetUint(), 171u);
+  EXPECT_TRUE(response["routes"][2].HasMember("trip"));
+}
+
+TEST(BatchRoute, Unpaired) {
+  tyr::actor_t actor(conf, true);
+  try {
+    actor.batch_route(R"({"costing":"auto","sources":[)" + a + "," + b + R"(],"targets":[)" + c +
+                      "]}");
+    FAIL() << "Expected the sources and targets to be rejected";
+  } catch (const valhalla_exception_t& e) { EXPECT_EQ(e.code, 129); }
+}
+
+TEST(BatchRoute, TooManyLocations) {
+  auto config = conf;
+  config.put("service_limits.batch_route.max_locations", 2);
+  tyr::actor_t actor(config, true);
+  try {
+    batch(actor, {{a, b}, {b, c}});
+    FAIL() << "Expected the batch to be too large";
+  } catch (const valhalla_exception_t& e) { EXPECT_EQ(e.code, 150); }
+}
+
+TEST(BatchRoute, DefaultLimits) {
+  // configs from before batch routes have no limits for them
+  auto config = conf;
+  config.get_child("service_limits").erase("batch_route");
+  tyr::actor_t actor(config, true);
+  auto response = parse(batch(actor, {{a, b}, {b, c}}));
+  ASSERT_EQ(response["routes"].Size(), 2u);
+  EXPECT_TRUE(response["routes"][0].HasMember("trip"));
+  EXPECT_TRUE(response["routes"][1].HasMember("trip"));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -209,6 +209,60 @@ TEST(DoubleBucketQueue, TestSimulation) {
   }
 }
 
+TEST(DoubleBucketQueue, TestAdaptiveSimulation) {
+  // ranges much too small for the costs so the overflow bucket gets emptied again and again
+  {
+    std::vector<simple_label> costs;
+    DoubleBucketQueue<simple_label> dbqueue(0, 10, 1, &costs);
+    dbqueue.set_adaptive(true);
+    TrySimulation(dbqueue, costs, 1000, 10, 1000);
+  }
+
+  // a range below the bucket size must keep ordering exactly
+  {
+    std::vector<simple_label> costs;
+    DoubleBucketQueue<simple_label> dbqueue(0, 1, 100000, &costs);
+    dbqueue.set_adaptive(true);
+    TrySimulation(dbqueue, costs, 333, 60, 100);
+  }
+
+  // the setting survives reuse and the range is reset to the configured one
+  {
+    std::vector<simple_label> costs;
+    DoubleBucketQueue<simple_label> dbqueue(0, 10, 1, &costs);
+    dbqueue.set_adaptive(true);
+    TrySimulation(dbqueue, costs, 500, 20, 5000);
+    costs.clear();
+    dbqueue.reuse(0, 10, 1, &costs);
+    TrySimulation(dbqueue, costs, 500, 20, 5000);
+  }
+}
+
+TEST(DoubleBucketQueue, TestAdaptiveAddRemove) {
+  std::vector<simple_label> edgelabels;
+  DoubleBucketQueue<simple_label> adjlist(0, 8, 1, &edgelabels);
+  adjlist.set_adaptive(true);
+
+  // everything but the first label lands in the overflow bucket
+  std::vector<uint32_t> costs = {3, 1000, 17, 250, 99, 5000, 42, 42, 100000, 64, 31, 7777};
+  for (uint32_t i = 0; i < costs.size(); ++i) {
+    edgelabels.emplace_back(simple_label{static_cast<float>(costs[i])});
+    adjlist.add(i);
+  }
+  // decrease a label while it is still in the overflow bucket
+  adjlist.decrease(5, 2);
+  edgelabels[5].c = 2;
+  costs[5] = 2;
+
+  std::sort(costs.begin(), costs.end());
+  for (auto expected : costs) {
+    const auto top = adjlist.pop();
+    ASSERT_NE(top, baldr::kInvalidLabel);
+    EXPECT_EQ(edgelabels[top].sortcost(), static_cast<float>(expected));
+  }
+  EXPECT_EQ(adjlist.pop(), baldr::kInvalidLabel);
+}
+
 // Test EdgeLabel size
 TEST(EdgeLabel, test_sizeof) {
   EXPECT_EQ(sizeof(EdgeLabel), kEdgeLabelExpectedSize);
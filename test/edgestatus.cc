@@ -4,6 +4,10 @@
 #include "config.h"
 #include "test.h"
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 using namespace std;
 using namespace valhalla::baldr;
 using namespace valhalla::thor;
@@ -65,6 +69,91 @@ TEST(EdgeStatus, TestStatus) {
   TryGet(edgestatus, GraphId(555, 3, 1), EdgeSet::kUnreachedOrReset);
 }
 
+TEST(EdgeStatus, ManyTilesAndPaths) {
+  EdgeStatus edgestatus;
+
+  GraphTileHeader header;
+  header.set_directededgecount(1000);
+  test_tile* tt = new test_tile;
+  tt->header_ = &header;
+  graph_tile_ptr tile{tt};
+
+  // enough tiles to grow the tile table and to need more than one slab
+  for (int pass = 0; pass < 2; ++pass) {
+    for (uint32_t tile_id = 0; tile_id < 500; ++tile_id) {
+      for (uint8_t path_id = 0; path_id < 3; ++path_id) {
+        GraphId edgeid(tile_id, 2, tile_id % 1000);
+        edgestatus.Set(edgeid, EdgeSet::kTemporary, tile_id + path_id, tile, path_id);
+      }
+    }
+    for (uint32_t tile_id = 0; tile_id < 500; tile_id += 2) {
+      edgestatus.Update(GraphId(tile_id, 2, tile_id % 1000), EdgeSet::kPermanent, 1);
+    }
+
+    for (uint32_t tile_id = 0; tile_id < 500; ++tile_id) {
+      GraphId edgeid(tile_id, 2, tile_id % 1000);
+      for (uint8_t path_id = 0; path_id < 3; ++path_id) {
+        auto status = edgestatus.Get(edgeid, path_id);
+        EXPECT_EQ(status.index(), tile_id + path_id);
+        EXPECT_EQ(status.set(), path_id == 1 && tile_id % 2 == 0 ? EdgeSet::kPermanent
+                                                                 : EdgeSet::kTemporary);
+      }
+      // pointers into the same tile array
+      EXPECT_EQ(edgestatus.GetPtr(edgeid, tile, 2) + 1,
+                edgestatus.GetPtr(GraphId(tile_id, 2, tile_id % 1000 + 1), tile, 2));
+      TryGet(edgestatus, GraphId(tile_id, 2, tile_id % 1000 + 1), EdgeSet::kUnreachedOrReset);
+      TryGet(edgestatus, GraphId(tile_id, 1, tile_id % 1000), EdgeSet::kUnreachedOrReset);
+    }
+
+    // the second pass reuses the slabs kept by clear
+    edgestatus.clear();
+    TryGet(edgestatus, GraphId(0, 2, 0), EdgeSet::kUnreachedOrReset);
+  }
+
+  EXPECT_THROW(edgestatus.Update(GraphId(0, 2, 0), EdgeSet::kPermanent), std::runtime_error);
+}
+
+TEST(EdgeStatus, ConcurrentGet) {
+  EdgeStatus edgestatus;
+
+  GraphTileHeader header;
+  header.set_directededgecount(100);
+  test_tile* tt = new test_tile;
+  tt->header_ = &header;
+  graph_tile_ptr tile{tt};
+
+  for (uint32_t tile_id = 0; tile_id < 50; ++tile_id) {
+    for (uint32_t id = 0; id < 100; id += 10) {
+      edgestatus.Set(GraphId(tile_id, 2, id), EdgeSet::kPermanent, tile_id * 100 + id, tile);
+    }
+  }
+
+  // the lookups jump between tiles on several threads at once, which must neither disturb each
+  // other nor the last tile the object remembers (run under -fsanitize=thread to see races)
+  std::vector<std::thread> threads;
+  std::atomic<uint32_t> mismatches{0};
+  for (uint32_t t = 0; t < 8; ++t) {
+    threads.emplace_back([&edgestatus, &mismatches, t]() {
+      for (uint32_t round = 0; round < 200; ++round) {
+        for (uint32_t tile_id = 0; tile_id < 50; ++tile_id) {
+          const GraphId edgeid((tile_id + t) % 50, 2, (round % 10) * 10);
+          if (edgestatus.Get(edgeid).index() != edgeid.tileid() * 100 + edgeid.id()) {
+            ++mismatches;
+          }
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(mismatches, 0);
+
+  // the writer goes on using the tile it last set
+  edgestatus.Update(GraphId(49, 2, 90), EdgeSet::kTemporary);
+  TryGet(edgestatus, GraphId(49, 2, 90), EdgeSet::kTemporary);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -1,5 +1,7 @@
 #include "baldr/curl_tilegetter.h"
+#include "baldr/graphreader.h"
 #include "baldr/tilehierarchy.h"
+#include "midgard/elevation_encoding.h"
 #include "midgard/pointll.h"
 #include "midgard/sequence.h"
 #include "mjolnir/elevationbuilder.h"
@@ -12,11 +14,14 @@
 #include <filesystem>
 #include <fstream>
 #include <iterator>
+#include <map>
 #include <string>
+#include <tuple>
 #include <unordered_set>
 #include "mjolnir/util.h
 #include "pixels.h"
 #include "skadi/sample.h"
+#include "skadi/util.h"
 #include "tile_server.h"
 
 namespace {
@@ -526,6 +531,188 @@ TEST(ElevationBuilder, compare_applied_elevations) {
   clear(pbf_dir);
 }
 
+/**
+ * @brief Add elevation to a tile the way the elevation builder did before it sampled all of the
+ * postings of a tile at once, sampling the nodes one by one and every edge shape on its own.
+ * */
+void add_elevations_per_edge(const std::string& tile_dir,
+                             const GraphId& tile_id,
+                             valhalla::skadi::sample& sample) {
+  valhalla::mjolnir::GraphTileBuilder tilebuilder(tile_dir, tile_id, true);
+  tilebuilder.header_builder().set_has_elevation(true);
+  for (uint32_t i = 0; i < tilebuilder.header()->nodecount(); ++i) {
+    NodeInfo& nodeinfo = tilebuilder.node_builder(i);
+    nodeinfo.set_elevation(sample.get(nodeinfo.latlng(tilebuilder.header()->base_ll())));
+  }
+
+  std::multimap<uint32_t, uint32_t> edge_info_offsets;
+  for (uint32_t i = 0; i < tilebuilder.header()->directededgecount(); ++i) {
+    edge_info_offsets.emplace(tilebuilder.directededge_builder(i).edgeinfo_offset(), i);
+  }
+
+  // weighted grade and max up and down slope forward and reverse per edge info
+  std::unordered_map<uint32_t, std::tuple<uint32_t, uint32_t, float, float, float, float>> cache;
+  std::unordered_map<uint32_t, uint32_t> new_offsets;
+  uint32_t ei_offset = 0;
+  for (const auto& elem : edge_info_offsets) {
+    DirectedEdge& directededge = tilebuilder.directededge_builder(elem.second);
+    auto found = cache.find(elem.first);
+    if (found == cache.cend()) {
+      auto shape = tilebuilder.edgeinfo(&directededge).shape();
+      auto length = directededge.length();
+      bool btf = directededge.bridge() || directededge.tunnel() || directededge.use() == Use::kFerry;
+
+      std::vector<PointLL> resampled =
+          valhalla::midgard::resample_spherical_polyline(shape, POSTING_INTERVAL);
+      resampled.push_back(shape.back());
+      std::vector<double> heights(resampled.size());
+      if (btf) {
+        auto h = sample.get_all(std::vector<PointLL>{resampled.front(), resampled.back()});
+        heights[0] = h[0];
+        float dh = (h[1] - heights[0]) / heights.size();
+        for (size_t i = 1; i < heights.size(); ++i) {
+          heights[i] = heights[i - 1] + dh;
+        }
+      } else {
+        heights = sample.get_all(resampled);
+      }
+
+      auto forward_grades = valhalla::skadi::weighted_grade(heights, POSTING_INTERVAL);
+      auto mean_elevation = std::get<3>(forward_grades);
+      std::tuple<double, double, double, double> reverse_grades(0.0, 0.0, 0.0, mean_elevation);
+      if (length < 10.0) {
+        forward_grades = reverse_grades;
+      } else {
+        std::reverse(heights.begin(), heights.end());
+        reverse_grades = valhalla::skadi::weighted_grade(heights, POSTING_INTERVAL);
+      }
+      found = cache
+                  .emplace(elem.first,
+                           std::make_tuple(static_cast<uint32_t>(std::get<0>(forward_grades) * .6 +
+                                                                 6.5),
+                                           static_cast<uint32_t>(std::get<0>(reverse_grades) * .6 +
+                                                                 6.5),
+                                           std::get<1>(forward_grades), std::get<2>(forward_grades),
+                                           std::get<1>(reverse_grades), std::get<2>(reverse_grades)))
+                  .first;
+
+      std::vector<double> encoded_heights;
+      if (btf) {
+        double h1 = sample.get(shape.front());
+        double h2 = sample.get(shape.back());
+        uint32_t n = static_cast<uint32_t>(length / sampling_interval(length)) + 1;
+        encoded_heights.resize(n);
+        encoded_heights.front() = h1;
+        float delta = (h2 - h1) / n;
+        for (uint32_t i = 1; i < n - 1; ++i) {
+          encoded_heights[i] = encoded_heights[i - 1] + delta;
+        }
+        encoded_heights.back() = h2;
+      } else {
+        uint32_t n = encoded_elevation_count(length) + 2;
+        encoded_heights = sample.get_all(
+            valhalla::midgard::uniform_resample_spherical_polyline(shape, length, n));
+      }
+      bool error = false;
+      new_offsets[elem.first] = ei_offset;
+      ei_offset += tilebuilder.set_elevation(elem.first, mean_elevation,
+                                             encode_elevation(encoded_heights, error));
+    }
+
+    bool forward = directededge.forward();
+    directededge.set_weighted_grade(forward ? std::get<0>(found->second)
+                                            : std::get<1>(found->second));
+    directededge.set_max_up_slope(forward ? std::get<2>(found->second) : std::get<4>(found->second));
+    directededge.set_max_down_slope(forward ? std::get<3>(found->second)
+                                            : std::get<5>(found->second));
+  }
+
+  for (uint32_t i = 0; i < tilebuilder.header()->directededgecount(); ++i) {
+    DirectedEdge& directededge = tilebuilder.directededge_builder(i);
+    directededge.set_edgeinfo_offset(new_offsets.at(directededge.edgeinfo_offset()));
+  }
+  tilebuilder.StoreTileData();
+}
+
+TEST(ElevationBuilder, same_as_per_edge) {
+  // the local tile of the utrecht test tiles with the most edges, copied to be built both ways
+  GraphReader reader(test::make_config("test/data/utrecht_tiles").get_child("mjolnir"));
+  GraphId tile_id;
+  uint32_t edge_count = 0;
+  for (const auto& id : reader.GetTileSet(TileHierarchy::levels().back().level)) {
+    auto count = reader.GetGraphTile(id)->header()->directededgecount();
+    if (count > edge_count) {
+      tile_id = id;
+      edge_count = count;
+    }
+  }
+  ASSERT_TRUE(tile_id.Is_Valid());
+  const std::string per_edge_dir{test_tile_dir + "/per_edge/"};
+  const std::string batched_dir{test_tile_dir + "/batched/"};
+  for (const auto& dir : {per_edge_dir, batched_dir}) {
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(
+        std::filesystem::path(dir + GraphTile::FileSuffix(tile_id)).parent_path());
+    std::filesystem::copy_file(reader.tile_dir() + "/" + GraphTile::FileSuffix(tile_id),
+                               dir + GraphTile::FileSuffix(tile_id));
+  }
+
+  // the elevation rises to the south and to the east so that the edges have grades
+  const std::string elevation_dir{test_tile_dir + "/sloped_elevation/"};
+  const auto center = TileHierarchy::get_tiling(tile_id.level()).Center(tile_id.tileid());
+  const auto elevation_file =
+      elevation_dir + valhalla::skadi::get_hgt_file_name(TestableSample::get_tile_index(center));
+  std::filesystem::remove_all(elevation_dir);
+  ASSERT_TRUE(std::filesystem::save<std::string>(elevation_file));
+  {
+    valhalla::midgard::sequence<int16_t> s(elevation_file, true);
+    for (int row = 0; row < 3601; ++row) {
+      for (int col = 0; col < 3601; ++col) {
+        int h = row + col / 2;
+        s.push_back(((h & 0xFF) << 8) | ((h >> 8) & 0xFF));
+      }
+    }
+  }
+
+  valhalla::skadi::sample sample(elevation_dir);
+  add_elevations_per_edge(per_edge_dir, tile_id, sample);
+  auto config = test::make_config("test/data", {{"mjolnir.tile_dir", batched_dir},
+                                                {"additional_data.elevation", elevation_dir},
+                                                {"mjolnir.concurrency", "1"}});
+  valhalla::mjolnir::ElevationBuilder::Build(config, {tile_id});
+
+  auto per_edge = GraphTile::Create(per_edge_dir, tile_id);
+  auto batched = GraphTile::Create(batched_dir, tile_id);
+  ASSERT_TRUE(per_edge && batched);
+  ASSERT_EQ(per_edge->header()->nodecount(), batched->header()->nodecount());
+  for (uint32_t i = 0; i < per_edge->header()->nodecount(); ++i) {
+    EXPECT_EQ(per_edge->node(i)->elevation(), batched->node(i)->elevation());
+  }
+  ASSERT_EQ(per_edge->header()->directededgecount(), batched->header()->directededgecount());
+  bool graded = false;
+  for (uint32_t i = 0; i < per_edge->header()->directededgecount(); ++i) {
+    const auto* expected = per_edge->directededge(i);
+    const auto* edge = batched->directededge(i);
+    EXPECT_EQ(edge->weighted_grade(), expected->weighted_grade()) << "edge " << i;
+    EXPECT_EQ(edge->max_up_slope(), expected->max_up_slope()) << "edge " << i;
+    EXPECT_EQ(edge->max_down_slope(), expected->max_down_slope()) << "edge " << i;
+    graded = graded || expected->max_up_slope() != 0 || expected->max_down_slope() != 0;
+
+    auto expected_info = per_edge->edgeinfo(expected);
+    auto info = batched->edgeinfo(edge);
+    EXPECT_EQ(info.mean_elevation(), expected_info.mean_elevation()) << "edge " << i;
+    double interval, expected_interval;
+    EXPECT_EQ(info.encoded_elevation(edge->length(), interval),
+              expected_info.encoded_elevation(expected->length(), expected_interval))
+        << "edge " << i;
+  }
+  EXPECT_TRUE(graded) << "The elevation should give the edges some slope";
+
+  clear(per_edge_dir);
+  clear(batched_dir);
+  clear(elevation_dir);
+}
+
 } // namespace
 
 class HttpElevationsEnv : public ::testing::Environment {
@@ -0,0 +1,87 @@
+#include "baldr/graphoverlay.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/pointll.h"
+#include "test.h"
+
+#include <cstdio>
+#include <fstream>
+
+using namespace valhalla::baldr;
+
+namespace {
+
+GraphOverlay make_overlay() {
+  std::vector<GraphOverlay::Cell> cells;
+  cells.push_back({GraphId(7, 0, 0), {GraphId(5, 0, 12), GraphId(3, 0, 1)}, {GraphId(7, 0, 9)}});
+  cells.push_back({GraphId(3, 0, 0), {}, {GraphId(3, 0, 4), GraphId(3, 0, 1)}, true});
+  return GraphOverlay(std::move(cells));
+}
+
+TEST(GraphOverlay, Lookups) {
+  auto overlay = make_overlay();
+  ASSERT_EQ(overlay.cells().size(), 2);
+  // cells and their boundaries are sorted
+  EXPECT_EQ(overlay.cells()[0].tile_id, GraphId(3, 0, 0));
+  EXPECT_EQ(overlay.cells()[1].entries.front(), GraphId(3, 0, 1));
+
+  EXPECT_EQ(overlay.cell_index(GraphId(7, 0, 0)), 1);
+  EXPECT_EQ(overlay.cell_index(GraphId(7, 0, 1234)), 1);
+  EXPECT_EQ(overlay.cell_index(GraphId(8, 0, 0)), GraphOverlay::kInvalidIndex);
+
+  EXPECT_EQ(overlay.entry_index(1, GraphId(5, 0, 12)), 1);
+  EXPECT_EQ(overlay.entry_index(1, GraphId(7, 0, 9)), GraphOverlay::kInvalidIndex);
+  EXPECT_EQ(overlay.exit_index(0, GraphId(3, 0, 4)), 1);
+  EXPECT_EQ(overlay.exit_index(0, GraphId(3, 0, 2)), GraphOverlay::kInvalidIndex);
+  EXPECT_EQ(overlay.entry_index(0, GraphId(3, 0, 1)), GraphOverlay::kInvalidIndex);
+}
+
+TEST(GraphOverlay, HighwayLevelOnly) {
+  // the lower levels have no cells
+  std::vector<GraphOverlay::Cell> arterial;
+  arterial.push_back({GraphId(7, 1, 0), {}, {GraphId(7, 1, 9)}});
+  EXPECT_THROW(GraphOverlay(std::move(arterial)), std::invalid_argument);
+
+  // and no boundary edges
+  std::vector<GraphOverlay::Cell> local_exit;
+  local_exit.push_back({GraphId(7, 0, 0), {}, {GraphId(7, 0, 9), GraphId(123, 2, 4)}});
+  EXPECT_THROW(GraphOverlay(std::move(local_exit)), std::invalid_argument);
+}
+
+TEST(GraphOverlay, CellTile) {
+  const auto& local = TileHierarchy::levels().back();
+  const auto& highway = TileHierarchy::levels().front();
+  valhalla::midgard::PointLL ll(13.4, 52.5);
+  GraphId local_tile = TileHierarchy::GetGraphId(ll, local.level);
+  GraphId local_node(local_tile.tileid(), local_tile.level(), 42);
+  EXPECT_EQ(GraphOverlay::cell_tile(local_node), TileHierarchy::GetGraphId(ll, highway.level));
+  GraphId highway_edge(TileHierarchy::GetGraphId(ll, highway.level).tileid(), highway.level, 7);
+  EXPECT_EQ(GraphOverlay::cell_tile(highway_edge), highway_edge.Tile_Base());
+}
+
+TEST(GraphOverlay, RoundTrip) {
+  const std::string file_name = "test_overlay.bin";
+  auto overlay = make_overlay();
+  overlay.Write(file_name);
+  auto read = GraphOverlay::Read(file_name);
+  std::remove(file_name.c_str());
+
+  ASSERT_EQ(read.cells().size(), overlay.cells().size());
+  for (size_t i = 0; i < read.cells().size(); ++i) {
+    EXPECT_EQ(read.cells()[i].tile_id, overlay.cells()[i].tile_id);
+    EXPECT_EQ(read.cells()[i].entries, overlay.cells()[i].entries);
+    EXPECT_EQ(read.cells()[i].exits, overlay.cells()[i].exits);
+    EXPECT_EQ(read.cells()[i].restricted, overlay.cells()[i].restricted);
+  }
+  EXPECT_EQ(read.cell_index(GraphId(3, 0, 0)), 0);
+}
+
+TEST(GraphOverlay, BadFile) {
+  EXPECT_THROW(GraphOverlay::Read("does_not_exist.bin"), std::runtime_error);
+
+  const std::string file_name = "test_not_overlay.bin";
+  std::ofstream(file_name) << "definitely not an overlay";
+  EXPECT_THROW(GraphOverlay::Read(file_name), std::runtime_error);
+  std::remove(file_name.c_str());
+}
+
+} // namespace
@@ -16,6 +16,7 @@
 #include <cstdint>
 #include <filesystem>
 #include <fstream>
+#include <iterator>
 
 #if !defined(VALHALLA_SOURCE_DIR)
 #define VALHALLA_SOURCE_DIR
@@ -629,6 +630,46 @@ void BicycleTrafficSignals(const std::string& config_file) {
   CleanUp();
 }
 
+// parses an extract with the given concurrency, returns what it counted and the files it wrote
+std::vector<std::string> ParseWithConcurrency(const std::string& config_file, size_t concurrency) {
+  boost::property_tree::ptree conf;
+  rapidjson::read_json(config_file, conf);
+  conf.put("mjolnir.concurrency", concurrency);
+  const std::string pbf = VALHALLA_SOURCE_DIR "test/data/baltimore.osm.pbf";
+
+  auto osmdata = PBFGraphParser::ParseWays(conf.get_child("mjolnir"), {pbf}, ways_file,
+                                           way_nodes_file, access_file);
+  PBFGraphParser::ParseRelations(conf.get_child("mjolnir"), {pbf}, from_restriction_file,
+                                 to_restriction_file, osmdata);
+  PBFGraphParser::ParseNodes(conf.get_child("mjolnir"), {pbf}, way_nodes_file, bss_nodes_file,
+                             linguistic_node_file, osmdata);
+
+  std::vector<std::string> parsed{std::to_string(osmdata.osm_way_count),
+                                  std::to_string(osmdata.osm_node_count),
+                                  std::to_string(osmdata.node_count),
+                                  std::to_string(osmdata.edge_count),
+                                  std::to_string(osmdata.restrictions.size()),
+                                  std::to_string(osmdata.max_changeset_id_)};
+  for (const auto& file : {ways_file, way_nodes_file, access_file, from_restriction_file,
+                           to_restriction_file, linguistic_node_file}) {
+    std::ifstream in(file, std::ios::binary);
+    parsed.emplace_back(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  CleanUp();
+  return parsed;
+}
+
+TEST(GraphParser, TestConcurrencyKeepsOrder) {
+  // the lua transform runs on more threads but everything is still written in the same order
+  const auto serial = ParseWithConcurrency(config_file, 1);
+  const auto parallel = ParseWithConcurrency(config_file, 8);
+  ASSERT_EQ(serial.size(), parallel.size());
+  for (size_t i = 0; i < serial.size(); ++i) {
+    EXPECT_TRUE(serial[i] == parallel[i]) << "Parsed differently at " << i;
+  }
+  EXPECT_NE(serial[1], "0") << "No nodes were parsed";
+}
+
 TEST(GraphParser, TestBollardsGatesAndAccess) {
   // write the tiles with it
   BollardsGatesAndAccess(config_file);
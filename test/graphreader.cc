@@ -6,7 +6,15 @@
 #include <fcntl.h>
 
 #include <cstdint>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+#if !defined(VALHALLA_SOURCE_DIR)
+#define VALHALLA_SOURCE_DIR
+#endif
 
 using namespace valhalla::baldr;
 
@@ -888,6 +896,308 @@ TEST(CacheLruSoft, TrimOnExactlyFullCache) {
   CheckGraphTile(cache.Get(tile2_id), tile2_id, tile2_size);
 }
 
+TEST(ConcurrentCache, PutGetClear) {
+  ConcurrentTileCache cache(4000, 4);
+
+  GraphId id1(100, 2, 0);
+  auto tile1 = cache.Put(id1, graph_tile_ptr{new TestGraphTile(id1, 123)}, 123);
+  EXPECT_EQ(cache.Get(id1), tile1);
+  CheckGraphTile(tile1, id1, 123);
+
+  GraphId id2(300, 1, 0);
+  auto tile2 = cache.Put(id2, graph_tile_ptr{new TestGraphTile(id2, 200)}, 200);
+  EXPECT_EQ(cache.Get(id2), tile2);
+  CheckGraphTile(tile2, id2, 200);
+
+  EXPECT_TRUE(cache.Contains(id1));
+  EXPECT_TRUE(cache.Contains(id2));
+  EXPECT_FALSE(cache.Contains({1000, 0, 0}));
+  EXPECT_EQ(cache.Get({1000, 0, 0}), nullptr);
+  EXPECT_FALSE(cache.OverCommitted());
+
+  cache.Clear();
+
+  EXPECT_FALSE(cache.Contains(id1));
+  EXPECT_FALSE(cache.Contains(id2));
+  EXPECT_EQ(cache.Get(id1), nullptr);
+  EXPECT_EQ(cache.Get(id2), nullptr);
+}
+
+TEST(ConcurrentCache, PutKeepsFirstCopy) {
+  ConcurrentTileCache cache(4000, 4);
+
+  GraphId id(100, 2, 0);
+  auto first = cache.Put(id, graph_tile_ptr{new TestGraphTile(id, 100)}, 100);
+  auto second = cache.Put(id, graph_tile_ptr{new TestGraphTile(id, 100)}, 100);
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(cache.Get(id), first);
+}
+
+TEST(ConcurrentCache, NeverOvercommitted) {
+  // a single shard makes the eviction order predictable
+  ConcurrentTileCache cache(1000, 1);
+
+  std::vector<GraphId> ids;
+  for (uint32_t i = 0; i < 10; ++i) {
+    ids.emplace_back(i, 2, 0);
+    cache.Put(ids.back(), graph_tile_ptr{new TestGraphTile(ids.back(), 300)}, 300);
+    EXPECT_FALSE(cache.OverCommitted());
+  }
+
+  // only the 3 newest tiles fit
+  for (size_t i = 0; i < ids.size(); ++i) {
+    EXPECT_EQ(cache.Contains(ids[i]), i >= ids.size() - 3) << "tile " << i;
+  }
+}
+
+TEST(ConcurrentCache, ShardsSplitTheBudget) {
+  ConcurrentTileCache cache(64000, 16);
+
+  for (uint32_t i = 0; i < 1000; ++i) {
+    GraphId id(i, 2, 0);
+    cache.Put(id, graph_tile_ptr{new TestGraphTile(id, 500)}, 500);
+    EXPECT_FALSE(cache.OverCommitted());
+  }
+
+  size_t cached = 0;
+  for (uint32_t i = 0; i < 1000; ++i) {
+    cached += cache.Contains({i, 2, 0});
+  }
+  EXPECT_LE(cached * 500, 64000);
+  EXPECT_GT(cached, 0);
+}
+
+#ifdef ENABLE_THREAD_SAFE_TILE_REF_COUNT
+TEST(ConcurrentCache, SharedAcrossThreads) {
+  ConcurrentTileCache cache(100 * 1000, 8);
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 8; ++t) {
+    threads.emplace_back([&cache]() {
+      for (uint32_t i = 0; i < 1000; ++i) {
+        GraphId id(i % 150, 2, 0);
+        auto tile = cache.Get(id);
+        if (!tile) {
+          tile = cache.Put(id, graph_tile_ptr{new TestGraphTile(id, 1000)}, 1000);
+        }
+        CheckGraphTile(tile, id, 1000);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_FALSE(cache.OverCommitted());
+}
+
+TEST(ConcurrentCache, SharedPerConfig) {
+  boost::property_tree::ptree pt;
+  pt.put("use_concurrent_mem_cache", true);
+  pt.put("max_cache_size", 100 * 1000);
+  pt.put("tile_dir", "test/concurrent_cache_a");
+  std::unique_ptr<TileCache> cache(TileCacheFactory::createTileCache(pt));
+  std::unique_ptr<TileCache> same(TileCacheFactory::createTileCache(pt));
+  GraphId id(100, 2, 0);
+  cache->Put(id, graph_tile_ptr{new TestGraphTile(id, 1000)}, 1000);
+  EXPECT_TRUE(same->Contains(id));
+
+  // other tiles or another size never see the tiles of the first cache
+  auto other_tiles = pt;
+  other_tiles.put("tile_dir", "test/concurrent_cache_b");
+  std::unique_ptr<TileCache> other_tiles_cache(TileCacheFactory::createTileCache(other_tiles));
+  EXPECT_FALSE(other_tiles_cache->Contains(id));
+  auto other_size = pt;
+  other_size.put("max_cache_size", 50 * 1000);
+  std::unique_ptr<TileCache> other_size_cache(TileCacheFactory::createTileCache(other_size));
+  EXPECT_FALSE(other_size_cache->Contains(id));
+}
+#endif
+
+TEST(MappedTiles, SameAsRead) {
+  // the test tiles are compressed, so uncompress them into a tile dir of their own
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", VALHALLA_SOURCE_DIR "test/traffic_matcher_tiles");
+  GraphReader compressed(pt);
+  const std::string tile_dir = "test/mapped_tiles";
+  std::filesystem::remove_all(tile_dir);
+  const auto tile_ids = compressed.GetTileSet();
+  ASSERT_FALSE(tile_ids.empty());
+  for (const auto& tile_id : tile_ids) {
+    auto tile = compressed.GetGraphTile(tile_id);
+    ASSERT_TRUE(tile);
+    std::filesystem::path file{tile_dir};
+    file /= GraphTile::FileSuffix(tile_id);
+    std::filesystem::create_directories(file.parent_path());
+    std::ofstream(file, std::ios::binary)
+        .write(reinterpret_cast<const char*>(tile->header()), tile->header()->end_offset());
+  }
+
+  pt.put("tile_dir", tile_dir);
+  GraphReader read(pt);
+  pt.put("mmap_tiles", true);
+  pt.put("mmap_tiles_advice", "random");
+  GraphReader mapped(pt);
+  for (const auto& tile_id : tile_ids) {
+    auto read_tile = read.GetGraphTile(tile_id);
+    auto mapped_tile = mapped.GetGraphTile(tile_id);
+    ASSERT_TRUE(read_tile);
+    ASSERT_TRUE(mapped_tile);
+    const auto size = read_tile->header()->end_offset();
+    ASSERT_EQ(mapped_tile->header()->end_offset(), size);
+    EXPECT_EQ(std::memcmp(read_tile->header(), mapped_tile->header(), size), 0);
+    EXPECT_EQ(mapped.GetGraphTile(tile_id), mapped_tile) << "mapped tiles are cached too";
+  }
+  std::filesystem::remove_all(tile_dir);
+}
+
+TEST(MappedTiles, CompressedAreRead) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", VALHALLA_SOURCE_DIR "test/traffic_matcher_tiles");
+  pt.put("mmap_tiles", true);
+  GraphReader reader(pt);
+  for (const auto& tile_id : reader.GetTileSet()) {
+    EXPECT_TRUE(reader.GetGraphTile(tile_id));
+  }
+}
+
+TEST(MappedTiles, UnknownAdvice) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", VALHALLA_SOURCE_DIR "test/traffic_matcher_tiles");
+  pt.put("mmap_tiles_advice", "sometimes");
+  EXPECT_THROW(GraphReader{pt}, std::runtime_error);
+}
+
+TEST(ShapeCache, SameAsEdgeInfo) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", VALHALLA_SOURCE_DIR "test/traffic_matcher_tiles");
+  GraphReader uncached(pt);
+  const auto tile_id = *uncached.GetTileSet().begin();
+  auto tile = uncached.GetGraphTile(tile_id);
+  ASSERT_TRUE(tile);
+  EXPECT_EQ(uncached.GetDecodedShape(tile, tile->directededge(0)), nullptr);
+  uint64_t hits, misses;
+  EXPECT_FALSE(uncached.TakeShapeCacheStats(hits, misses));
+
+  pt.put("shape_cache_size", 1 << 20);
+  GraphReader reader(pt);
+  tile = reader.GetGraphTile(tile_id);
+  ASSERT_TRUE(tile);
+  for (const auto& edge : tile->GetDirectedEdges()) {
+    auto decoded = reader.GetDecodedShape(tile, &edge);
+    ASSERT_TRUE(decoded);
+    const auto& shape = tile->edgeinfo(&edge).shape();
+    ASSERT_EQ(decoded->shape, shape);
+    ASSERT_EQ(decoded->lengths.size(), shape.size());
+    double length = 0;
+    for (size_t i = 1; i < shape.size(); ++i) {
+      length += shape[i - 1].Distance(shape[i]);
+      EXPECT_EQ(decoded->lengths[i], length);
+    }
+    // the second time its the same one
+    EXPECT_EQ(reader.GetDecodedShape(tile, &edge), decoded);
+  }
+
+  // every edge was asked for twice and found at least the second time
+  const auto edge_count = tile->header()->directededgecount();
+  ASSERT_TRUE(reader.TakeShapeCacheStats(hits, misses));
+  EXPECT_EQ(hits + misses, 2 * edge_count);
+  EXPECT_GE(hits, edge_count);
+  reader.TakeShapeCacheStats(hits, misses);
+  EXPECT_EQ(hits + misses, 0) << "The stats should have been reset";
+
+  // once the tile is cleared its shapes are gone too
+  auto decoded = reader.GetDecodedShape(tile, tile->directededge(0));
+  reader.Clear();
+  tile = reader.GetGraphTile(tile_id);
+  EXPECT_NE(reader.GetDecodedShape(tile, tile->directededge(0)), decoded);
+}
+
+// exposes the constructor which reads a tile from a tile dir
+struct ReadGraphTile : public GraphTile {
+  ReadGraphTile(const std::string& tile_dir, const GraphId& id) : GraphTile(tile_dir, id) {
+  }
+};
+
+TEST(ShapeCache, RereadAtSameAddress) {
+  const std::string tile_dir = VALHALLA_SOURCE_DIR "test/traffic_matcher_tiles";
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", tile_dir);
+  const auto tile_id = *GraphReader(pt).GetTileSet().begin();
+
+  // read the tile into the same memory twice, the second copy must not get the shapes of the first
+  alignas(ReadGraphTile) char storage[sizeof(ReadGraphTile)];
+  ShapeCache cache(1 << 20, 1);
+  auto* tile = new (storage) ReadGraphTile(tile_dir, tile_id);
+  const auto* edge = tile->directededge(0);
+  const auto offset = edge->edgeinfo_offset();
+  auto shape = std::make_shared<const DecodedShape>(tile->edgeinfo(edge).lazy_shape());
+  cache.Put(tile, offset, shape);
+  EXPECT_EQ(cache.Get(tile, offset), shape);
+  const auto instance = tile->instance();
+  tile->~ReadGraphTile();
+
+  auto* reread = new (storage) ReadGraphTile(tile_dir, tile_id);
+  ASSERT_EQ(static_cast<GraphTile*>(reread), static_cast<GraphTile*>(tile));
+  EXPECT_NE(reread->instance(), instance);
+  EXPECT_EQ(cache.Get(reread, offset), nullptr);
+  reread->~ReadGraphTile();
+}
+
+TEST(ShapeCache, SharedPerConfig) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", VALHALLA_SOURCE_DIR "test/traffic_matcher_tiles");
+  pt.put("global_synchronized_cache", true);
+  pt.put("shape_cache_size", 1 << 20);
+  GraphReader reader(pt);
+  auto tile = reader.GetGraphTile(*reader.GetTileSet().begin());
+  ASSERT_TRUE(tile);
+  const auto* edge = tile->directededge(0);
+  auto decoded = reader.GetDecodedShape(tile, edge);
+  ASSERT_TRUE(decoded);
+
+  // a reader of the same tiles with the same cache size finds the shape the first one decoded
+  GraphReader same(pt);
+  EXPECT_EQ(same.GetDecodedShape(tile, edge), decoded);
+
+  // other tiles or another size never see the shapes of the first cache
+  auto other_tiles = pt;
+  other_tiles.put("tile_dir", "test/shape_cache_other");
+  EXPECT_NE(GraphReader(other_tiles).GetDecodedShape(tile, edge), decoded);
+  auto other_size = pt;
+  other_size.put("shape_cache_size", 1 << 19);
+  EXPECT_NE(GraphReader(other_size).GetDecodedShape(tile, edge), decoded);
+}
+
+TEST(ShapeCache, Bounded) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", VALHALLA_SOURCE_DIR "test/traffic_matcher_tiles");
+  GraphReader reader(pt);
+  auto tile = reader.GetGraphTile(*reader.GetTileSet().begin());
+  ASSERT_TRUE(tile);
+
+  // a tile read again is a different tile, its shapes have to be decoded again
+  ShapeCache cache(4096, 1);
+  const auto* edge = tile->directededge(0);
+  auto shape = std::make_shared<const DecodedShape>(tile->edgeinfo(edge).lazy_shape());
+  EXPECT_EQ(cache.Put(tile.get(), edge->edgeinfo_offset(), shape), shape);
+  EXPECT_EQ(cache.Get(tile.get(), edge->edgeinfo_offset()), shape);
+  GraphReader other(pt);
+  auto reread = other.GetGraphTile(tile->id());
+  ASSERT_TRUE(reread);
+  EXPECT_EQ(cache.Get(reread.get(), edge->edgeinfo_offset()), nullptr);
+
+  // the cache never grows beyond its size, unless a single shape is bigger than that
+  for (const auto& e : tile->GetDirectedEdges()) {
+    auto decoded = std::make_shared<const DecodedShape>(tile->edgeinfo(&e).lazy_shape());
+    const auto size = decoded->MemoryUsage();
+    cache.Put(tile.get(), e.edgeinfo_offset(), std::move(decoded));
+    EXPECT_LE(cache.Size(), std::max<size_t>(4096, size));
+  }
+  cache.Clear();
+  EXPECT_EQ(cache.Size(), 0);
+  EXPECT_EQ(cache.Get(tile.get(), edge->edgeinfo_offset()), nullptr);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
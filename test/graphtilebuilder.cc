@@ -3,8 +3,10 @@
 #include "baldr/tilehierarchy.h"
 #include "midgard/encoded.h"
 #include "midgard/pointll.h"
+#include "midgard/sequence.h"
 #include "test.h"
 
+#include <filesystem>
 #include <fstream>
 #include <streambuf>
 #include <string>
@@ -276,6 +278,196 @@ TEST(GraphTileBuilder, TestAddBins) {
   }
 }
 
+TEST(GraphTileBuilder, TestAddReach) {
+  GraphId id(744881, 2, 0);
+  auto t = GraphTile::Create(VALHALLA_SOURCE_DIR "test/data/bin_tiles/no_bin", id);
+  ASSERT_TRUE(t && t->header()) << "Couldn't load test tile";
+  StoredReach reach;
+  EXPECT_EQ(t->GetStoredReach(0, 0, reach), 0) << "Test tile should not have any reach stored";
+
+  // store a made up reach for 2 costings
+  const uint32_t edge_count = t->header()->directededgecount();
+  StoredReachHeader reach_header{};
+  reach_header.max_reach = 100;
+  reach_header.costing_count = 2;
+  reach_header.costings[0] = 0;
+  reach_header.costings[1] = 2;
+  std::vector<StoredReach> reaches;
+  for (uint32_t c = 0; c < reach_header.costing_count; ++c) {
+    for (uint32_t i = 0; i < edge_count; ++i) {
+      reaches.push_back({static_cast<uint8_t>((i + c) % 101), static_cast<uint8_t>(i % 7)});
+    }
+  }
+  std::string reach_dir = "test/data/bin_tiles/reach";
+  GraphTileBuilder::AddReach(reach_dir, t, reach_header, reaches);
+
+  auto check = [&](const graph_tile_ptr& tile) {
+    ASSERT_TRUE(tile && tile->header());
+    EXPECT_EQ(tile->header()->directededgecount(), edge_count);
+    EXPECT_EQ(tile->GetStoredReach(0, 1, reach), 0) << "No reach was stored for this costing";
+    for (uint32_t c = 0; c < reach_header.costing_count; ++c) {
+      for (uint32_t i = 0; i < edge_count; ++i) {
+        ASSERT_EQ(tile->GetStoredReach(i, reach_header.costings[c], reach), 100);
+        EXPECT_EQ(reach.outbound, (i + c) % 101);
+        EXPECT_EQ(reach.inbound, i % 7);
+      }
+    }
+  };
+  auto with_reach = GraphTile::Create(reach_dir, id);
+  check(with_reach);
+  EXPECT_EQ(with_reach->header()->end_offset(), t->header()->end_offset() +
+                                                    sizeof(StoredReachHeader) +
+                                                    reaches.size() * sizeof(StoredReach));
+
+  // storing it again replaces it rather than adding another one
+  GraphTileBuilder::AddReach(reach_dir, with_reach, reach_header, reaches);
+  auto again = GraphTile::Create(reach_dir, id);
+  check(again);
+  EXPECT_EQ(again->header()->end_offset(), with_reach->header()->end_offset());
+
+  // the reach survives bins being added in front of it
+  std::array<std::vector<GraphId>, kBinCount> bins;
+  for (auto& bin : bins)
+    bin.emplace_back(id.tileid(), 2, 0);
+  GraphTileBuilder::AddBins(reach_dir, again, bins);
+  check(GraphTile::Create(reach_dir, id));
+
+  // there has to be a reach for every edge
+  reaches.pop_back();
+  EXPECT_THROW(GraphTileBuilder::AddReach(reach_dir, t, reach_header, reaches), std::runtime_error);
+}
+
+TEST(GraphTileBuilder, TestReplaceMappedTile) {
+  GraphId id(744885, 2, 0);
+  auto t = GraphTile::Create(VALHALLA_SOURCE_DIR "test/data/bin_tiles/no_bin", id);
+  ASSERT_TRUE(t && t->header()) << "Couldn't load test tile";
+  std::string mapped_dir = "test/data/bin_tiles/mapped";
+  std::array<std::vector<GraphId>, kBinCount> bins;
+  GraphTileBuilder::AddBins(mapped_dir, t, bins);
+
+  // a reader maps the tile while it is rewritten, the mapping has to keep the old contents
+  const std::string file_name = mapped_dir + "/" + GraphTile::FileSuffix(id);
+  const size_t size = t->header()->end_offset();
+  valhalla::midgard::mem_map<char> mapped;
+  mapped.map_readonly(file_name, size);
+  const std::string before(mapped.get(), size);
+
+  for (auto& bin : bins)
+    bin.emplace_back(id.tileid(), 2, 0);
+  GraphTileBuilder::AddBins(mapped_dir, t, bins);
+  EXPECT_EQ(std::string(mapped.get(), size), before);
+
+  GraphTileBuilder builder(mapped_dir, id, false);
+  std::vector<NodeInfo> nodes(&builder.node(0), &builder.node(0) + builder.header()->nodecount());
+  std::vector<DirectedEdge> edges(&builder.directededge(0),
+                                  &builder.directededge(0) + builder.header()->directededgecount());
+  edges.front().set_speed(edges.front().speed() + 1);
+  builder.Update(nodes, edges);
+  EXPECT_EQ(std::string(mapped.get(), size), before);
+
+  // the new tile is in place and nothing is left behind
+  auto updated = GraphTile::Create(mapped_dir, id);
+  ASSERT_TRUE(updated && updated->header());
+  EXPECT_EQ(updated->directededge(0)->speed(), edges.front().speed());
+  EXPECT_FALSE(std::filesystem::exists(file_name + ".tmp"));
+}
+
+TEST(GraphTileBuilder, TestAddCandidateIndex) {
+  GraphId id(744881, 2, 0);
+  auto t = GraphTile::Create(VALHALLA_SOURCE_DIR "test/data/bin_tiles/no_bin", id);
+  ASSERT_TRUE(t && t->header()) << "Couldn't load test tile";
+  std::unordered_set<GraphId> edges;
+  EXPECT_FALSE(t->GetCandidateEdges(t->BoundingBox(), edges)) << "Test tile should have no index";
+
+  // a made up 4x4 index with the first edge of the tile everywhere and another in each cell
+  const auto bbox = t->BoundingBox();
+  CandidateIndexHeader index_header{4, 4, static_cast<float>(bbox.Width() / 4),
+                                    static_cast<float>(bbox.Height() / 4), 17, 32};
+  std::vector<CandidateIndexEdge> index_edges;
+  std::vector<uint32_t> cells, entries;
+  for (uint32_t i = 0; i < index_header.edge_count; ++i) {
+    index_edges.push_back({static_cast<uint32_t>(id.value), i});
+  }
+  for (uint32_t cell = 0; cell < 16; ++cell) {
+    cells.push_back(entries.size());
+    entries.push_back(0);
+    entries.push_back(cell + 1);
+  }
+  cells.push_back(entries.size());
+
+  // store it in a tile which has a stored reach already
+  const uint32_t edge_count = t->header()->directededgecount();
+  StoredReachHeader reach_header{};
+  reach_header.max_reach = 100;
+  reach_header.costing_count = 1;
+  std::vector<StoredReach> reaches(edge_count, StoredReach{7, 9});
+  std::string index_dir = "test/data/bin_tiles/candidate_index";
+  GraphTileBuilder::AddReach(index_dir, t, reach_header, reaches);
+  GraphTileBuilder::AddCandidateIndex(index_dir, GraphTile::Create(index_dir, id), index_header,
+                                      index_edges, cells, entries);
+
+  auto edge = [&id](const uint32_t i) { return GraphId(id.tileid(), id.level(), i); };
+  auto check = [&](const graph_tile_ptr& tile) {
+    ASSERT_TRUE(tile && tile->header());
+    EXPECT_EQ(tile->header()->directededgecount(), edge_count);
+
+    // everything in the tile
+    edges.clear();
+    ASSERT_TRUE(tile->GetCandidateEdges(bbox, edges));
+    EXPECT_EQ(edges.size(), index_header.edge_count);
+
+    // the 2 cells in the middle of the bottom row
+    edges.clear();
+    const auto y = bbox.miny() + index_header.cell_height / 2;
+    ASSERT_TRUE(tile->GetCandidateEdges({bbox.minx() + index_header.cell_width * 1.5, y,
+                                         bbox.minx() + index_header.cell_width * 2.5, y},
+                                        edges));
+    EXPECT_EQ(edges, (std::unordered_set<GraphId>{edge(0), edge(2), edge(3)}));
+
+    // anything outside of the tile is clamped to the cells at its edge
+    edges.clear();
+    ASSERT_TRUE(tile->GetCandidateEdges({bbox.maxx() + 1, bbox.maxy() + 1, bbox.maxx() + 2,
+                                         bbox.maxy() + 2},
+                                        edges));
+    EXPECT_EQ(edges, (std::unordered_set<GraphId>{edge(0), edge(16)}));
+
+    // the reach is still there after it
+    StoredReach reach;
+    ASSERT_EQ(tile->GetStoredReach(edge_count - 1, 0, reach), 100);
+    EXPECT_EQ(reach.outbound, 7);
+    EXPECT_EQ(reach.inbound, 9);
+  };
+  auto with_index = GraphTile::Create(index_dir, id);
+  check(with_index);
+  const size_t index_size = sizeof(CandidateIndexHeader) +
+                            index_edges.size() * sizeof(CandidateIndexEdge) +
+                            (cells.size() + entries.size()) * sizeof(uint32_t);
+  EXPECT_EQ(with_index->header()->end_offset(), t->header()->end_offset() + index_size +
+                                                    sizeof(StoredReachHeader) +
+                                                    reaches.size() * sizeof(StoredReach));
+
+  // storing it again replaces it rather than adding another one, so does storing the reach again
+  GraphTileBuilder::AddCandidateIndex(index_dir, with_index, index_header, index_edges, cells,
+                                      entries);
+  GraphTileBuilder::AddReach(index_dir, GraphTile::Create(index_dir, id), reach_header, reaches);
+  auto again = GraphTile::Create(index_dir, id);
+  check(again);
+  EXPECT_EQ(again->header()->end_offset(), with_index->header()->end_offset());
+
+  // the index survives bins being added in front of it
+  std::array<std::vector<GraphId>, kBinCount> bins;
+  for (auto& bin : bins)
+    bin.emplace_back(id.tileid(), 2, 0);
+  GraphTileBuilder::AddBins(index_dir, again, bins);
+  check(GraphTile::Create(index_dir, id));
+
+  // the cells have to match the grid
+  cells.pop_back();
+  EXPECT_THROW(GraphTileBuilder::AddCandidateIndex(index_dir, t, index_header, index_edges, cells,
+                                                   entries),
+               std::runtime_error);
+}
+
 struct fake_tile : public GraphTile {
 public:
   fake_tile(const std::string& plyenc_shape) {
@@ -660,6 +660,9 @@ valhalla::Api do_action(const valhalla::Options::Action& action,
     case valhalla::Options::sources_to_targets:
       json_str = actor.matrix(request_json, nullptr, &api);
       break;
+    case valhalla::Options::batch_route:
+      json_str = actor.batch_route(request_json, nullptr, &api);
+      break;
     case valhalla::Options::height:
       json_str = actor.height(request_json, nullptr, &api);
       break;
@@ -713,7 +716,7 @@ valhalla::Api do_action(const valhalla::Options::Action& action,
   return do_action(action, map, *request_json, reader, response);
 }
 
-// overload for /sources_to_targets
+// overload for /sources_to_targets and /batch_route
 valhalla::Api do_action(const valhalla::Options::Action& action,
                         const map& map,
                         const std::vector<std::string>& sources,
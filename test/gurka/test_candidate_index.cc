@@ -0,0 +1,115 @@
+#include "baldr/graphreader.h"
+#include "baldr/tilehierarchy.h"
+#include "gurka.h"
+#include "meili/candidate_search.h"
+#include "mjolnir/util.h"
+#include "test.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace valhalla;
+
+namespace {
+
+// spans several local tiles so that some of the queries cross the edges of tiles
+const std::string ascii_map = R"(
+    A-----B-----C-----D-----E-----F
+    |     |           |           |
+    |     |           |           |
+    G-----H-----I-----J-----K-----L
+)";
+
+const std::string workdir = "test/data/gurka_candidate_index";
+const std::string indexed_dir = workdir + "/indexed_tiles";
+constexpr uint32_t kGridSize = 500;
+
+class CandidateIndex : public ::testing::Test {
+protected:
+  static void SetUpTestSuite() {
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, 3000);
+    gurka::ways ways;
+    for (const std::string way : {"AB", "BC", "CD", "DE", "EF", "GA", "BH", "DJ", "FL", "GH", "HI",
+                                  "IJ", "JK", "KL"}) {
+      ways[way] = {{"highway", "primary"}, {"name", way}};
+    }
+    map = gurka::buildtiles(layout, ways, {}, {}, workdir);
+
+    // the same tiles again, with a candidate index of the size of the meili grid
+    const auto tile_dir = map.config.get<std::string>("mjolnir.tile_dir");
+    std::filesystem::remove_all(indexed_dir);
+    std::filesystem::copy(tile_dir, indexed_dir, std::filesystem::copy_options::recursive);
+    indexed_config = map.config;
+    indexed_config.put("mjolnir.tile_dir", indexed_dir);
+    indexed_config.put("mjolnir.candidate_index.grid_size", kGridSize);
+    ASSERT_TRUE(mjolnir::build_tile_set(indexed_config, {}, mjolnir::BuildStage::kCandidateIndex,
+                                        mjolnir::BuildStage::kCandidateIndex));
+  }
+
+  // the candidate edges meili finds around a point
+  static std::set<baldr::GraphId> candidates(const meili::CandidateGridQuery& query,
+                                             const midgard::PointLL& point) {
+    std::set<baldr::GraphId> edges;
+    for (const auto& location : query.Query(point, baldr::Location::StopType::BREAK, 50 * 50, {})) {
+      for (const auto& edge : location.edges) {
+        edges.insert(edge.id);
+      }
+    }
+    return edges;
+  }
+
+  static gurka::map map;
+  static boost::property_tree::ptree indexed_config;
+};
+
+gurka::map CandidateIndex::map = {};
+boost::property_tree::ptree CandidateIndex::indexed_config = {};
+
+TEST_F(CandidateIndex, SameCandidates) {
+  baldr::GraphReader reader(map.config.get_child("mjolnir"));
+  baldr::GraphReader indexed_reader(indexed_config.get_child("mjolnir"));
+
+  // only the copy has an index
+  const auto local_level = baldr::TileHierarchy::levels().back().level;
+  size_t tiles = 0;
+  for (const auto& tile_id : indexed_reader.GetTileSet(local_level)) {
+    EXPECT_GT(indexed_reader.GetGraphTile(tile_id)->header()->candidate_index_offset(), 0u);
+    EXPECT_EQ(reader.GetGraphTile(tile_id)->header()->candidate_index_offset(), 0u);
+    ++tiles;
+  }
+  ASSERT_GT(tiles, 1u);
+
+  const float tile_size = baldr::TileHierarchy::levels().back().tiles.TileSize();
+  meili::CandidateGridQuery query(reader, tile_size / kGridSize, tile_size / kGridSize);
+  meili::CandidateGridQuery indexed_query(indexed_reader, tile_size / kGridSize,
+                                          tile_size / kGridSize);
+
+  // points along every way and a bit off to its side, away from the nodes so that no candidate
+  // is dropped for snapping to a node another one snapped to already
+  size_t found = 0;
+  for (const std::string way : {"AB", "BC", "CD", "DE", "EF", "GA", "BH", "DJ", "FL", "GH", "HI",
+                                "IJ", "JK", "KL"}) {
+    const auto& a = map.nodes.at(way.substr(0, 1));
+    const auto& b = map.nodes.at(way.substr(1, 1));
+    for (double along : {0.1, 0.3, 0.5, 0.7, 0.9}) {
+      for (double side : {0.0, 0.0002, -0.0003}) {
+        midgard::PointLL point(a.lng() + (b.lng() - a.lng()) * along + side,
+                               a.lat() + (b.lat() - a.lat()) * along + side);
+        auto expected = candidates(query, point);
+        EXPECT_EQ(candidates(indexed_query, point), expected) << way << " " << along << " " << side;
+        found += expected.size();
+      }
+    }
+  }
+  EXPECT_GT(found, 0u);
+
+  // the tiles with an index answer the queries without any grid being built
+  EXPECT_GT(query.size(), 0u);
+  EXPECT_EQ(indexed_query.size(), 0u);
+}
+
+} // namespace
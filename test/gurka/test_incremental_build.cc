@@ -0,0 +1,153 @@
+#include "baldr/graphtile.h"
+#include "baldr/tilehierarchy.h"
+#include "gurka.h"
+#include "mjolnir/incrementalbuilder.h"
+#include "mjolnir/util.h"
+#include "test.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+
+using namespace valhalla;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+// spans 4 columns and 2 rows of local tiles, only the bottom row changes
+const std::string ascii_map = R"(
+    A-----B-----C-----D-----E-----F
+    |                             |
+    |                             |
+    |           X                 |
+    |           |                 |
+    G-----H-----I-----J-----K-----L
+)";
+
+// way ids are given so that the change file can refer to them
+gurka::ways make_ways(const bool changed) {
+  gurka::ways ways;
+  uint64_t osm_id = 100;
+  for (const std::string way : {"AB", "BC", "CD", "DE", "EF", "FL", "GA", "HG", "IH", "IX", "JI",
+                                "KJ", "LK"}) {
+    ++osm_id;
+    if (way == "IX" && !changed) {
+      continue;
+    }
+    ways[way] = {{"highway", way == "IX" ? "residential" : "primary"},
+                 {"name", way == "KJ" && changed ? "New Street" : way},
+                 {"osm_id", std::to_string(osm_id)}};
+  }
+  return ways;
+}
+
+// the change from the ways above to the changed ways
+const std::string change_file_contents = R"(<?xml version="1.0" encoding="UTF-8"?>
+<osmChange version="0.6" generator="gurka">
+  <create>
+    <way id="110" version="1"/>
+  </create>
+  <modify>
+    <way id="112" version="2"/>
+  </modify>
+</osmChange>
+)";
+
+class IncrementalBuild : public ::testing::Test {
+protected:
+  static void SetUpTestSuite() {
+    std::filesystem::remove_all(workdir);
+    std::filesystem::create_directories(workdir);
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, 3000);
+    gurka::detail::build_pbf(layout, make_ways(false), {}, {}, workdir + "/original.pbf");
+    gurka::detail::build_pbf(layout, make_ways(true), {}, {}, workdir + "/changed.pbf");
+    std::ofstream(workdir + "/changes.osc") << change_file_contents;
+  }
+
+  static boost::property_tree::ptree config(const std::string& name, const bool incremental) {
+    std::unordered_map<std::string, std::string> options = {{"mjolnir.concurrency", "1"}};
+    if (incremental) {
+      options["mjolnir.incremental_dir"] = workdir + "/kept";
+    }
+    return test::make_config(workdir + "/" + name, options);
+  }
+
+  static bool build(const boost::property_tree::ptree& config,
+                    const std::string& pbf,
+                    const std::vector<std::string>& change_files = {}) {
+    return build_tile_set(config, {workdir + "/" + pbf}, BuildStage::kInitialize,
+                          BuildStage::kCleanup, change_files);
+  }
+
+  static const std::string workdir;
+};
+
+const std::string IncrementalBuild::workdir = "test/data/gurka_incremental_build";
+
+TEST_F(IncrementalBuild, SameAsFullBuild) {
+  const auto incremental = config("incremental", true);
+  const auto tile_dir = incremental.get<std::string>("mjolnir.tile_dir");
+  ASSERT_TRUE(build(incremental, "original.pbf"));
+  EXPECT_TRUE(std::filesystem::exists(workdir + "/kept/ways.bin"));
+  EXPECT_TRUE(std::filesystem::exists(workdir + "/kept/way_nodes.bin"));
+
+  // the original tiles are what the change is applied to
+  ASSERT_TRUE(build(config("original", false), "original.pbf"));
+  EXPECT_EQ(IncrementalBuilder::Compare(tile_dir, workdir + "/original"), 0u);
+
+  // only the tiles the change touched and their neighbours are built, the top row is copied
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 3000);
+  const auto local_level = baldr::TileHierarchy::levels().back().level;
+  auto tile_of = [&](const std::string& node) {
+    return baldr::TileHierarchy::GetGraphId(layout.at(node), local_level);
+  };
+  const auto staged = config("staged", false);
+  const std::filesystem::path staged_dir = staged.get<std::string>("mjolnir.tile_dir");
+  ASSERT_TRUE(build_tile_set(staged, {workdir + "/changed.pbf"}, BuildStage::kInitialize,
+                             BuildStage::kConstructEdges));
+  const auto tiles = TileManifest::ReadFromFile((staged_dir / "tile_manifest.json").string()).tileset;
+  auto restored = incremental;
+  const std::filesystem::path restored_dir = workdir + "/restored";
+  restored.put("mjolnir.tile_dir", restored_dir.string());
+  const auto build_tiles =
+      IncrementalBuilder::Restore(restored, {workdir + "/changes.osc"},
+                                  (staged_dir / "ways.bin").string(),
+                                  (staged_dir / "way_nodes.bin").string(), tiles, 1);
+  for (const std::string node : {"A", "B", "C", "D", "E", "F"}) {
+    EXPECT_EQ(build_tiles.count(tile_of(node)), 0u) << node;
+    EXPECT_TRUE(std::filesystem::exists(restored_dir / baldr::GraphTile::FileSuffix(tile_of(node))))
+        << node;
+  }
+  for (const std::string node : {"I", "J", "K", "X"}) {
+    EXPECT_EQ(build_tiles.count(tile_of(node)), 1u) << node;
+  }
+  EXPECT_LT(build_tiles.size(), tiles.size());
+
+  ASSERT_TRUE(build(incremental, "changed.pbf", {workdir + "/changes.osc"}));
+  ASSERT_TRUE(build(config("full", false), "changed.pbf"));
+  EXPECT_EQ(IncrementalBuilder::Compare(tile_dir, workdir + "/full"), 0u);
+  EXPECT_GT(IncrementalBuilder::Compare(tile_dir, workdir + "/original"), 0u);
+
+  // the new way made it into the graph
+  gurka::map map{incremental, layout};
+  auto result = gurka::do_action(valhalla::Options::route, map, {"X", "F"}, "auto");
+  gurka::assert::raw::expect_path(result, {"IX", "JI", "New Street", "LK", "FL"});
+}
+
+TEST_F(IncrementalBuild, NoLastBuild) {
+  // without anything kept every tile is built
+  const auto incremental = config("no_last_build", true);
+  std::filesystem::remove_all(workdir + "/kept");
+  ASSERT_TRUE(build(incremental, "changed.pbf", {workdir + "/changes.osc"}));
+  ASSERT_TRUE(build(config("full", false), "changed.pbf"));
+  EXPECT_EQ(IncrementalBuilder::Compare(incremental.get<std::string>("mjolnir.tile_dir"),
+                                        workdir + "/full"),
+            0u);
+}
+
+TEST_F(IncrementalBuild, ChangesNeedIncrementalDir) {
+  EXPECT_FALSE(build(config("not_incremental", false), "changed.pbf", {workdir + "/changes.osc"}));
+}
+
+} // namespace
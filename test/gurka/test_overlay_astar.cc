@@ -0,0 +1,141 @@
+#include "gurka.h"
+#include "mjolnir/util.h"
+#include "test.h"
+#include "thor/overlay_astar.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace valhalla;
+
+namespace {
+
+// Two motorways 100km apart, with a grid of 50km the map is about 18 degrees wide and spans several
+// cells of the highway level. The slow stretch on top makes the best route switch over and back
+const std::string ascii_map = R"(
+    A---b---c---d---e---f---g---h---i---j---B
+    |       |       |       |       |       |
+    k---l---m---n---o---p---q---r---s---t---C
+)";
+
+const std::string workdir = "test/data/gurka_overlay_astar";
+
+gurka::ways make_ways() {
+  gurka::ways ways;
+  for (const std::string way : {"Ab", "bc", "cd", "de", "ef", "fg", "gh", "hi", "ij", "jB", "kl",
+                                "lm", "mn", "no", "op", "pq", "qr", "rs", "st", "tC", "Ak", "cm",
+                                "eo", "gq", "is", "BC"}) {
+    ways[way] = {{"highway", "motorway"}, {"oneway", "no"}, {"name", way}};
+  }
+  ways["ef"]["maxspeed"] = "30";
+  ways["fg"]["maxspeed"] = "30";
+  return ways;
+}
+
+class OverlayAStar : public ::testing::Test {
+protected:
+  static void SetUpTestSuite() {
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, 50000, {3.0, 10.0});
+    map = gurka::buildtiles(layout, make_ways(), {}, {}, workdir,
+                            {{"mjolnir.concurrency", "1"},
+                             {"mjolnir.overlay", workdir + "/overlay.bin"},
+                             {"thor.overlay_astar.min_distance", "1000"},
+                             {"thor.overlay_astar.customize_after", "1"}});
+    // the overlay stage runs after the graph is validated
+    ASSERT_TRUE(mjolnir::build_tile_set(map.config, {}, mjolnir::BuildStage::kOverlay,
+                                        mjolnir::BuildStage::kOverlay));
+
+    // the same graph without the overlay routes with bidirectional A*
+    plain_map = map;
+    plain_map.config.get_child("mjolnir").erase("overlay");
+  }
+
+  // routes twice since the options of the first request are only customized in the background
+  static valhalla::Api route_with_overlay(const std::vector<std::string>& waypoints,
+                                          const std::unordered_map<std::string, std::string>& options) {
+    gurka::do_action(Options::route, map, waypoints, "auto", options);
+    thor::get_overlay_metric_cache(map.config)->wait();
+    return gurka::do_action(Options::route, map, waypoints, "auto", options);
+  }
+
+  static void expect_same_route(const std::vector<std::string>& waypoints,
+                                const std::unordered_map<std::string, std::string>& options = {}) {
+    auto overlay = route_with_overlay(waypoints, options);
+    auto bidirectional = gurka::do_action(Options::route, plain_map, waypoints, "auto", options);
+    ASSERT_EQ(overlay.trip().routes(0).legs(0).algorithms(0), "overlay_a*");
+    ASSERT_EQ(bidirectional.trip().routes(0).legs(0).algorithms(0), "bidirectional_a*");
+
+    EXPECT_EQ(gurka::detail::get_paths(overlay), gurka::detail::get_paths(bidirectional));
+    auto cost = [](const valhalla::Api& result) {
+      return result.trip().routes(0).legs(0).node().rbegin()->cost().elapsed_cost();
+    };
+    EXPECT_NEAR(cost(overlay).cost(), cost(bidirectional).cost(), 1e-4 * cost(overlay).cost());
+    EXPECT_NEAR(cost(overlay).seconds(), cost(bidirectional).seconds(),
+                1e-4 * cost(overlay).seconds());
+  }
+
+  static gurka::map map;
+  static gurka::map plain_map;
+};
+
+gurka::map OverlayAStar::map = {};
+gurka::map OverlayAStar::plain_map = {};
+
+TEST_F(OverlayAStar, HighwayCells) {
+  auto overlay = baldr::GraphOverlay::Read(workdir + "/overlay.bin");
+  // the motorways cross from cell to cell, at least one cell lies between the ends of the map
+  EXPECT_GE(overlay.cells().size(), 3u);
+  for (const auto& cell : overlay.cells()) {
+    EXPECT_EQ(cell.tile_id.level(), baldr::TileHierarchy::levels().front().level);
+  }
+}
+
+TEST_F(OverlayAStar, SameAsBidirectional) {
+  expect_same_route({"A", "B"});
+  expect_same_route({"B", "A"});
+  expect_same_route({"k", "B"});
+  expect_same_route({"C", "A"});
+}
+
+TEST_F(OverlayAStar, CustomizedSameAsBidirectional) {
+  // each set of options gets a metric of its own, the costs have to match the regular search
+  expect_same_route({"A", "B"}, {{"/costing_options/auto/top_speed", "60"}});
+  expect_same_route({"B", "k"}, {{"/costing_options/auto/shortest", "1"}});
+  expect_same_route({"C", "A"}, {{"/costing_options/auto/use_highways", "0.2"}});
+}
+
+TEST_F(OverlayAStar, NoHierarchyPruning) {
+  // the cells only have the highway level, routes that may use any level anywhere cannot hop
+  auto result =
+      gurka::do_action(Options::route, map, {"A", "B"}, "auto",
+                       {{"/costing_options/auto/disable_hierarchy_pruning", "1"}});
+  EXPECT_EQ(result.trip().routes(0).legs(0).algorithms(0), "bidirectional_a*");
+}
+
+TEST_F(OverlayAStar, UnsupportedOptions) {
+  // the clique weights know nothing of time, alternates or the exclusions of a single request
+  auto algorithm = [](const valhalla::Api& result) {
+    return result.trip().routes(0).legs(0).algorithms(0);
+  };
+  EXPECT_NE(algorithm(route_with_overlay({"A", "B"}, {{"/date_time/type", "1"},
+                                                      {"/date_time/value", "2020-04-15T06:00"}})),
+            "overlay_a*");
+  EXPECT_NE(algorithm(route_with_overlay({"A", "B"}, {{"/alternates", "1"}})), "overlay_a*");
+
+  auto location = [](const midgard::PointLL& ll) {
+    return R"({"lat":)" + std::to_string(ll.lat()) + R"(,"lon":)" + std::to_string(ll.lng()) + "}";
+  };
+  const auto& d = map.nodes.at("d");
+  const auto& e = map.nodes.at("e");
+  const auto request = R"({"locations":[)" + location(map.nodes.at("A")) + "," +
+                       location(map.nodes.at("B")) + R"(],"costing":"auto","exclude_locations":[)" +
+                       location({(d.lng() + e.lng()) / 2, (d.lat() + e.lat()) / 2}) + "]}";
+  gurka::do_action(Options::route, map, request);
+  thor::get_overlay_metric_cache(map.config)->wait();
+  EXPECT_NE(algorithm(gurka::do_action(Options::route, map, request)), "overlay_a*");
+}
+
+} // namespace
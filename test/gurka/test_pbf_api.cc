@@ -54,7 +54,7 @@ TEST(pbf_api, pbf_in_out) {
     // do the regular request with json in and out
     std::string expected_json, request_json;
     Api expected_pbf;
-    if (action == Options::sources_to_targets) {
+    if (action == Options::sources_to_targets || action == Options::batch_route) {
       expected_pbf = gurka::do_action(Options::Action(action), map, {"A", "C"}, {"I", "G"},
                                       "pedestrian", {}, {}, &expected_json, &request_json);
     } else if (action == Options::isochrone) {
@@ -1,15 +1,19 @@
+#include "baldr/rapidjson_utils.h"
 #include "gurka.h"
-#include "loki/reach.h"
+#include "mjolnir/util.h"
 #include "sif/costfactory.h"
 #include "sif/dynamiccost.h"
 #include "test.h"
+#include "thor/reach.h"
 
 #include <valhalla/proto/options.pb.h>
 
 #include <gtest/gtest.h>
 
+#include <string>
+
 using namespace valhalla;
-using namespace valhalla::loki;
+using namespace valhalla::thor;
 using LiveTrafficCustomize = test::LiveTrafficCustomize;
 
 namespace {
@@ -132,7 +136,7 @@ TEST_F(TestReach, ReachWithNoClosures) {
   auto edge = gurka::findEdgeByNodes(*reader, closure_map.nodes, "A", "B");
 
   // check its reach
-  loki::Reach reach_checker;
+  thor::Reach reach_checker;
   auto reach = reach_checker(std::get<1>(edge), std::get<0>(edge), 50, *reader, costing);
 
   // all edges should have the same in/outbound reach
@@ -156,7 +160,7 @@ TEST_F(TestReach, ReachWithClosures) {
   // - flow mask: "default" (includes current) to consider live speeds
   // - filter_closures: enabled, to remove closed edges
   sif::CostFactory factory;
-  loki::Reach reach_checker;
+  thor::Reach reach_checker;
 
   Costing c;
   c.set_type(Costing::auto_);
@@ -217,7 +221,7 @@ TEST_F(TestReach, DISABLED_ReachWithClosures2) {
   // - flow mask: "default" (includes current) to consider live speeds
   // - filter_closures: enabled, to remove closed edges
   sif::CostFactory factory;
-  loki::Reach reach_checker;
+  thor::Reach reach_checker;
 
   Costing c;
   c.set_type(Costing::auto_);
@@ -231,3 +235,69 @@ TEST_F(TestReach, DISABLED_ReachWithClosures2) {
   EXPECT_EQ(reach.inbound, 3);
   EXPECT_EQ(reach.outbound, 3);
 }
+
+TEST(StoredReach, SameAsExpanded) {
+  // a dead end, a oneway, a road that is cut off and a bigger grid to hit the cap
+  const std::string ascii_map = R"(
+      A---B---C---D
+      |   |   |   |
+      E---F---G---H---I---J
+                  |
+                  K
+
+      L---M---N
+     )";
+  const gurka::ways ways = {{"ABCD", {{"highway", "residential"}}},
+                            {"EFGHIJ", {{"highway", "residential"}}},
+                            {"AE", {{"highway", "residential"}}},
+                            {"BF", {{"highway", "residential"}}},
+                            {"CG", {{"highway", "residential"}}},
+                            {"DH", {{"highway", "residential"}, {"oneway", "yes"}}},
+                            {"HK", {{"highway", "residential"}}},
+                            {"LMN", {{"highway", "residential"}}}};
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/stored_reach");
+
+  // store the reach capped below the size of the grid so some edges are capped and some are not
+  constexpr uint32_t max_reach = 8;
+  const std::vector<Costing::Type> costing_types{Costing::auto_, Costing::pedestrian};
+  boost::property_tree::ptree costings;
+  for (const auto type : costing_types) {
+    boost::property_tree::ptree costing;
+    costing.put("", Costing_Enum_Name(type));
+    costings.push_back({"", costing});
+  }
+  map.config.put_child("mjolnir.reach.costings", costings);
+  map.config.put("mjolnir.reach.max_reach", max_reach);
+  ASSERT_TRUE(mjolnir::build_tile_set(map.config, {}, mjolnir::BuildStage::kReach,
+                                      mjolnir::BuildStage::kReach));
+
+  // the reach loki expands for a request without any costing options
+  baldr::GraphReader reader(map.config.get_child("mjolnir"));
+  sif::CostFactory factory;
+  Reach reach_finder;
+  size_t capped = 0, exact = 0;
+  for (const auto type : costing_types) {
+    rapidjson::Document doc;
+    doc.SetObject();
+    Costing costing_options;
+    sif::ParseCosting(doc, "/costing_options/" + Costing_Enum_Name(type), &costing_options, type);
+    const auto costing = factory.Create(costing_options);
+
+    for (const auto& tile_id : reader.GetTileSet()) {
+      auto tile = reader.GetGraphTile(tile_id);
+      baldr::GraphId edge_id = tile_id;
+      for (uint32_t e = 0; e < tile->header()->directededgecount(); ++e, ++edge_id) {
+        baldr::StoredReach stored;
+        ASSERT_EQ(tile->GetStoredReach(e, static_cast<uint8_t>(type), stored), max_reach);
+        const auto expanded =
+            reach_finder(tile->directededge(e), edge_id, max_reach, reader, costing);
+        EXPECT_EQ(stored.outbound, expanded.outbound) << Costing_Enum_Name(type) << " " << edge_id;
+        EXPECT_EQ(stored.inbound, expanded.inbound) << Costing_Enum_Name(type) << " " << edge_id;
+        (expanded.outbound < max_reach ? exact : capped)++;
+      }
+    }
+  }
+  EXPECT_GT(exact, 0u);
+  EXPECT_GT(capped, 0u);
+}
@@ -1,10 +1,13 @@
 #include "baldr/json.h"
+#include "baldr/rapidjson_utils.h"
 #include "loki/worker.h"
+#include "meili/map_matcher_factory.h"
 #include "midgard/distanceapproximator.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
 #include "midgard/util.h"
 #include "odin/worker.h"
+#include "sif/costfactory.h"
 #include "test.h"
 #include "thor/worker.h"
 #include "tyr/actor.h"
@@ -12,7 +15,9 @@
 
 #include <algorithm>
 #include <iostream>
+#include <list>
 #include <random>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -292,6 +297,29 @@ TEST(Mapmatch, test_matcher) {
   }
 }
 
+TEST(Mapmatch, test_narrow_beam_same_as_default) {
+  // a clean trace along one street, a narrow beam only drops candidates that are not on its path
+  const std::string trace = R"({"costing":"auto","shape_match":"map_snap","shape":[
+      {"lat": 52.098134, "lon": 5.130043},
+      {"lat": 52.098125, "lon": 5.130946},
+      {"lat": 52.098064, "lon": 5.131499},
+      {"lat": 52.098087, "lon": 5.131504}]})";
+  auto matched_edges = [&trace](const boost::property_tree::ptree& config) {
+    tyr::actor_t actor(config, true);
+    auto matched = test::json_to_pt(actor.trace_attributes(trace));
+    std::vector<uint64_t> edges;
+    for (const auto& edge : matched.get_child("edges"))
+      edges.push_back(edge.second.get<uint64_t>("id"));
+    return edges;
+  };
+
+  auto narrow_conf = conf;
+  narrow_conf.put("meili.default.beam_width", 2);
+  const auto expected = matched_edges(conf);
+  ASSERT_FALSE(expected.empty());
+  EXPECT_EQ(matched_edges(narrow_conf), expected);
+}
+
 TEST(Mapmatch, test_distance_only) {
   tyr::actor_t actor(conf, true);
   auto matched = test::json_to_pt(actor.trace_attributes(
@@ -1519,6 +1547,116 @@ TEST(Mapmatch, openlr_parameter_falsy_native_api) {
     EXPECT_THROW(response.get_child("trip.linear_references"), std::runtime_error);
   }
 }
+TEST(Mapmatch, online_match) {
+  // a trace along a route across town, with the odd measurement close enough to be interpolated
+  tyr::actor_t actor(conf, true);
+  const auto route = test::json_to_pt(actor.route(
+      R"({"costing":"auto","locations":[{"lat":52.09110,"lon":5.09806},{"lat":52.10250,"lon":5.11690}]})"));
+  const auto shape = midgard::resample_spherical_polyline(
+      midgard::decode<std::vector<PointLL>>(
+          route.get_child("trip.legs").front().second.get<std::string>("shape")),
+      25.);
+  std::vector<meili::Measurement> measurements;
+  for (size_t i = 0; i < shape.size(); ++i) {
+    measurements.emplace_back(shape[i], 5.f, 15.f);
+    if (i % 5 == 2) {
+      measurements.emplace_back(PointLL(shape[i].lng() + 2e-5, shape[i].lat()), 5.f, 15.f);
+    }
+  }
+
+  Options options;
+  options.set_costing_type(Costing::auto_);
+  sif::ParseCosting(rapidjson::Document{}, "/costing_options", options);
+  meili::MapMatcherFactory factory(conf);
+  std::unique_ptr<meili::MapMatcher> matcher(factory.Create(options));
+  const auto expected = matcher->OfflineMatch(measurements).front().results;
+
+  // feed it a few measurements at a time
+  std::vector<meili::MatchResult> results;
+  for (auto begin = measurements.cbegin(); begin != measurements.cend();) {
+    const auto end = begin + std::min<ptrdiff_t>(3, measurements.cend() - begin);
+    const auto matched = matcher->OnlineMatch({begin, end}, end == measurements.cend());
+    results.insert(results.end(), matched.cbegin(), matched.cend());
+    // results only come once they are final, they can't be far behind
+    EXPECT_LT(static_cast<size_t>(end - measurements.cbegin()) - results.size(), 20u);
+    begin = end;
+  }
+
+  ASSERT_EQ(results.size(), expected.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].edgeid, expected[i].edgeid) << "at measurement " << i;
+    EXPECT_NEAR(results[i].distance_along, expected[i].distance_along, 1e-6)
+        << "at measurement " << i;
+    EXPECT_EQ(results[i].GetType(), expected[i].GetType()) << "at measurement " << i;
+  }
+}
+
+TEST(Mapmatch, shared_grid_cache) {
+  // a few traces across town
+  tyr::actor_t actor(conf, true);
+  std::vector<std::vector<meili::Measurement>> traces;
+  for (const auto& locations :
+       {R"([{"lat":52.09110,"lon":5.09806},{"lat":52.10250,"lon":5.11690}])",
+        R"([{"lat":52.10250,"lon":5.11690},{"lat":52.0797372,"lon":5.1293068}])",
+        R"([{"lat":52.0797372,"lon":5.1293068},{"lat":52.09110,"lon":5.09806}])"}) {
+    const auto route = test::json_to_pt(actor.route(
+        R"({"costing":"auto","locations":)" + std::string(locations) + "}"));
+    traces.emplace_back();
+    for (const auto& point : midgard::resample_spherical_polyline(
+             midgard::decode<std::vector<PointLL>>(
+                 route.get_child("trip.legs").front().second.get<std::string>("shape")),
+             30.)) {
+      traces.back().emplace_back(point, 5.f, 15.f);
+    }
+  }
+
+  Options options;
+  options.set_costing_type(Costing::auto_);
+  sif::ParseCosting(rapidjson::Document{}, "/costing_options", options);
+  auto match = [&options](meili::MapMatcherFactory& factory,
+                          const std::vector<meili::Measurement>& trace) {
+    std::unique_ptr<meili::MapMatcher> matcher(factory.Create(options));
+    std::vector<baldr::GraphId> edges;
+    for (const auto& result : matcher->OfflineMatch(trace).front().results) {
+      edges.push_back(result.edgeid);
+    }
+    return edges;
+  };
+
+  // match them one after the other
+  meili::MapMatcherFactory serial_factory(conf);
+  std::vector<std::vector<baldr::GraphId>> expected;
+  for (const auto& trace : traces) {
+    expected.emplace_back(match(serial_factory, trace));
+  }
+
+  // and all of them on each of a few threads which only index the bins once between them
+  meili::MapMatcherFactory first_factory(conf);
+  std::list<meili::MapMatcherFactory> factories;
+  for (size_t i = 0; i < 4; ++i) {
+    factories.emplace_back(conf, nullptr, first_factory.grid_cache());
+  }
+  std::vector<std::vector<std::vector<baldr::GraphId>>> results(factories.size());
+  std::vector<std::thread> threads;
+  auto results_it = results.begin();
+  for (auto& factory : factories) {
+    threads.emplace_back([&, &thread_results = *results_it++]() {
+      for (const auto& trace : traces) {
+        thread_results.emplace_back(match(factory, trace));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (const auto& thread_results : results) {
+    EXPECT_EQ(thread_results, expected);
+  }
+  EXPECT_GT(first_factory.grid_cache()->size(), 0u);
+  EXPECT_EQ(first_factory.grid_cache()->size(), serial_factory.grid_cache()->size());
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -4,6 +4,7 @@
 #include "midgard/logging.h"
 #include "sif/dynamiccost.h"
 #include "test.h"
+#include "thor/bucketmatrix.h"
 #include "thor/costmatrix.h"
 #include "thor/timedistancematrix.h"
 #include "thor/worker.h"
@@ -284,6 +285,151 @@ TEST(Matrix, test_matrix) {
   }
 }
 
+TEST(Matrix, test_matrix_threads) {
+  loki_worker_t loki_worker(cfg);
+
+  Api request;
+  ParseApi(test_request, Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  thor_worker_t::adjust_scores(*request.mutable_options());
+
+  GraphReader reader(cfg.get_child("mjolnir"));
+
+  sif::mode_costing_t mode_costing;
+  mode_costing[0] =
+      CreateSimpleCost(request.options().costings().find(request.options().costing_type())->second);
+  set_hierarchy_limits(mode_costing[0]);
+  CostMatrix cost_matrix;
+  cost_matrix.SourceToTarget(request, reader, mode_costing, sif::TravelMode::kDrive, 400000.0);
+  const auto expected = request.matrix().SerializeAsString();
+
+  // with more threads than locations they all expand on the calling thread
+  for (uint32_t threads : {2, 3, 4, 8}) {
+    std::vector<std::shared_ptr<GraphReader>> readers;
+    for (uint32_t i = 1; i < threads; ++i) {
+      readers.emplace_back(std::make_shared<GraphReader>(cfg.get_child("mjolnir")));
+    }
+    CostMatrix parallel_matrix;
+    parallel_matrix.set_thread_readers(readers);
+
+    // the second time around the threads are reused
+    for (int run = 0; run < 2; ++run) {
+      request.clear_matrix();
+      parallel_matrix.SourceToTarget(request, reader, mode_costing, sif::TravelMode::kDrive,
+                                     400000.0);
+      parallel_matrix.Clear();
+      EXPECT_EQ(request.matrix().SerializeAsString(), expected)
+          << "CostMatrix on " + std::to_string(threads) + " threads differs from one thread";
+    }
+  }
+}
+
+TEST(Matrix, test_bucketmatrix) {
+  loki_worker_t loki_worker(cfg);
+
+  Api request;
+  ParseApi(test_request, Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  thor_worker_t::adjust_scores(*request.mutable_options());
+
+  GraphReader reader(cfg.get_child("mjolnir"));
+
+  sif::mode_costing_t mode_costing;
+  mode_costing[0] =
+      CreateSimpleCost(request.options().costings().find(request.options().costing_type())->second);
+  set_hierarchy_limits(mode_costing[0]);
+  BucketMatrix bucket_matrix;
+  bucket_matrix.SourceToTarget(request, reader, mode_costing, sif::TravelMode::kDrive, 400000.0);
+  EXPECT_EQ(request.matrix().algorithm(), Matrix::BucketMatrix);
+  auto matrix = request.matrix();
+  for (int i = 0; i < matrix.times().size(); ++i) {
+    EXPECT_NEAR(matrix.distances()[i], matrix_answers[i][1], kThreshold)
+        << "result " + std::to_string(i) + "'s distance is not close enough" +
+               " to expected value for BucketMatrix";
+
+    EXPECT_NEAR(matrix.times()[i], matrix_answers[i][0], kThreshold)
+        << "result " + std::to_string(i) + "'s time is not close enough" +
+               " to expected value for BucketMatrix";
+  }
+  const auto expected = matrix.SerializeAsString();
+  bucket_matrix.Clear();
+
+  // the searches of the targets and then of the sources are spread over the threads
+  std::vector<std::shared_ptr<GraphReader>> readers;
+  for (uint32_t i = 1; i < 3; ++i) {
+    readers.emplace_back(std::make_shared<GraphReader>(cfg.get_child("mjolnir")));
+  }
+  BucketMatrix parallel_matrix;
+  parallel_matrix.set_thread_readers(readers);
+  request.clear_matrix();
+  parallel_matrix.SourceToTarget(request, reader, mode_costing, sif::TravelMode::kDrive, 400000.0);
+  EXPECT_EQ(request.matrix().SerializeAsString(), expected)
+      << "BucketMatrix on 3 threads differs from one thread";
+}
+
+// Many sources and targets expanding on many threads, best run in a -fsanitize=thread build: the
+// connection checks of one direction all read the search state of the other one at the same time
+TEST(Matrix, test_matrix_threads_stress) {
+  std::string locations;
+  for (int lat = 0; lat < 6; ++lat) {
+    for (int lon = 0; lon < 6; ++lon) {
+      locations += (locations.empty() ? "" : ",") + std::string("{\"lat\":") +
+                   std::to_string(52.09 + lat * 0.005) +
+                   ",\"lon\":" + std::to_string(5.065 + lon * 0.008) + "}";
+    }
+  }
+  const auto stress_request = "{\"sources\":[" + locations + "],\"targets\":[" + locations +
+                              "],\"costing\":\"auto\"}";
+
+  loki_worker_t loki_worker(cfg);
+  Api request;
+  ParseApi(stress_request, Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  thor_worker_t::adjust_scores(*request.mutable_options());
+
+  GraphReader reader(cfg.get_child("mjolnir"));
+  sif::mode_costing_t mode_costing;
+  mode_costing[0] =
+      CreateSimpleCost(request.options().costings().find(request.options().costing_type())->second);
+  set_hierarchy_limits(mode_costing[0]);
+
+  std::vector<std::shared_ptr<GraphReader>> readers;
+  for (uint32_t i = 1; i < 8; ++i) {
+    readers.emplace_back(std::make_shared<GraphReader>(cfg.get_child("mjolnir")));
+  }
+
+  CostMatrix cost_matrix;
+  cost_matrix.SourceToTarget(request, reader, mode_costing, sif::TravelMode::kDrive, 400000.0);
+  const auto cost_expected = request.matrix().SerializeAsString();
+  cost_matrix.Clear();
+  CostMatrix parallel_cost_matrix;
+  parallel_cost_matrix.set_thread_readers(readers);
+
+  BucketMatrix bucket_matrix;
+  request.clear_matrix();
+  bucket_matrix.SourceToTarget(request, reader, mode_costing, sif::TravelMode::kDrive, 400000.0);
+  const auto bucket_expected = request.matrix().SerializeAsString();
+  bucket_matrix.Clear();
+  BucketMatrix parallel_bucket_matrix;
+  parallel_bucket_matrix.set_thread_readers(readers);
+
+  for (int run = 0; run < 3; ++run) {
+    request.clear_matrix();
+    parallel_cost_matrix.SourceToTarget(request, reader, mode_costing, sif::TravelMode::kDrive,
+                                        400000.0);
+    parallel_cost_matrix.Clear();
+    EXPECT_EQ(request.matrix().SerializeAsString(), cost_expected)
+        << "CostMatrix on 8 threads differs from one thread in run " + std::to_string(run);
+
+    request.clear_matrix();
+    parallel_bucket_matrix.SourceToTarget(request, reader, mode_costing, sif::TravelMode::kDrive,
+                                          400000.0);
+    parallel_bucket_matrix.Clear();
+    EXPECT_EQ(request.matrix().SerializeAsString(), bucket_expected)
+        << "BucketMatrix on 8 threads differs from one thread in run " + std::to_string(run);
+  }
+}
+
 TEST(Matrix, test_timedistancematrix_forward) {
   // Input request is the same as `test_request`, but without the last target
   const auto test_request_more_sources = R"({
@@ -0,0 +1,82 @@
+#include "thor/overlay_astar.h"
+#include "test.h"
+
+#include <boost/property_tree/ptree.hpp>
+
+using namespace valhalla;
+using namespace valhalla::thor;
+
+namespace {
+
+// Without cells there is nothing to search, which leaves only the bookkeeping of the cache
+OverlayMetricCache make_cache(uint32_t customize_after, uint32_t max_metrics) {
+  boost::property_tree::ptree config;
+  config.put("mjolnir.tile_dir", "test/data/does_not_exist");
+  config.put("thor.overlay_astar.customize_after", customize_after);
+  config.put("thor.overlay_astar.max_metrics", max_metrics);
+  config.put("thor.overlay_astar.concurrency", 2);
+  return OverlayMetricCache(std::make_shared<const baldr::GraphOverlay>(), config);
+}
+
+Costing make_costing(Costing::Type type, float use_highways) {
+  Costing costing;
+  costing.set_type(type);
+  costing.mutable_options()->set_use_highways(use_highways);
+  return costing;
+}
+
+TEST(OverlayMetricCache, Fingerprint) {
+  auto costing = make_costing(Costing::auto_, 0.5f);
+  EXPECT_EQ(OverlayMetric::fingerprint(costing), OverlayMetric::fingerprint(costing));
+  EXPECT_NE(OverlayMetric::fingerprint(costing),
+            OverlayMetric::fingerprint(make_costing(Costing::auto_, 0.4f)));
+  EXPECT_NE(OverlayMetric::fingerprint(costing),
+            OverlayMetric::fingerprint(make_costing(Costing::truck, 0.5f)));
+}
+
+TEST(OverlayMetricCache, CustomizeAfter) {
+  auto cache = make_cache(2, 4);
+  auto costing = make_costing(Costing::auto_, 0.5f);
+  EXPECT_EQ(cache.get(costing), nullptr);
+  cache.wait();
+  EXPECT_EQ(cache.get(costing), nullptr);
+  cache.wait();
+
+  auto metric = cache.get(costing);
+  ASSERT_NE(metric, nullptr);
+  EXPECT_TRUE(metric->matches(costing));
+  EXPECT_FALSE(metric->matches(make_costing(Costing::auto_, 0.4f)));
+  EXPECT_EQ(cache.get(make_costing(Costing::auto_, 0.4f)), nullptr);
+}
+
+TEST(OverlayMetricCache, Unsupported) {
+  auto cache = make_cache(1, 4);
+  auto costing = make_costing(Costing::pedestrian, 0.5f);
+  cache.customize(costing);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(cache.get(costing), nullptr);
+    cache.wait();
+  }
+}
+
+TEST(OverlayMetricCache, LeastRecentlyUsed) {
+  auto cache = make_cache(1, 2);
+  auto first = make_costing(Costing::auto_, 0.1f);
+  auto second = make_costing(Costing::auto_, 0.2f);
+  auto third = make_costing(Costing::truck, 0.3f);
+
+  cache.customize(first);
+  cache.customize(second);
+  cache.wait();
+  EXPECT_NE(cache.get(second), nullptr);
+  EXPECT_NE(cache.get(first), nullptr);
+
+  // second was used least recently so it makes room for third
+  EXPECT_EQ(cache.get(third), nullptr);
+  cache.wait();
+  EXPECT_NE(cache.get(third), nullptr);
+  EXPECT_NE(cache.get(first), nullptr);
+  EXPECT_EQ(cache.get(second), nullptr);
+}
+
+} // namespace
@@ -0,0 +1,79 @@
+#include "tyr/pipeline_worker.h"
+#include "tyr/actor.h"
+#include "test.h"
+
+#include <string>
+
+#if !defined(VALHALLA_SOURCE_DIR)
+#define VALHALLA_SOURCE_DIR
+#endif
+
+using namespace valhalla;
+
+namespace {
+
+// fake up config against pine grove traffic extract
+const auto conf = test::make_config(VALHALLA_SOURCE_DIR "test/traffic_matcher_tiles");
+
+const std::string route_request = R"({"locations":[{"lat":40.546115,"lon":-76.385076,"type":"break"},
+      {"lat":40.544232,"lon":-76.385752,"type":"break"}],"costing":"auto"})";
+
+TEST(PipelineWorker, SameAsActor) {
+  tyr::actor_t actor(conf, true);
+  tyr::pipeline_worker_t worker(conf);
+
+  const struct {
+    Options::Action action;
+    std::string request;
+  } tests[] = {
+      {Options::route, route_request},
+      {Options::locate, route_request},
+      {Options::sources_to_targets, route_request},
+      {Options::trace_attributes, R"({"shape":[{"lat":40.546115,"lon":-76.385076},
+        {"lat":40.544232,"lon":-76.385752}],"costing":"auto","shape_match":"map_snap"})"},
+  };
+
+  for (const auto& t : tests) {
+    Api expected;
+    ParseApi(t.request, t.action, expected);
+    auto expected_response = actor.act(expected);
+
+    Api request;
+    ParseApi(t.request, t.action, request);
+    auto response = worker.act(request);
+    worker.cleanup();
+    EXPECT_EQ(response, expected_response) << Options_Action_Enum_Name(t.action);
+  }
+}
+
+TEST(PipelineWorker, UnsupportedAction) {
+  auto config = conf;
+  config.get_child("loki.actions").clear();
+  config.get_child("loki.actions").push_back({"", boost::property_tree::ptree("locate")});
+  tyr::pipeline_worker_t worker(config);
+
+  Api request;
+  ParseApi(route_request, Options::route, request);
+  try {
+    worker.act(request);
+    FAIL() << "Expected the route action to be rejected";
+  } catch (const valhalla_exception_t& e) { EXPECT_EQ(e.code, 106); }
+
+  Api locate;
+  ParseApi(route_request, Options::locate, locate);
+  EXPECT_NE(worker.act(locate).find("edges"), std::string::npos);
+}
+
+struct test_exception_t {};
+
+TEST(PipelineWorker, Interrupt) {
+  tyr::pipeline_worker_t worker(conf);
+  std::function<void()> interrupt = [] { throw test_exception_t{}; };
+  worker.set_interrupt(&interrupt);
+
+  Api request;
+  ParseApi(route_request, Options::route, request);
+  EXPECT_THROW(worker.act(request), test_exception_t);
+}
+
+} // namespace
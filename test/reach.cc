@@ -1,4 +1,3 @@
-#include "loki/reach.h"
 #include "baldr/graphreader.h"
 #include "baldr/rapidjson_utils.h"
 #include "gurka/gurka.h"
@@ -7,13 +6,14 @@
 #include "sif/costfactory.h"
 #include "sif/dynamiccost.h"
 #include "test.h"
+#include "thor/reach.h"
 
 #include <algorithm>
 
 using namespace valhalla;
 using namespace valhalla::midgard;
 using namespace valhalla::baldr;
-using namespace valhalla::loki;
+using namespace valhalla::thor;
 namespace vs = valhalla::sif;
 
 namespace {
@@ -109,7 +109,7 @@ TEST(Reach, transition_misscount) {
   auto edge = gurka::findEdgeByNodes(reader, map.nodes, "a", "f");
 
   // check its reach
-  loki::Reach reach_checker;
+  thor::Reach reach_checker;
   auto reach = reach_checker(std::get<1>(edge), std::get<0>(edge), 50, reader, costing);
 
   // all edges should have the same in/outbound reach
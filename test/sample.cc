@@ -11,6 +11,7 @@
 #include <filesystem>
 #include <fstream>
 #include <list>
+#include <random>
 
 using namespace valhalla;
 
@@ -118,6 +119,101 @@ TEST(Sample, getlz4) {
   _get("test/data/samplelz4");
 };
 
+TEST(Sample, elevation_store) {
+  // unpack the compressed tiles into a store and sample it the same way
+  ASSERT_TRUE(skadi::build_elevation_store("test/data/samplegz", "test/data/elevation.store"));
+  _get("test/data/elevation.store");
+
+  // it can also be configured, tiles it doesn't have still come from the directory
+  boost::property_tree::ptree config;
+  config.put("additional_data.elevation", "test/data/sample");
+  config.put("additional_data.elevation_store", "test/data/elevation.store");
+  {
+    std::vector<int16_t> tile(3601 * 3601, 0);
+    for (const auto& p : pixels)
+      tile[p.first] = p.second;
+    std::ofstream file("test/data/sample/N00/N00E001.hgt", std::ios::binary | std::ios::trunc);
+    file.write(static_cast<const char*>(static_cast<void*>(tile.data())),
+               sizeof(int16_t) * tile.size());
+  }
+  skadi::sample s(config);
+  EXPECT_NEAR(490, s.get(std::make_pair(-76.503915, 40.678783)), 1.0);
+  EXPECT_NEAR(490, s.get(std::make_pair(2 - 0.503915, 0.678783)), 1.0);
+  std::filesystem::remove("test/data/sample/N00/N00E001.hgt");
+
+  // rebuilding the store replaces it, the one already mapped keeps its data
+  std::filesystem::create_directories("test/data/sample_empty");
+  ASSERT_TRUE(skadi::build_elevation_store("test/data/sample_empty", "test/data/elevation.store"));
+  EXPECT_NEAR(490, s.get(std::make_pair(-76.503915, 40.678783)), 1.0);
+  EXPECT_FALSE(std::filesystem::exists("test/data/elevation.store.tmp"));
+  skadi::sample empty("test/data/elevation.store");
+  EXPECT_EQ(empty.get(std::make_pair(-76.503915, 40.678783)), skadi::get_no_data_value());
+  std::filesystem::remove("test/data/sample_empty");
+
+  // there is nothing to build a store from
+  EXPECT_FALSE(skadi::build_elevation_store("test/data/this_is_not_a_directory",
+                                            "test/data/elevation.store"));
+
+  // and something which isn't a store has no data
+  skadi::sample not_a_store("test/data/sample/N40/N40W077.hgt");
+  EXPECT_EQ(not_a_store.get(std::make_pair(-76.503915, 40.678783)), skadi::get_no_data_value());
+
+  std::filesystem::remove("test/data/elevation.store");
+}
+
+TEST(Sample, get_all_matches_get) {
+  // a tile of random heights with voids and out of range values
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> height(-500, 4000), kind(0, 9);
+  {
+    std::vector<int16_t> tile(3601 * 3601);
+    for (auto& pixel : tile) {
+      int16_t value = kind(gen) == 0 ? -32768 : kind(gen) == 0 ? 20000 : height(gen);
+      pixel = ((value & 0xFF) << 8) | ((value >> 8) & 0xFF);
+    }
+    std::ofstream file("test/data/sample/N00/N00E002.hgt", std::ios::binary | std::ios::trunc);
+    file.write(static_cast<const char*>(static_cast<void*>(tile.data())),
+               sizeof(int16_t) * tile.size());
+  }
+  skadi::sample s("test/data/sample");
+
+  // postings all over the tile, on its edges, in tiles without data and in the one with some
+  std::uniform_real_distribution<double> offset(0, 1);
+  std::vector<std::pair<double, double>> postings;
+  for (int i = 0; i < 10000; ++i) {
+    postings.emplace_back(2 + offset(gen), offset(gen));
+  }
+  for (int i = 0; i <= 100; ++i) {
+    postings.emplace_back(2 + i / 100.0, 0.0);
+    postings.emplace_back(2.0, i / 100.0);
+    postings.emplace_back(2 + i / 100.0, 1 - 1e-9);
+  }
+  for (int i = 0; i < 100; ++i) {
+    postings.emplace_back(4 + offset(gen), offset(gen));
+    postings.emplace_back(-77 + offset(gen), 40 + offset(gen));
+  }
+  std::shuffle(postings.begin(), postings.end(), gen);
+
+  auto check = [&s](const auto& coords) {
+    const auto values = s.get_all(coords);
+    ASSERT_EQ(values.size(), coords.size());
+    auto value = values.cbegin();
+    for (const auto& coord : coords) {
+      EXPECT_EQ(*value++, s.get(coord)) << coord.first << "," << coord.second;
+    }
+  };
+  check(postings);
+  check(std::list<std::pair<double, double>>(postings.begin(), postings.end()));
+  std::vector<std::pair<float, float>> float_postings;
+  for (const auto& posting : postings) {
+    float_postings.emplace_back(posting.first, posting.second);
+  }
+  check(float_postings);
+  check(std::vector<std::pair<double, double>>{});
+
+  std::filesystem::remove("test/data/sample/N00/N00E002.hgt");
+}
+
 struct testable_sample_t : public skadi::sample {
   testable_sample_t(const std::string& dir) : sample(dir) {
     {
@@ -2,6 +2,9 @@
 #include "test.h"
 
 #include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
 
 using namespace valhalla::midgard;
 
@@ -70,6 +73,82 @@ TEST(Sequence, Iterator) {
   EXPECT_EQ(i.position(), 0) << "Pre-decrement operator wasn't right";
 }
 
+TEST(Sequence, ParallelSort) {
+  // a small buffer makes many runs which have to be merged back together
+  const uint64_t count = 10000;
+  for (size_t concurrency : {1, 3, 8}) {
+    for (size_t buffer_size : {64, 1000, 20000}) {
+      {
+        sequence<osm_node> sequence("parallel.nd", true, 512);
+        for (uint64_t i = 0; i < count; ++i)
+          sequence.push_back({(i * 7919) % count, 0.f, 0.f, 0});
+      }
+      {
+        sequence<osm_node> sequence("parallel.nd", false, 512);
+        sequence.sort([](const osm_node& a, const osm_node& b) { return a.id < b.id; },
+                      buffer_size, concurrency);
+      }
+      sequence<osm_node> sequence("parallel.nd", false, 512);
+      ASSERT_EQ(sequence.size(), count);
+      for (uint64_t i = 0; i < count; ++i)
+        ASSERT_EQ((*sequence[i]).id, i) << "concurrency " << concurrency << " buffer " << buffer_size;
+    }
+  }
+}
+
+TEST(Sequence, SortSameAtAnyConcurrency) {
+  // equal elements have to end up in the same order however many runs the threads sort
+  const uint32_t count = 5000;
+  auto sorted_bytes = [count](size_t buffer_size, size_t concurrency) {
+    {
+      sequence<osm_node> sequence("concurrency.nd", true, 512);
+      for (uint32_t i = 0; i < count; ++i)
+        sequence.push_back({(static_cast<uint64_t>(i) * 2654435761u) % 37, 0.f, 0.f, i});
+    }
+    {
+      sequence<osm_node> sequence("concurrency.nd", false, 512);
+      sequence.sort([](const osm_node& a, const osm_node& b) { return a.id < b.id; }, buffer_size,
+                    concurrency);
+    }
+    std::ifstream file("concurrency.nd", std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  };
+
+  for (size_t buffer_size : {100, 1000, 10000}) {
+    auto serial = sorted_bytes(buffer_size, 1);
+    ASSERT_EQ(serial.size(), count * sizeof(osm_node));
+    EXPECT_EQ(sorted_bytes(buffer_size, 8), serial) << "buffer " << buffer_size;
+  }
+}
+
+TEST(Sequence, SortByKey) {
+  // few distinct keys so that the stability of the sort shows in the attributes
+  const uint32_t count = 5000;
+  for (size_t concurrency : {1, 4}) {
+    for (size_t buffer_size : {100, 10000}) {
+      {
+        sequence<osm_node> sequence("by_key.nd", true, 512);
+        for (uint32_t i = 0; i < count; ++i)
+          sequence.push_back({(static_cast<uint64_t>(i) * 2654435761u) % 37 << 40, 0.f, 0.f, i});
+      }
+      {
+        sequence<osm_node> sequence("by_key.nd", false, 512);
+        sequence.sort_by_key([](const osm_node& n) { return n.id; }, buffer_size, concurrency);
+      }
+      sequence<osm_node> sequence("by_key.nd", false, 512);
+      ASSERT_EQ(sequence.size(), count);
+      osm_node previous = *sequence[0];
+      for (uint32_t i = 1; i < count; ++i) {
+        osm_node node = *sequence[i];
+        ASSERT_LE(previous.id, node.id) << "Not sorted at " << i;
+        if (previous.id == node.id)
+          ASSERT_LT(previous.attributes, node.attributes) << "Not stable at " << i;
+        previous = node;
+      }
+    }
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -0,0 +1,97 @@
+#include "mjolnir/sortedmultimap.h"
+#include "test.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+
+using namespace valhalla::mjolnir;
+
+namespace {
+
+struct Value {
+  uint32_t a;
+  uint32_t b;
+};
+
+std::vector<uint32_t> values(const SortedMultiMap<Value>& map, const uint64_t id) {
+  std::vector<uint32_t> found;
+  auto range = map.equal_range(id);
+  for (auto it = range.first; it != range.second; ++it) {
+    EXPECT_EQ(it->first, id);
+    found.push_back(it->second.a);
+  }
+  return found;
+}
+
+TEST(SortedMultiMap, EqualRange) {
+  SortedMultiMap<Value> map;
+  map.emplace(5, {1, 0});
+  map.emplace(2, {2, 0});
+  map.insert({5, {3, 0}});
+  map.emplace(9, {4, 0});
+  map.emplace(5, {5, 0});
+  EXPECT_EQ(map.size(), 5);
+
+  // added out of order so they need to be sorted first
+  EXPECT_THROW(map.equal_range(5), std::logic_error);
+  map.sort();
+
+  // the values with the same id keep the order they were added in
+  EXPECT_EQ(values(map, 5), std::vector<uint32_t>({1, 3, 5}));
+  EXPECT_EQ(values(map, 2), std::vector<uint32_t>({2}));
+  EXPECT_EQ(values(map, 9), std::vector<uint32_t>({4}));
+  EXPECT_EQ(map.equal_range(3).first, map.end());
+  EXPECT_EQ(map.find(10), map.end());
+  EXPECT_EQ(map.find(9)->second.a, 4);
+
+  // adding in order keeps it sorted
+  map.emplace(11, {6, 0});
+  EXPECT_EQ(values(map, 11), std::vector<uint32_t>({6}));
+}
+
+TEST(SortedMultiMap, WriteAndMap) {
+  const std::string file_name = "test/data/sortedmultimap_write_and_map.bin";
+  {
+    SortedMultiMap<Value> map;
+    map.emplace(7, {1, 2});
+    map.emplace(3, {3, 4});
+    map.emplace(7, {5, 6});
+    // writing sorts
+    ASSERT_TRUE(map.write(file_name));
+  }
+
+  SortedMultiMap<Value> map;
+  ASSERT_TRUE(map.map(file_name));
+  EXPECT_EQ(map.size(), 3);
+  EXPECT_EQ(values(map, 7), std::vector<uint32_t>({1, 5}));
+  EXPECT_EQ(map.find(3)->second.b, 4);
+
+  // writing to the file it is mapped from leaves the file alone
+  ASSERT_TRUE(map.write(file_name));
+  EXPECT_EQ(std::filesystem::file_size(file_name), 3 * sizeof(SortedMultiMap<Value>::value_type));
+
+  // adding to it copies the mapped values onto the heap
+  map.emplace(1, {7, 8});
+  map.sort();
+  EXPECT_EQ(map.size(), 4);
+  EXPECT_EQ(values(map, 1), std::vector<uint32_t>({7}));
+  EXPECT_EQ(values(map, 7), std::vector<uint32_t>({1, 5}));
+
+  // an empty map maps an empty file
+  SortedMultiMap<Value> empty;
+  ASSERT_TRUE(empty.write(file_name));
+  ASSERT_TRUE(map.map(file_name));
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(map.find(7), map.end());
+  EXPECT_FALSE(map.map(file_name + ".missing"));
+  std::filesystem::remove(file_name);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -273,6 +273,10 @@ boost::property_tree::ptree make_config(const std::string& path_prefix,
           "max_matrix_distance": 400000.0,
           "max_matrix_location_pairs": 2500
         },
+        "batch_route": {
+          "max_distance": 5000000.0,
+          "max_locations": 1000
+        },
         "bicycle": {
           "max_distance": 500000.0,
           "max_locations": 50,
@@ -0,0 +1,120 @@
+#include "mjolnir/tilescheduler.h"
+#include "test.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+using namespace valhalla::baldr;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+TEST(TileScheduler, EveryTileOnce) {
+  TileScheduler scheduler("test", 4);
+  for (uint32_t i = 0; i < 1000; ++i) {
+    scheduler.add(GraphId(i, 2, 0), i % 7);
+  }
+  EXPECT_EQ(scheduler.size(), 1000);
+
+  std::mutex lock;
+  std::vector<GraphId> done;
+  std::vector<size_t> indexes;
+  scheduler.run([&](TileScheduler::Worker& worker) {
+    GraphId tile_id;
+    while (worker.next(tile_id)) {
+      std::lock_guard<std::mutex> guard(lock);
+      done.push_back(tile_id);
+      indexes.push_back(worker.index());
+    }
+  });
+
+  ASSERT_EQ(done.size(), 1000);
+  std::sort(done.begin(), done.end());
+  for (uint32_t i = 0; i < 1000; ++i) {
+    EXPECT_EQ(done[i], GraphId(i, 2, 0));
+  }
+  EXPECT_LT(*std::max_element(indexes.begin(), indexes.end()), 4);
+}
+
+TEST(TileScheduler, HeaviestFirst) {
+  // on one thread the tiles run by weight, those of the same weight in the order they were added
+  TileScheduler scheduler("test", 1);
+  scheduler.add(GraphId(1, 2, 0), 5);
+  scheduler.add(GraphId(2, 2, 0), 50);
+  scheduler.add(GraphId(3, 2, 0), 5);
+  scheduler.add(GraphId(4, 2, 0), 500);
+
+  std::vector<GraphId> done;
+  scheduler.run([&](TileScheduler::Worker& worker) {
+    GraphId tile_id;
+    while (worker.next(tile_id)) {
+      done.push_back(tile_id);
+    }
+  });
+  EXPECT_EQ(done, std::vector<GraphId>({GraphId(4, 2, 0), GraphId(2, 2, 0), GraphId(1, 2, 0),
+                                        GraphId(3, 2, 0)}));
+}
+
+TEST(TileScheduler, Stealing) {
+  // the first thread is stuck on its first tile so the other one has to steal its tiles. The other
+  // one only starts once the first one has its tile, else it could take all of them
+  TileScheduler scheduler("test", 2);
+  for (uint32_t i = 0; i < 100; ++i) {
+    scheduler.add(GraphId(i, 2, 0), 100 - i);
+  }
+  std::mutex lock;
+  std::condition_variable changed;
+  bool started = false, finished = false;
+  size_t second = 0;
+  scheduler.run([&](TileScheduler::Worker& worker) {
+    GraphId tile_id;
+    if (worker.index() == 0) {
+      const bool first = worker.next(tile_id);
+      std::unique_lock<std::mutex> guard(lock);
+      started = true;
+      changed.notify_all();
+      changed.wait(guard, [&finished]() { return finished; });
+      EXPECT_TRUE(first);
+      EXPECT_FALSE(worker.next(tile_id));
+      return;
+    }
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      changed.wait(guard, [&started]() { return started; });
+    }
+    while (worker.next(tile_id)) {
+      std::lock_guard<std::mutex> guard(lock);
+      ++second;
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    finished = true;
+    changed.notify_all();
+  });
+  EXPECT_EQ(second, 99);
+}
+
+TEST(TileScheduler, Rethrows) {
+  TileScheduler scheduler("test", 3);
+  for (uint32_t i = 0; i < 10; ++i) {
+    scheduler.add(GraphId(i, 2, 0));
+  }
+  EXPECT_THROW(scheduler.run([](TileScheduler::Worker& worker) {
+    GraphId tile_id;
+    while (worker.next(tile_id)) {
+      if (tile_id.tileid() == 5) {
+        throw std::runtime_error("bad tile");
+      }
+    }
+  }),
+               std::runtime_error);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -2,6 +2,7 @@
 #include "test.h"
 
 #include <cstdint>
+#include <filesystem>
 
 using namespace std;
 using namespace valhalla::mjolnir;
@@ -44,6 +45,34 @@ TEST(UniqueNames, TestAddAndIndex) {
   EXPECT_EQ(names.name(index6), "I-95 N");
 }
 
+TEST(UniqueNames, WriteAndMap) {
+  UniqueNames names;
+  uint32_t index1 = names.index("I-95");
+  uint32_t index2 = names.index("Interstate 95");
+  const std::string file_name = "test/data/uniquenames_write_and_map.bin";
+  ASSERT_TRUE(names.write(file_name));
+
+  UniqueNames mapped;
+  ASSERT_TRUE(mapped.map(file_name));
+  EXPECT_EQ(mapped.Size(), 2);
+  EXPECT_EQ(mapped.name(0), "");
+  EXPECT_EQ(mapped.name(index1), "I-95");
+  EXPECT_EQ(mapped.name(index2), "Interstate 95");
+  EXPECT_EQ(mapped.name(index2 + 1), "");
+
+  // writing to the file it is mapped from leaves the file alone
+  ASSERT_TRUE(mapped.write(file_name));
+  EXPECT_EQ(mapped.name(index2), "Interstate 95");
+
+  // adding names copies the mapped ones onto the heap and keeps their indexes
+  EXPECT_EQ(mapped.index("Interstate 95"), index2);
+  uint32_t index3 = mapped.index("I-95 N");
+  EXPECT_EQ(mapped.Size(), 3);
+  EXPECT_EQ(mapped.name(index1), "I-95");
+  EXPECT_EQ(mapped.name(index3), "I-95 N");
+  std::filesystem::remove(file_name);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
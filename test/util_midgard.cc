@@ -780,6 +780,55 @@ TEST(UtilMidgard, PolygonArea) {
   }
 }
 
+TEST(UtilMidgard, ProjectOntoShape) {
+  std::mt19937 generator(17);
+  std::uniform_real_distribution<double> offset(-0.01, 0.01);
+  for (size_t i = 0; i < 2000; ++i) {
+    PointLL ll(13.4 + offset(generator), 52.5 + offset(generator));
+    projector_t project(ll);
+
+    // shapes of every length (including none) with some zero length segments mixed in
+    std::vector<PointLL> shape;
+    for (size_t j = 0; j < i % 23; ++j) {
+      shape.emplace_back(13.4 + offset(generator), 52.5 + offset(generator));
+    }
+    if (shape.size() > 3 && i % 3 == 0) {
+      shape[2] = shape[1];
+    }
+
+    // one segment at a time
+    PointLL expected_point(1, 1);
+    double expected_sq_distance = std::numeric_limits<double>::max();
+    size_t expected_index = 0;
+    for (size_t j = 0; j + 1 < shape.size(); ++j) {
+      auto point = project(shape[j], shape[j + 1]);
+      auto sq_distance = project.approx.DistanceSquared(point);
+      if (sq_distance < expected_sq_distance) {
+        expected_point = point;
+        expected_sq_distance = sq_distance;
+        expected_index = j;
+      }
+    }
+
+    // all of them at once
+    PointLL point(1, 1);
+    double sq_distance;
+    auto index = project(shape, point, sq_distance);
+    EXPECT_EQ(index, expected_index) << i;
+    EXPECT_DOUBLE_EQ(sq_distance, expected_sq_distance) << i;
+    EXPECT_DOUBLE_EQ(point.lng(), expected_point.lng()) << i;
+    EXPECT_DOUBLE_EQ(point.lat(), expected_point.lat()) << i;
+  }
+
+  // the first of equally close segments
+  projector_t project(PointLL(0, 0));
+  std::vector<PointLL> shape{{1, 1}, {1, -1}, {1, 1}, {1, -1}, {1, 1}, {1, -1}, {1, 1}};
+  PointLL point;
+  double sq_distance;
+  EXPECT_EQ(project(shape, point, sq_distance), 0);
+  EXPECT_EQ(point, PointLL(1, 0));
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
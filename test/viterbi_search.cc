@@ -533,6 +533,165 @@ TEST(ViterbiSearch, TestTopKSearch) {
   }
 }
 
+std::vector<Column> generate_sparse_columns(size_t column_length) {
+  // real valued costs so that no two paths tie, some states don't connect so that paths break
+  std::uniform_real_distribution<float> cost_distribution(0.f, 100.f), chance_distribution(0.f, 1.f);
+  std::uniform_int_distribution<size_t> count_distribution(0, 6);
+  std::vector<Column> columns(column_length);
+  for (auto& column : columns) {
+    column.resize(count_distribution(COUNT_GENERATOR));
+  }
+  for (size_t time = 0; time < columns.size(); ++time) {
+    for (auto& state : columns[time]) {
+      state.emission_cost = cost_distribution(EMISSION_COST_GENERATOR);
+      for (uint32_t idx = 0; time + 1 < columns.size() && idx < columns[time + 1].size(); ++idx) {
+        if (chance_distribution(TRANSITION_COST_GENERATOR) < .4f) {
+          state.transition_costs[idx] = cost_distribution(TRANSITION_COST_GENERATOR);
+        }
+      }
+    }
+  }
+  return columns;
+}
+
+TEST(ViterbiSearch, TestConvergedPath) {
+  for (int i = 0; i < 50; ++i) {
+    const auto columns = generate_sparse_columns(100);
+
+    // the path the way OfflineMatch puts it together
+    ViterbiSearch offline;
+    offline.set_emission_cost_model(EmissionCostModel(columns));
+    offline.set_transition_cost_model(TransitionCostModel(columns));
+    AddColumns(offline, columns);
+    std::vector<StateId> expected;
+    while (expected.size() < columns.size()) {
+      const StateId::Time time = columns.size() - expected.size() - 1;
+      std::copy(offline.SearchPathVS(time, false), offline.PathEnd(), std::back_inserter(expected));
+    }
+    std::reverse(expected.begin(), expected.end());
+
+    // the same path one column at a time, forgetting what is not needed anymore
+    ViterbiSearch online;
+    online.set_emission_cost_model(EmissionCostModel(columns));
+    online.set_transition_cost_model(TransitionCostModel(columns));
+    std::vector<StateId> path;
+    for (StateId::Time time = 0; time < columns.size(); ++time) {
+      for (uint32_t idx = 0; idx < columns[time].size(); ++idx) {
+        online.AddStateId(StateId(time, idx));
+      }
+      online.SearchColumn(time);
+      const auto last = time + 1 == columns.size();
+      const auto converged = online.ConvergedPath(path.empty() ? 0 : path.size() - 1, last);
+      for (auto stateid = converged.cbegin(); stateid != converged.cend(); ++stateid) {
+        if (stateid != converged.cbegin() || path.empty()) {
+          path.push_back(*stateid);
+        }
+      }
+      if (1 < path.size()) {
+        online.Prune(path.size() - 2);
+      }
+    }
+    path.resize(columns.size());
+
+    for (StateId::Time time = 0; time < columns.size(); ++time) {
+      EXPECT_EQ(expected[time], path[time]) << "different states at time " << time;
+    }
+  }
+}
+
+class CountingTransitionCostModel : public TransitionCostModel {
+public:
+  CountingTransitionCostModel(const std::vector<Column>& columns,
+                              std::shared_ptr<std::unordered_set<StateId>> sources)
+      : TransitionCostModel(columns), sources_(std::move(sources)) {
+  }
+
+  float operator()(const StateId& lhs, const StateId& rhs) const {
+    sources_->insert(lhs);
+    return TransitionCostModel::operator()(lhs, rhs);
+  }
+
+private:
+  // the states transition costs were asked for from, which map matching would route from
+  std::shared_ptr<std::unordered_set<StateId>> sources_;
+};
+
+std::vector<StateId> offline_path(const std::vector<Column>& columns, ViterbiSearch& vs) {
+  AddColumns(vs, columns);
+  std::vector<StateId> path;
+  while (path.size() < columns.size()) {
+    const StateId::Time time = columns.size() - path.size() - 1;
+    std::copy(vs.SearchPathVS(time, false), vs.PathEnd(), std::back_inserter(path));
+  }
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+TEST(ViterbiSearch, TestBeamWidth) {
+  size_t all_source_count = 0, beam_source_count = 0;
+  for (int i = 0; i < 50; ++i) {
+    const auto columns = generate_sparse_columns(100);
+    auto sources = std::make_shared<std::unordered_set<StateId>>();
+    auto search = [&columns, &sources](const size_t beam_width) {
+      sources->clear();
+      ViterbiSearch vs;
+      vs.set_emission_cost_model(EmissionCostModel(columns));
+      vs.set_transition_cost_model(CountingTransitionCostModel(columns, sources));
+      vs.set_beam_width(beam_width);
+      return offline_path(columns, vs);
+    };
+    const auto expected = search(0);
+    const auto all_sources = sources->size();
+
+    // a beam as wide as the columns is no beam at all
+    EXPECT_EQ(search(6), expected);
+    EXPECT_EQ(sources->size(), all_sources);
+
+    // a narrow one routes from fewer states and still finds a path through every column
+    const auto path = search(2);
+    EXPECT_LE(sources->size(), all_sources);
+    all_source_count += all_sources;
+    beam_source_count += sources->size();
+    ASSERT_EQ(path.size(), expected.size());
+    for (StateId::Time time = 0; time < path.size(); ++time) {
+      EXPECT_EQ(path[time].IsValid(), expected[time].IsValid()) << "at time " << time;
+    }
+
+    // and no more states than the beam width were routed from at any time
+    std::unordered_map<StateId::Time, size_t> sources_by_time;
+    for (const auto& source : *sources) {
+      EXPECT_LE(++sources_by_time[source.time()], 2) << "at time " << source.time();
+    }
+
+    // and the online search limited to the same beam finds the same path
+    ViterbiSearch online;
+    online.set_emission_cost_model(EmissionCostModel(columns));
+    online.set_transition_cost_model(TransitionCostModel(columns));
+    online.set_beam_width(2);
+    std::vector<StateId> online_path;
+    for (StateId::Time time = 0; time < columns.size(); ++time) {
+      for (uint32_t idx = 0; idx < columns[time].size(); ++idx) {
+        online.AddStateId(StateId(time, idx));
+      }
+      online.SearchColumn(time);
+      const auto last = time + 1 == columns.size();
+      const auto begin = online_path.empty() ? 0 : online_path.size() - 1;
+      const auto converged = online.ConvergedPath(begin, last);
+      for (auto stateid = converged.cbegin(); stateid != converged.cend(); ++stateid) {
+        if (stateid != converged.cbegin() || online_path.empty()) {
+          online_path.push_back(*stateid);
+        }
+      }
+      if (1 < online_path.size()) {
+        online.Prune(online_path.size() - 2);
+      }
+    }
+    online_path.resize(columns.size());
+    EXPECT_EQ(online_path, path);
+  }
+  EXPECT_LT(beam_source_count, all_source_count);
+}
+
 int main(int argc, char* argv[]) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
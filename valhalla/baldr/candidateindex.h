@@ -0,0 +1,41 @@
+#ifndef VALHALLA_BALDR_CANDIDATEINDEX_H_
+#define VALHALLA_BALDR_CANDIDATEINDEX_H_
+
+#include <cstdint>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * An edge referenced by the candidate index of a tile. Edges from the bins of a tile can be in a
+ * neighboring tile, so it is the full graph id split in two halves to keep the section 4 byte
+ * aligned wherever it starts in the tile.
+ */
+struct CandidateIndexEdge {
+  uint32_t tile_base; // the value of the graph id of the tile of the edge
+  uint32_t id;        // the index of the edge within that tile
+};
+
+/**
+ * Start of the candidate index section of a tile. The index is a grid of cells over the bounding
+ * box of the tile, each cell lists the edges from the bins of the tile which have a segment of
+ * their shape in it. Only one of the directed edges of each pair is listed, the same as in the
+ * bins. The header is followed by:
+ *  - the edge_count edges the cells refer to
+ *  - the columns * rows + 1 offsets of the first entry of each cell, row by row
+ *  - the entry_count entries of the cells, which are indexes into the edges
+ * All of it is made of 4 byte values so the section only has to start at a multiple of 4 bytes.
+ */
+struct CandidateIndexHeader {
+  uint32_t columns;     // number of cells along the width of the tile
+  uint32_t rows;        // number of cells along the height of the tile
+  float cell_width;     // width of the cells in degrees
+  float cell_height;    // height of the cells in degrees
+  uint32_t edge_count;  // how many edges the cells refer to
+  uint32_t entry_count; // how many entries all of the cells have together
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_CANDIDATEINDEX_H_
@@ -21,9 +21,18 @@ using buckets_t = std::vector<bucket_t>;
  * reduced memory use. Costs outside the current bucket "range" get placed
  * into the overflow bucket and are moved into the low-level buckets as
  * needed. Each bucket stores label indexes into external data.
+ *
+ * In adaptive mode the range of the low-level buckets is widened (up to
+ * kMaxRangeGrowth times the configured range) whenever the overflow bucket
+ * is emptied and too few of its labels would fit into the current range.
+ * This keeps a too narrow range from rescanning the overflow bucket over and
+ * over for a handful of labels, without paying for a wide range up front.
  */
 template <typename label_t> class DoubleBucketQueue final {
 public:
+  // How many times the low-level range may grow in adaptive mode
+  static constexpr float kMaxRangeGrowth = 16.f;
+
   /**
    * Default c-tor creates empty object that needs to be initialized with `reuse` method
    */
@@ -87,6 +96,8 @@ public:
     bucketsize_ = static_cast<float>(bucketsize);
     inv_ = 1.0f / bucketsize_;
 
+    maxrange_ = bucketrange_ * kMaxRangeGrowth;
+
     // Set the maximum cost (above this goes into the overflow bucket)
     maxcost_ = mincost_ + bucketrange_;
 
@@ -98,6 +109,15 @@ public:
     currentbucket_ = buckets_.begin();
   }
 
+  /**
+   * Enables or disables adaptive sizing of the low-level bucket range. The
+   * setting is kept across calls to `reuse` and `clear`.
+   * @param adaptive  Whether to widen the range from the observed costs.
+   */
+  void set_adaptive(const bool adaptive) {
+    adaptive_ = adaptive;
+  }
+
   /**
    * Clear all labels from the low-level buckets and the overflow bucket and deallocate the buckets'
    * memory.
@@ -182,6 +202,11 @@ private:
   double mincost_;    // Minimum cost within the low level buckets
   float maxcost_;     // Above this goes into overflow bucket
   float currentcost_; // Current cost
+  float maxrange_;    // Upper limit of the bucket range in adaptive mode
+  bool adaptive_ = false;
+
+  // Scratch space for the costs of the overflow labels in adaptive mode
+  std::vector<float> overflowcosts_;
 
   // Low level buckets
   buckets_t buckets_;
@@ -236,6 +261,9 @@ private:
 
       // Adjust cost range so smallest element is in the buckets_
       float min = (*labelcontainer_)[*itr].sortcost();
+      if (adaptive_) {
+        adapt_range(min);
+      }
       mincost_ += (std::floor((min - mincost_) / bucketrange_)) * bucketrange_;
 
       // Avoid precision issues
@@ -264,6 +292,39 @@ private:
     currentcost_ = mincost_;
     currentbucket_ = buckets_.begin();
   }
+
+  /**
+   * Widens the low-level bucket range so that about a quarter of the labels
+   * in the overflow bucket will be moved into the low-level buckets. Only
+   * called while the low-level buckets are empty so they can be resized.
+   * @param  min  Minimum cost within the overflow bucket.
+   */
+  void adapt_range(const float min) {
+    // Not worth it while the overflow holds fewer labels than there are buckets. A range below
+    // the bucket size is kept as is since it is what orders the labels of the single bucket
+    if (overflowbucket_.size() <= buckets_.size() || bucketrange_ >= maxrange_ ||
+        bucketrange_ < bucketsize_) {
+      return;
+    }
+
+    // Find the cost below which a quarter of the overflow labels lie
+    overflowcosts_.clear();
+    for (const auto label : overflowbucket_) {
+      overflowcosts_.push_back((*labelcontainer_)[label].sortcost());
+    }
+    auto quarter = overflowcosts_.begin() + overflowcosts_.size() / 4;
+    std::nth_element(overflowcosts_.begin(), quarter, overflowcosts_.end());
+
+    // Grow by powers of 2 so the range stays a multiple of the bucket size
+    float range = bucketrange_;
+    while (range < (*quarter - min) + bucketsize_ && range < maxrange_) {
+      range *= 2.f;
+    }
+    if (range != bucketrange_) {
+      bucketrange_ = std::min(range, maxrange_);
+      buckets_.resize(static_cast<size_t>(bucketrange_ / bucketsize_) + 1);
+    }
+  }
 };
 
 } // namespace baldr
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <valhalla/baldr/graphid.h>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Metric independent partition of the routing graph used to speed up long routes, in the spirit of
+ * customizable route planning. Every tile on the highway level is a cell. The boundary of a cell
+ * is made of the highway edges crossing into it (entries) and out of it (exits), so the exits of
+ * one cell are the entries of its neighbours. Clique weights between the entries and exits of each
+ * cell depend on the costing and are computed separately (see thor::OverlayMetric).
+ *
+ * There is a single level of cells and it is the highway level, the lower levels have no cells of
+ * their own. A route over the overlay therefore only uses highway edges between the cells it
+ * expands edge by edge, the constructor rejects cells or boundary edges on any other level.
+ */
+class GraphOverlay {
+public:
+  static constexpr uint32_t kInvalidIndex = std::numeric_limits<uint32_t>::max();
+
+  struct Cell {
+    GraphId tile_id;
+    std::vector<GraphId> entries; // edges of other cells ending in this cell, sorted
+    std::vector<GraphId> exits;   // edges of this cell ending in other cells, sorted
+    bool restricted = false;      // a complex restriction crosses one of its entries or exits
+  };
+
+  GraphOverlay() = default;
+
+  /**
+   * Constructs the overlay from its cells. Throws if a cell or one of its boundary edges is not on
+   * the highway level.
+   * @param cells  the cells, in any order
+   */
+  explicit GraphOverlay(std::vector<Cell>&& cells);
+
+  /**
+   * Reads an overlay written by Write. Throws if the file cannot be read or is not an overlay.
+   * @param file_name  path of the overlay file
+   * @return the overlay
+   */
+  static GraphOverlay Read(const std::string& file_name);
+
+  /**
+   * Writes the overlay to a file. Throws if the file cannot be written.
+   * @param file_name  path of the overlay file
+   */
+  void Write(const std::string& file_name) const;
+
+  /**
+   * Returns the tile of the highway level containing the tile of the given id, this is the cell of
+   * every node and edge within that tile regardless of their level.
+   * @param id  a graph id on any level
+   * @return the tile id of the cell
+   */
+  static GraphId cell_tile(const GraphId& id);
+
+  const std::vector<Cell>& cells() const {
+    return cells_;
+  }
+
+  /**
+   * Returns the index of the cell for a tile on the highway level
+   * @param tile_id  the tile of the cell
+   * @return the cell index or kInvalidIndex if the tile has no boundary edges
+   */
+  uint32_t cell_index(const GraphId& tile_id) const;
+
+  /**
+   * Returns the index of an edge among the entries of a cell
+   * @param cell     the cell index
+   * @param edge_id  the edge crossing into the cell
+   * @return the entry index or kInvalidIndex if the edge is not an entry of the cell
+   */
+  uint32_t entry_index(const uint32_t cell, const GraphId& edge_id) const;
+
+  /**
+   * Returns the index of an edge among the exits of a cell
+   * @param cell     the cell index
+   * @param edge_id  the edge leaving the cell
+   * @return the exit index or kInvalidIndex if the edge is not an exit of the cell
+   */
+  uint32_t exit_index(const uint32_t cell, const GraphId& edge_id) const;
+
+protected:
+  std::vector<Cell> cells_;
+  std::unordered_map<uint64_t, uint32_t> cell_indices_;
+};
+
+} // namespace baldr
+} // namespace valhalla
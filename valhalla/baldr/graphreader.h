@@ -2,6 +2,7 @@
 
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphtile.h>
+#include <valhalla/baldr/shapecache.h>
 #include <valhalla/baldr/tilegetter.h>
 #include <valhalla/baldr/tilehierarchy.h>
 #include <valhalla/midgard/aabb2.h>
@@ -10,9 +11,12 @@
 #include <boost/property_tree/ptree.hpp>
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
 
@@ -107,7 +111,7 @@ public:
 
   /**
    * Reserves enough cache to hold (max_cache_size / tile_size) items.
-   * @param tile_size appeoximate size of one tile
+   * @param tile_size approximate size of one tile
    */
   void Reserve(size_t tile_size) override;
 
@@ -191,7 +195,7 @@ public:
 
   /**
    * Reserves enough cache to hold (max_cache_size / tile_size) items.
-   * @param tile_size appeoximate size of one tile
+   * @param tile_size approximate size of one tile
    */
   void Reserve(size_t tile_size) override;
 
@@ -266,7 +270,7 @@ public:
 
   /**
    * Reserves enough cache to hold (max_cache_size / tile_size) items.
-   * @param tile_size appeoximate size of one tile
+   * @param tile_size approximate size of one tile
    */
   void Reserve(size_t tile_size) override;
 
@@ -367,7 +371,7 @@ public:
   SynchronizedTileCache(TileCache& cache, std::mutex& mutex);
   /**
    * Reserves enough cache to hold (max_cache_size / tile_size) items.
-   * @param tile_size appeoximate size of one tile
+   * @param tile_size approximate size of one tile
    */
   void Reserve(size_t tile_size) override;
 
@@ -415,6 +419,106 @@ private:
   std::mutex& mutex_ref_;
 };
 
+/**
+ * Tile cache split into independently locked shards so that it can be shared by all threads of a
+ * process. Get and Contains only take a shared lock on the shard owning the tile, so readers never
+ * block each other and writers only contend on the same shard. Each shard owns an equal slice of
+ * the memory budget and evicts its oldest tiles on Put, so the cache is never overcommitted.
+ * It is thread-safe. Handing its tiles to several threads requires ENABLE_THREAD_SAFE_TILE_REF_COUNT.
+ */
+class ConcurrentTileCache : public TileCache {
+public:
+  /**
+   * Constructor.
+   * @param max_size     maximum size of the cache
+   * @param shard_count  number of independently locked shards, rounded up to a power of 2
+   */
+  ConcurrentTileCache(size_t max_size, size_t shard_count = kDefaultShardCount);
+
+  /**
+   * Reserves enough cache to hold (max_cache_size / tile_size) items.
+   * @param tile_size approximate size of one tile
+   */
+  void Reserve(size_t tile_size) override;
+
+  /**
+   * Checks if tile exists in the cache.
+   * @param graphid  the graphid of the tile
+   * @return true if tile exists in the cache
+   */
+  bool Contains(const GraphId& graphid) const override;
+
+  /**
+   * Puts a copy of a tile of into the cache. If another thread already put the same tile the
+   * cached copy is kept and returned so that all threads share a single instance.
+   * @param graphid  the graphid of the tile
+   * @param tile the graph tile
+   * @param size size of the tile in memory
+   */
+  graph_tile_ptr Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) override;
+
+  /**
+   * Get a pointer to a graph tile object given a GraphId.
+   * @param graphid  the graphid of the tile
+   * @return GraphTile* a pointer to the graph tile
+   */
+  graph_tile_ptr Get(const GraphId& graphid) const override;
+
+  /**
+   * Lets you know if the cache is too large.
+   * @return true if the cache is over committed with respect to the limit
+   */
+  bool OverCommitted() const override;
+
+  /**
+   * Clears the cache.
+   */
+  void Clear() override;
+
+  /**
+   *  Does its best to reduce the cache size to remove overcommitted state.
+   *  Evicts the oldest tiles of every shard which is above its share of the limit.
+   */
+  void Trim() override;
+
+  static constexpr size_t kDefaultShardCount = 64;
+
+protected:
+  struct Shard {
+    mutable std::shared_mutex mutex;
+    // The cached GraphTile objects
+    std::unordered_map<uint64_t, graph_tile_ptr> tiles;
+    // Tile ids and sizes in insertion order, the front is evicted first
+    std::deque<std::pair<uint64_t, size_t>> fifo;
+    // The current shard size in bytes
+    size_t size = 0;
+  };
+
+  inline Shard& get_shard(const GraphId& graphid) const {
+    // fibonacci hashing spreads the consecutive tile ids of a region over all the shards
+    return shards_[((graphid.value * 0x9E3779B97F4A7C15ull) >> 32) & (shard_count_ - 1)];
+  }
+
+  /**
+   * Evicts the oldest tiles of the shard until required_size bytes fit in its budget.
+   * The caller must hold the exclusive lock of the shard.
+   * @param shard          the shard to evict from
+   * @param required_size  size in bytes that should be free in the shard
+   */
+  void TrimToFit(Shard& shard, size_t required_size);
+
+  // The shards, the number of them is a power of 2
+  std::unique_ptr<Shard[]> shards_;
+  size_t shard_count_;
+
+  // The current cache size in bytes over all the shards
+  std::atomic<size_t> cache_size_;
+
+  // The max cache size in bytes and the part of it each shard is allowed to use
+  size_t max_cache_size_;
+  size_t max_shard_size_;
+};
+
 /**
  * Creates tile caches.
  */
@@ -513,6 +617,9 @@ public:
    */
   virtual void Clear() {
     cache_->Clear();
+    if (shape_cache_) {
+      shape_cache_->Clear();
+    }
   }
 
   /**
@@ -523,6 +630,41 @@ public:
     cache_->Trim();
   }
 
+  /**
+   * Get the decoded shape of an edge from the shape cache, decoding and caching it if it is not
+   * in there yet. Without a shape cache (mjolnir.shape_cache_size) there is nothing to get and the
+   * caller has to decode the shape of the edge info itself.
+   * @param tile  the tile the edge is in
+   * @param edge  the directed edge
+   * @return the decoded shape or nullptr if there is no shape cache
+   */
+  decoded_shape_ptr GetDecodedShape(const graph_tile_ptr& tile, const DirectedEdge* edge) {
+    if (!shape_cache_) {
+      return nullptr;
+    }
+    const auto offset = static_cast<uint32_t>(edge->edgeinfo_offset());
+    if (auto cached = shape_cache_->Get(tile.get(), offset)) {
+      shape_cache_hits_.fetch_add(1, std::memory_order_relaxed);
+      return cached;
+    }
+    shape_cache_misses_.fetch_add(1, std::memory_order_relaxed);
+    auto decoded = std::make_shared<const DecodedShape>(tile->edgeinfo(edge).lazy_shape());
+    return shape_cache_->Put(tile.get(), offset, std::move(decoded));
+  }
+
+  /**
+   * Takes the counts of the shapes this reader found and did not find in the shape cache since
+   * the last time they were taken.
+   * @param hits    set to how many of the shapes were cached
+   * @param misses  set to how many of them had to be decoded
+   * @return false if there is no shape cache
+   */
+  bool TakeShapeCacheStats(uint64_t& hits, uint64_t& misses) {
+    hits = shape_cache_hits_.exchange(0, std::memory_order_relaxed);
+    misses = shape_cache_misses_.exchange(0, std::memory_order_relaxed);
+    return shape_cache_ != nullptr;
+  }
+
   /**
    * Returns the maximum number of threads that can
    * use the reader concurrently without blocking
@@ -984,6 +1126,19 @@ protected:
   // Information about where the tiles are kept
   const std::string tile_dir_;
 
+  // Whether the uncompressed tiles of the tile_dir are mapped rather than read, and how
+  const bool mmap_tiles_;
+  const int mmap_advice_;
+
+  /**
+   * Map the uncompressed file of a tile in the tile_dir into memory.
+   * @param  base            the base graphid of the tile
+   * @param  traffic_memory  the tile's traffic, only taken when the tile could be mapped
+   * @return the mapped tile or nullptr if there is no such file or it could not be mapped
+   */
+  graph_tile_ptr MapGraphTile(const GraphId& base,
+                              std::unique_ptr<const GraphMemory>& traffic_memory) const;
+
   // Stuff for getting at remote tiles
   std::unique_ptr<tile_getter_t> tile_getter_;
   const size_t max_concurrent_users_;
@@ -994,6 +1149,11 @@ protected:
 
   std::unique_ptr<TileCache> cache_;
 
+  // The decoded shapes of edges, process wide when the tiles are
+  std::shared_ptr<ShapeCache> shape_cache_;
+  std::atomic<uint64_t> shape_cache_hits_{0};
+  std::atomic<uint64_t> shape_cache_misses_{0};
+
   bool enable_incidents_;
 };
 
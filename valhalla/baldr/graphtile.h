@@ -2,6 +2,7 @@
 
 #include <valhalla/baldr/accessrestriction.h>
 #include <valhalla/baldr/admininfo.h>
+#include <valhalla/baldr/candidateindex.h>
 #include <valhalla/baldr/complexrestriction.h>
 #include <valhalla/baldr/directededge.h>
 #include <valhalla/baldr/edgeinfo.h>
@@ -16,6 +17,7 @@
 #include <valhalla/baldr/predictedspeeds.h>
 #include <valhalla/baldr/sign.h>
 #include <valhalla/baldr/signinfo.h>
+#include <valhalla/baldr/storedreach.h>
 #include <valhalla/baldr/traffictile.h>
 #include <valhalla/baldr/transitdeparture.h>
 #include <valhalla/baldr/transitroute.h>
@@ -30,6 +32,7 @@
 #include <filesystem>
 #include <iterator>
 #include <memory>
+#include <unordered_set>
 
 namespace valhalla {
 namespace baldr {
@@ -140,6 +143,16 @@ public:
     return header_->graphid();
   }
 
+  /**
+   * Gets the instance number of this copy of the tile. Every tile object that is constructed gets
+   * a new one, so a tile read again never has the instance number of an earlier copy even if it
+   * happens to live at the same address.
+   * @return  Returns the instance number, unique within the process.
+   */
+  uint64_t instance() const {
+    return instance_;
+  }
+
   /**
    * Gets a pointer to the graph tile header.
    * @return  Returns the header for the graph tile.
@@ -613,6 +626,37 @@ public:
    */
   std::vector<LaneConnectivity> GetLaneConnectivity(const uint32_t idx) const;
 
+  /**
+   * Get the reach of a directed edge stored in this tile for a costing.
+   * @param  idx      Index of the directed edge within the tile.
+   * @param  costing  The costing type the reach was expanded for.
+   * @param  reach    Set to the stored reach if there is one.
+   * @return  Returns the max reach the stored reach is capped at, 0 if none is stored.
+   */
+  uint32_t GetStoredReach(const uint32_t idx, const uint8_t costing, StoredReach& reach) const {
+    if (reach_header_ == nullptr || idx >= header_->directededgecount()) {
+      return 0;
+    }
+    for (uint32_t i = 0; i < reach_header_->costing_count; ++i) {
+      if (reach_header_->costings[i] == costing) {
+        reach = reaches_[i * header_->directededgecount() + idx];
+        return reach_header_->max_reach;
+      }
+    }
+    return 0;
+  }
+
+  /**
+   * Get the edges from the candidate index of this tile which have a segment of their shape in
+   * one of the cells the range touches. Like the bins it only lists one of the directed edges of
+   * each pair.
+   * @param  range  the range to get the edges in, it is clamped to the cells of the tile
+   * @param  edges  the edges are added to these
+   * @return  Returns false if the tile has no candidate index, the bins have to be used instead.
+   */
+  bool GetCandidateEdges(const midgard::AABB2<midgard::PointLL>& range,
+                         std::unordered_set<GraphId>& edges) const;
+
   /**
    * Convenience method for use with costing to get the speed for an edge given the directed
    * edge and a time (seconds since start of the week). If the current speed of the edge
@@ -873,6 +917,16 @@ protected:
   // Predicted speeds
   PredictedSpeeds predictedspeeds_;
 
+  // Stored reach, the reach of every edge follows the header for each costing in turn
+  const StoredReachHeader* reach_header_{};
+  const StoredReach* reaches_{};
+
+  // Candidate index, the cells index into the edges and their offsets index into the entries
+  const CandidateIndexHeader* candidate_index_{};
+  const CandidateIndexEdge* candidate_edges_{};
+  const uint32_t* candidate_cells_{};
+  const uint32_t* candidate_entries_{};
+
   // Map of stop one stops in this tile.
   std::unordered_map<std::string, GraphId> stop_one_stops;
 
@@ -885,6 +939,9 @@ protected:
   // Pointer to live traffic data (can be nullptr if not active)
   TrafficTile traffic_tile{nullptr};
 
+  // Instance number of this copy of the tile, see instance()
+  uint64_t instance_ = NextInstance();
+
   // GraphTiles are noncopyable.
   GraphTile(const GraphTile&) = delete;
   GraphTile& operator=(const GraphTile&) = delete;
@@ -924,6 +981,11 @@ protected:
    */
   void Initialize(const GraphId& graphid);
 
+  /**
+   * @return the instance number for the next tile object, see instance()
+   */
+  static uint64_t NextInstance();
+
   /**
    * For transit tiles, save off the pair<tileid,lineid> lookup via
    * onestop_ids.  This will be used for including or excluding transit lines
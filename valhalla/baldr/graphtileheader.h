@@ -18,7 +18,7 @@ namespace baldr {
 // something to the tile simply subtract one from this number and add it
 // just before the empty_slots_ array below. NOTE that it can ONLY be an
 // offset in bytes and NOT a bitfield or union or anything of that sort
-constexpr size_t kEmptySlots = 11;
+constexpr size_t kEmptySlots = 9;
 
 // Maximum size of the version string (stored as a fixed size
 // character array so the GraphTileHeader size remains fixed).
@@ -574,6 +574,39 @@ public:
     predictedspeeds_offset_ = offset;
   }
 
+  /**
+   * Gets the offset to the stored reach, which is always the last section of the tile.
+   * @return  Returns the offset (bytes) to the stored reach, 0 if the tile has none.
+   */
+  uint32_t reach_offset() const {
+    return reach_offset_;
+  }
+
+  /**
+   * Sets the offset to the stored reach within the tile.
+   * @param offset Offset to the stored reach within the tile, 0 if it has none.
+   */
+  void set_reach_offset(const uint32_t offset) {
+    reach_offset_ = offset;
+  }
+
+  /**
+   * Gets the offset to the candidate index, which comes right before the stored reach if the tile
+   * has both and is the last section of the tile otherwise.
+   * @return  Returns the offset (bytes) to the candidate index, 0 if the tile has none.
+   */
+  uint32_t candidate_index_offset() const {
+    return candidate_index_offset_;
+  }
+
+  /**
+   * Sets the offset to the candidate index within the tile.
+   * @param offset Offset to the candidate index within the tile, 0 if it has none.
+   */
+  void set_candidate_index_offset(const uint32_t offset) {
+    candidate_index_offset_ = offset;
+  }
+
   /**
    * Get the offset to the end of the tile
    * @return the number of bytes in the tile, unless the last slot is used
@@ -689,6 +722,12 @@ protected:
   // GraphTile data size in bytes
   uint32_t tile_size_ = 0;
 
+  // Offset to the beginning of the stored reach, 0 if the tile has none
+  uint32_t reach_offset_ = 0;
+
+  // Offset to the beginning of the candidate index, 0 if the tile has none
+  uint32_t candidate_index_offset_ = 0;
+
   // Marks the end of this version of the tile with the rest of the slots
   // being available for growth. If you want to use one of the empty slots,
   // simply add a uint32_t some_offset_; just above empty_slots_ and decrease
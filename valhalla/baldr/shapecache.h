@@ -0,0 +1,133 @@
+#ifndef VALHALLA_BALDR_SHAPECACHE_H_
+#define VALHALLA_BALDR_SHAPECACHE_H_
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/midgard/encoded.h>
+#include <valhalla/midgard/pointll.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+class GraphTile;
+
+/**
+ * The decoded shape of an edge and the length along it up to each of its points.
+ */
+struct DecodedShape {
+  /**
+   * Decodes the shape and measures it.
+   * @param encoded  the encoded shape of the edge
+   */
+  explicit DecodedShape(midgard::Shape7Decoder<midgard::PointLL> encoded);
+
+  /**
+   * @return how much memory the shape takes up
+   */
+  size_t MemoryUsage() const {
+    return sizeof(DecodedShape) + shape.capacity() * sizeof(midgard::PointLL) +
+           lengths.capacity() * sizeof(double);
+  }
+
+  // Lng, lat shape of the edge
+  std::vector<midgard::PointLL> shape;
+  // The length in meters from the start of the shape to each of its points
+  std::vector<double> lengths;
+};
+
+using decoded_shape_ptr = std::shared_ptr<const DecodedShape>;
+
+/**
+ * Bounded cache of the decoded shapes of edges, so that the shapes of busy edges are not decoded
+ * over and over again. Shapes are keyed by the tile and the offset of their edge info in it. A
+ * shape is only handed out for the same instance of the tile it was decoded from (see
+ * GraphTile::instance), so a tile which was evicted from the tile cache and read again invalidates
+ * its shapes, even if the new copy lives at the address of the old one. Like the
+ * ConcurrentTileCache it is split into independently locked shards and evicts the oldest shapes of
+ * a shard when it is full, so it can be shared by all the threads of a process.
+ */
+class ShapeCache {
+public:
+  /**
+   * Constructor.
+   * @param max_size     maximum size of the cache in bytes
+   * @param shard_count  number of independently locked shards, rounded up to a power of 2
+   */
+  ShapeCache(size_t max_size, size_t shard_count = kDefaultShardCount);
+
+  /**
+   * Get a shape from the cache.
+   * @param tile             the tile the edge info is in
+   * @param edgeinfo_offset  the offset of the edge info in the tile
+   * @return the shape or nullptr if it is not in the cache
+   */
+  decoded_shape_ptr Get(const GraphTile* tile, const uint32_t edgeinfo_offset) const;
+
+  /**
+   * Puts a shape into the cache. If another thread already put the same shape the cached one is
+   * kept and returned.
+   * @param tile             the tile the edge info is in
+   * @param edgeinfo_offset  the offset of the edge info in the tile
+   * @param shape            the decoded shape
+   * @return the cached shape
+   */
+  decoded_shape_ptr
+  Put(const GraphTile* tile, const uint32_t edgeinfo_offset, decoded_shape_ptr shape);
+
+  /**
+   * Clears the cache.
+   */
+  void Clear();
+
+  /**
+   * @return the current size of the cache in bytes
+   */
+  size_t Size() const;
+
+  static constexpr size_t kDefaultShardCount = 16;
+
+protected:
+  struct Entry {
+    // the instance of the tile the shape was decoded from
+    uint64_t tile_instance;
+    decoded_shape_ptr shape;
+    size_t size;
+  };
+
+  struct Shard {
+    mutable std::shared_mutex mutex;
+    // The cached shapes
+    std::unordered_map<uint64_t, Entry> shapes;
+    // Keys in insertion order, the front is evicted first
+    std::deque<uint64_t> fifo;
+    // The current shard size in bytes
+    size_t size = 0;
+  };
+
+  /**
+   * @return the key of an edge info, the base of the tile fits in the low 25 bits of a graphid
+   */
+  static uint64_t key(const GraphTile* tile, const uint32_t edgeinfo_offset);
+
+  inline Shard& get_shard(const uint64_t key) const {
+    return shards_[((key * 0x9E3779B97F4A7C15ull) >> 32) & (shard_count_ - 1)];
+  }
+
+  // The shards, the number of them is a power of 2
+  std::unique_ptr<Shard[]> shards_;
+  size_t shard_count_;
+
+  // The max size in bytes each shard is allowed to use
+  size_t max_shard_size_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_SHAPECACHE_H_
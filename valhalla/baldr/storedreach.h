@@ -0,0 +1,42 @@
+#ifndef VALHALLA_BALDR_STOREDREACH_H_
+#define VALHALLA_BALDR_STOREDREACH_H_
+
+#include <cstdint>
+
+namespace valhalla {
+namespace baldr {
+
+// Most reach that can be stored per edge
+constexpr uint32_t kMaxStoredReach = 255;
+
+// Most costings a tile can store the reach for
+constexpr uint32_t kMaxStoredReachCostings = 6;
+
+// Used to say that no stored reach can be used for a costing
+constexpr uint8_t kNoStoredReach = 255;
+
+/**
+ * The reach of a directed edge (see thor::Reach) expanded with the default options of a costing
+ * and capped at the max reach of the section. A reach below the cap is the exact reach, a reach at
+ * the cap only says that the edge reaches at least that far.
+ */
+struct StoredReach {
+  uint8_t outbound;
+  uint8_t inbound;
+};
+
+/**
+ * Start of the reach section of a tile. It is followed by the StoredReach of every directed edge
+ * of the tile for each of the costings in turn. Everything in the section is single bytes so that
+ * it can be appended to a tile at any offset.
+ */
+struct StoredReachHeader {
+  uint8_t max_reach;                         // the cap of all of the reaches
+  uint8_t costing_count;                     // how many costings have their reach stored
+  uint8_t costings[kMaxStoredReachCostings]; // the costing types (as in the Costing proto)
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_STOREDREACH_H_
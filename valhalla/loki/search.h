@@ -5,6 +5,8 @@
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/baldr/location.h>
 #include <valhalla/baldr/pathlocation.h>
+#include <valhalla/baldr/storedreach.h>
+#include <valhalla/proto/options.pb.h>
 #include <valhalla/sif/dynamiccost.h>
 
 namespace valhalla {
@@ -19,13 +21,25 @@ namespace loki {
  * proper cache
  * @param costing        a costing object by which we can determine which portions of the graph are
  *                       accessible and therefor potential candidates
+ * @param stored_reach   the costing whose reach stored in the tiles is the reach of the costing
+ *                       above (see GetStoredReachCosting), the reach is expanded if there is none
  * @return pathLocations the correlated data with in the tile that matches the inputs. If a
  * projection is not found, it will not have any entry in the returned value.
  */
 std::unordered_map<baldr::Location, baldr::PathLocation>
 Search(const std::vector<baldr::Location>& locations,
        baldr::GraphReader& reader,
-       const std::shared_ptr<sif::DynamicCost>& costing);
+       const std::shared_ptr<sif::DynamicCost>& costing,
+       const uint8_t stored_reach = baldr::kNoStoredReach);
+
+/**
+ * The reach stored in the tiles was expanded with the default options of its costings, so it is
+ * only the reach of a request whose options are the defaults as well.
+ *
+ * @param options  the request options, after their costing was parsed
+ * @return the costing type whose stored reach can be used or kNoStoredReach if there is none
+ */
+uint8_t GetStoredReachCosting(const Options& options);
 
 } // namespace loki
 } // namespace valhalla
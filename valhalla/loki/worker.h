@@ -4,6 +4,7 @@
 #include <valhalla/baldr/connectivity_map.h>
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/baldr/location.h>
+#include <valhalla/baldr/storedreach.h>
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/proto/options.pb.h>
 #include <valhalla/sif/costfactory.h>
@@ -35,6 +36,7 @@ public:
 
   std::string locate(Api& request);
   void route(Api& request);
+  void batch_route(Api& request);
   void matrix(Api& request);
   void isochrones(Api& request);
   void trace(Api& request);
@@ -56,6 +58,7 @@ protected:
 
   void init_locate(Api& request);
   void init_route(Api& request);
+  void init_batch_route(Api& request);
   void init_matrix(Api& request);
   void init_isochrones(Api& request);
   void init_trace(Api& request);
@@ -65,6 +68,7 @@ protected:
   boost::property_tree::ptree config;
   sif::CostFactory factory;
   sif::cost_ptr_t costing;
+  uint8_t stored_reach_costing = baldr::kNoStoredReach;
   std::shared_ptr<baldr::GraphReader> reader;
   std::shared_ptr<baldr::connectivity_map_t> connectivity_map;
   std::unordered_set<Options::Action> actions;
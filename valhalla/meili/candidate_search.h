@@ -16,6 +16,9 @@
 
 #include <algorithm>
 #include <cmath>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
 
 namespace valhalla {
 namespace meili {
@@ -30,11 +33,62 @@ public:
                                                  const sif::cost_ptr_t& costing = nullptr) const = 0;
 };
 
-class CandidateGridQuery final : public CandidateQuery {
+/**
+ * The grids of the bins of the local tiles which have been indexed so far. A grid never changes
+ * once it is indexed, so the cache can be shared by the CandidateGridQuery of several threads (each
+ * with its own GraphReader) and a bin is only indexed once no matter which thread needs it first.
+ */
+class CandidateGridCache {
 public:
   using grid_t = GridRangeQuery<baldr::GraphId, midgard::PointLL>;
 
-  CandidateGridQuery(baldr::GraphReader& reader, float cell_width, float cell_height);
+  /**
+   * Get the grid of a bin from the cache.
+   * @param bin_id  the id of the bin among the bins of all of the local tiles
+   * @return the grid or nullptr if it is not in the cache
+   */
+  std::shared_ptr<const grid_t> Get(const int32_t bin_id) const;
+
+  /**
+   * Puts the grid of a bin into the cache. If another thread already put the same bin the cached
+   * grid is kept and returned.
+   * @param bin_id  the id of the bin among the bins of all of the local tiles
+   * @param grid    the indexed grid of the bin
+   * @return the cached grid
+   */
+  std::shared_ptr<const grid_t> Put(const int32_t bin_id, std::shared_ptr<const grid_t> grid);
+
+  /**
+   * @return the number of grids in the cache
+   */
+  size_t size() const;
+
+  /**
+   * Clears the cache, grids still in use by a query stay alive until it is done with them.
+   */
+  void Clear();
+
+private:
+  mutable std::shared_mutex mutex_;
+  std::unordered_map<int32_t, std::shared_ptr<const grid_t>> grids_;
+};
+
+class CandidateGridQuery final : public CandidateQuery {
+public:
+  using grid_t = CandidateGridCache::grid_t;
+
+  /**
+   * Constructor.
+   * @param reader       the graph reader to get the tiles of the bins from
+   * @param cell_width   the width of the cells of the grids in degrees
+   * @param cell_height  the height of the cells of the grids in degrees
+   * @param grid_cache   a cache of grids to share with other queries, by default each query has
+   *                     its own
+   */
+  CandidateGridQuery(baldr::GraphReader& reader,
+                     float cell_width,
+                     float cell_height,
+                     const std::shared_ptr<CandidateGridCache>& grid_cache = {});
 
   ~CandidateGridQuery() override;
 
@@ -60,20 +114,24 @@ public:
                                            edgeids.end(), costing);
   }
 
-  std::unordered_map<baldr::GraphId, grid_t>::size_type size() const {
-    return grid_cache_.size();
+  size_t size() const {
+    return grid_cache_->size();
   }
 
   void Clear() {
-    grid_cache_.clear();
+    grid_cache_->Clear();
+  }
+
+  const std::shared_ptr<CandidateGridCache>& grid_cache() const {
+    return grid_cache_;
   }
 
 private:
   // Get a grid for a specified bin within a tile. Tile support for
   // graph tiles and bins is provided to go between bin Ids and tile Ids.
-  const grid_t* GetGrid(const int32_t bin_id,
-                        const midgard::Tiles<midgard::PointLL>& tiles,
-                        const midgard::Tiles<midgard::PointLL>& bins) const;
+  std::shared_ptr<const grid_t> GetGrid(const int32_t bin_id,
+                                        const midgard::Tiles<midgard::PointLL>& tiles,
+                                        const midgard::Tiles<midgard::PointLL>& bins) const;
 
   std::unordered_set<baldr::GraphId> RangeQuery(const midgard::AABB2<midgard::PointLL>& range) const;
 
@@ -83,7 +141,7 @@ private:
   float cell_height_;
 
   // Grid cache - cached per "bin" within a graph tile
-  mutable std::unordered_map<int32_t, grid_t> grid_cache_;
+  std::shared_ptr<CandidateGridCache> grid_cache_;
 
   baldr::GraphReader& reader_;
 };
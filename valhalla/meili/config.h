@@ -42,6 +42,9 @@ struct Config {
     float turn_penalty_factor = 200.f;
     // define if 'turn_penalty_factor' option can be reassigned with user request
     bool is_turn_penalty_factor_customizable = true;
+    // how many of the candidates of each measurement with the lowest accumulated costs the viterbi
+    // search routes from; 0 routes from all of them
+    size_t beam_width = 0;
 
     void Read(const boost::property_tree::ptree& params);
   };
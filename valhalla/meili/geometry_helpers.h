@@ -20,6 +20,14 @@ Project(const midgard::projector_t& p,
         midgard::Shape7Decoder<midgard::PointLL>& shape,
         double snap_distance = 0.0);
 
+// the same for an already decoded shape, which must not be empty, optionally with the length along
+// it up to each of its points
+std::tuple<midgard::PointLL, double, typename std::vector<midgard::PointLL>::size_type, double>
+Project(const midgard::projector_t& p,
+        const std::vector<midgard::PointLL>& shape,
+        double snap_distance = 0.0,
+        const std::vector<double>* lengths = nullptr);
+
 } // namespace helpers
 } // namespace meili
 } // namespace valhalla
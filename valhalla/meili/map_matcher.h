@@ -15,6 +15,7 @@
 #include <valhalla/meili/transition_cost_model.h>
 #include <valhalla/midgard/pointll.h>
 
+#include <unordered_map>
 #include <vector>
 
 namespace valhalla {
@@ -68,6 +69,20 @@ public:
   std::vector<MatchResults> OfflineMatch(const std::vector<Measurement>& measurements,
                                          uint32_t k = 1);
 
+  /**
+   * Match a live trace as its measurements come in. The search goes on where the previous call left
+   * off and a match result is only returned once it can't change anymore, that is once the most
+   * probable paths to all the candidates of the latest measurement agree on it. The states before
+   * the returned results are dropped, so a trace can go on for as long as it likes. Together the
+   * results of all the calls are what OfflineMatch (with k = 1) finds for the whole trace. Clear or
+   * OfflineMatch start over.
+   * @param measurements  the measurements which came in since the last call
+   * @param finish        whether the trace ends here, all the remaining results are returned
+   * @return the match results which can't change anymore, in the order of their measurements
+   */
+  std::vector<MatchResult> OnlineMatch(const std::vector<Measurement>& measurements,
+                                       bool finish = false);
+
   /**
    * Set a callback that will throw when the map-matching should be aborted
    * @param interrupt_callback  the function to periodically call to see if we should abort
@@ -83,6 +98,10 @@ private:
 
   StateId::Time AppendMeasurement(const Measurement& measurement, const float sq_max_search_radius);
 
+  void SetLeaveTime(StateId::Time time,
+                    const std::vector<Measurement>& interpolated,
+                    const Measurement& next);
+
   void RemoveRedundancies(const std::vector<StateId>& result,
                           const std::vector<MatchResult>& results);
 
@@ -108,6 +127,15 @@ private:
   EmissionCostModel emission_cost_model_;
 
   TransitionCostModel transition_cost_model_;
+
+  // The states of the online match which can't change anymore
+  TimeWindow<StateId> online_path_;
+
+  // The measurements of the online match which are interpolated after each time
+  std::unordered_map<StateId::Time, std::vector<Measurement>> online_interpolated_;
+
+  // The time of the next online match result to return
+  StateId::Time online_time_{0};
 };
 
 /**
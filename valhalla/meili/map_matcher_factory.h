@@ -16,8 +16,17 @@ namespace meili {
 
 class MapMatcherFactory final {
 public:
+  /**
+   * Constructor. A factory and the matchers it creates are meant to be used by one thread at a
+   * time. To match on several threads give each of them its own factory, with its own graph reader,
+   * and share the grid cache of the first one with the others so that each bin is only indexed once.
+   * @param root          the config
+   * @param graph_reader  the graph reader to use, by default one is created from the config
+   * @param grid_cache    the cache of candidate grids to use, by default the factory has its own
+   */
   MapMatcherFactory(const boost::property_tree::ptree& root,
-                    const std::shared_ptr<baldr::GraphReader>& graph_reader = {});
+                    const std::shared_ptr<baldr::GraphReader>& graph_reader = {},
+                    const std::shared_ptr<CandidateGridCache>& grid_cache = {});
 
   ~MapMatcherFactory();
 
@@ -29,6 +38,10 @@ public:
     return *candidatequery_;
   }
 
+  const std::shared_ptr<CandidateGridCache>& grid_cache() const {
+    return candidatequery_->grid_cache();
+  }
+
   MapMatcher* Create(const Options& options);
 
   MapMatcher* Create(const Costing::Type costing_type) {
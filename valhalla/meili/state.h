@@ -121,7 +121,14 @@ public:
   }
 
   StateId::Time size() const {
-    return static_cast<StateId::Time>(columns_.size());
+    return columns_.size();
+  }
+
+  // Drop the measurements and states before the time, the later ones keep their ids
+  void Prune(const StateId::Time& time) {
+    measurements_.prune(time);
+    leave_times_.prune(time);
+    columns_.prune(time);
   }
 
   // Check to see if we have the minimum number of measurements and edge candidates to perform a map
@@ -189,11 +196,11 @@ public:
   }
 
 private:
-  std::vector<Measurement> measurements_;
+  TimeWindow<Measurement> measurements_;
 
-  std::vector<double> leave_times_;
+  TimeWindow<double> leave_times_;
 
-  std::vector<Column> columns_;
+  TimeWindow<Column> columns_;
 };
 
 } // namespace meili
@@ -1,7 +1,9 @@
 #ifndef VALHALLA_MEILI_STATE_H_
 #define VALHALLA_MEILI_STATE_H_
 
+#include <algorithm>
 #include <cstdint>
+#include <deque>
 #include <functional>
 #include <limits>
 #include <utility>
@@ -46,6 +48,100 @@ private:
 
   uint64_t value_;
 };
+
+/**
+ * Items indexed by time, like the columns of the states. The items before a time can be pruned
+ * once they aren't needed anymore, the remaining ones keep their times so that the ids of their
+ * states stay valid. Size is one past the latest time, as if nothing had been pruned.
+ */
+template <typename T> class TimeWindow {
+public:
+  using iterator = typename std::deque<T>::iterator;
+  using const_iterator = typename std::deque<T>::const_iterator;
+
+  explicit TimeWindow(StateId::Time first_time = 0) : first_time_(first_time) {
+  }
+
+  T& operator[](StateId::Time time) {
+    return items_[time - first_time_];
+  }
+
+  const T& operator[](StateId::Time time) const {
+    return items_[time - first_time_];
+  }
+
+  StateId::Time first_time() const {
+    return first_time_;
+  }
+
+  StateId::Time size() const {
+    return first_time_ + static_cast<StateId::Time>(items_.size());
+  }
+
+  bool empty() const {
+    return items_.empty();
+  }
+
+  void clear() {
+    items_.clear();
+    first_time_ = 0;
+  }
+
+  void resize(StateId::Time size) {
+    items_.resize(size - first_time_);
+  }
+
+  void push_back(const T& item) {
+    items_.push_back(item);
+  }
+
+  void push_back(T&& item) {
+    items_.push_back(std::move(item));
+  }
+
+  template <typename... Args> void emplace_back(Args&&... args) {
+    items_.emplace_back(std::forward<Args>(args)...);
+  }
+
+  T& back() {
+    return items_.back();
+  }
+
+  const T& back() const {
+    return items_.back();
+  }
+
+  iterator begin() {
+    return items_.begin();
+  }
+
+  iterator end() {
+    return items_.end();
+  }
+
+  const_iterator begin() const {
+    return items_.begin();
+  }
+
+  const_iterator end() const {
+    return items_.end();
+  }
+
+  // Drop the items before the time
+  void prune(StateId::Time time) {
+    if (time <= first_time_) {
+      return;
+    }
+    const auto count = std::min<size_t>(time - first_time_, items_.size());
+    items_.erase(items_.begin(), items_.begin() + count);
+    first_time_ += static_cast<StateId::Time>(count);
+  }
+
+private:
+  std::deque<T> items_;
+  StateId::Time first_time_;
+};
+
 } // namespace meili
 } // namespace valhalla
 
@@ -93,6 +93,11 @@ public:
    * @return true if it's removed
    */
   virtual bool RemoveStateId(const StateId& stateid);
+  /**
+   * Forget the states before a time, the search must never need them again. The remaining states
+   * keep their ids.
+   */
+  virtual void Prune(StateId::Time time);
   virtual StateId SearchWinner(StateId::Time time) = 0;
   virtual StateId Predecessor(const StateId& stateid) const = 0;
   virtual double AccumulatedCost(const StateId& stateid) const = 0;
@@ -116,8 +121,8 @@ protected:
   constexpr static double
   CostSofar(double prev_costsofar, float transition_cost, float emission_cost);
 
-  std::vector<std::vector<StateId>> states_by_time;
-  std::vector<StateId> winner_by_time;
+  TimeWindow<std::vector<StateId>> states_by_time;
+  TimeWindow<StateId> winner_by_time;
 
 private:
   std::unordered_set<StateId> added_states_;
@@ -139,6 +144,7 @@ public:
   void ClearSearch() override;
   bool AddStateId(const StateId& stateid) override;
   bool RemoveStateId(const StateId& stateid) override;
+  void Prune(StateId::Time time) override;
   StateId SearchWinner(StateId::Time time) override;
   StateId Predecessor(const StateId& stateid) const override;
   double AccumulatedCost(const StateId& stateid) const override;
@@ -151,7 +157,7 @@ private:
   StateId FindWinner(const std::vector<StateLabel>& labels) const;
   const StateLabel& GetLabel(const StateId& stateid) const;
 
-  std::vector<std::vector<StateLabel>> history_;
+  TimeWindow<std::vector<StateLabel>> history_;
 };
 
 class ViterbiSearch : public IViterbiSearch {
@@ -165,21 +171,72 @@ public:
   void ClearSearch() override;
   bool AddStateId(const StateId& stateid) override;
   bool RemoveStateId(const StateId& stateid) override;
+  void Prune(StateId::Time time) override;
   StateId SearchWinner(StateId::Time time) override;
   StateId Predecessor(const StateId& stateid) const override;
   double AccumulatedCost(const StateId& stateid) const override;
 
+  /**
+   * Search the winner at a time like SearchWinner and then keep searching until the optimal path
+   * to every other state at that time is known too, like a full viterbi pass over the columns
+   * would. The time must be the latest one searched so far (the search stops at the last time which
+   * has any states). When the search goes on the successors of all these states are expanded.
+   * @param time  the time to search
+   * @return the winner at the time
+   */
+  StateId SearchColumn(StateId::Time time);
+
+  /**
+   * Get the part of the most probable path which can't change anymore, however many states are
+   * added after the latest column searched by SearchColumn. That is the path up to the latest time
+   * at which the optimal paths to all the states of the latest column run through the same state.
+   * @param begin  the time to get the path from, the path must have converged there already
+   * @param last   whether no states will be added anymore, the path then ends at the winner of
+   *               the latest column
+   * @return the states of the path from begin on, empty if it didn't converge since then
+   */
+  std::vector<StateId> ConvergedPath(StateId::Time begin, bool last = false) const;
+
+  /**
+   * Limit the search to a beam of the states with the lowest accumulated costs at each time. States
+   * are scanned in the order of their accumulated costs, so once the first beam width states of a
+   * time are scanned the others are never expanded and their transition costs never computed.
+   * Neither are those of the states before it, which can't get into the beam anymore. The search
+   * is then no longer guaranteed to find the optimal path.
+   * @param beam_width  how many states are expanded at each time, 0 to expand all of them
+   */
+  void set_beam_width(size_t beam_width) {
+    beam_width_ = beam_width;
+  }
+
+  size_t beam_width() const {
+    return beam_width_;
+  }
+
 private:
   // Initialize labels from a column and push them into priority queue
   void InitQueue(const std::vector<StateId>& column);
   void AddSuccessorsToQueue(const StateId& stateid);
   StateId::Time IterativeSearch(StateId::Time target, bool request_new_start);
+  // Remember the label of an optimal state and remove it from the unreached ones, returns whether
+  // the state is in the beam and gets expanded
+  bool Scan(const StateLabel& label);
+  // Whether the beam at the time is full
+  bool IsBeamFull(StateId::Time time) const;
+  // The state before this one on the path, the winner before it if it starts a new path
+  StateId PathPredecessor(const StateId& stateid, StateId::Time time) const;
   constexpr static bool IsInvalidCost(double cost);
 
-  std::vector<std::vector<StateId>> unreached_states_by_time;
+  TimeWindow<std::vector<StateId>> unreached_states_by_time;
   std::unordered_map<StateId, StateLabel> scanned_labels_;
   SPQueue<StateLabel> queue_;
   StateId::Time earliest_time_{0};
+  // States at the latest time scanned by SearchColumn, their successors are not in the queue yet
+  std::vector<StateId> unexpanded_;
+  // How many states are expanded at each time, 0 for all of them
+  size_t beam_width_{0};
+  // How many states have been scanned at each time
+  TimeWindow<uint32_t> scanned_count_by_time_;
 };
 } // namespace meili
 } // namespace valhalla
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cerrno>
 #include <cmath>
 #include <cstdint>
@@ -14,6 +16,7 @@
 #include <queue>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
@@ -255,10 +258,80 @@ protected:
   std::string file_name;
 };
 
+// Merges sorted runs of elements, each step takes the smallest of the heads of the runs in
+// log2(runs) comparisons. Ties go to the earlier run so merging runs of a stable sort is stable.
+template <class T, class Less> class loser_tree {
+public:
+  using run_t = std::pair<const T*, const T*>;
+
+  loser_tree(std::vector<run_t> runs, const Less& less)
+      : runs(std::move(runs)), less(less), losers(this->runs.size()) {
+    winner = this->runs.empty() ? 0 : play(1);
+  }
+
+  // whether all of the runs are done
+  bool empty() const {
+    return runs.empty() || done(winner);
+  }
+
+  // the smallest of the heads of the runs
+  const T& top() const {
+    return *runs[winner].first;
+  }
+
+  // move on to the next element of the run the smallest came from
+  void pop() {
+    ++runs[winner].first;
+    // replay the matches on the way from its leaf to the root
+    for (size_t node = (winner + runs.size()) / 2; node > 0; node /= 2) {
+      if (beats(losers[node], winner)) {
+        std::swap(losers[node], winner);
+      }
+    }
+  }
+
+protected:
+  bool done(size_t run) const {
+    return runs[run].first == runs[run].second;
+  }
+
+  // whether the head of run a comes before the head of run b
+  bool beats(size_t a, size_t b) const {
+    if (done(a) || done(b)) {
+      return done(b) && (!done(a) || a < b);
+    }
+    if (less(*runs[a].first, *runs[b].first)) {
+      return true;
+    }
+    return !less(*runs[b].first, *runs[a].first) && a < b;
+  }
+
+  // the nodes below runs.size() are matches, the ones above are the runs, returns the winner
+  size_t play(size_t node) {
+    if (node >= runs.size()) {
+      return node - runs.size();
+    }
+    auto left = play(node * 2), right = play(node * 2 + 1);
+    if (beats(left, right)) {
+      losers[node] = right;
+      return left;
+    }
+    losers[node] = left;
+    return right;
+  }
+
+  std::vector<run_t> runs;
+  Less less;
+  std::vector<size_t> losers;
+  size_t winner;
+};
+
 template <class T> class sequence {
 public:
   // static_assert(std::is_pod<T>::value, "sequence requires POD types for now");
   static const size_t npos = -1;
+  // how many elements are sorted in memory at a time by default
+  static constexpr size_t default_sort_buffer_size = 1024 * 1024 * 512 / sizeof(T);
 
   using value_type = T;
 
@@ -323,70 +396,31 @@ public:
 
   // sort the file based on the predicate, and outputs to output_seq
   //
-  // Strategy is to first sort sub-ranges of length buffer_size in place.
-  // These should all fit in memory. Then, merge the sub-ranges into the
-  // output sequence via priority queue.
-  void sort(const std::function<bool(const T&, const T&)>& predicate,
-            size_t buffer_size = 1024 * 1024 * 512 / sizeof(T)) {
-    flush();
-    // if no elements we are done
-    if (memmap.size() == 0) {
-      return;
-    }
-
-    // If there wont be any merging we may as well take the simple approach
-    if (buffer_size > memmap.size() + write_buffer.size()) {
-      std::sort(static_cast<T*>(memmap), static_cast<T*>(memmap) + memmap.size(), predicate);
-      return;
-    }
-
-    auto tmp_path = std::filesystem::path(file_name).replace_filename(
-        std::filesystem::path(file_name).filename().string() + ".tmp");
-    {
-      // we need a temporary sequence to merge the sorted subsections into
-      sequence<T> output_seq(tmp_path.string(), true);
-
-      // Comparator needs to be inverted for pq to provide constant time *smallest* lookup
-      // Pq keeps track of element and its index.
-      auto cmp = [&predicate](const std::pair<T, size_t>& a, std::pair<T, size_t>& b) {
-        return predicate(b.first, a.first);
-      };
-      std::priority_queue<std::pair<T, size_t>, std::vector<std::pair<T, size_t>>, decltype(cmp)> pq(
-          cmp);
-
-      // Sort the subsections
-      for (size_t i = 0; i < memmap.size(); i += buffer_size) {
-        std::sort(static_cast<T*>(memmap) + i,
-                  static_cast<T*>(memmap) + std::min(memmap.size(), i + buffer_size), predicate);
-        pq.emplace(*at(i), i);
-      }
-
-      // Perform the merge
-      while (!pq.empty()) {
-        auto tmp = pq.top();
-        pq.pop();
-        output_seq.push_back(tmp.first);
-        size_t new_idx = tmp.second + 1;
-        if (new_idx % buffer_size != 0 && new_idx < memmap.size()) {
-          pq.emplace(*at(new_idx), new_idx);
-        }
-      }
-      output_seq.flush();
-    }
-
-    // Forget about this file for a second so we can swap in the temp file
-    file.reset();
-    memmap.unmap();
-
-    // Move the sorted result back into place
-    std::filesystem::remove(file_name);
-    std::filesystem::rename(tmp_path, file_name);
-
-    // Reload the sequence
-    sequence<T> reloaded(file_name, false);
-    std::swap(file, reloaded.file);
-    std::swap(memmap, reloaded.memmap);
-    return;
+  // Strategy is to first sort sub-ranges in place, concurrency of them at a time, each of them
+  // buffer_size / concurrency long so that all of them fit in memory at once. Then, merge the
+  // sub-ranges into the output sequence via loser tree. The sub-ranges are sorted stably, so equal
+  // elements keep their order and the result does not depend on the concurrency
+  template <class Compare>
+  void sort(const Compare& predicate,
+            size_t buffer_size = default_sort_buffer_size,
+            size_t concurrency = 1) {
+    auto sort_chunk = [&predicate](T* begin, T* end) { std::stable_sort(begin, end, predicate); };
+    external_sort(sort_chunk, predicate, buffer_size, concurrency);
+  }
+
+  // sort the file by an unsigned integer key of the elements, like sort with a predicate comparing
+  // the keys but each sub-range is radix sorted. It is stable, elements with the same key keep their
+  // order. Radix sorting needs as much memory again as the sub-ranges being sorted
+  template <class Key>
+  void sort_by_key(const Key& key,
+                   size_t buffer_size = default_sort_buffer_size,
+                   size_t concurrency = 1) {
+    using key_t = std::decay_t<decltype(key(std::declval<const T&>()))>;
+    static_assert(std::is_integral<key_t>::value && std::is_unsigned<key_t>::value,
+                  "sort_by_key requires unsigned integer keys");
+    auto sort_chunk = [&key](T* begin, T* end) { radix_sort(begin, end, key); };
+    auto predicate = [&key](const T& a, const T& b) { return key(a) < key(b); };
+    external_sort(sort_chunk, predicate, buffer_size, concurrency);
   }
 
   // perform an volatile operation on all the items of this sequence
@@ -556,6 +590,150 @@ public:
     return iterator(this, index);
   }
 
+protected:
+  // sorts sub-ranges with sort_chunk and merges them in order of the predicate
+  template <class SortChunk, class Compare>
+  void external_sort(const SortChunk& sort_chunk,
+                     const Compare& predicate,
+                     size_t buffer_size,
+                     size_t concurrency) {
+    flush();
+    // if no elements we are done
+    if (memmap.size() == 0) {
+      return;
+    }
+    buffer_size = std::max<size_t>(buffer_size, 1);
+    concurrency = std::max<size_t>(concurrency, 1);
+    T* data = memmap;
+
+    // If there wont be any merging we may as well take the simple approach
+    if (buffer_size > memmap.size() + write_buffer.size()) {
+      parallel_sort(data, data + memmap.size(), sort_chunk, predicate, concurrency);
+      return;
+    }
+
+    // Sort the subsections, as many at a time as there are threads
+    using merge_t = loser_tree<T, std::decay_t<Compare>>;
+    std::vector<typename merge_t::run_t> runs;
+    const size_t run_size = std::max<size_t>(buffer_size / concurrency, 1);
+    for (size_t i = 0; i < memmap.size(); i += run_size) {
+      runs.emplace_back(data + i, data + std::min(memmap.size(), i + run_size));
+    }
+    parallel_for(runs.size(), concurrency, [&runs, &sort_chunk](size_t i) {
+      sort_chunk(const_cast<T*>(runs[i].first), const_cast<T*>(runs[i].second));
+    });
+
+    auto tmp_path = std::filesystem::path(file_name).replace_filename(
+        std::filesystem::path(file_name).filename().string() + ".tmp");
+    {
+      // we need a temporary sequence to merge the sorted subsections into
+      sequence<T> output_seq(tmp_path.string(), true);
+
+      // Perform the merge
+      merge_t merge(std::move(runs), predicate);
+      for (; !merge.empty(); merge.pop()) {
+        output_seq.push_back(merge.top());
+      }
+      output_seq.flush();
+    }
+
+    // Forget about this file for a second so we can swap in the temp file
+    file.reset();
+    memmap.unmap();
+
+    // Move the sorted result back into place
+    std::filesystem::remove(file_name);
+    std::filesystem::rename(tmp_path, file_name);
+
+    // Reload the sequence
+    sequence<T> reloaded(file_name, false);
+    std::swap(file, reloaded.file);
+    std::swap(memmap, reloaded.memmap);
+  }
+
+  // calls work for each of 0 to count - 1 on up to concurrency threads
+  template <class Work> static void parallel_for(size_t count, size_t concurrency, const Work& work) {
+    std::atomic<size_t> next{0};
+    auto worker = [&next, count, &work]() {
+      for (size_t i = next++; i < count; i = next++) {
+        work(i);
+      }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min(concurrency, count); ++i) {
+      threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+
+  // sorts concurrency chunks of the range at the same time with sort_chunk and then merges them
+  // pairwise, which keeps the order of equal elements
+  template <class SortChunk, class Compare>
+  static void parallel_sort(T* begin,
+                            T* end,
+                            const SortChunk& sort_chunk,
+                            const Compare& predicate,
+                            size_t concurrency) {
+    const size_t count = end - begin;
+    const size_t chunk = std::max<size_t>((count + concurrency - 1) / concurrency, 1024);
+    if (count <= chunk) {
+      sort_chunk(begin, end);
+      return;
+    }
+    parallel_for((count + chunk - 1) / chunk, concurrency, [&](size_t i) {
+      sort_chunk(begin + i * chunk, begin + std::min(count, (i + 1) * chunk));
+    });
+    for (size_t width = chunk; width < count; width *= 2) {
+      parallel_for((count + 2 * width - 1) / (2 * width), concurrency, [&](size_t i) {
+        const auto first = i * 2 * width;
+        if (first + width < count) {
+          std::inplace_merge(begin + first, begin + first + width,
+                             begin + std::min(count, first + 2 * width), predicate);
+        }
+      });
+    }
+  }
+
+  // least significant byte first radix sort by the key, skipping bytes every key has in common
+  template <class Key> static void radix_sort(T* begin, T* end, const Key& key) {
+    using key_t = std::decay_t<decltype(key(std::declval<const T&>()))>;
+    const size_t count = end - begin;
+    if (count < 2) {
+      return;
+    }
+    std::vector<T> buffer(count);
+    T* from = begin;
+    T* to = buffer.data();
+    for (size_t shift = 0; shift < sizeof(key_t) * 8; shift += 8) {
+      // count how many keys have each byte
+      std::array<size_t, 256> offsets{};
+      for (const T* element = from; element != from + count; ++element) {
+        ++offsets[(key(*element) >> shift) & 0xFF];
+      }
+      if (std::find(offsets.cbegin(), offsets.cend(), count) != offsets.cend()) {
+        continue;
+      }
+      // scatter them to where their byte starts
+      size_t offset = 0;
+      for (auto& bucket : offsets) {
+        offset += bucket;
+        bucket = offset - bucket;
+      }
+      for (const T* element = from; element != from + count; ++element) {
+        to[offsets[(key(*element) >> shift) & 0xFF]++] = *element;
+      }
+      std::swap(from, to);
+    }
+    if (from != begin) {
+      std::copy(from, from + count, begin);
+    }
+  }
+
+public:
+
   // write/read at certain index
   iterator operator[](size_t index) {
     return at(index);
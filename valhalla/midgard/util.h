@@ -622,6 +622,19 @@ struct projector_t {
     return {u.first + bx * scale, u.second + by * scale};
   }
 
+  /**
+   * Projects onto all of the segments of a decoded shape in one pass, several segments at a time
+   * with SSE2 or AVX2 where the cpu has them. The outcome is the same as projecting onto the
+   * segments one at a time and keeping the first of the closest projections.
+   *
+   * @param shape        the points of the shape
+   * @param point        set to the closest point on the shape
+   * @param sq_distance  set to the squared distance to that point or max if the shape has no
+   *                     segments (in which case the point is left as is)
+   * @return the index of the segment the closest point is on
+   */
+  size_t operator()(const std::vector<PointLL>& shape, PointLL& point, double& sq_distance) const;
+
   // critical data
   double lon_scale;
   double lat;
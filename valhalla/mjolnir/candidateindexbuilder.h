@@ -0,0 +1,23 @@
+#pragma once
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to store a candidate index (see baldr::CandidateIndexHeader) in the local tiles, so
+ * that map matching can look up the edges near a point without indexing the bins of the tile first.
+ */
+class CandidateIndexBuilder {
+public:
+  /**
+   * Index the shape segments of the edges in the bins of every local tile in a grid of
+   * mjolnir.candidate_index.grid_size by mjolnir.candidate_index.grid_size cells and store it in
+   * the tile.
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
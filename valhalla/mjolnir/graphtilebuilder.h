@@ -454,6 +454,36 @@ public:
                       const graph_tile_ptr& tile,
                       const std::array<std::vector<GraphId>, kBinCount>& more_bins);
 
+  /**
+   * Stores the reach of the edges of a tile as its last section, replacing any it already has.
+   * Everything else is copied directly without ever looking at it
+   * @param tile_dir      Base tile directory
+   * @param tile          the tile that gets the reach
+   * @param reach_header  the cap of the reach and the costings it was expanded for
+   * @param reaches       the reach of every edge of the tile, for each of the costings in turn
+   */
+  static void AddReach(const std::string& tile_dir,
+                       const graph_tile_ptr& tile,
+                       const StoredReachHeader& reach_header,
+                       const std::vector<StoredReach>& reaches);
+
+  /**
+   * Stores the candidate index of a tile right before its stored reach, replacing any index it
+   * already has. Everything else is copied directly without ever looking at it
+   * @param tile_dir      Base tile directory
+   * @param tile          the tile that gets the index
+   * @param index_header  the size of the grid and of its cells and how many edges and entries it has
+   * @param edges         the edges the entries refer to
+   * @param cells         the offset of the first entry of each cell, row by row, and the entry count
+   * @param entries       the entries of all the cells, indexes into the edges
+   */
+  static void AddCandidateIndex(const std::string& tile_dir,
+                                const graph_tile_ptr& tile,
+                                const CandidateIndexHeader& index_header,
+                                const std::vector<CandidateIndexEdge>& edges,
+                                const std::vector<uint32_t>& cells,
+                                const std::vector<uint32_t>& entries);
+
   /**
    * Get the turn lane builder at the specified index.
    * @param  idx  Index of the turn lane builder.
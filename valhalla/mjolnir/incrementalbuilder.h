@@ -0,0 +1,75 @@
+#pragma once
+
+#include <valhalla/baldr/graphid.h>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to rebuild only the local tiles that OSM change files (.osc) touch. It keeps the local
+ * tiles as the build stage wrote them (before any later stage renumbered or extended them) and the
+ * ways and way nodes of the last build in mjolnir.incremental_dir. The tiles of every way that
+ * changed, or that uses a node that changed, before and after the change are rebuilt along with
+ * the tiles which have edges ending in them, all the others are copied from the last build. Only
+ * the build stage works this way, the stages before and after it still run on the whole extract.
+ */
+class IncrementalBuilder {
+public:
+  /**
+   * Copies the local tiles of the last build which the changes do not touch into the tile_dir.
+   * @param pt              the config, mjolnir.incremental_dir is where the last build was kept
+   * @param change_files    the OSM change files from the extract of the last build to this one
+   * @param ways_file       the ways of this build
+   * @param way_nodes_file  the way nodes of this build, sorted by way
+   * @param tiles           the manifest of all the local tiles of this build
+   * @param dataset_id      the dataset id of this build, set in the copied tiles
+   * @return the manifest of the tiles which still need to be built
+   */
+  static std::map<baldr::GraphId, size_t> Restore(const boost::property_tree::ptree& pt,
+                                                  const std::vector<std::string>& change_files,
+                                                  const std::string& ways_file,
+                                                  const std::string& way_nodes_file,
+                                                  const std::map<baldr::GraphId, size_t>& tiles,
+                                                  const uint64_t dataset_id);
+
+  /**
+   * Keeps the local tiles the build stage just built in mjolnir.incremental_dir and removes the
+   * kept tiles which are no longer part of the tile set.
+   * @param pt     the config
+   * @param built  the manifest of the tiles which were built
+   * @param tiles  the manifest of all the local tiles
+   */
+  static void Save(const boost::property_tree::ptree& pt,
+                   const std::map<baldr::GraphId, size_t>& built,
+                   const std::map<baldr::GraphId, size_t>& tiles);
+
+  /**
+   * Moves the ways and way nodes of this build into mjolnir.incremental_dir, where the next build
+   * looks up what its changes touched before.
+   * @param pt              the config
+   * @param ways_file       the ways of this build
+   * @param way_nodes_file  the way nodes of this build, sorted by way
+   */
+  static void SaveWays(const boost::property_tree::ptree& pt,
+                       const std::string& ways_file,
+                       const std::string& way_nodes_file);
+
+  /**
+   * Compares all the tiles of two tile directories, ignoring when they were built and from which
+   * dataset. Every tile that differs is logged.
+   * @param tile_dir        one tile directory, usually updated from change files
+   * @param other_tile_dir  the other, usually fully built from the changed extract
+   * @return the number of tiles which differ or only exist on one side
+   */
+  static size_t Compare(const std::string& tile_dir, const std::string& other_tile_dir);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -8,6 +8,7 @@
 #include <valhalla/mjolnir/osmnodelinguistic.h>
 #include <valhalla/mjolnir/osmrestriction.h>
 #include <valhalla/mjolnir/osmway.h>
+#include <valhalla/mjolnir/sortedmultimap.h>
 #include <valhalla/mjolnir/uniquenames.h>
 
 #include <cstdint>
@@ -49,15 +50,15 @@ struct OSMLaneConnectivity {
   uint32_t from_lanes_index; // Index to string in UniqueNames
 };
 
-// Data types used within OSMData
-using RestrictionsMultiMap = std::unordered_multimap<uint64_t, OSMRestriction>;
+// Data types used within OSMData. The multimaps are sorted by OSM id so that the build stages can
+// map them read only from the temporary files instead of reading them back onto the heap
+using RestrictionsMultiMap = SortedMultiMap<OSMRestriction>;
 using ViaSet = std::unordered_set<uint64_t>;
-using AccessRestrictionsMultiMap = std::unordered_multimap<uint64_t, OSMAccessRestriction>;
-using BikeMultiMap = std::unordered_multimap<uint64_t, OSMBike>;
-using OSMLaneConnectivityMultiMap = std::unordered_multimap<uint64_t, OSMLaneConnectivity>;
-using LinguisticMultiMap = std::unordered_multimap<uint64_t, OSMLinguistic>;
-using ConditionalSpeedLimitsMultiMap =
-    std::unordered_multimap<uint64_t, baldr::ConditionalSpeedLimit>;
+using AccessRestrictionsMultiMap = SortedMultiMap<OSMAccessRestriction>;
+using BikeMultiMap = SortedMultiMap<OSMBike>;
+using OSMLaneConnectivityMultiMap = SortedMultiMap<OSMLaneConnectivity>;
+using LinguisticMultiMap = SortedMultiMap<OSMLinguistic>;
+using ConditionalSpeedLimitsMultiMap = SortedMultiMap<baldr::ConditionalSpeedLimit>;
 
 // OSMString map uses the way Id as the key and the name index into UniqueNames as the value
 using OSMStringMap = std::unordered_map<uint64_t, uint32_t>;
@@ -74,17 +75,23 @@ struct OSMData {
   bool write_to_temp_files(const std::string& tile_dir);
 
   /**
-   * Read data from temporary files.
+   * Read data from temporary files. The multimaps and the unique names are mapped read only from
+   * the files rather than copied onto the heap, so the files must outlive this data.
    * @return Returns true if successful, false if an error occurs.
    */
   bool read_from_temp_files(const std::string& tile_dir);
 
   /**
-   * Read data from temporary unique name file.
+   * Read data from temporary unique name file, it is mapped read only like above.
    * @return Returns true if successful, false if an error occurs.
    */
   bool read_from_unique_names_file(const std::string& tile_dir);
 
+  /**
+   * Sorts the multimaps by OSM id, which the lookups need after parsing added to them.
+   */
+  void sort_multimaps();
+
   /**
    * add the direction information to the forward or reverse map for relations.
    */
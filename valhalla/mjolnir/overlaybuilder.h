@@ -0,0 +1,22 @@
+#pragma once
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to build the metric independent route planning overlay (see baldr::GraphOverlay)
+ * from the highway level of the tiles.
+ */
+class OverlayBuilder {
+public:
+  /**
+   * Find the boundary edges of every highway tile and write them to the file configured
+   * as mjolnir.overlay.
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to store the reach (see thor::Reach) of every directed edge in the tiles, so that
+ * loki can look it up instead of expanding it for every candidate edge.
+ */
+class ReachBuilder {
+public:
+  /**
+   * Expand the inbound and outbound reach of every edge, capped at mjolnir.reach.max_reach, with
+   * the default options of each of the costings in mjolnir.reach.costings and store it in the tiles.
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -0,0 +1,161 @@
+#ifndef VALHALLA_MJOLNIR_SORTEDMULTIMAP_H
+#define VALHALLA_MJOLNIR_SORTEDMULTIMAP_H
+
+#include <valhalla/midgard/sequence.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Multimap from OSM ids to fixed size values, kept as one flat array of id/value pairs sorted by
+ * id. While parsing the pairs live on the heap. Once written to a file the later stages map that
+ * file read only and look ids up with a binary search in place, so nothing is copied back onto
+ * the heap between the stages. Values with the same id keep the order they were inserted in.
+ */
+template <typename T> class SortedMultiMap {
+  static_assert(std::is_trivially_copyable_v<T>, "The values are written and mapped as raw bytes");
+
+public:
+  using value_type = std::pair<uint64_t, T>;
+  using const_iterator = const value_type*;
+
+  /**
+   * Adds a value. If the map was mapped from a file its contents are copied onto the heap first.
+   * Lookups need the map to be sorted again unless the ids are added in ascending order.
+   * @param value  the id and the value
+   */
+  void insert(const value_type& value) {
+    unmap();
+    sorted_ = sorted_ && (values_.empty() || values_.back().first <= value.first);
+    values_.push_back(value);
+  }
+
+  void emplace(const uint64_t id, const T& value) {
+    insert(value_type{id, value});
+  }
+
+  /**
+   * Sorts the values by id, the values with the same id stay in the order they were added in.
+   * Has to be called after adding values out of order and before looking anything up.
+   */
+  void sort() {
+    if (!sorted_) {
+      std::stable_sort(values_.begin(), values_.end(),
+                       [](const value_type& a, const value_type& b) { return a.first < b.first; });
+      sorted_ = true;
+    }
+  }
+
+  /**
+   * Gets the range of values with the given id.
+   * @param id  the OSM id
+   * @return the range of values, both end() if there are none
+   */
+  std::pair<const_iterator, const_iterator> equal_range(const uint64_t id) const {
+    if (!sorted_) {
+      throw std::logic_error("SortedMultiMap has to be sorted before looking up ids");
+    }
+    auto range = std::equal_range(begin(), end(), value_type{id, {}},
+                                  [](const value_type& a, const value_type& b) {
+                                    return a.first < b.first;
+                                  });
+    return range.first == range.second ? std::make_pair(end(), end()) : range;
+  }
+
+  const_iterator find(const uint64_t id) const {
+    return equal_range(id).first;
+  }
+
+  const_iterator begin() const {
+    return mapped_ ? mapped_->get() : values_.data();
+  }
+
+  const_iterator end() const {
+    return begin() + size();
+  }
+
+  size_t size() const {
+    return mapped_ ? mapped_->size() : values_.size();
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  void clear() {
+    mapped_.reset();
+    values_.clear();
+    sorted_ = true;
+  }
+
+  /**
+   * Writes the sorted values to a file. Nothing is written if they are mapped from that very file
+   * since they cannot have changed.
+   * @param file_name  the file to write
+   * @return whether the file could be written
+   */
+  bool write(const std::string& file_name) {
+    std::error_code ec;
+    if (mapped_ && std::filesystem::equivalent(file_name, mapped_->name(), ec)) {
+      return true;
+    }
+    sort();
+    std::ofstream file(file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      return false;
+    }
+    file.write(reinterpret_cast<const char*>(begin()), size() * sizeof(value_type));
+    return !file.fail();
+  }
+
+  /**
+   * Maps a file written by write() read only and drops whatever was on the heap.
+   * @param file_name  the file to map
+   * @return whether the file exists
+   */
+  bool map(const std::string& file_name) {
+    clear();
+    std::error_code ec;
+    const auto bytes = std::filesystem::file_size(file_name, ec);
+    if (ec) {
+      return false;
+    }
+    values_.shrink_to_fit();
+    // an empty file has nothing to map so there is nothing to look up either
+    if (bytes >= sizeof(value_type)) {
+      mapped_ = std::make_unique<midgard::mem_map<value_type>>();
+      mapped_->map_readonly(file_name, bytes / sizeof(value_type), POSIX_MADV_RANDOM);
+    }
+    return true;
+  }
+
+protected:
+  // copies the mapped values onto the heap so that more can be added
+  void unmap() {
+    if (mapped_) {
+      values_.assign(begin(), end());
+      mapped_.reset();
+    }
+  }
+
+  std::vector<value_type> values_;
+  // mem_map does not hand its mapping over when moved so it is kept behind a pointer
+  std::unique_ptr<midgard::mem_map<value_type>> mapped_;
+  bool sorted_ = true;
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_SORTEDMULTIMAP_H
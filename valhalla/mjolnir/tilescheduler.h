@@ -0,0 +1,122 @@
+#pragma once
+
+#include <valhalla/baldr/graphid.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Hands the tiles of a build stage out to the threads of that stage. The tiles are started heaviest
+ * first, by a weight like their size on disk or their node count, so that the dense tiles do not
+ * end up last and keep one thread busy while all the others sit idle. Each thread has its own
+ * queue of tiles and takes from the back of the fullest other queue once its own runs dry. When
+ * the stage is done it logs how busy its threads were and how long its tail was, that is how long
+ * it took to finish once there were no more tiles to start.
+ */
+class TileScheduler {
+public:
+  /**
+   * What a thread of the stage uses to get its tiles.
+   */
+  class Worker {
+  public:
+    /**
+     * Gets the next tile to work on, from the queue of this thread or from another one.
+     * @param tile_id  set to the next tile
+     * @return false once there are no tiles left
+     */
+    bool next(baldr::GraphId& tile_id);
+
+    /**
+     * @return the index of this thread, from 0 to the concurrency of the scheduler
+     */
+    size_t index() const {
+      return index_;
+    }
+
+  protected:
+    friend class TileScheduler;
+    Worker(TileScheduler& scheduler, const size_t index) : scheduler_(scheduler), index_(index) {
+    }
+
+    TileScheduler& scheduler_;
+    size_t index_;
+    size_t tiles_ = 0;
+    std::chrono::steady_clock::duration busy_{};
+    std::chrono::steady_clock::time_point started_{};
+    bool working_ = false;
+  };
+
+  /**
+   * @param stage        the name of the stage to report
+   * @param concurrency  how many threads to run, at least one is
+   */
+  TileScheduler(const std::string& stage, const size_t concurrency);
+
+  /**
+   * Adds a tile. Tiles of the same weight are started in the order they were added in.
+   * @param tile_id  the tile
+   * @param weight   how much work the tile is relative to the others
+   */
+  void add(const baldr::GraphId& tile_id, const uint64_t weight = 0);
+
+  /**
+   * Runs the stage, the work is called once on each thread and loops over the tiles the worker
+   * hands it. If the work throws on any thread the first exception is rethrown once all threads
+   * are done.
+   * @param work  what each thread does
+   */
+  void run(const std::function<void(Worker&)>& work);
+
+  /**
+   * @return how many threads run the stage, workers are numbered below this
+   */
+  size_t concurrency() const {
+    return concurrency_;
+  }
+
+  /**
+   * @return how many tiles were added
+   */
+  size_t size() const {
+    return tasks_.size();
+  }
+
+  /**
+   * The weight of a tile by its size on disk, for the stages which work on built tiles.
+   * @param tile_dir  where the tiles are
+   * @param tile_id   the tile
+   * @return the size of the tile file or 0 if there is none
+   */
+  static uint64_t tile_size(const std::string& tile_dir, const baldr::GraphId& tile_id);
+
+protected:
+  struct Queue {
+    std::mutex lock;
+    std::deque<baldr::GraphId> tiles;
+    std::atomic<size_t> size{0};
+  };
+
+  bool take(const size_t index, baldr::GraphId& tile_id);
+
+  std::string stage_;
+  size_t concurrency_;
+  std::vector<std::pair<uint64_t, baldr::GraphId>> tasks_;
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::atomic<size_t> stolen_{0};
+  std::atomic<bool> drained_{false};
+  std::chrono::steady_clock::time_point drained_at_{};
+};
+
+} // namespace mjolnir
+} // namespace valhalla
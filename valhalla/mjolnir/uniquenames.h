@@ -1,8 +1,13 @@
 #ifndef VALHALLA_MJOLNIR_UNIQUENAMES_H
 #define VALHALLA_MJOLNIR_UNIQUENAMES_H
 
+#include <valhalla/midgard/sequence.h>
+
 #include <algorithm>
 #include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -13,7 +18,8 @@ namespace mjolnir {
 using NamesMap = std::unordered_map<std::string, uint32_t>;
 
 /**
- * Class to hold a list of unique names and indexes to them.
+ * Class to hold a list of unique names and indexes to them. Once written to a file the names can
+ * be mapped from it read only, the names are only copied onto the heap when another is added.
  */
 class UniqueNames {
 public:
@@ -32,6 +38,8 @@ public:
    * @return  Returns an index into the unique list of names.
    */
   uint32_t index(const std::string& name) {
+    unmap();
+
     // Find the name in the map. If it is there return the index.
     auto it = names_.find(name);
     if (it != names_.end()) {
@@ -51,7 +59,14 @@ public:
    * @param  index  Index into the unique name list.
    * @return  Returns the name
    */
-  const std::string& name(const uint32_t index) const {
+  std::string name(const uint32_t index) const {
+    if (mapped_) {
+      if (index >= mapped_count()) {
+        return {};
+      }
+      const uint64_t* offsets = mapped_offsets();
+      return std::string(mapped_names() + offsets[index], offsets[index + 1] - offsets[index]);
+    }
     return (index < (uint32_t)indexes_.size()) ? indexes_[index]->first : indexes_[0]->first;
   }
 
@@ -59,26 +74,108 @@ public:
    * Clear the names and indexes.
    */
   void Clear() {
+    mapped_.reset();
     names_.clear();
     indexes_.clear();
   }
 
+  /**
+   * Writes the names to a file: the number of names, the offsets of the names (and of the end of
+   * the last one) and all of the names one after another. Nothing is written if the names are
+   * mapped from that very file since they cannot have changed.
+   * @param  file_name  The file to write.
+   * @return  Returns true if the file could be written.
+   */
+  bool write(const std::string& file_name) const {
+    std::error_code ec;
+    if (mapped_ && std::filesystem::equivalent(file_name, mapped_->name(), ec)) {
+      return true;
+    }
+
+    std::ofstream file(file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      return false;
+    }
+    const uint64_t count = Size() + 1;
+    std::vector<uint64_t> offsets{0};
+    offsets.reserve(count + 1);
+    for (uint32_t i = 0; i < count; ++i) {
+      offsets.push_back(offsets.back() + name(i).size());
+    }
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    file.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+    for (uint32_t i = 0; i < count; ++i) {
+      const auto n = name(i);
+      file.write(n.data(), n.size());
+    }
+    return !file.fail();
+  }
+
+  /**
+   * Maps the names from a file written by write() read only, dropping the names on the heap.
+   * @param  file_name  The file to map.
+   * @return  Returns true if the file exists and holds names.
+   */
+  bool map(const std::string& file_name) {
+    std::error_code ec;
+    const auto bytes = std::filesystem::file_size(file_name, ec);
+    if (ec || bytes < 3 * sizeof(uint64_t)) {
+      return false;
+    }
+    Clear();
+    names_.rehash(0);
+    indexes_.shrink_to_fit();
+    mapped_ = std::make_unique<midgard::mem_map<char>>();
+    mapped_->map_readonly(file_name, bytes, POSIX_MADV_RANDOM);
+    return true;
+  }
+
   /**
    * Get the size - number of names. Since a blank name is added as the first unique name this
    * returns the size of the map - 1.
    * @return  Returns the number of unique names.
    */
   size_t Size() const {
-    return names_.size() - 1;
+    return mapped_ ? mapped_count() - 1 : names_.size() - 1;
   }
 
 protected:
+  uint64_t mapped_count() const {
+    return *reinterpret_cast<const uint64_t*>(mapped_->get());
+  }
+
+  const uint64_t* mapped_offsets() const {
+    return reinterpret_cast<const uint64_t*>(mapped_->get()) + 1;
+  }
+
+  const char* mapped_names() const {
+    return mapped_->get() + (mapped_count() + 2) * sizeof(uint64_t);
+  }
+
+  // copies the mapped names onto the heap so that more can be added
+  void unmap() {
+    if (mapped_) {
+      std::vector<std::string> names(mapped_count());
+      for (uint32_t i = 0; i < names.size(); ++i) {
+        names[i] = name(i);
+      }
+      Clear();
+      for (const auto& n : names) {
+        index(n);
+      }
+    }
+  }
+
   // Map of names to indexes
   NamesMap names_;
 
   // List of entries into the map
   using nameiter = NamesMap::iterator;
   std::vector<nameiter> indexes_;
+
+  // The names mapped from a file, mem_map does not hand its mapping over when moved so it is kept
+  // behind a pointer
+  std::unique_ptr<midgard::mem_map<char>> mapped_;
 };
 
 } // namespace mjolnir
@@ -9,6 +9,8 @@
 
 #include <boost/property_tree/ptree_fwd.hpp>
 
+#include <algorithm>
+#include <iterator>
 #include <list>
 #include <map>
 #include <string>
@@ -36,9 +38,30 @@ enum class BuildStage : int8_t {
   kRestrictions = 12,
   kElevation = 13,
   kValidate = 14,
-  kCleanup = 15
+  kCleanup = 15,
+  kOverlay = 16,
+  kReach = 17,
+  kCandidateIndex = 18
 };
 
+// The stages in pipeline order. New stages are appended to BuildStage so that the values of the
+// existing ones never change, this is where they run
+constexpr BuildStage kBuildStages[] = {
+    BuildStage::kInitialize,   BuildStage::kParseWays,      BuildStage::kParseRelations,
+    BuildStage::kParseNodes,   BuildStage::kConstructEdges, BuildStage::kBuild,
+    BuildStage::kEnhance,      BuildStage::kFilter,         BuildStage::kTransit,
+    BuildStage::kBss,          BuildStage::kHierarchy,      BuildStage::kShortcuts,
+    BuildStage::kRestrictions, BuildStage::kElevation,      BuildStage::kValidate,
+    BuildStage::kOverlay,      BuildStage::kReach,          BuildStage::kCandidateIndex,
+    BuildStage::kCleanup,
+};
+
+// Position of a stage in the pipeline, -1 for an invalid stage
+inline int stage_position(const BuildStage stage) {
+  const auto* found = std::find(std::begin(kBuildStages), std::end(kBuildStages), stage);
+  return found == std::end(kBuildStages) ? -1 : static_cast<int>(found - std::begin(kBuildStages));
+}
+
 constexpr uint8_t kMinor = 1;
 constexpr uint8_t kStopSign = 2;
 constexpr uint8_t kYieldSign = 4;
@@ -58,9 +81,12 @@ inline BuildStage string_to_buildstage(const std::string& s) {
        {"bss", BuildStage::kBss},
        {"hierarchy", BuildStage::kHierarchy},
        {"shortcuts", BuildStage::kShortcuts},
+       {"overlay", BuildStage::kOverlay},
        {"restrictions", BuildStage::kRestrictions},
        {"elevation", BuildStage::kElevation},
        {"validate", BuildStage::kValidate},
+       {"reach", BuildStage::kReach},
+       {"candidateindex", BuildStage::kCandidateIndex},
        {"cleanup", BuildStage::kCleanup}};
 
   auto i = stringToBuildStage.find(s);
@@ -82,9 +108,12 @@ inline std::string to_string(BuildStage stg) {
        {static_cast<int8_t>(BuildStage::kBss), "bss"},
        {static_cast<int8_t>(BuildStage::kHierarchy), "hierarchy"},
        {static_cast<int8_t>(BuildStage::kShortcuts), "shortcuts"},
+       {static_cast<int8_t>(BuildStage::kOverlay), "overlay"},
        {static_cast<int8_t>(BuildStage::kRestrictions), "restrictions"},
        {static_cast<int8_t>(BuildStage::kElevation), "elevation"},
        {static_cast<int8_t>(BuildStage::kValidate), "validate"},
+       {static_cast<int8_t>(BuildStage::kReach), "reach"},
+       {static_cast<int8_t>(BuildStage::kCandidateIndex), "candidateindex"},
        {static_cast<int8_t>(BuildStage::kCleanup), "cleanup"}};
 
   auto i = BuildStageStrings.find(static_cast<int8_t>(stg));
@@ -156,12 +185,16 @@ uint32_t compute_curvature(const std::list<midgard::PointLL>& shape);
  * @param end_stage     End stage of the pipeline to run
  * @param release_osmpbf_memory Free PBF parsing libs after use.  Saves RAM, but makes libprotobuf
  * unusable afterwards.  Set to false if you need to perform protobuf operations after building tiles.
+ * @param change_files  OSM change files (.osc) from the extract of the build kept in
+ *                      mjolnir.incremental_dir to input_files. If given only the local tiles they
+ *                      touch are built in the build stage, see IncrementalBuilder
  * @return Returns true if no errors occur, false if an error occurs.
  */
 bool build_tile_set(const boost::property_tree::ptree& config,
                     const std::vector<std::string>& input_files,
                     const BuildStage start_stage = BuildStage::kInitialize,
-                    const BuildStage end_stage = BuildStage::kValidate);
+                    const BuildStage end_stage = BuildStage::kValidate,
+                    const std::vector<std::string>& change_files = {});
 
 // The tile manifest is a JSON-serializable index of tiles to be processed during the build stage of
 // valhalla_build_tiles'. It can be used to distribute shard keys when building tiles with
@@ -15,6 +15,7 @@ namespace skadi {
 
 struct cache_t;
 class tile_data;
+class elevation_store_t;
 
 class sample {
 public:
@@ -35,7 +36,8 @@ public:
   /// when valhalla_benchmark_skadi start using config instead of folder
   /**
    * @brief Constructor
-   * @param[in] data_source  directory name of the datasource from which to sample
+   * @param[in] data_source  directory name of the datasource from which to sample or the path of
+   *                         an elevation store (see build_elevation_store)
    */
   sample(const std::string& data_source);
   ~sample();
@@ -63,6 +65,14 @@ protected:
    */
   template <class coord_t> double get(const coord_t& coord, tile_data& tile);
 
+  /**
+   * Get the tile with the given index from the store, the cache or the remote source
+   * @param index the tile index
+   * @param tile  the tile, output value
+   * @return true if there is data for the tile
+   */
+  bool source(uint16_t index, tile_data& tile);
+
   /**
    * @return A tile index value from a coordinate
    */
@@ -100,6 +110,14 @@ private:
    */
   void cache_initialisation(const std::string& source_path);
 
+  /**
+   * @brief maps an elevation store, tiles in it are sampled without going through the cache
+   * @param[in] store_path Path of the elevation store.
+   */
+  void store_initialisation(const std::string& store_path);
+
+  std::unique_ptr<elevation_store_t> store_;
+
   std::mutex cache_lck;
   std::string url_;
   std::unique_ptr<baldr::tile_getter_t> remote_loader_;
@@ -112,6 +130,17 @@ private:
  */
 std::string get_hgt_file_name(uint16_t index);
 
+/**
+ * @brief Converts an elevation directory into an elevation store: a single file with all of its
+ * tiles unpacked and indexed, which is memory mapped and sampled from without any locking or
+ * decompressing. Corrupt tiles are skipped. An existing store is only replaced once the new one
+ * is complete, so services which have it mapped keep reading the old one.
+ * @param[in] data_source  directory with the (compressed) elevation tiles
+ * @param[in] store_path   path of the elevation store to write
+ * @return true if the store was written
+ */
+bool build_elevation_store(const std::string& data_source, const std::string& store_path);
+
 /**
  * @return the no data value for this data source
  */
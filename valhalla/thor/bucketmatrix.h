@@ -0,0 +1,93 @@
+#ifndef VALHALLA_THOR_BUCKETMATRIX_H_
+#define VALHALLA_THOR_BUCKETMATRIX_H_
+
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto_conversions.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/costmatrix.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Class to compute cost (cost + time + distance) matrices among locations with the bucket
+ * approach to many-to-many queries: the backward search of every target runs to completion first,
+ * leaving (target, label) buckets on every edge it reached. The forward search of every source then
+ * only has to scan the buckets of the edges it settles, it never waits on the targets' searches.
+ * Both searches use the same expansion (and hierarchy limits) as CostMatrix, the buckets are its
+ * reached edges. Unlike CostMatrix the searches of the sources and of the targets are independent
+ * of each other, so they all run on as many threads as the CostMatrix was given.
+ */
+class BucketMatrix : public CostMatrix {
+public:
+  /**
+   * Default constructor. Most internal values are set when a query is made so
+   * the constructor mainly just sets some internals to a default empty value.
+   */
+  BucketMatrix(const boost::property_tree::ptree& config = {});
+
+  /**
+   * Forms a time distance matrix from the set of source locations
+   * to the set of target locations.
+   * @param  request               the full request
+   * @param  graphreader           Graph reader for accessing routing graph.
+   * @param  mode_costing          Costing methods.
+   * @param  mode                  Travel mode to use.
+   * @param  max_matrix_distance   Maximum arc-length distance for current mode.
+   */
+  bool SourceToTarget(Api& request,
+                      baldr::GraphReader& graphreader,
+                      const sif::mode_costing_t& mode_costing,
+                      const sif::travel_mode_t mode,
+                      const float max_matrix_distance) override;
+
+  /**
+   * Get the algorithm's name
+   * @return the name of the algorithm
+   */
+  inline const std::string& name() override {
+    return MatrixAlgoToString(Matrix::BucketMatrix);
+  }
+
+protected:
+  // how much longer than the straight line a path may be and still be found for sure
+  float detour_factor_;
+
+  /**
+   * Get the path distance both searches expand to. Every pair whose path is at most detour factor
+   * times as long as the straight line between them meets in the middle, any farther than that
+   * could only be found by chance.
+   * @param  sources              List of source locations.
+   * @param  targets              List of target locations.
+   * @param  max_matrix_distance  Maximum arc-length distance for current mode.
+   */
+  float GetSearchRadius(const google::protobuf::RepeatedPtrField<valhalla::Location>& sources,
+                        const google::protobuf::RepeatedPtrField<valhalla::Location>& targets,
+                        const float max_matrix_distance) const;
+
+  /**
+   * Expand the search of a single source or target until it is done.
+   * @param  index        Index of the source or target location.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  options      the request options
+   * @param  time_info    The origin's timeinfo object
+   * @param  invariant    Whether time should be treated as invariant
+   * @param  interruptible Whether the interrupt can be checked on this thread
+   */
+  template <const MatrixExpansionType expansion_direction,
+            const bool FORWARD = expansion_direction == MatrixExpansionType::forward>
+  void Search(const uint32_t index,
+              baldr::GraphReader& graphreader,
+              const valhalla::Options& options,
+              const baldr::TimeInfo& time_info,
+              const bool invariant,
+              const bool interruptible);
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_BUCKETMATRIX_H_
@@ -14,8 +14,10 @@
 #include <valhalla/thor/pathinfo.h>
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <set>
+#include <utility>
 #include <vector>
 
 namespace valhalla {
@@ -72,6 +74,25 @@ struct BestCandidate {
   }
 };
 
+// Threshold of a location which stopped expanding
+constexpr int kExhaustedThreshold = -1;
+
+/**
+ * What an iteration of a location changes for the locations of the other direction. These are
+ * only applied once every location of its direction had its iteration, in the order of the
+ * locations, so that the locations of one direction can be expanded concurrently and still find
+ * the very same connections as when they are expanded one after the other.
+ */
+struct DeferredStatus {
+  // edges this location's search reached, for the connection checks of the other direction
+  std::vector<baldr::GraphId> reached;
+  // locations of the other direction this one is done with and the threshold they continue with
+  // if it was the last one they were waiting for, kExhaustedThreshold if this search was exhausted
+  std::vector<std::pair<uint32_t, int>> done;
+  // whether this location stopped expanding
+  bool exhausted = false;
+};
+
 /**
  * Class to compute cost (cost + time + distance) matrices among locations.
  * This uses a bidirectional search with highway hierarchies. This is a
@@ -118,6 +139,14 @@ public:
     return MatrixAlgoToString(Matrix::CostMatrix);
   }
 
+  /**
+   * Expand the sources and the targets on more threads, each of which needs a graph reader of its
+   * own. The results are the same as when expanding on a single thread. No readers means the
+   * expansion stays on the calling thread.
+   * @param  readers  one graph reader for each additional thread
+   */
+  void set_thread_readers(const std::vector<std::shared_ptr<baldr::GraphReader>>& readers);
+
 protected:
   uint32_t max_reserved_labels_count_;
   uint32_t max_reserved_locations_count_;
@@ -127,6 +156,9 @@ protected:
   // found
   uint32_t max_iterations_;
 
+  // whether the adjacency lists widen their bucket range from the observed costs
+  bool adaptive_queue_;
+
   // Access mode used by the costing method
   uint32_t access_mode_;
 
@@ -160,6 +192,9 @@ protected:
   // List of best connections found so far
   std::vector<BestCandidate> best_connection_;
 
+  // Changes to the other direction each location made during the current iteration
+  std::array<std::vector<DeferredStatus>, 2> deferred_status_;
+
   bool ignore_hierarchy_limits_;
 
   // when doing timezone differencing a timezone cache speeds up the computation
@@ -175,6 +210,81 @@ protected:
                   const google::protobuf::RepeatedPtrField<valhalla::Location>& target_location_list,
                   const valhalla::Matrix& matrix);
 
+  /**
+   * Run one iteration of the search of every source or target which is still expanding, on as
+   * many threads as there are, and then apply what they changed for the other direction.
+   * @param  n            Iteration counter.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  options      the request options
+   * @param  time_infos   The sources' timeinfo objects
+   * @param  invariant    Whether time should be treated as invariant
+   */
+  template <const MatrixExpansionType expansion_direction,
+            const bool FORWARD = expansion_direction == MatrixExpansionType::forward>
+  void IterateLocations(const uint32_t n,
+                        baldr::GraphReader& graphreader,
+                        const valhalla::Options& options,
+                        const std::vector<baldr::TimeInfo>& time_infos,
+                        const bool invariant);
+
+  /**
+   * Run a function for each of the locations. It runs on all threads when there are at least as
+   * many locations as threads, otherwise the locations run one after the other on this thread.
+   * @param  count        Number of locations.
+   * @param  graphreader  Graph reader of the calling thread.
+   * @param  run          Called with the index of a location and the graph reader of its thread.
+   */
+  void RunLocations(const uint32_t count,
+                    baldr::GraphReader& graphreader,
+                    const std::function<void(const uint32_t, baldr::GraphReader&)>& run);
+
+  /**
+   * Add the edges a source or target reached since the last time to the ones the connection
+   * check of the other direction looks at.
+   * @param  forward  Whether it is a source or a target.
+   * @param  index    Index of the source or target location.
+   */
+  void MarkReached(const bool forward, const uint32_t index);
+
+  /**
+   * Form the matrix from the best connections between the sources and targets.
+   * @param  request      the full request
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  time_infos   The sources' timeinfo objects
+   * @param  invariant    Whether time should be treated as invariant
+   * @return Whether all connections were found
+   */
+  bool FormMatrix(Api& request,
+                  baldr::GraphReader& graphreader,
+                  const std::vector<baldr::TimeInfo>& time_infos,
+                  const bool invariant);
+
+  /**
+   * Run one iteration of the search of a single source or target.
+   * @param  index        Index of the source or target location.
+   * @param  n            Iteration counter.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  options      the request options
+   * @param  time_info    The origin's timeinfo object
+   * @param  invariant    Whether time should be treated as invariant
+   */
+  template <const MatrixExpansionType expansion_direction,
+            const bool FORWARD = expansion_direction == MatrixExpansionType::forward>
+  void Iterate(const uint32_t index,
+               const uint32_t n,
+               baldr::GraphReader& graphreader,
+               const valhalla::Options& options,
+               const baldr::TimeInfo& time_info,
+               const bool invariant);
+
+  /**
+   * Apply what the iteration of a source or target changed for the other direction.
+   * @param  index  Index of the source or target location.
+   */
+  template <const MatrixExpansionType expansion_direction,
+            const bool FORWARD = expansion_direction == MatrixExpansionType::forward>
+  void ApplyDeferredStatus(const uint32_t index);
+
   /**
    * Iterate the forward search from the source/origin location.
    * @param  index        Index of the source location.
@@ -244,10 +354,13 @@ protected:
                                const valhalla::Options& options);
 
   /**
-   * Update status when a connection is found.
+   * Update status when a connection is found. The location of the expanding direction is updated
+   * right away, the one of the other direction once the whole direction had its iteration.
    * @param  source  Source index
    * @param  target  Target index
    */
+  template <const MatrixExpansionType expansion_direction,
+            const bool FORWARD = expansion_direction == MatrixExpansionType::forward>
   void UpdateStatus(const uint32_t source, const uint32_t target);
 
   /**
@@ -350,10 +463,14 @@ protected:
 
 private:
   class ReachedMap;
+  class ExpansionPool;
 
   // Mark each source/target edge with a list of source/target indexes that have reached it
   std::unique_ptr<ReachedMap> targets_;
   std::unique_ptr<ReachedMap> sources_;
+
+  // Threads expanding the sources and targets alongside the calling one, if any
+  std::unique_ptr<ExpansionPool> pool_;
 };
 
 } // namespace thor
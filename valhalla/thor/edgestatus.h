@@ -3,7 +3,10 @@
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphtile.h>
 
-#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
 
 // handy macro for shifting the 7bit path index value so that it can be or'd with the tile/level id
 #define SHIFT_path_id(x) (static_cast<uint32_t>(x) << 25u)
@@ -51,13 +54,29 @@ struct EdgeStatusInfo {
  * edges within arrays for each tile. This allows the path algorithms to get
  * a pointer to the first edge status and iterate that pointer over sequential
  * edges. This reduces the number of map lookups.
+ *
+ * The per tile arrays are carved out of large slabs which are kept when the
+ * object is cleared, so that an algorithm reused across requests does not
+ * allocate and free them over and over. Tiles are mapped to their arrays by a
+ * small open addressing table and the last looked up tile is remembered, since
+ * consecutive lookups mostly hit the same tile. Only the modifying methods
+ * remember it, so Get may be called from several threads at once as long as
+ * none of them modifies the object meanwhile.
  */
 class EdgeStatus {
 public:
+  // Number of EdgeStatusInfo in a slab, tiles with more edges get a slab of their own
+  static constexpr size_t kSlabSize = 1 << 16;
+  // By default keep up to 4 slabs (1MB) around when clearing
+  static constexpr size_t kDefaultReservedSlabs = 4;
+
   /**
-   * Default constructor.
+   * Constructor.
+   * @param  reserved_slabs  Number of slabs kept when clearing, the rest is freed.
    */
-  EdgeStatus() = default;
+  explicit EdgeStatus(const size_t reserved_slabs = kDefaultReservedSlabs)
+      : reserved_slabs_(reserved_slabs) {
+  }
 
   // in order no to delete objects twice in destructor we should explicitly
   // forbid copying
@@ -67,21 +86,24 @@ public:
   EdgeStatus& operator=(EdgeStatus&&) = default;
 
   /**
-   * Destructor. Delete any allocated EdgeStatusInfo arrays.
+   * Clear the EdgeStatusInfo arrays and the edge status map. The slabs the
+   * arrays were taken from are kept (up to the reserved number) for reuse.
+   * @param  release_memory  Free all the slabs instead of keeping them.
    */
-  ~EdgeStatus() {
-    clear();
-  }
-
-  /**
-   * Clear the EdgeStatusInfo arrays and the edge status map.
-   */
-  void clear() {
-    // Delete any allocated arrays for tiles within the map.
-    for (auto& iter : edgestatus_) {
-      delete[] iter.second;
+  void clear(const bool release_memory = false) {
+    const size_t reservation = release_memory ? 0 : reserved_slabs_;
+    if (slabs_.size() > reservation) {
+      slabs_.resize(reservation);
+      slabs_.shrink_to_fit();
+    }
+    slab_index_ = 0;
+    slab_offset_ = 0;
+    if (tile_count_ > 0) {
+      std::fill(table_.begin(), table_.end(), Entry{});
+      tile_count_ = 0;
     }
-    edgestatus_.clear();
+    last_key_ = kNoKey;
+    last_status_ = nullptr;
   }
 
   /**
@@ -99,16 +121,14 @@ public:
            const graph_tile_ptr& tile,
            const uint8_t path_id = 0) {
     assert(path_id <= baldr::kMaxMultiPathId);
-    auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    if (p != edgestatus_.end()) {
-      p->second[edgeid.id()] = {set, index};
-    } else {
+    EdgeStatusInfo* status = Find(edgeid.tile_value() | SHIFT_path_id(path_id));
+    if (status == nullptr) {
       // Tile is not in the map. Add an array of EdgeStatusInfo, sized to
       // the number of directed edges in the specified tile.
-      auto inserted = edgestatus_.emplace(edgeid.tile_value() | SHIFT_path_id(path_id),
-                                          new EdgeStatusInfo[tile->header()->directededgecount()]);
-      inserted.first->second[edgeid.id()] = {set, index};
+      status = Insert(edgeid.tile_value() | SHIFT_path_id(path_id),
+                      tile->header()->directededgecount());
     }
+    status[edgeid.id()] = {set, index};
   }
 
   /**
@@ -121,9 +141,9 @@ public:
    */
   void Update(const baldr::GraphId& edgeid, const EdgeSet set, const uint8_t path_id = 0) {
     assert(path_id <= baldr::kMaxMultiPathId);
-    const auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    if (p != edgestatus_.end()) {
-      p->second[edgeid.id()].set_ = static_cast<uint32_t>(set);
+    EdgeStatusInfo* status = Find(edgeid.tile_value() | SHIFT_path_id(path_id));
+    if (status != nullptr) {
+      status[edgeid.id()].set_ = static_cast<uint32_t>(set);
     } else {
       throw std::runtime_error("EdgeStatus Update on edge not previously set");
     }
@@ -138,8 +158,8 @@ public:
    */
   EdgeStatusInfo Get(const baldr::GraphId& edgeid, const uint8_t path_id = 0) const {
     assert(path_id <= baldr::kMaxMultiPathId);
-    const auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    return (p == edgestatus_.end()) ? EdgeStatusInfo() : p->second[edgeid.id()];
+    const EdgeStatusInfo* status = Lookup(edgeid.tile_value() | SHIFT_path_id(path_id));
+    return status == nullptr ? EdgeStatusInfo() : status[edgeid.id()];
   }
 
   /**
@@ -155,23 +175,133 @@ public:
   EdgeStatusInfo*
   GetPtr(const baldr::GraphId& edgeid, const graph_tile_ptr& tile, const uint8_t path_id = 0) {
     assert(path_id <= baldr::kMaxMultiPathId);
-    const auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    if (p != edgestatus_.end()) {
-      return &p->second[edgeid.id()];
-    } else {
+    EdgeStatusInfo* status = Find(edgeid.tile_value() | SHIFT_path_id(path_id));
+    if (status == nullptr) {
       // Tile is not in the map. Add an array of EdgeStatusInfo, sized to
       // the number of directed edges in the specified tile.
-      auto inserted = edgestatus_.emplace(edgeid.tile_value() | SHIFT_path_id(path_id),
-                                          new EdgeStatusInfo[tile->header()->directededgecount()]);
-      return &(inserted.first->second)[edgeid.id()];
+      status = Insert(edgeid.tile_value() | SHIFT_path_id(path_id),
+                      tile->header()->directededgecount());
     }
+    return &status[edgeid.id()];
   }
 
 private:
-  // Edge status - keys are the tile Ids (level and tile Id) and the
-  // values are dynamically allocated arrays of EdgeStatusInfo (sized
-  // based on the directed edge count within the tile).
-  std::unordered_map<uint32_t, EdgeStatusInfo*> edgestatus_;
+  // the tile key of a GraphId with level 7 and path id 127 can never be used
+  static constexpr uint32_t kNoKey = std::numeric_limits<uint32_t>::max();
+
+  struct Entry {
+    uint32_t key = kNoKey;
+    EdgeStatusInfo* status = nullptr;
+  };
+
+  // Fibonacci hashing of the tile key into the table
+  size_t Slot(const uint32_t key) const {
+    return (key * 0x9E3779B9u) >> (32 - table_bits_);
+  }
+
+  // Looks up a tile and remembers it for the next lookup, for the modifying methods
+  EdgeStatusInfo* Find(const uint32_t key) {
+    EdgeStatusInfo* status = Lookup(key);
+    if (status != nullptr) {
+      last_key_ = key;
+      last_status_ = status;
+    }
+    return status;
+  }
+
+  // Looks up a tile without writing anything, so that several threads can read one object
+  EdgeStatusInfo* Lookup(const uint32_t key) const {
+    if (key == last_key_) {
+      return last_status_;
+    }
+    if (tile_count_ == 0) {
+      return nullptr;
+    }
+    const size_t mask = table_.size() - 1;
+    for (size_t i = Slot(key);; i = (i + 1) & mask) {
+      const Entry& entry = table_[i];
+      if (entry.key == key) {
+        return entry.status;
+      }
+      if (entry.status == nullptr) {
+        return nullptr;
+      }
+    }
+  }
+
+  EdgeStatusInfo* Insert(const uint32_t key, const uint32_t edge_count) {
+    // keep the load factor below 1/2 so probe sequences stay short
+    if ((tile_count_ + 1) * 2 > table_.size()) {
+      Rehash();
+    }
+    EdgeStatusInfo* status = Allocate(edge_count);
+    const size_t mask = table_.size() - 1;
+    size_t i = Slot(key);
+    while (table_[i].status != nullptr) {
+      i = (i + 1) & mask;
+    }
+    table_[i] = {key, status};
+    ++tile_count_;
+    last_key_ = key;
+    last_status_ = status;
+    return status;
+  }
+
+  void Rehash() {
+    std::vector<Entry> old(table_.empty() ? 64 : table_.size() * 2);
+    old.swap(table_);
+    table_bits_ = 0;
+    while ((size_t(1) << table_bits_) < table_.size()) {
+      ++table_bits_;
+    }
+    const size_t mask = table_.size() - 1;
+    for (const auto& entry : old) {
+      if (entry.status != nullptr) {
+        size_t i = Slot(entry.key);
+        while (table_[i].status != nullptr) {
+          i = (i + 1) & mask;
+        }
+        table_[i] = entry;
+      }
+    }
+  }
+
+  // Hands out a zeroed array of edge_count EdgeStatusInfo from the slabs
+  EdgeStatusInfo* Allocate(const uint32_t edge_count) {
+    // at least one status so that empty tiles still get a valid (non null) array
+    const size_t count = std::max<size_t>(edge_count, 1);
+    while (true) {
+      if (slab_index_ == slabs_.size()) {
+        slabs_.emplace_back(std::max(kSlabSize, count));
+      }
+      auto& slab = slabs_[slab_index_];
+      if (slab.size() - slab_offset_ >= count) {
+        EdgeStatusInfo* status = slab.data() + slab_offset_;
+        std::fill(status, status + count, EdgeStatusInfo());
+        slab_offset_ += count;
+        return status;
+      }
+      // this slab is too full, move to the next one
+      ++slab_index_;
+      slab_offset_ = 0;
+    }
+  }
+
+  // Open addressing table of tile keys (tile_value | path id) to their status arrays
+  std::vector<Entry> table_;
+  uint32_t table_bits_ = 0;
+  size_t tile_count_ = 0;
+
+  // The most recently found tile, consecutive lookups mostly stay in the same tile. Only the
+  // modifying methods update it, the const ones merely read it.
+  uint32_t last_key_ = kNoKey;
+  EdgeStatusInfo* last_status_ = nullptr;
+
+  // Slabs the per tile arrays are carved out of and the position of the next free status
+  std::vector<std::vector<EdgeStatusInfo>> slabs_;
+  size_t slab_index_ = 0;
+  size_t slab_offset_ = 0;
+  size_t reserved_slabs_;
 };
 
 } // namespace thor
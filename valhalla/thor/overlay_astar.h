@@ -0,0 +1,325 @@
+#pragma once
+
+#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/baldr/graphoverlay.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/options.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/sif/edgelabel.h>
+#include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/unidirectional_astar.h>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <cstdint>
+#include <future>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Edge based Dijkstra restricted to the highway edges of one overlay cell. Starts on an entry of
+ * the cell and runs until every exit of the cell, or a single target exit, is settled. Used to
+ * compute the clique weights of a cell and to unpack overlay hops into the edges they stand for.
+ */
+class CellSearch {
+public:
+  CellSearch() = default;
+
+  /**
+   * Runs the search from the end of the entry edge
+   * @param reader   graph reader
+   * @param costing  costing to search with
+   * @param cell     the cell the entry edge leads into
+   * @param entry    the entry edge, its cost is not included in the search
+   * @param target   stop once this exit is settled, search the whole cell if invalid
+   */
+  void Run(baldr::GraphReader& reader,
+           const sif::DynamicCost& costing,
+           const baldr::GraphOverlay::Cell& cell,
+           const baldr::GraphId& entry,
+           const baldr::GraphId& target = {});
+
+  /**
+   * Returns the label of an exit reached by the last search
+   * @param exit  the exit edge
+   * @return the label or nullptr if the exit was not reached
+   */
+  const sif::BDEdgeLabel* label(const baldr::GraphId& exit) const;
+
+  /**
+   * Returns the labels of the path from the entry to an exit reached by the last search, the
+   * entry is left out and the exit comes last
+   * @param exit  the exit edge
+   * @return the labels along the path
+   */
+  std::vector<const sif::BDEdgeLabel*> path(const baldr::GraphId& exit) const;
+
+private:
+  void Expand(baldr::GraphReader& reader,
+              const sif::DynamicCost& costing,
+              const baldr::GraphId& cell_tile,
+              const uint32_t pred_idx);
+
+  std::vector<sif::BDEdgeLabel> labels_;
+  EdgeStatus edgestatus_;
+  baldr::DoubleBucketQueue<sif::BDEdgeLabel> adjacencylist_;
+};
+
+/**
+ * Clique weights of a GraphOverlay customized for one set of costing options. For every cell there
+ * is a weight from each of its entries to each of its exits: the cost of turning off the entry,
+ * driving through the cell and traversing the exit.
+ */
+class OverlayMetric {
+public:
+  static constexpr float kUnreachable = std::numeric_limits<float>::max();
+
+  struct Weight {
+    sif::Cost cost{kUnreachable, kUnreachable};
+    uint32_t length = 0; // meters from the end of the entry to the end of the exit
+    bool reachable() const {
+      return cost.cost < kUnreachable;
+    }
+  };
+
+  /**
+   * Computes the clique weights of every cell of the overlay. Cells are independent so they are
+   * handed out to the threads one by one, every thread with its own graph reader and costing.
+   * @param overlay         the overlay
+   * @param mjolnir_config  config to create the graph readers from
+   * @param costing         the costing options to customize the overlay for
+   * @param concurrency     number of threads to customize with
+   */
+  OverlayMetric(std::shared_ptr<const baldr::GraphOverlay> overlay,
+                const boost::property_tree::ptree& mjolnir_config,
+                const Costing& costing,
+                const uint32_t concurrency);
+
+  /**
+   * Returns a fingerprint of the costing type and options, equal options have equal fingerprints
+   * @param costing  costing options
+   */
+  static uint64_t fingerprint(const Costing& costing);
+
+  /**
+   * Whether the metric was customized for exactly these costing options
+   * @param costing  costing options of a request
+   */
+  bool matches(const Costing& costing) const;
+
+  const baldr::GraphOverlay& overlay() const {
+    return *overlay_;
+  }
+
+  /**
+   * Returns the weights from an entry of a cell to all of its exits
+   * @param cell   the cell index
+   * @param entry  the entry index within the cell
+   * @return pointer to the weights, one per exit of the cell
+   */
+  const Weight* weights(const uint32_t cell, const uint32_t entry) const {
+    return weights_[cell].data() + entry * overlay_->cells()[cell].exits.size();
+  }
+
+protected:
+  std::shared_ptr<const baldr::GraphOverlay> overlay_;
+  std::string costing_;
+  std::vector<std::vector<Weight>> weights_;
+};
+
+/**
+ * Process wide cache of the metrics of one overlay, keyed by the fingerprint of the costing options
+ * they were customized for. Costing options that keep showing up in requests are customized in the
+ * background, once ready the routes with those options can use the overlay. The least recently
+ * used metrics are dropped when there are too many.
+ */
+class OverlayMetricCache {
+public:
+  /**
+   * Constructor
+   * @param overlay  the overlay to customize
+   * @param config   the full config, uses mjolnir and thor.overlay_astar
+   */
+  OverlayMetricCache(std::shared_ptr<const baldr::GraphOverlay> overlay,
+                     const boost::property_tree::ptree& config);
+
+  /**
+   * Returns the metric for the costing options, counts the request towards customizing them if
+   * there is none yet
+   * @param costing  costing options of a request
+   * @return the metric or nullptr if it is not (yet) available
+   */
+  std::shared_ptr<const OverlayMetric> get(const Costing& costing);
+
+  /**
+   * Starts customizing a metric for the costing options right away unless there is one already
+   * @param costing  costing options
+   */
+  void customize(const Costing& costing);
+
+  /**
+   * Blocks until every customization that was started is done
+   */
+  void wait();
+
+  /**
+   * Whether the overlay can be customized for the costing at all, only the drive modes use the
+   * highways the cells are made of
+   * @param costing_type  type of costing
+   */
+  static bool supports(const Costing::Type costing_type);
+
+protected:
+  using metric_future_t = std::shared_future<std::shared_ptr<const OverlayMetric>>;
+  struct CachedMetric {
+    metric_future_t metric;
+    uint64_t last_use;
+  };
+
+  // whether customizing a new metric is allowed, may evict another one. Expects mutex_ to be held
+  bool make_room();
+
+  // customizes a metric in the background. Expects mutex_ to be held
+  void start(const uint64_t fingerprint, const Costing& costing);
+
+  std::shared_ptr<const baldr::GraphOverlay> overlay_;
+  boost::property_tree::ptree mjolnir_config_;
+  uint32_t concurrency_;
+  uint32_t customize_after_;
+  uint32_t max_metrics_;
+
+  std::mutex mutex_;
+  uint64_t uses_ = 0;
+  std::unordered_map<uint64_t, CachedMetric> metrics_;
+  std::unordered_map<uint64_t, uint32_t> requests_; // requests seen per uncustomized fingerprint
+};
+
+/**
+ * Returns the process wide metric cache of the overlay written by the mjolnir overlay stage. The
+ * overlay is loaded and customized for the default auto costing the first time it is requested.
+ * @param config  the full config, mjolnir.overlay is the overlay file
+ * @return the cache or nullptr if the overlay could not be loaded
+ */
+std::shared_ptr<OverlayMetricCache> get_overlay_metric_cache(const boost::property_tree::ptree& config);
+
+/**
+ * Forward A* that uses the overlay for long routes. The cells are tiles of the highway level. The
+ * cells within reach of the lower levels around the origin and destination, that is within the
+ * largest expand_within_dist of their hierarchy limits, are expanded like UnidirectionalAStar
+ * does. Everywhere else the search hops straight from the entry of a cell to its exits using the
+ * clique weights, so only the highway level is used between the locations, just like the hierarchy
+ * limits do for long routes. Costing options that disable hierarchy pruning can not use the
+ * overlay. Hops are unpacked into the edges they stand for when the path is formed. If no path is
+ * found the route falls back to bidirectional A*.
+ *
+ * The clique weights are exact costs of the costing options the metric was customized for and
+ * cells with complex restrictions across their boundary are never hopped over, so the route is an
+ * optimal one on the graph the hierarchy limits leave, the same graph bidirectional A* searches.
+ * Like there, a cheaper route using the lower levels far away from both locations is not found.
+ */
+class OverlayAStar : public UnidirectionalAStar<ExpansionType::forward> {
+public:
+  /**
+   * Constructor.
+   * @param config A config object of key, value pairs
+   */
+  explicit OverlayAStar(const boost::property_tree::ptree& config = {});
+
+  /**
+   * Sets the metrics of the overlay to route on
+   * @param metrics  the metric cache, nullptr disables the algorithm
+   */
+  void set_metrics(std::shared_ptr<OverlayMetricCache> metrics) {
+    metrics_ = std::move(metrics);
+  }
+
+  /**
+   * Whether a route between the locations can use the overlay, that is the overlay is customized
+   * for the request's costing options and the locations are far enough apart to leave their cells.
+   * If so the metric is kept for the next call to GetBestPath. Requests with options the clique
+   * weights can not honor are left to the other algorithms: a date_time on the request or its
+   * locations, alternates and excluded edges, which is what exclude_locations and
+   * exclude_polygons become.
+   * @param origin       origin location
+   * @param destination  destination location
+   * @param options      request options
+   */
+  bool CanRoute(const valhalla::Location& origin,
+                const valhalla::Location& destination,
+                const Options& options);
+
+  /**
+   * Form the path like UnidirectionalAStar does, hopping over the cells where it can. Only call it
+   * once CanRoute accepted the request, the options are not checked again.
+   */
+  std::vector<std::vector<PathInfo>>
+  GetBestPath(valhalla::Location& origin,
+              valhalla::Location& dest,
+              baldr::GraphReader& graphreader,
+              const sif::mode_costing_t& mode_costing,
+              const sif::TravelMode mode,
+              const Options& options = Options::default_instance()) override;
+
+  void Clear() override;
+
+  const char* name() const override {
+    return "overlay_a*";
+  }
+
+protected:
+  /**
+   * Adds the exits of the cell the predecessor leads into to the adjacency list
+   * @param  graphreader  Graph tile reader.
+   * @param  pred         Predecessor edge label, an entry of the cell.
+   * @param  pred_idx     Predecessor index into the EdgeLabel list.
+   * @param  cell         Index of the cell.
+   */
+  void ExpandOverlay(baldr::GraphReader& graphreader,
+                     const sif::BDEdgeLabel& pred,
+                     const uint32_t pred_idx,
+                     const uint32_t cell);
+
+  /**
+   * Form the path from the edge labels, unpacking overlay hops into the edges of their cells
+   * @param   graphreader  Graph tile reader.
+   * @param   dest         Index in the edge labels of the destination edge.
+   * @return  Returns the path info from origin to destination
+   */
+  std::vector<PathInfo> FormOverlayPath(baldr::GraphReader& graphreader, const uint32_t dest);
+
+  /**
+   * Returns the overlay cell of a node, caching it per tile
+   * @param  node  the node
+   * @return the cell index, kInvalidIndex if the tile is no cell or a sentinel for the tiles
+   *         around the locations that are expanded edge by edge
+   */
+  uint32_t GetCell(const baldr::GraphId& node);
+
+  // Routes shorter than this stay in regular expansion around the locations anyway
+  float min_distance_;
+
+  std::shared_ptr<OverlayMetricCache> metrics_;
+  std::shared_ptr<const OverlayMetric> metric_;
+
+  // Cells expanded edge by edge (those around the origin and destination)
+  std::unordered_set<uint64_t> regular_cells_;
+
+  // Overlay cell of each tile seen so far, see GetCell
+  std::unordered_map<uint32_t, uint32_t> tile_cells_;
+
+  // Labels reached by an overlay hop and the predecessor they hopped from
+  std::unordered_map<uint32_t, uint32_t> overlay_hops_;
+
+  CellSearch cell_search_;
+};
+
+} // namespace thor
+} // namespace valhalla
@@ -1,6 +1,5 @@
 #pragma once
 #include <valhalla/baldr/directededge.h>
-#include <valhalla/loki/search.h>
 #include <valhalla/thor/dijkstras.h>
 
 #include <ankerl/unordered_dense.h>
@@ -11,7 +10,7 @@ constexpr uint8_t kInbound = 1;
 constexpr uint8_t kOutbound = 2;
 
 namespace valhalla {
-namespace loki {
+namespace thor {
 
 // NOTE: another approach is possible which would still allow for one-at-a-time look up. In this case
 // we could actually keep the tree from the previous expansion and as soon as the tree from the next
@@ -104,5 +103,5 @@ protected:
   size_t transitions_{};
 };
 
-} // namespace loki
+} // namespace thor
 } // namespace valhalla
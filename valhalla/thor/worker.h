@@ -14,10 +14,12 @@
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/astar_bss.h>
 #include <valhalla/thor/bidirectional_astar.h>
+#include <valhalla/thor/bucketmatrix.h>
 #include <valhalla/thor/centroid.h>
 #include <valhalla/thor/costmatrix.h>
 #include <valhalla/thor/isochrone.h>
 #include <valhalla/thor/multimodal.h>
+#include <valhalla/thor/overlay_astar.h>
 #include <valhalla/thor/timedistancebssmatrix.h>
 #include <valhalla/thor/timedistancematrix.h>
 #include <valhalla/thor/triplegbuilder.h>
@@ -27,6 +29,8 @@
 
 #include <boost/property_tree/ptree.hpp>
 
+#include <atomic>
+#include <memory>
 #include <tuple>
 #include <vector>
 
@@ -39,7 +43,12 @@ void run_service(const boost::property_tree::ptree& config);
 
 class thor_worker_t : public service_worker_t {
 public:
-  enum SOURCE_TO_TARGET_ALGORITHM { SELECT_OPTIMAL = 0, COST_MATRIX = 1, TIME_DISTANCE_MATRIX = 2 };
+  enum SOURCE_TO_TARGET_ALGORITHM {
+    SELECT_OPTIMAL = 0,
+    COST_MATRIX = 1,
+    TIME_DISTANCE_MATRIX = 2,
+    BUCKET_MATRIX = 3
+  };
   thor_worker_t(const boost::property_tree::ptree& config,
                 const std::shared_ptr<baldr::GraphReader>& graph_reader = {});
   virtual ~thor_worker_t();
@@ -53,6 +62,7 @@ public:
   static void adjust_scores(valhalla::Options& options);
 
   void route(Api& request);
+  void batch_route(Api& request);
   std::string matrix(Api& request);
   void optimized_route(Api& request);
   std::string isochrones(Api& request);
@@ -87,6 +97,20 @@ protected:
    */
   std::vector<std::tuple<float, float, std::vector<meili::MatchResult>>> map_match(Api& request);
 
+  /**
+   * Routes the pairs of sources and targets of a batch, taking the index of the next pair to route
+   * from next_pair until there are none left. This is how the workers of a batch share its pairs.
+   * @param options    the options of the batch request
+   * @param routes     one route per pair, filled out with the path or the reason there was none
+   * @param next_pair  the index of the next pair that no worker is routing yet
+   * @param info       collects the warnings of the pairs
+   * @param cancelled  once set no further pairs are started
+   */
+  void route_pairs(const Options& options,
+                   google::protobuf::RepeatedPtrField<TripRoute>& routes,
+                   std::atomic<int>& next_pair,
+                   Info& info,
+                   const std::atomic<bool>& cancelled);
   void path_arrive_by(Api& api, const std::string& costing);
   void path_depart_at(Api& api, const std::string& costing);
   void parse_measurements(const Api& request);
@@ -117,9 +141,11 @@ protected:
   MultiModalPathAlgorithm multi_modal_astar;
   TimeDepForward timedep_forward;
   TimeDepReverse timedep_reverse;
+  OverlayAStar overlay_astar;
 
   // Time distance matrix
   CostMatrix costmatrix_;
+  BucketMatrix bucketmatrix_;
   TimeDistanceMatrix time_distance_matrix_;
   TimeDistanceBSSMatrix time_distance_bss_matrix_;
 
@@ -130,10 +156,17 @@ protected:
   SOURCE_TO_TARGET_ALGORITHM source_to_target_algorithm;
   bool costmatrix_allow_second_pass;
   std::shared_ptr<baldr::GraphReader> reader;
+  // The other threads of the cost matrix each read tiles with one of these
+  std::vector<std::shared_ptr<baldr::GraphReader>> costmatrix_readers;
   meili::MapMatcherFactory matcher_factory;
   baldr::AttributesController controller;
   Centroid centroid_gen;
 
+  // Batch routes use this many threads, the extra ones each with a worker of their own
+  uint32_t batch_concurrency;
+  boost::property_tree::ptree batch_config;
+  std::vector<std::unique_ptr<thor_worker_t>> batch_workers;
+
   // Hierarchy limits
   bool allow_hierarchy_limits_modifications;
   // ignored if allow_hierarchy_limits_modifications is false
@@ -6,13 +6,20 @@
 
 #include <boost/property_tree/ptree.hpp>
 
+#include <functional>
 #include <memory>
+#include <string>
 
 namespace valhalla {
 namespace tyr {
 
 class actor_t {
 public:
+  /**
+   * The services an action runs through, in this order
+   */
+  enum class stage_t { loki, thor, odin };
+
   /**
    * Constructor
    * @param config         used to configure loki/thor/odin workers and their graphreaders
@@ -45,6 +52,21 @@ public:
    */
   std::string act(Api& api, const std::function<void()>* interrupt = nullptr);
 
+  /**
+   * Runs every stage of the action of a request which was already parsed and validated, the
+   * actions below do the same once they parsed their request. The request is handed from one stage
+   * to the next by reference
+   * @param api        the parsed request, filled out as the stages run
+   * @param interrupt  allows the underlying computation to be aborted via the functor throwing
+   * @return json or pbf bytes depending on what was specified in the options object
+   */
+  std::string dispatch(Api& api, const std::function<void()>* interrupt = nullptr);
+
+  /**
+   * @return the stage the last action was in when it returned or threw
+   */
+  stage_t stage() const;
+
   /**
    * Perform the route action and return json or protobuf depending on which was requested. The
    * request may either be in the form of a json string provided by the request_str parameter or
@@ -199,6 +221,22 @@ public:
                        const std::function<void()>* interrupt = nullptr,
                        Api* api = nullptr);
 
+  /**
+   * Perform the batch route action and return json or protobuf depending on which was requested.
+   * Every source is routed to the target at the same index, the locations are all correlated at
+   * once and the costing is only set up once for all of them. The request may either be in the
+   * form of a json string provided by the request_str parameter or contained in the api parameter
+   * as a deserialized protobuf object
+   * @param request_str  json string if json input is being used empty otherwise
+   * @param interrupt    allows the underlying computation to be aborted via the functor throwing
+   * @param api          protobuffer object which can contain the input request via the options object
+   *                     and will be filled out as the request is processed
+   * @return json or pbf bytes depending on what was specified in the options object
+   */
+  std::string batch_route(const std::string& request_str,
+                          const std::function<void()>* interrupt = nullptr,
+                          Api* api = nullptr);
+
   /**
    * Perform the status action and return json or protobuf depending on which was requested. The
    * request may either be in the form of a json string provided by the request_str parameter or
@@ -0,0 +1,72 @@
+#ifndef VALHALLA_TYR_PIPELINE_WORKER_H_
+#define VALHALLA_TYR_PIPELINE_WORKER_H_
+
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/api.pb.h>
+#include <valhalla/tyr/actor.h>
+#include <valhalla/worker.h>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <memory>
+#include <string>
+#include <unordered_set>
+
+namespace valhalla {
+namespace tyr {
+
+#ifdef ENABLE_SERVICES
+/**
+ * Runs a worker which takes requests straight from the http server proxy and answers them on its
+ * own, instead of the loki, thor and odin workers passing them along the proxies between them
+ * @param config  the config, uses the loki proxy as the upstream endpoint
+ */
+void run_service(const boost::property_tree::ptree& config);
+#endif
+
+/**
+ * A worker that runs all stages of a request, loki then thor then odin, on the same thread. The
+ * request is handed from one stage to the next by reference so it is never serialized between
+ * them, which saves the protobuf round trips and socket hops of the proxy topology on a single
+ * machine. The stages are run by an actor_t, on top of it the worker only serves the actions loki
+ * is configured to and answers like the service workers do.
+ */
+class pipeline_worker_t : public service_worker_t {
+public:
+  pipeline_worker_t(const boost::property_tree::ptree& config,
+                    const std::shared_ptr<baldr::GraphReader>& graph_reader = {});
+  virtual ~pipeline_worker_t();
+#ifdef ENABLE_SERVICES
+  virtual prime_server::worker_t::result_t work(const std::list<zmq::message_t>& job,
+                                                void* request_info,
+                                                const std::function<void()>& interrupt) override;
+#endif
+  virtual void cleanup() override;
+
+  /**
+   * Runs every stage of the action of a parsed request
+   * @param request  the parsed request, filled out as the stages run
+   * @return the serialized response
+   */
+  std::string act(Api& request);
+
+protected:
+  // code for unexpected errors of the stage the last request was in, the same as its own worker
+  // would use
+  unsigned unknown_error_code() const;
+
+  std::shared_ptr<baldr::GraphReader> reader;
+  actor_t actor;
+  std::unordered_set<Options::Action> actions;
+  std::string action_str;
+
+private:
+  std::string service_name() const override {
+    return "pipeline";
+  }
+};
+
+} // namespace tyr
+} // namespace valhalla
+
+#endif // VALHALLA_TYR_PIPELINE_WORKER_H_
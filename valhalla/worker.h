@@ -14,6 +14,9 @@
 #include <boost/property_tree/ptree.hpp>
 
 namespace valhalla {
+namespace baldr {
+class GraphReader;
+}
 
 struct hierarchy_limits_config_t {
   std::vector<HierarchyLimits> max_limits;
@@ -194,6 +197,15 @@ protected:
    */
   midgard::Finally<std::function<void()>> measure_scope_time(Api& api) const;
 
+  /**
+   * Adds how many shapes the reader found in and had to add to the shape cache since the last
+   * request as stats of this one, if it has a shape cache
+   *
+   * @param api     The request object where we store the stats
+   * @param reader  The graph reader the request used
+   */
+  void record_shape_cache_stats(Api& api, baldr::GraphReader& reader) const;
+
   /**
    * Signals the start of the worker, sends statsd message if so configured
    */